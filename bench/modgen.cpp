@@ -0,0 +1,294 @@
+//
+//	modgen.cpp | Finn Le Var
+//
+//	generates synthetic modules for the benchmark suite, see bench::suite()
+//
+//	modgen <dir> <modules> [functions] [exports] [hooks]
+//
+//	- functions is how many filler functions each module has, for its code size
+//	- exports is how many extra functions each module exports, for its symbol table
+//	- hooks is a comma separated list of update, fixed_update, input, and reload
+//
+//	writes synth_0000.cpp and so on, plus synth_reload.cpp, which is built twice with different
+//	values of SYNTH_VARIANT so that the suite has two builds of it to swap between, and which
+//	also subscribes to an event channel, keeps a state block, and allocates through the engine,
+//	so that reloading it over and over shows up anything that a reload fails to give back
+//
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+//
+// static vars
+//
+namespace
+{
+	//
+	// everything a module is generated from
+	//
+	struct config_t
+	{
+		size_t functions	= 64;
+		size_t exports		= 8;
+		bool   update		= true;
+		bool   fixed_update = false;
+		bool   input		= false;
+		bool   reload		= false;
+	};
+
+	//
+	// writes a module's source, named _name, _seed makes each module's code different so
+	// that nothing can be folded together across them
+	//
+	std::string generate(const std::string& _name, uint64_t _seed, const config_t& _config, bool _variant)
+	{
+		std::ostringstream out;
+
+		out << "//\n//\t" << _name << ".cpp | generated by modgen, dont edit\n//\n";
+		out << "#define HOT_MOD \"" << _name << "\"\n\n";
+		out << "#include \"shared/context.h\"\n";
+		out << "#include \"shared/macros.h\"\n";
+		out << "#include \"shared/print.h\"\n";
+		out << "#include \"shared/subsystem.h\"\n";
+
+		if (_variant)
+		{
+			out << "#include \"shared/events.h\"\n";
+			out << "#include \"shared/state.h\"\n";
+			out << "#include \"shared/alloc.h\"\n";
+		}
+
+		out << "\n";
+
+		if (_variant)
+			out << "#ifndef SYNTH_VARIANT\n#define SYNTH_VARIANT 0\n#endif\n\n";
+
+		out << "namespace\n{\n";
+		out << "\t// what our hooks write to so that they can't be optimised away\n";
+		out << "\tvolatile uint64_t g_sink = 0;\n\n";
+
+		// a bit of everything the engine has to clean up after
+		if (_variant)
+		{
+			out << "\tmodule_context_t* g_mod = nullptr;\n\n";
+			out << "\tstruct synth_event_t { uint64_t frame; };\n";
+			out << "\tstruct synth_state_t { uint64_t loads; uint64_t updates; };\n\n";
+			out << "\tchannel_t<synth_event_t> g_channel;\n";
+			out << "\tuint64_t g_sub = 0;\n";
+			out << "\tsynth_state_t* g_state = nullptr;\n";
+			out << "\tvoid* g_block = nullptr;\n\n";
+			out << "\tvoid on_events(const synth_event_t* _events, size_t _count)\n\t{\n";
+			out << "\t\tif (_count)\n\t\t\tg_sink = g_sink + _events[_count - 1].frame;\n\t}\n\n";
+		}
+
+		// the filler, each one does something slightly different so that none of them are merged
+		for (size_t i = 0; i < _config.functions; ++i)
+		{
+			uint64_t constant = (_seed * 0x9e3779b97f4a7c15ull) ^ (i * 0xbf58476d1ce4e5b9ull);
+
+			out << "\tuint64_t fill_" << i << "(uint64_t _x)\n\t{\n";
+			out << "\t\tfor (uint64_t i = 0; i < (_x & 7); ++i)\n";
+			out << "\t\t\t_x = (_x ^ (_x >> " << 7 + i % 23 << ")) * " << (constant | 1) << "ull;\n\n";
+			out << "\t\treturn _x + " << i << (_variant ? " + SYNTH_VARIANT" : "") << ";\n\t}\n\n";
+		}
+
+		out << "\tusing fill_fn_t = uint64_t(*)(uint64_t);\n\n";
+		out << "\tconst fill_fn_t g_fill[] =\n\t{\n";
+
+		for (size_t i = 0; i < _config.functions; ++i)
+			out << "\t\t&fill_" << i << ",\n";
+
+		if (_config.functions == 0)
+			out << "\t\tnullptr,\n";
+
+		out << "\t};\n}\n\n";
+
+		// calls a filler function, so that the table, and everything in it, is kept
+		out << "HOT_EXPORT uint64_t synth_fill(uint64_t _index, uint64_t _x)\n{\n";
+		out << "\treturn " << (_config.functions ? "g_fill[_index % (sizeof(g_fill) / sizeof(g_fill[0]))](_x)" : "_x") << ";\n}\n\n";
+
+		for (size_t i = 0; i < _config.exports; ++i)
+			out << "HOT_EXPORT uint64_t synth_export_" << i << "(uint64_t _x) { return synth_fill(" << i << ", _x); }\n";
+
+		out << "\n";
+
+		// so that the two builds of the reload module always differ
+		if (_variant)
+			out << "HOT_EXPORT uint64_t synth_variant() { return SYNTH_VARIANT; }\n\n";
+
+		// what the suite calls into us for
+		out << "HOT_EXPORT uint64_t synth_bench_lookup(uint64_t _count)\n{\n";
+		out << "\tuint64_t sum = 0;\n\n";
+		out << "\tfor (uint64_t i = 0; i < _count; ++i)\n";
+		out << "\t\tsum += RECAST(uintptr_t, g_subsystem.get_raw(CASTTO(subsystem_type_t, 1 + i % (SUB_COUNT - 1))));\n\n";
+		out << "\treturn sum;\n}\n\n";
+
+		out << "HOT_EXPORT void synth_bench_log(uint64_t _count)\n{\n";
+		out << "\tfor (uint64_t i = 0; i < _count; ++i)\n";
+		out << "\t\tprintmsg(\"synthetic print \" << i << \" of \" << _count);\n}\n\n";
+
+		out << "bool MOD_INIT_FN(engine_context_t* _ctx)\n{\n\tg_subsystem.init(_ctx);\n\n";
+
+		if (_variant)
+		{
+			out << "\thot_alloc::init(g_subsystem.find<SUB_ALLOC>(), g_mod);\n\n";
+			out << "\tif (g_channel.open(g_subsystem.find<SUB_DISPATCHER>(), \"synth.reload\"))\n";
+			out << "\t\tg_sub = g_channel.subscribe<&on_events>(g_mod);\n\n";
+			out << "\tg_state = acquire_state<synth_state_t>(g_subsystem.find<SUB_STATE>(), g_mod, \"synth_reload\", 1);\n\n";
+			out << "\tif (g_state)\n\t\tg_state->loads++;\n\n";
+			out << "\tg_block = hot_alloc::allocate(4096 * SYNTH_VARIANT);\n\n";
+		}
+
+		out << "\treturn _ctx != nullptr;\n}\n\n";
+
+		out << "bool MOD_UNLOAD_FN()\n{\n";
+
+		if (_variant)
+		{
+			out << "\tg_channel.unsubscribe(g_sub);\n";
+			out << "\tg_channel.close();\n\n";
+			out << "\thot_alloc::deallocate(g_block);\n\n";
+			out << "\tg_block = nullptr;\n";
+			out << "\tg_state = nullptr;\n\n";
+		}
+
+		out << "\tg_subsystem.cleanup();\n\n\treturn true;\n}\n\n";
+
+		if (_config.update && _variant)
+			out << "void MOD_UPDATE_FN(float, uint64_t _frame)\n{\n\tg_sink = g_sink + _frame;\n\n\tg_channel.publish({ _frame });\n\n\tif (g_state)\n\t\tg_state->updates++;\n}\n\n";
+		else if (_config.update)
+			out << "void MOD_UPDATE_FN(float, uint64_t _frame)\n{\n\tg_sink = g_sink + _frame;\n}\n\n";
+
+		if (_config.fixed_update)
+			out << "void MOD_FIXED_FN(float, uint64_t _step)\n{\n\tg_sink = g_sink ^ _step;\n}\n\n";
+
+		if (_config.input)
+			out << "void MOD_INPUT_FN()\n{\n\tg_sink = g_sink + 1;\n}\n\n";
+
+		if (_config.reload)
+			out << "void MOD_RELOAD_FN()\n{\n\tg_sink = 0;\n}\n\n";
+
+		out << "HOT_EXPORT void MOD_LOAD_FN(module_context_t* _mod)\n{\n";
+		out << "\tif (!_mod)\n\t\treturn;\n\n";
+
+		if (_variant)
+			out << "\tg_mod = _mod;\n\n";
+		out << "\t_mod->name   = HOT_MOD;\n";
+		out << "\t_mod->author = \"modgen\";\n";
+		out << "\t_mod->desc   = \"synthetic module\";\n\n";
+		out << "\t_mod->CTX_INIT_FN   = &MOD_INIT_FN;\n";
+		out << "\t_mod->CTX_UNLOAD_FN = &MOD_UNLOAD_FN;\n";
+
+		if (_config.update)
+			out << "\t_mod->CTX_UPDATE_FN = &MOD_UPDATE_FN;\n";
+
+		if (_config.fixed_update)
+			out << "\t_mod->CTX_FIXED_FN = &MOD_FIXED_FN;\n";
+
+		if (_config.input)
+			out << "\t_mod->CTX_INPUT_FN = &MOD_INPUT_FN;\n";
+
+		if (_config.reload)
+			out << "\t_mod->CTX_RELOAD_FN = &MOD_RELOAD_FN;\n";
+
+		out << "\n\t_mod->loaded = true;\n}\n";
+
+		return out.str();
+	}
+
+	//
+	// writes the given source to the given path, leaving it alone if it hasn't changed so that
+	// it isn't rebuilt for nothing
+	//
+	bool write(const std::filesystem::path& _path, const std::string& _source)
+	{
+		{
+			std::ifstream in(_path, std::ios::binary);
+
+			if (in)
+			{
+				std::ostringstream existing;
+				existing << in.rdbuf();
+
+				if (existing.str() == _source)
+					return true;
+			}
+		}
+
+		std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+
+		out << _source;
+
+		return out.good();
+	}
+}
+
+//
+// main entry point
+//
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage : modgen <dir> <modules> [functions] [exports] [hooks]\n";
+		return 1;
+	}
+
+	std::filesystem::path dir	  = argv[1];
+	size_t				  modules = std::stoull(argv[2]);
+
+	config_t config;
+
+	if (argc > 3)
+		config.functions = std::stoull(argv[3]);
+
+	if (argc > 4)
+		config.exports = std::stoull(argv[4]);
+
+	if (argc > 5)
+	{
+		std::string hooks = std::string(",") + argv[5] + ",";
+
+		config.update		= hooks.find(",update,") != std::string::npos;
+		config.fixed_update = hooks.find(",fixed_update,") != std::string::npos;
+		config.input		= hooks.find(",input,") != std::string::npos;
+		config.reload		= hooks.find(",reload,") != std::string::npos;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+
+	if (ec)
+	{
+		std::cerr << "[error] modgen | couldn't create '" << dir.string() << "' : " << ec.message() << "\n";
+		return 1;
+	}
+
+	for (size_t i = 0; i < modules; ++i)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "synth_%04zu", i);
+
+		if (!write(dir / (std::string(name) + ".cpp"), generate(name, i + 1, config, false)))
+		{
+			std::cerr << "[error] modgen | failed to write '" << name << ".cpp'\n";
+			return 1;
+		}
+	}
+
+	if (!write(dir / "synth_reload.cpp", generate("synth_reload", 0, config, true)))
+	{
+		std::cerr << "[error] modgen | failed to write 'synth_reload.cpp'\n";
+		return 1;
+	}
+
+	std::cout << "[hot] modgen | generated " << modules << " module(s) with " << config.functions << " function(s) and "
+		<< config.exports << " export(s) each in '" << dir.string() << "'\n";
+
+	return 0;
+}
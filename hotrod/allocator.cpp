@@ -0,0 +1,433 @@
+//
+//	allocator.cpp | Finn Le Var
+//
+#include "allocator.h"
+
+#include <new>
+#include <array>
+#include <algorithm>
+
+//
+// static vars
+//
+namespace
+{
+	// the size of each class's blocks, header included, all multiples of 16 so everything stays aligned
+	constexpr uint32_t g_class_sizes[ALLOC_CLASS_COUNT] =
+	{
+		32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768, 1024, 1280, 1536, 2048, 2560, 3072, 4096,
+	};
+
+	// the class for every size in steps of 16, so finding one is a single lookup
+	constexpr auto g_class_lookup = []()
+	{
+		std::array<uint8_t, ALLOC_MAX_SMALL / 16 + 1> lookup = {};
+
+		for (size_t i = 0, c = 0; i < lookup.size(); ++i)
+		{
+			while (g_class_sizes[c] < i * 16)
+				c++;
+
+			lookup[i] = CASTTO(uint8_t, c);
+		}
+
+		return lookup;
+	}();
+
+	constexpr size_t g_header = sizeof(alloc_header_t);
+
+	static_assert(g_header == 16, "allocation headers must keep blocks 16 byte aligned");
+}
+
+//
+// a thread's cache of free blocks, given back to the shared lists when the thread exits
+//
+struct alloc_cache_t
+{
+	pool_allocator_t::free_block_t* heads[ALLOC_CLASS_COUNT]  = {};
+	uint32_t						counts[ALLOC_CLASS_COUNT] = {};
+
+	// the shard of every module's stats that we count into, and whether we're the only one using it
+	uint32_t shard	   = UINT32_MAX;
+	bool	 exclusive = false;
+
+	// the last module we counted for, and its stats, since it's usually the same one over and over
+	uint32_t	   last_module = UINT32_MAX;
+	alloc_stats_t* last_stats  = nullptr;
+
+	~alloc_cache_t()
+	{
+		for (uint16_t c = 0; c < ALLOC_CLASS_COUNT; ++c)
+			g_allocator.drain(c, heads[c], counts[c], 0);
+
+		if (exclusive)
+			g_allocator.give_shard(shard);
+	}
+};
+
+namespace
+{
+	thread_local alloc_cache_t t_cache;
+}
+
+//
+// frees our slabs and stats
+//
+pool_allocator_t::~pool_allocator_t()
+{
+	for (auto slab : m_slabs)
+		::operator delete(slab, std::align_val_t(64));
+
+	for (auto& page : m_stats)
+		delete[] page.load();
+}
+
+//
+// allocates for the given module
+//
+void* pool_allocator_t::alloc(uint32_t _module, size_t _size, size_t _align)
+{
+	if (_align == 0 || (_align & (_align - 1)) != 0)
+		printerret(nullptr, "alignment " << _align << " isn't a power of two");
+
+	std::byte* user = nullptr;
+	uint16_t   cls	= ALLOC_CLASS_LARGE;
+	size_t	   offset = 0;
+
+	// most things fit in a size class, and come out of our cache without a lock
+	if (_align <= g_header && _size + g_header <= ALLOC_MAX_SMALL)
+	{
+		cls = size_class(_size + g_header);
+
+		free_block_t*& head	 = t_cache.heads[cls];
+		uint32_t&	   count = t_cache.counts[cls];
+
+		if (!head)
+			refill(cls, head, count);
+
+		if (!head)
+			return nullptr;
+
+		free_block_t* block = head;
+
+		head = block->next;
+		count--;
+
+		user = RECAST(std::byte*, block) + g_header;
+	}
+	else
+	{
+		// leave room to align, and for the header before it
+		_align = std::max(_align, g_header);
+
+		if (_align > UINT16_MAX / 2)
+			printerret(nullptr, "alignment " << _align << " is too big");
+
+		auto raw = CASTTO(std::byte*, ::operator new(_size + _align + g_header, std::nothrow));
+
+		if (!raw)
+			return nullptr;
+
+		auto addr = RECAST(uintptr_t, raw + g_header);
+
+		user   = raw + g_header + ((_align - addr % _align) % _align);
+		offset = user - g_header - raw;
+	}
+
+	*RECAST(alloc_header_t*, user - g_header) = { .module = _module, .size_class = cls, .offset = CASTTO(uint16_t, offset), .size = _size };
+
+	count(_module, CASTTO(int64_t, _size), 1);
+
+	return user;
+}
+
+//
+// frees something from alloc()
+//
+void pool_allocator_t::free(void* _ptr)
+{
+	if (!_ptr)
+		return;
+
+	auto head = RECAST(alloc_header_t*, CASTTO(std::byte*, _ptr) - g_header);
+
+	if (head->size_class == ALLOC_CLASS_LOCAL)
+		printerret(;, "can't free an allocation a module made itself, it has to free it");
+
+	count(head->module, -CASTTO(int64_t, head->size), -1);
+
+	if (head->size_class == ALLOC_CLASS_LARGE)
+	{
+		::operator delete(RECAST(std::byte*, head) - head->offset);
+		return;
+	}
+
+	if (head->size_class >= ALLOC_CLASS_COUNT)
+		printerret(;, "freeing something that isn't ours, or has already been freed");
+
+	uint16_t cls = head->size_class;
+
+	auto block = RECAST(free_block_t*, head);
+
+	block->next			 = t_cache.heads[cls];
+	t_cache.heads[cls]	 = block;
+	t_cache.counts[cls] += 1;
+
+	// dont let one thread sit on everything, say a consumer freeing what a producer allocated
+	if (t_cache.counts[cls] > ALLOC_BATCH * 2)
+		drain(cls, t_cache.heads[cls], t_cache.counts[cls], ALLOC_BATCH);
+}
+
+//
+// counts an allocation against another module
+//
+void pool_allocator_t::transfer(void* _ptr, uint32_t _module)
+{
+	if (!_ptr)
+		return;
+
+	auto head = RECAST(alloc_header_t*, CASTTO(std::byte*, _ptr) - g_header);
+
+	if (head->size_class == ALLOC_CLASS_LOCAL)
+		printerret(;, "can't transfer an allocation a module made itself");
+
+	if (head->module == _module)
+		return;
+
+	count(head->module, -CASTTO(int64_t, head->size), -1);
+	count(_module, CASTTO(int64_t, head->size), 1);
+
+	head->module = _module;
+}
+
+//
+// gets the given module's stats
+//
+alloc_stats_t& pool_allocator_t::stats(uint32_t _module)
+{
+	// ids wrap around our table, after a million or so builds stats start being shared
+	size_t index = _module % (ALLOC_STATS_PAGE * ALLOC_STATS_PAGES);
+
+	std::atomic<alloc_stats_t*>& slot = m_stats[index / ALLOC_STATS_PAGE];
+
+	alloc_stats_t* page = slot.load(std::memory_order_acquire);
+
+	if (!page)
+	{
+		LGUARD(m_stats_mutex);
+
+		page = slot.load(std::memory_order_acquire);
+
+		if (!page)
+		{
+			page = new alloc_stats_t[ALLOC_STATS_PAGE];
+			slot.store(page, std::memory_order_release);
+		}
+	}
+
+	return page[index % ALLOC_STATS_PAGE];
+}
+
+//
+// reports anything the given module still has allocated
+//
+size_t pool_allocator_t::report(uint32_t _module, const std::string& _name)
+{
+	alloc_stats_t& s = stats(_module);
+
+	int64_t bytes = s.live_bytes();
+	int64_t count = s.live_count();
+
+	if (count <= 0)
+		return 0;
+
+	m_leaks.fetch_add(1, std::memory_order_relaxed);
+
+	printerror("module '" << _name << "' (" << _module << ") was unloaded with " << bytes << " byte(s) in " << count << " allocation(s) still live");
+
+	return CASTTO(size_t, bytes);
+}
+
+//
+// prints what every module has allocated
+//
+void pool_allocator_t::dump()
+{
+	printdebug("allocator : " << m_slabs.size() << " slab(s) of " << ALLOC_SLAB_SIZE << " byte(s), " << m_leaks.load() << " leak(s) reported");
+
+	for (size_t p = 0; p < ALLOC_STATS_PAGES; ++p)
+	{
+		alloc_stats_t* page = m_stats[p].load(std::memory_order_acquire);
+
+		if (!page)
+			continue;
+
+		for (size_t i = 0; i < ALLOC_STATS_PAGE; ++i)
+		{
+			alloc_stats_t& s = page[i];
+
+			if (s.total_count() == 0)
+				continue;
+
+			printdebug("+    module " << p * ALLOC_STATS_PAGE + i << " : " << s.live_bytes() << " byte(s) in " << s.live_count() << " live allocation(s), "
+				<< s.total_count() << " allocation(s) in total");
+		}
+	}
+}
+
+//
+// gets the size class for the given size
+//
+uint16_t pool_allocator_t::size_class(size_t _size)
+{
+	return g_class_lookup[(_size + 15) / 16];
+}
+
+//
+// takes a batch of blocks from a class's shared list
+//
+void pool_allocator_t::refill(uint16_t _class, free_block_t*& _head, uint32_t& _count)
+{
+	class_t& cls = m_classes[_class];
+
+	LGUARD(cls.mutex);
+
+	// nothing to share, so carve up a new slab
+	if (!cls.head)
+	{
+		const size_t block = g_class_sizes[_class];
+		const size_t count = ALLOC_SLAB_SIZE / block;
+
+		auto slab = CASTTO(std::byte*, ::operator new(ALLOC_SLAB_SIZE, std::align_val_t(64), std::nothrow));
+
+		if (!slab)
+			return;
+
+		{
+			LGUARD(m_slab_mutex);
+			m_slabs.push_back(slab);
+		}
+
+		// link them up in address order, so that a batch is contiguous
+		for (size_t i = count; i-- > 0;)
+		{
+			auto free = RECAST(free_block_t*, slab + i * block);
+
+			free->next = cls.head;
+			cls.head   = free;
+		}
+
+		cls.count += count;
+	}
+
+	for (uint32_t i = 0; i < ALLOC_BATCH && cls.head; ++i)
+	{
+		free_block_t* free = cls.head;
+
+		cls.head = free->next;
+		cls.count--;
+
+		free->next = _head;
+		_head	   = free;
+		_count++;
+	}
+}
+
+//
+// gives a batch of blocks back to a class's shared list
+//
+void pool_allocator_t::drain(uint16_t _class, free_block_t*& _head, uint32_t& _count, uint32_t _keep)
+{
+	if (_count <= _keep)
+		return;
+
+	// unlink what we're giving back before taking the lock
+	free_block_t* first = _head;
+	free_block_t* last	= _head;
+
+	uint32_t giving = _count - _keep;
+
+	for (uint32_t i = 1; i < giving; ++i)
+		last = last->next;
+
+	_head	= last->next;
+	_count -= giving;
+
+	class_t& cls = m_classes[_class];
+
+	LGUARD(cls.mutex);
+
+	last->next = cls.head;
+	cls.head   = first;
+	cls.count += giving;
+}
+
+//
+// records allocations or frees against a module
+//
+void pool_allocator_t::count(uint32_t _module, int64_t _bytes, int64_t _count)
+{
+	alloc_cache_t& cache = t_cache;
+
+	if (cache.shard == UINT32_MAX)
+	{
+		cache.shard		= take_shard();
+		cache.exclusive = cache.shard < ALLOC_STAT_SHARDS - 1;
+	}
+
+	if (cache.last_module != _module)
+	{
+		cache.last_module = _module;
+		cache.last_stats  = &stats(_module);
+	}
+
+	alloc_shard_t& shard = cache.last_stats->shards[cache.shard];
+
+	const uint64_t total = _count > 0 ? _count : 0;
+
+	// nobody else writes to our shard, so there's no need for an atomic add
+	if (cache.exclusive)
+	{
+		shard.bytes.store(shard.bytes.load(std::memory_order_relaxed) + _bytes, std::memory_order_release);
+		shard.count.store(shard.count.load(std::memory_order_relaxed) + _count, std::memory_order_release);
+		shard.total.store(shard.total.load(std::memory_order_relaxed) + total, std::memory_order_release);
+	}
+	else
+	{
+		shard.bytes.fetch_add(_bytes, std::memory_order_acq_rel);
+		shard.count.fetch_add(_count, std::memory_order_acq_rel);
+		shard.total.fetch_add(total, std::memory_order_acq_rel);
+	}
+}
+
+//
+// gets a shard for a thread to call its own
+//
+uint32_t pool_allocator_t::take_shard()
+{
+	LGUARD(m_stats_mutex);
+
+	if (!m_free_shards.empty())
+	{
+		uint32_t shard = m_free_shards.back();
+		m_free_shards.pop_back();
+
+		return shard;
+	}
+
+	// the last one is shared
+	if (m_next_shard < ALLOC_STAT_SHARDS - 1)
+		return m_next_shard++;
+
+	return ALLOC_STAT_SHARDS - 1;
+}
+
+//
+// gives a thread's shard back
+//
+void pool_allocator_t::give_shard(uint32_t _shard)
+{
+	LGUARD(m_stats_mutex);
+
+	m_free_shards.push_back(_shard);
+}
@@ -0,0 +1,202 @@
+//
+//	allocator.h | Finn Le Var
+//
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+// how many size classes we have, and the biggest block they hand out, header included
+#define ALLOC_CLASS_COUNT 21
+#define ALLOC_MAX_SMALL	  4096
+
+// how big the slabs we carve blocks out of are
+#define ALLOC_SLAB_SIZE (64 * 1024)
+
+// how many blocks a thread's cache moves to and from the shared lists at once
+#define ALLOC_BATCH 32
+
+// module stats are kept in pages of this many modules, and we can have this many pages
+#define ALLOC_STATS_PAGE  256
+#define ALLOC_STATS_PAGES 4096
+
+// how many ways each module's stats are split, all but the last belong to a single thread each
+#define ALLOC_STAT_SHARDS 8
+
+//
+// one thread's share of a module's stats
+//
+struct alignas(64) alloc_shard_t
+{
+	std::atomic<int64_t>  bytes = 0;
+	std::atomic<int64_t>  count = 0;
+	std::atomic<uint64_t> total = 0;
+};
+
+//
+// what a module has allocated
+//
+// counting every allocation on one set of atomics costs more than the allocation does, so each
+// thread counts into its own shard with plain stores, and only threads past the first few share
+// the last shard and pay for atomic adds, reading sums the shards
+//
+struct alloc_stats_t
+{
+	alloc_shard_t shards[ALLOC_STAT_SHARDS];
+
+	int64_t live_bytes() const
+	{
+		int64_t sum = 0;
+		for (const auto& shard : shards) sum += shard.bytes.load(std::memory_order_acquire);
+		return sum;
+	}
+
+	int64_t live_count() const
+	{
+		int64_t sum = 0;
+		for (const auto& shard : shards) sum += shard.count.load(std::memory_order_acquire);
+		return sum;
+	}
+
+	uint64_t total_count() const
+	{
+		uint64_t sum = 0;
+		for (const auto& shard : shards) sum += shard.total.load(std::memory_order_acquire);
+		return sum;
+	}
+};
+
+//
+// size class pool allocator shared by the engine and every module, see sub_alloc_ctx_t
+//
+// small allocations come from slabs carved into fixed size blocks, each thread keeps a cache of
+// free blocks per size class so most allocations and frees never take a lock, and only moves
+// blocks in batches to and from the shared lists when its cache runs dry or gets too big
+//
+// every allocation has a header saying which module it belongs to, so it can be freed from any
+// thread and either side of the boundary, and so we can count what each module is holding on to
+//
+class pool_allocator_t
+{
+private:
+
+	//
+	// a free block, the link lives where the header would
+	//
+	struct free_block_t
+	{
+		free_block_t* next;
+	};
+
+	//
+	// a size class's shared free list
+	//
+	struct alignas(64) class_t
+	{
+		std::mutex	  mutex;
+		free_block_t* head	= nullptr;
+		size_t		  count = 0;
+	};
+
+	class_t m_classes[ALLOC_CLASS_COUNT];
+
+	// every slab we've carved, freed when we go
+	std::vector<void*> m_slabs;
+	std::mutex		   m_slab_mutex;
+
+	// each module's stats, by id, pages are made when first needed and never freed
+	std::atomic<alloc_stats_t*> m_stats[ALLOC_STATS_PAGES] = {};
+	std::mutex					m_stats_mutex;
+
+	// shards that no thread owns right now
+	std::vector<uint32_t> m_free_shards;
+	uint32_t			  m_next_shard = 0;
+
+	// how many leaks we've reported
+	std::atomic<uint64_t> m_leaks = 0;
+
+private:
+
+	// hide constructor so we can't create more instances
+	pool_allocator_t() = default;
+
+public:
+
+	~pool_allocator_t();
+
+	//
+	// allocates for the given module, null if it failed
+	//
+	void* alloc(uint32_t _module, size_t _size, size_t _align = alignof(std::max_align_t));
+
+	//
+	// frees something from alloc(), from any thread
+	//
+	void free(void* _ptr);
+
+	//
+	// counts an allocation against another module
+	//
+	void transfer(void* _ptr, uint32_t _module);
+
+	//
+	// gets the given module's stats
+	//
+	alloc_stats_t& stats(uint32_t _module);
+
+	//
+	// reports anything the given module still has allocated, called once its build has been
+	// unloaded and its library freed, returns the number of bytes it leaked
+	//
+	size_t report(uint32_t _module, const std::string& _name);
+
+	//
+	// prints what every module has allocated
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(pool_allocator_t);
+
+private:
+
+	//
+	// gets the size class for the given size, header included, or ALLOC_CLASS_COUNT if it's too big
+	//
+	static uint16_t size_class(size_t _size);
+
+	//
+	// takes a batch of blocks from a class's shared list into _cache, carving a new slab if it's empty
+	//
+	void refill(uint16_t _class, free_block_t*& _head, uint32_t& _count);
+
+	//
+	// gives a batch of blocks from _cache back to a class's shared list
+	//
+	void drain(uint16_t _class, free_block_t*& _head, uint32_t& _count, uint32_t _keep);
+
+	//
+	// records allocations or frees against a module, _count is negative for frees
+	//
+	void count(uint32_t _module, int64_t _bytes, int64_t _count);
+
+	//
+	// gets a shard for a thread to call its own, or the shared one if they're all taken
+	//
+	uint32_t take_shard();
+
+	//
+	// gives a thread's shard back when it exits
+	//
+	void give_shard(uint32_t _shard);
+
+	friend struct alloc_cache_t;
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(pool_allocator_t, allocator)
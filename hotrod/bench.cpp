@@ -0,0 +1,1396 @@
+//
+//	bench.cpp | Finn Le Var
+//
+#include "bench.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <barrier>
+#include <filesystem>
+#include <fstream>
+#include <streambuf>
+
+#include "dll.h"
+#include "dll_manager.h"
+#include "dispatch.h"
+#include "logger.h"
+#include "epoch.h"
+#include "event_bus.h"
+#include "frame_arena.h"
+#include "allocator.h"
+#include "trace.h"
+#include "thread_pool.h"
+#include "shadow.h"
+#include "util.h"
+
+#include "shared/subsystem.h"
+
+//
+// static vars
+//
+namespace
+{
+	// what our fake hooks write to so that the calls can't be optimised away
+	volatile uint64_t g_sink = 0;
+
+	// the same for benchmarks that run on several threads at once
+	thread_local volatile uint64_t t_sink = 0;
+
+	void fake_update(float, uint64_t) { g_sink = g_sink + 1; }
+	void fake_input()				  { g_sink = g_sink + 2; }
+
+	bool fake_load(engine_context_t*) { return true; }
+	bool fake_unload()				  { return true; }
+
+	// how long fake_work keeps its thread busy for, in nanoseconds
+	std::atomic<uint64_t> g_work_ns = 0;
+
+	//
+	// an update that takes a while, so that there's something worth spreading across threads
+	//
+	void fake_work(float, uint64_t)
+	{
+		auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(g_work_ns.load(std::memory_order_relaxed));
+
+		while (std::chrono::steady_clock::now() < end)
+			t_sink = t_sink + 1;
+	}
+
+	//
+	// somewhere to write prints to when we're timing the logger rather than the terminal
+	//
+	struct null_buf_t : std::streambuf
+	{
+		int_type		overflow(int_type _c) override { return traits_type::not_eof(_c); }
+		std::streamsize xsputn(const char*, std::streamsize _count) override { return _count; }
+	};
+
+	//
+	// a single result of the suite
+	//
+	struct suite_result_t
+	{
+		std::string name;
+		double		value;
+		const char* unit;
+	};
+
+	//
+	// the value at the given fraction of the way through the given values
+	//
+	double percentile(std::vector<double> _values, double _fraction)
+	{
+		if (_values.empty())
+			return 0.0;
+
+		std::sort(_values.begin(), _values.end());
+
+		return _values[std::min(_values.size() - 1, CASTTO(size_t, _fraction * _values.size()))];
+	}
+
+	//
+	// how long the given func takes per call in nanoseconds, best of a few runs
+	//
+	template<typename fn_t>
+	double time_ns(size_t _ticks, fn_t&& _fn)
+	{
+		double best = 0.0;
+
+		for (int run = 0; run < 5; ++run)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			for (size_t i = 0; i < _ticks; ++i)
+				_fn();
+
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / _ticks;
+
+			best = run == 0 ? ns : std::min(best, ns);
+		}
+
+		return best;
+	}
+
+	//
+	// what the process was holding on to at some point during a soak
+	//
+	struct soak_sample_t
+	{
+		process_stats_t stats;
+
+		// how many shadows were left in CUR_FOLDER
+		size_t shadows = 0;
+	};
+
+	//
+	// how much something is allowed to grow from the first half of a soak to the second before we
+	// call it a leak, a little for allocator pools and the like settling in
+	//
+	struct soak_limit_t
+	{
+		const char* name;
+		const char* unit;
+
+		// gets the value from a sample, in unit
+		double (*get)(const soak_sample_t&);
+
+		// how much it can grow by, and by how much of itself on top of that
+		double slack;
+		double fraction;
+	};
+
+	//
+	// copies a build of a module over the given path the way a linker would, written next to it
+	// then renamed over it, so that the watcher never sees half a file
+	//
+	bool place(const std::filesystem::path& _build, const std::filesystem::path& _path)
+	{
+		std::filesystem::path temp = _path;
+		temp += ".tmp";
+
+		std::error_code ec;
+
+		std::filesystem::copy_file(_build, temp, std::filesystem::copy_options::overwrite_existing, ec);
+
+		if (!ec)
+			std::filesystem::rename(temp, _path, ec);
+
+		if (ec)
+			printerret(false, "failed to swap in '" << _build.string() << "' : " << ec.message());
+
+		return true;
+	}
+
+	//
+	// writes one flat list of results, so that a regression check only has to match up names
+	//
+	bool write_results(const std::string& _json, const char* _suite, size_t _modules, size_t _reloads, const std::vector<suite_result_t>& _results)
+	{
+		std::ofstream file(_json, std::ios::trunc);
+
+		if (!file)
+			printerret(false, "couldn't open '" << _json << "' to write our results to");
+
+		file << "{\n";
+		file << "\t\"suite\": \"" << _suite << "\",\n";
+		file << "\t\"time\": " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+		file << "\t\"modules\": " << _modules << ",\n";
+		file << "\t\"reloads\": " << _reloads << ",\n";
+		file << "\t\"threads\": " << std::thread::hardware_concurrency() << ",\n";
+		file << "\t\"results\": [\n";
+
+		for (size_t i = 0; i < _results.size(); ++i)
+		{
+			file << std::format("\t\t{{ \"name\": \"{}\", \"value\": {:.3f}, \"unit\": \"{}\" }}{}\n",
+				_results[i].name, _results[i].value, _results[i].unit, i + 1 < _results.size() ? "," : "");
+		}
+
+		file << "\t]\n}\n";
+
+		if (!file)
+			printerret(false, "failed to write our results to '" << _json << "'");
+
+		printmsg("wrote " << _results.size() << " result(s) to '" << _json << "'");
+
+		return true;
+	}
+
+	//
+	// how many files are in the given directory, zero if it doesn't exist
+	//
+	size_t count_files(const std::filesystem::path& _dir)
+	{
+		std::error_code ec;
+		size_t			count = 0;
+
+		for (std::filesystem::directory_iterator it(_dir, ec), end; !ec && it != end; it.increment(ec))
+			count++;
+
+		return count;
+	}
+}
+
+//
+//
+//
+namespace bench
+{
+	//
+	// times per tick dispatch through the pool's map against the flat tables
+	//
+	void dispatch(size_t _modules, size_t _ticks)
+	{
+		printmsg("benchmarking dispatch with " << _modules << " module(s) over " << _ticks << " tick(s)...");
+
+		// shuffle the order we allocate in so that the dlls and images are scattered like they
+		// would be after a while of loading and unloading
+		std::vector<size_t> order(_modules);
+
+		for (size_t i = 0; i < _modules; ++i)
+			order[i] = i;
+
+		std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+		std::unordered_map<std::string, dll_t*> map;
+		std::vector<dll_t*> list;
+		std::vector<dll_image_t*> images;
+
+		map.reserve(_modules);
+		list.reserve(_modules);
+		images.reserve(_modules);
+
+		for (size_t i : order)
+		{
+			const std::string name = "mod_" + std::to_string(i);
+
+			auto image = new dll_image_t;
+
+			// it's never dereferenced, it just has to look loaded
+			image->handle = RECAST(lib_handle_t, image);
+
+			image->ctx.name			 = "bench";
+			image->ctx.loaded		 = true;
+			image->ctx.CTX_INIT_FN	 = &fake_load;
+			image->ctx.CTX_UNLOAD_FN = &fake_unload;
+			image->ctx.CTX_UPDATE_FN = &fake_update;
+
+			// only some modules take input, like a real set of modules would
+			if (i % 4 == 0)
+				image->ctx.CTX_INPUT_FN = &fake_input;
+
+			// wrap it without installing it, so there's no on_load or prints for every module
+			auto dll = new dll_t(name, HASH_OFF, nullptr);
+
+			dll->m_image.store(image);
+
+			map[name] = dll;
+			list.push_back(dll);
+			images.push_back(image);
+		}
+
+		std::sort(list.begin(), list.end(), [](const dll_t* _a, const dll_t* _b) { return _a->m_name < _b->m_name; });
+
+		// how much a rebuild costs us on every load, unload, and reload
+		dispatch_table_t table;
+
+		auto build_start = std::chrono::steady_clock::now();
+
+		table.build(list);
+
+		double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+		frame_t frame = {};
+
+		// the old way, every module through the map, its dll, its image, and its context's checks
+		double map_update = time_ns(_ticks, [&]()
+		{
+			for (auto& [name, dll] : map)
+			{
+				if (dll->loaded())
+					dll->image()->ctx.on_update(frame.dt, frame.index);
+			}
+		});
+
+		double map_input = time_ns(_ticks, [&]()
+		{
+			for (auto& [name, dll] : map)
+			{
+				dll_image_t* image = dll->image();
+
+				if (image->loaded() && image->ctx.CTX_INPUT_FN)
+					image->ctx.on_input();
+			}
+		});
+
+		// the new way, straight down the table
+		double table_update = time_ns(_ticks, [&]() { table.update(frame); });
+		double table_input	= time_ns(_ticks, [&]() { table.dispatch(HOOK_INPUT); });
+
+		// and again with every call timed, like a real module's are
+		for (size_t i = 0; i < images.size(); ++i)
+			images[i]->trace = g_trace.module("bench_" + std::to_string(i));
+
+		table.build(list);
+
+		double traced_update = time_ns(_ticks, [&]() { table.update(frame); });
+
+		printmsg(std::format("table rebuild : {:.3f}ms", build_ms));
+		printmsg(std::format("update : map {:.1f}us/tick ({:.2f}ns/module), table {:.1f}us/tick ({:.2f}ns/module), {:.2f}x",
+			map_update / 1e3, map_update / _modules, table_update / 1e3, table_update / _modules, map_update / table_update));
+		printmsg(std::format("input  : map {:.1f}us/tick, table {:.1f}us/tick ({} module(s) implement it), {:.2f}x",
+			map_input / 1e3, table_input / 1e3, table.count(HOOK_INPUT), map_input / table_input));
+		printmsg(std::format("traced : table {:.1f}us/tick, {:.2f}ns/module more than untimed",
+			traced_update / 1e3, (traced_update - table_update) / _modules));
+
+		// our images aren't real, so take them back before the dlls try to free them
+		for (auto dll : list)
+		{
+			dll->m_image.store(nullptr);
+			delete dll;
+		}
+
+		for (auto image : images)
+			delete image;
+	}
+
+	//
+	// times updating modules one after the other against updating them through the update graph
+	//
+	void graph(size_t _modules, size_t _work_ns, size_t _ticks)
+	{
+		if (g_thread_pool.worker_count() == 0)
+			g_thread_pool.init();
+
+		printmsg("benchmarking the update graph with " << _modules << " module(s) doing " << _work_ns << "ns of work each, over "
+			<< _ticks << " tick(s) on " << g_thread_pool.worker_count() << " worker(s)...");
+
+		std::vector<dll_t*>		  list;
+		std::vector<dll_image_t*> images;
+
+		list.reserve(_modules);
+		images.reserve(_modules);
+
+		for (size_t i = 0; i < _modules; ++i)
+		{
+			auto image = new dll_image_t;
+
+			// it's never dereferenced, it just has to look loaded
+			image->handle = RECAST(lib_handle_t, image);
+
+			image->ctx.name			 = "bench";
+			image->ctx.loaded		 = true;
+			image->ctx.CTX_INIT_FN	 = &fake_load;
+			image->ctx.CTX_UNLOAD_FN = &fake_unload;
+			image->ctx.CTX_UPDATE_FN = &fake_work;
+
+			auto dll = new dll_t("mod_" + std::to_string(i), HASH_OFF, nullptr);
+
+			dll->m_image.store(image);
+
+			list.push_back(dll);
+			images.push_back(image);
+		}
+
+		std::sort(list.begin(), list.end(), [](const dll_t* _a, const dll_t* _b) { return _a->m_name < _b->m_name; });
+
+		//
+		// what each module says it touches
+		//
+		struct layout_t
+		{
+			const char* name;
+			void (*assign)(module_context_t&, size_t);
+		};
+
+		const layout_t layouts[] =
+		{
+			// nobody shares anything
+			{ "independent", [](module_context_t& _ctx, size_t) { _ctx.reads = 0; _ctx.writes = 0; } },
+
+			// a quarter of them write one of a handful of things that the rest read
+			{ "mixed", [](module_context_t& _ctx, size_t _i)
+			{
+				_ctx.reads	= SUB_MASK_USER_AT((_i * 7 + 3) % 16);
+				_ctx.writes = _i % 4 == 0 ? SUB_MASK_USER_AT(_i % 16) : 0;
+			} },
+
+			// everyone writes the same thing, so it's a chain
+			{ "chain", [](module_context_t& _ctx, size_t) { _ctx.reads = 0; _ctx.writes = SUB_MASK_USER(0); } },
+
+			// nobody said, like modules from before the graph
+			{ "undeclared", [](module_context_t& _ctx, size_t) { _ctx.reads = 0; _ctx.writes = SUB_ACCESS_ALL; } },
+		};
+
+		dispatch_table_t table;
+		frame_t			 frame = {};
+
+		for (const auto& layout : layouts)
+		{
+			for (size_t i = 0; i < images.size(); ++i)
+				layout.assign(images[i]->ctx, i);
+
+			auto build_start = std::chrono::steady_clock::now();
+
+			table.build(list);
+
+			double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+			g_work_ns = _work_ns;
+
+			double serial = time_ns(_ticks, [&]() { frame.index++; table.update(frame); });
+			double graph  = time_ns(_ticks, [&]() { frame.index++; table.update_parallel(frame); });
+
+			// what the graph costs us with nothing to hide it behind
+			g_work_ns = 0;
+
+			double serial_empty = time_ns(_ticks, [&]() { frame.index++; table.update(frame); });
+			double graph_empty	= time_ns(_ticks, [&]() { frame.index++; table.update_parallel(frame); });
+
+			printmsg(std::format("{:<12}: serial {:.1f}us/tick, graph {:.1f}us/tick, {:.2f}x, {} edge(s), {} deep, built in {:.3f}ms, {:.1f}ns/module overhead",
+				layout.name, serial / 1e3, graph / 1e3, serial / graph, table.graph.edges(), table.graph.depth(), build_ms, (graph_empty - serial_empty) / _modules));
+		}
+
+		// our images aren't real, so take them back before the dlls try to free them
+		for (auto dll : list)
+		{
+			dll->m_image.store(nullptr);
+			delete dll;
+		}
+
+		for (auto image : images)
+			delete image;
+	}
+
+	//
+	// times publishing to one channel from several threads while we flush it
+	//
+	void events(size_t _producers, size_t _events)
+	{
+		printmsg("benchmarking events with " << _producers << " producer(s) publishing " << _events << " event(s) each...");
+
+		struct bench_event_t
+		{
+			uint64_t producer;
+			uint64_t value;
+		};
+
+		event_channel_t* channel = g_event_bus.channel("bench.events", sizeof(bench_event_t), 16384);
+
+		if (!channel)
+			printerret(;, "couldn't create the bench channel");
+
+		// what our subscriber has seen, only touched while flushing so it doesn't need to be atomic
+		static uint64_t received = 0;
+		static uint64_t sum		 = 0;
+
+		received = 0;
+		sum		 = 0;
+
+		uint64_t sub = g_event_bus.subscribe(0, channel, [](void*, const void* _events, size_t _count)
+		{
+			auto events = CASTTO(const bench_event_t*, _events);
+
+			for (size_t i = 0; i < _count; ++i)
+				sum += events[i].value;
+
+			received += _count;
+		}, nullptr);
+
+		// how often our producers found the channel full and had to wait for a flush
+		std::atomic<uint64_t> full = 0;
+		std::atomic<size_t>	  done = 0;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> producers;
+
+		for (size_t p = 0; p < _producers; ++p)
+		{
+			producers.emplace_back([&, p]()
+			{
+				for (size_t i = 0; i < _events; ++i)
+				{
+					bench_event_t event = { .producer = p, .value = i };
+
+					// back off until the next flush makes room, rather than dropping
+					while (!g_event_bus.publish(channel, &event))
+					{
+						full.fetch_add(1, std::memory_order_relaxed);
+						std::this_thread::yield();
+					}
+				}
+
+				done.fetch_add(1);
+			});
+		}
+
+		// flush like a very fast main loop would until everyone's finished and we've seen it all
+		size_t flushes = 0;
+
+		while (done.load() < _producers || g_event_bus.pending(channel) > 0)
+		{
+			if (g_event_bus.flush() > 0)
+				flushes++;
+			else
+				std::this_thread::yield();
+		}
+
+		double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (auto& producer : producers)
+			producer.join();
+
+		g_event_bus.unsubscribe(sub);
+
+		// every producer sent 0 to _events - 1
+		const uint64_t expected = _producers * (_events * (_events - 1) / 2);
+
+		// the publish fails we counted as full also count as drops on the channel, but we retried them all
+		printmsg(std::format("{} event(s) in {:.3f}s, {:.2f}M events/s, {} flush(es) averaging {:.0f} event(s), channel full {} time(s)",
+			received, secs, received / secs / 1e6, flushes, flushes ? CASTTO(double, received) / flushes : 0.0, full.load()));
+
+		if (received != _producers * _events || sum != expected)
+			printerror("lost or corrupted events, got " << received << " with a sum of " << sum << ", expected " << _producers * _events << " with a sum of " << expected);
+	}
+
+	//
+	// times scratch allocations through the heap against the frame arenas
+	//
+	void frame(size_t _threads, size_t _allocs, size_t _ticks)
+	{
+		printmsg("benchmarking frame allocations with " << _threads << " thread(s) making " << _allocs << " allocation(s) a tick for " << _ticks << " tick(s)...");
+
+		// the same spread of sizes for both, like the strings and small vectors modules make
+		std::vector<size_t> sizes(_allocs);
+		std::mt19937 rng(1234);
+
+		for (auto& size : sizes)
+			size = 16 + rng() % 240;
+
+		// runs a tick's worth of allocations on every thread, with _end_tick run between ticks
+		auto run = [&](auto&& _tick, auto&& _end_tick)
+		{
+			std::barrier sync(CASTTO(std::ptrdiff_t, _threads), [&]() noexcept { _end_tick(); });
+			std::vector<std::thread> threads;
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (size_t t = 0; t < _threads; ++t)
+			{
+				threads.emplace_back([&]()
+				{
+					for (size_t tick = 0; tick < _ticks; ++tick)
+					{
+						_tick();
+						sync.arrive_and_wait();
+					}
+				});
+			}
+
+			for (auto& thread : threads)
+				thread.join();
+
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		// the old way, everything new'd and deleted within the tick
+		double heap_ms = run([&]()
+		{
+			thread_local std::vector<char*> live;
+
+			live.clear();
+
+			for (size_t size : sizes)
+			{
+				char* ptr = new char[size];
+				ptr[0] = 1;
+				live.push_back(ptr);
+			}
+
+			t_sink = t_sink + live.size();
+
+			for (char* ptr : live)
+				delete[] ptr;
+		}, []() {});
+
+		// the new way, bumped out of each thread's arena and dropped in one go at the end of the tick
+		double arena_ms = run([&]()
+		{
+			for (size_t size : sizes)
+			{
+				auto ptr = CASTTO(char*, g_frame_arena.alloc(0, size, alignof(std::max_align_t)));
+				ptr[0] = 1;
+			}
+
+			t_sink = t_sink + sizes.size();
+		}, []() { g_frame_arena.reset(); });
+
+		const double allocs = CASTTO(double, _threads * _allocs * _ticks);
+
+		printmsg(std::format("heap  : {:.1f}ms, {:.1f}ns/allocation", heap_ms, heap_ms * 1e6 / allocs));
+		printmsg(std::format("arena : {:.1f}ms, {:.1f}ns/allocation, {:.2f}x", arena_ms, arena_ms * 1e6 / allocs, heap_ms / arena_ms));
+
+		g_frame_arena.dump();
+	}
+
+	//
+	// times mixed size allocations through the heap against the pool allocator
+	//
+	void alloc(size_t _threads, size_t _allocs)
+	{
+		printmsg("benchmarking allocations with " << _threads << " thread(s) making " << _allocs << " allocation(s) each...");
+
+		// mostly small, some bigger, like a module's strings, nodes, and buffers
+		std::vector<size_t> sizes(4096);
+		std::mt19937 rng(1234);
+
+		for (auto& size : sizes)
+			size = rng() % 8 == 0 ? 256 + rng() % 3000 : 8 + rng() % 120;
+
+		// keeps a window of live allocations, so frees dont just undo the last allocation
+		auto run = [&](auto&& _alloc, auto&& _free)
+		{
+			std::vector<std::thread> threads;
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (size_t t = 0; t < _threads; ++t)
+			{
+				threads.emplace_back([&]()
+				{
+					std::vector<void*> live(256, nullptr);
+
+					for (size_t i = 0; i < _allocs; ++i)
+					{
+						void*& slot = live[i % live.size()];
+
+						_free(slot);
+
+						slot = _alloc(sizes[i % sizes.size()]);
+						CASTTO(char*, slot)[0] = 1;
+					}
+
+					for (void* ptr : live)
+						_free(ptr);
+				});
+			}
+
+			for (auto& thread : threads)
+				thread.join();
+
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		double heap_ms = run([](size_t _size) { return ::operator new(_size); }, [](void* _ptr) { ::operator delete(_ptr); });
+		double pool_ms = run([](size_t _size) { return g_allocator.alloc(0, _size); }, [](void* _ptr) { g_allocator.free(_ptr); });
+
+		const double allocs = CASTTO(double, _threads * _allocs);
+
+		printmsg(std::format("heap : {:.1f}ms, {:.1f}ns/allocation", heap_ms, heap_ms * 1e6 / allocs));
+		printmsg(std::format("pool : {:.1f}ms, {:.1f}ns/allocation, {:.2f}x", pool_ms, pool_ms * 1e6 / allocs, heap_ms / pool_ms));
+
+		g_allocator.dump();
+	}
+
+	//
+	// runs the whole suite against modgen's modules
+	//
+	void suite(const std::string& _dir, const std::string& _json, size_t _runs)
+	{
+		namespace fs = std::filesystem;
+
+		const fs::path modules = fs::path(_dir) / "modules";
+		const fs::path reload  = modules / ("synth_reload" MOD_EXT);
+
+		const fs::path variants[2] =
+		{
+			fs::path(_dir) / "reload" / "a" / ("synth_reload" MOD_EXT),
+			fs::path(_dir) / "reload" / "b" / ("synth_reload" MOD_EXT),
+		};
+
+		for (const auto& variant : variants)
+		{
+			if (!fs::exists(variant))
+				printerret(;, "missing '" << variant.string() << "', build the bench target first");
+		}
+
+		_runs = std::max<size_t>(_runs, 1);
+
+		std::vector<suite_result_t> results;
+
+		if (!place(variants[0], reload))
+			return;
+
+		printmsg("running the benchmark suite against '" << modules.string() << "' with " << _runs << " reload(s)...");
+
+		g_dll.init({ modules.string() });
+
+		// the first start is the dynamic loader's first look at every module, the rest are with
+		// everything it's already seen, and everything in the page cache
+		constexpr size_t starts = 5;
+
+		std::vector<double> start_ms;
+		size_t				loaded = 0;
+
+		for (size_t run = 0; run < starts; ++run)
+		{
+			if (run > 0)
+			{
+				g_dll.unload_all();
+				g_epoch.barrier();
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			loaded = g_dll.find_and_load();
+
+			start_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		dll_t* dll = g_dll.get("synth_reload");
+
+		if (!loaded || !dll)
+			printerret(;, "no synthetic modules found in '" << modules.string() << "'");
+
+		double warm_ms = *std::min_element(start_ms.begin() + 1, start_ms.end());
+
+		results.push_back({ "cold_start", start_ms[0], "ms" });
+		results.push_back({ "warm_start", warm_ms, "ms" });
+		results.push_back({ "warm_start_per_module", warm_ms * 1e3 / loaded, "us" });
+
+		// from asking for a reload to it being installed, and how long installing it stalled the tick for
+		std::vector<double> reload_ms;
+		std::vector<double> install_us;
+
+		for (size_t run = 0; run < _runs; ++run)
+		{
+			if (!place(variants[(run + 1) % 2], reload))
+				break;
+
+			auto start = std::chrono::steady_clock::now();
+
+			g_dll.request_reload(dll, true);
+
+			size_t installed = 0;
+
+			while (!installed && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+			{
+				auto install_start = std::chrono::steady_clock::now();
+
+				installed = g_dll.install_staged();
+
+				if (installed)
+					install_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - install_start).count());
+				else
+					std::this_thread::yield();
+			}
+
+			if (!installed)
+			{
+				printerror("reload " << run << " of 'synth_reload' never finished");
+				continue;
+			}
+
+			reload_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		results.push_back({ "reload_p50", percentile(reload_ms, 0.5), "ms" });
+		results.push_back({ "reload_max", percentile(reload_ms, 1.0), "ms" });
+		results.push_back({ "reload_install_p50", percentile(install_us, 0.5), "us" });
+		results.push_back({ "reload_install_max", percentile(install_us, 1.0), "us" });
+
+		// update_all across every module, like the main loop calls it
+		frame_t frame = {};
+
+		double tick_ns = time_ns(10000, [&]()
+		{
+			frame.index++;
+			g_dll.update_all(frame);
+		});
+
+		size_t updated = std::max<size_t>(1, g_dll.pool()->dispatch.count(HOOK_UPDATE));
+
+		results.push_back({ "dispatch_update_tick", tick_ns, "ns" });
+		results.push_back({ "dispatch_update_module", tick_ns / updated, "ns" });
+
+		// finding an export through the os's loader, through the build's export table, and through a bound handle
+		{
+			constexpr uint64_t finds = 1000000;
+
+			dll_image_t* image	= dll->image();
+			auto		 handle = dll->bind<uint64_t(*)(uint64_t)>("synth_bench_lookup");
+
+			double dlsym_ns = time_ns(finds, [&]() { g_sink = g_sink + RECAST(uintptr_t, util::find_sym(image->handle, "synth_bench_lookup")); });
+			double table_ns = time_ns(finds, [&]() { g_sink = g_sink + RECAST(uintptr_t, image->find("synth_bench_lookup")); });
+			double bound_ns = time_ns(finds, [&]() { g_sink = g_sink + RECAST(uintptr_t, handle.get()); });
+
+			results.push_back({ "export_find_os", dlsym_ns, "ns" });
+			results.push_back({ "export_find_table", table_ns, "ns" });
+			results.push_back({ "export_find_handle", bound_ns, "ns" });
+			results.push_back({ "exports_per_module", CASTTO(double, image->exports.size()), "exports" });
+		}
+
+		// a module looking up its subsystems through the engine's table
+		auto lookup = RECAST(uint64_t(*)(uint64_t), dll->find<uint64_t>("synth_bench_lookup"));
+		auto log	= RECAST(void(*)(uint64_t), dll->find<void>("synth_bench_log"));
+
+		if (lookup)
+		{
+			constexpr uint64_t lookups = 10000000;
+
+			double lookup_ns = time_ns(1, [&]() { g_sink = g_sink + lookup(lookups); }) / lookups;
+
+			results.push_back({ "subsystem_lookup", lookup_ns, "ns" });
+		}
+
+		// every print all the way out, the engine's and a module's, written to nowhere so that
+		// we're timing the logger rather than the terminal, and waiting rather than dropping
+		{
+			constexpr uint64_t prints = 200000;
+
+			null_buf_t null;
+
+			hot_log::flush();
+
+			std::streambuf* stdout_buf = std::cout.rdbuf(&null);
+
+			g_logger.set_policy(LOG_BLOCK);
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (uint64_t i = 0; i < prints; ++i)
+				printmsg("engine print " << i << " of " << prints);
+
+			hot_log::flush();
+
+			double engine_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double module_s = 0.0;
+
+			if (log)
+			{
+				start = std::chrono::steady_clock::now();
+
+				log(prints);
+
+				hot_log::flush();
+
+				module_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			g_logger.set_policy(LOG_DROP);
+
+			std::cout.rdbuf(stdout_buf);
+
+			results.push_back({ "log_engine", engine_s * 1e9 / prints, "ns" });
+			results.push_back({ "log_engine_throughput", prints / engine_s, "prints/s" });
+
+			if (log)
+			{
+				results.push_back({ "log_module", module_s * 1e9 / prints, "ns" });
+				results.push_back({ "log_module_throughput", prints / module_s, "prints/s" });
+			}
+		}
+
+		g_dll.unload_all();
+		g_epoch.barrier();
+
+		for (const auto& result : results)
+			printmsg(std::format("{:<24} {:>12.3f} {}", result.name, result.value, result.unit));
+
+		write_results(_json, "hotrod", loaded, reload_ms.size(), results);
+	}
+
+	//
+	// reloads a module over and over while ticking, watching for anything that keeps growing
+	//
+	bool soak(const std::string& _dir, const std::string& _json, size_t _reloads)
+	{
+		namespace fs = std::filesystem;
+
+		const fs::path modules = fs::path(_dir) / "modules";
+		const fs::path reload  = modules / ("synth_reload" MOD_EXT);
+
+		const fs::path variants[2] =
+		{
+			fs::path(_dir) / "reload" / "a" / ("synth_reload" MOD_EXT),
+			fs::path(_dir) / "reload" / "b" / ("synth_reload" MOD_EXT),
+		};
+
+		for (const auto& variant : variants)
+		{
+			if (!fs::exists(variant))
+				printerret(false, "missing '" << variant.string() << "', build the bench target first");
+		}
+
+		// we need enough samples in each half to compare them
+		_reloads = std::max<size_t>(_reloads, 100);
+
+		if (!place(variants[0], reload))
+			return false;
+
+		g_dll.init({ modules.string() });
+
+		size_t loaded = g_dll.find_and_load();
+		dll_t* dll	  = g_dll.get("synth_reload");
+
+		if (!loaded || !dll)
+			printerret(false, "no synthetic modules found in '" << modules.string() << "'");
+
+		printmsg("soaking '" << reload.string() << "' with " << _reloads << " reload(s) across " << loaded << " module(s)...");
+
+		// everything the main loop does in a tick, minus the wait, so that the modules keep running
+		// while the loader stages their next build
+		frame_t frame = { .dt = 1.0f / 60.0f, .fixed_dt = 1.0f / 50.0f };
+
+		auto tick = [&]()
+		{
+			frame.index++;
+
+			g_dll.fixed_update_all(frame.fixed_dt, frame.index);
+			g_dll.update_all(frame);
+
+			g_event_bus.flush();
+			g_frame_arena.reset();
+		};
+
+		// the first reloads warm up the loader, allocator pools and the like, so we dont sample them
+		const size_t warmup = _reloads / 10;
+		const size_t every	= std::max<size_t>(1, (_reloads - warmup) / 200);
+
+		std::vector<double>		   reload_ms;
+		std::vector<double>		   touch_ms;
+		std::vector<soak_sample_t> samples;
+
+		size_t failed  = 0;
+		size_t variant = 0;
+
+		auto soak_start = std::chrono::steady_clock::now();
+
+		for (size_t run = 0; run < _reloads; ++run)
+		{
+			// mostly a new build, but sometimes just the same one touched, like saving without
+			// changes, which the loader fingerprints and skips rather than installing
+			const bool touch = run % 4 == 3;
+
+			if (touch)
+			{
+				std::error_code ec;
+
+				fs::last_write_time(reload, fs::file_time_type::clock::now(), ec);
+			}
+			else if (!place(variants[++variant % 2], reload))
+			{
+				failed++;
+				continue;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			g_dll.request_reload(dll, true);
+
+			size_t installed = 0;
+			bool   finished	 = false;
+
+			while (!finished && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+			{
+				installed += g_dll.install_staged();
+				finished   = touch ? !g_dll.loading() : installed > 0;
+
+				tick();
+			}
+
+			if (!finished || (touch && installed))
+			{
+				printerror("reload " << run << " of 'synth_reload' " << (finished ? "installed a build that didn't change" : "never finished"));
+
+				failed++;
+				continue;
+			}
+
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			(touch ? touch_ms : reload_ms).push_back(ms);
+
+			if (run < warmup || (run - warmup) % every != 0)
+				continue;
+
+			// so that the builds we've swapped out have actually been freed, rather than still waiting on the epoch
+			g_epoch.barrier();
+
+			samples.push_back({ .stats = util::process_stats(), .shadows = count_files(CUR_FOLDER) });
+
+			if (samples.size() % 20 == 0)
+			{
+				const soak_sample_t& sample = samples.back();
+
+				printmsg("soak : " << run + 1 << " / " << _reloads << " reload(s), " << sample.stats.rss / 1024 << " KB resident, " << sample.stats.fds << " fd(s), "
+					<< sample.stats.maps << " mapping(s), " << sample.stats.threads << " thread(s), " << sample.shadows << " shadow(s)");
+			}
+		}
+
+		double soak_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - soak_start).count();
+
+		g_dll.unload_all();
+		g_epoch.barrier();
+
+		if (samples.size() < 2)
+			printerret(false, "not enough samples to tell whether anything is growing");
+
+		const soak_limit_t limits[] =
+		{
+			{ "rss",	 "KB",		 [](const soak_sample_t& _s) { return _s.stats.rss / 1024.0; }, 4096.0, 0.05 },
+			{ "fds",	 "fds",		 [](const soak_sample_t& _s) { return CASTTO(double, _s.stats.fds); }, 2.0, 0.0 },
+			{ "maps",	 "mappings", [](const soak_sample_t& _s) { return CASTTO(double, _s.stats.maps); }, 16.0, 0.0 },
+			{ "threads", "threads",	 [](const soak_sample_t& _s) { return CASTTO(double, _s.stats.threads); }, 1.0, 0.0 },
+			{ "shadows", "files",	 [](const soak_sample_t& _s) { return CASTTO(double, _s.shadows); }, 2.0, 0.0 },
+		};
+
+		std::vector<suite_result_t> results;
+
+		bool passed = failed == 0;
+
+		if (failed)
+			printerror(failed << " of " << _reloads << " reload(s) failed");
+
+		// something that leaks a bit every reload is higher all through the second half than it
+		// ever was in the first, where something that's just noisy isn't
+		const size_t half = samples.size() / 2;
+
+		for (const auto& limit : limits)
+		{
+			double first = 0.0, second = 0.0;
+
+			for (size_t i = 0; i < samples.size(); ++i)
+			{
+				double& peak = i < half ? first : second;
+
+				peak = std::max(peak, limit.get(samples[i]));
+			}
+
+			double growth  = second - first;
+			double allowed = limit.slack + first * limit.fraction;
+
+			results.push_back({ std::string(limit.name) + "_start", limit.get(samples.front()), limit.unit });
+			results.push_back({ std::string(limit.name) + "_end", limit.get(samples.back()), limit.unit });
+			results.push_back({ std::string(limit.name) + "_growth", growth, limit.unit });
+
+			if (growth > allowed)
+			{
+				printerror("soak : " << limit.name << " grew by " << growth << " " << limit.unit << " from the first half to the second, more than the " << allowed << " allowed");
+
+				passed = false;
+			}
+		}
+
+		// reloads getting slower the more we've done is a leak too, in some list we're walking
+		const auto middle = reload_ms.begin() + reload_ms.size() / 2;
+
+		double first_p50  = percentile(std::vector<double>(reload_ms.begin(), middle), 0.5);
+		double second_p50 = percentile(std::vector<double>(middle, reload_ms.end()), 0.5);
+
+		if (second_p50 > first_p50 * 2.0 + 0.25)
+		{
+			printerror("soak : reloads slowed from " << first_p50 << "ms to " << second_p50 << "ms at p50");
+
+			passed = false;
+		}
+
+		results.push_back({ "reload_p50", percentile(reload_ms, 0.5), "ms" });
+		results.push_back({ "reload_p99", percentile(reload_ms, 0.99), "ms" });
+		results.push_back({ "reload_p999", percentile(reload_ms, 0.999), "ms" });
+		results.push_back({ "reload_max", percentile(reload_ms, 1.0), "ms" });
+		results.push_back({ "touch_p50", percentile(touch_ms, 0.5), "ms" });
+		results.push_back({ "touch_p99", percentile(touch_ms, 0.99), "ms" });
+		results.push_back({ "reload_p50_first_half", first_p50, "ms" });
+		results.push_back({ "reload_p50_second_half", second_p50, "ms" });
+		results.push_back({ "reloads_per_second", (reload_ms.size() + touch_ms.size()) / soak_s, "reloads/s" });
+		results.push_back({ "reloads_failed", CASTTO(double, failed), "reloads" });
+		results.push_back({ "passed", passed ? 1.0 : 0.0, "bool" });
+
+		for (const auto& result : results)
+			printmsg(std::format("{:<24} {:>12.3f} {}", result.name, result.value, result.unit));
+
+		write_results(_json, "soak", loaded, reload_ms.size(), results);
+
+		if (passed)
+			printmsg("soak passed, nothing grew across " << reload_ms.size() << " reload(s)");
+		else
+			printerror("soak failed");
+
+		return passed;
+	}
+
+	//
+	// starts the suite's modules eagerly and then lazily, and compares how long each start takes and
+	// how much memory each holds on to once it's settled, with only some of the modules being used
+	//
+	void lazy(const std::string& _dir, const std::string& _json, size_t _used)
+	{
+		namespace fs = std::filesystem;
+
+		const fs::path modules = fs::path(_dir) / "modules";
+
+		std::vector<std::string> names;
+
+		std::error_code ec;
+
+		for (fs::directory_iterator it(modules, ec), end; !ec && it != end; it.increment(ec))
+		{
+			if (it->path().extension() == MOD_EXT)
+				names.push_back(it->path().stem().string());
+		}
+
+		if (names.empty())
+			printerret(;, "no synthetic modules found in '" << modules.string() << "', build the bench target first");
+
+		std::sort(names.begin(), names.end());
+
+		// the few that actually get used, spread across the lot
+		_used = std::clamp<size_t>(_used, 1, 100);
+
+		std::vector<std::string> used;
+
+		for (size_t i = 0; i < names.size(); i += std::max<size_t>(1, 100 / _used))
+			used.push_back(names[i]);
+
+		printmsg("starting " << names.size() << " module(s) eagerly and lazily, using " << used.size() << " of them...");
+
+		// everything the main loop does in a tick, minus the wait
+		frame_t frame = { .dt = 1.0f / 60.0f, .fixed_dt = 1.0f / 50.0f };
+
+		auto tick = [&]()
+		{
+			frame.index++;
+
+			g_dll.fixed_update_all(frame.fixed_dt, frame.index);
+			g_dll.update_all(frame);
+
+			g_event_bus.flush();
+			g_frame_arena.reset();
+		};
+
+		constexpr size_t ticks = 300;
+
+		// only once everything we've unloaded has actually been freed
+		auto rss_kb = []()
+		{
+			g_epoch.barrier();
+
+			return util::process_stats().rss / 1024.0;
+		};
+
+		auto since = [](std::chrono::steady_clock::time_point _start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		};
+
+		g_dll.init({ modules.string() });
+
+		double baseline_kb = rss_kb();
+
+		// eagerly first, so that anything it leaves behind in the allocator counts against loading lazily, not for it
+		auto start = std::chrono::steady_clock::now();
+
+		size_t loaded	= g_dll.find_and_load();
+		double eager_ms = since(start);
+
+		for (size_t i = 0; i < ticks; ++i)
+			tick();
+
+		double eager_kb		  = rss_kb();
+		size_t eager_resident = g_dll.count();
+
+		g_dll.unload_all();
+		g_epoch.barrier();
+
+		// then lazily, where only what gets used is loaded, and is evicted again once it isn't
+		g_dll.set_lazy(true);
+		g_dll.set_idle_timeout(std::chrono::milliseconds(250));
+
+		start = std::chrono::steady_clock::now();
+
+		g_dll.find_and_load();
+
+		double lazy_ms	  = since(start);
+		size_t registered = g_dll.registered();
+		double idle_kb	  = rss_kb();
+
+		std::vector<double> first_use_ms;
+
+		for (const auto& name : used)
+		{
+			start = std::chrono::steady_clock::now();
+
+			if (g_dll.require(name))
+				first_use_ms.push_back(since(start));
+		}
+
+		for (size_t i = 0; i < ticks; ++i)
+		{
+			for (const auto& name : used)
+				g_dll.require(name);
+
+			tick();
+		}
+
+		double lazy_kb		 = rss_kb();
+		size_t lazy_resident = g_dll.count();
+
+		// and then nothing needs them anymore, not even the tick, since updating counts as being needed
+		start = std::chrono::steady_clock::now();
+
+		while (g_dll.count() > 0 && since(start) < 5000.0)
+		{
+			g_dll.evict_idle();
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		double evict_ms	  = since(start);
+		double evicted_kb = rss_kb();
+
+		if (g_dll.count() > 0)
+			printerror(g_dll.count() << " module(s) were never evicted");
+
+		g_dll.unload_all();
+		g_epoch.barrier();
+
+		g_dll.set_lazy(false);
+
+		std::vector<suite_result_t> results =
+		{
+			{ "start_eager", eager_ms, "ms" },
+			{ "start_lazy", lazy_ms, "ms" },
+			{ "first_use_p50", percentile(first_use_ms, 0.5), "ms" },
+			{ "first_use_max", percentile(first_use_ms, 1.0), "ms" },
+			{ "rss_baseline", baseline_kb, "KB" },
+			{ "rss_eager", eager_kb, "KB" },
+			{ "rss_lazy_registered", idle_kb, "KB" },
+			{ "rss_lazy", lazy_kb, "KB" },
+			{ "rss_lazy_evicted", evicted_kb, "KB" },
+			{ "resident_eager", CASTTO(double, eager_resident), "modules" },
+			{ "resident_lazy", CASTTO(double, lazy_resident), "modules" },
+			{ "registered_lazy", CASTTO(double, registered), "modules" },
+			{ "evicted_after", evict_ms, "ms" },
+		};
+
+		for (const auto& result : results)
+			printmsg(std::format("{:<24} {:>12.3f} {}", result.name, result.value, result.unit));
+
+		// anything that updates is loaded by the tick, so what's in use is more than just what we required
+		printmsg(std::format("lazy : started {:.1f}x faster, holding {:.0f} KB less with {} of {} module(s) in use, {} required and the rest updating ({:.0f} KB over baseline against {:.0f} KB eagerly)",
+			lazy_ms > 0.0 ? eager_ms / lazy_ms : 0.0, eager_kb - lazy_kb, lazy_resident, loaded, used.size(), lazy_kb - baseline_kb, eager_kb - baseline_kb));
+
+		write_results(_json, "lazy", loaded, 0, results);
+	}
+
+	//
+	// starts copies of the suite's modules, first with no module index, then with the one the first
+	// start left behind, both eagerly and lazily
+	//
+	void index(const std::string& _dir, const std::string& _json, size_t _count)
+	{
+		namespace fs = std::filesystem;
+
+		const fs::path	  scratch	 = fs::path(_dir) / "index";
+		const fs::path	  modules	 = scratch / "modules";
+		const std::string index_path = (scratch / "modules.index").string();
+
+		// everything but the module the reload benchmarks use, since it holds on to named state
+		std::vector<fs::path> sources;
+
+		std::error_code ec;
+
+		for (fs::directory_iterator it(fs::path(_dir) / "modules", ec), end; !ec && it != end; it.increment(ec))
+		{
+			if (it->path().extension() == MOD_EXT && it->path().stem() != "synth_reload")
+				sources.push_back(it->path());
+		}
+
+		if (sources.empty())
+			printerret(;, "no synthetic modules found in '" << (fs::path(_dir) / "modules").string() << "', build the bench target first");
+
+		std::sort(sources.begin(), sources.end());
+
+		// copied over and over under their own names to make up the numbers, only once if they're already there
+		size_t existing = 0;
+
+		for (fs::directory_iterator it(modules, ec), end; !ec && it != end; it.increment(ec))
+			existing++;
+
+		if (existing != _count)
+		{
+			fs::remove_all(modules, ec);
+			fs::create_directories(modules, ec);
+
+			for (size_t i = 0; i < _count; ++i)
+				fs::copy_file(sources[i % sources.size()], modules / std::format("indexed_{:04}{}", i, MOD_EXT), fs::copy_options::overwrite_existing, ec);
+		}
+
+		printmsg("starting " << _count << " module(s) with and without an index...");
+
+		auto since = [](std::chrono::steady_clock::time_point _start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		};
+
+		g_dll.init({ modules.string() });
+
+		double read_ms = 0.0;
+
+		// starts everything, from nothing or from the index the last start left behind, a lazy start is
+		// only ready once everything that updates every frame is loaded, returns how long it took
+		auto start = [&](bool _warm, bool _lazy, size_t& _loaded)
+		{
+			if (!_warm)
+				fs::remove(index_path, ec);
+
+			g_dll.set_lazy(_lazy);
+
+			auto begin = std::chrono::steady_clock::now();
+
+			g_dll.set_index_path(index_path);
+
+			read_ms = since(begin);
+
+			_loaded = g_dll.find_and_load();
+
+			if (_lazy)
+				_loaded += g_dll.require_hook(HOOK_UPDATE);
+
+			double ms = since(begin);
+
+			g_dll.unload_all();
+			g_epoch.barrier();
+
+			g_dll.set_lazy(false);
+
+			return ms;
+		};
+
+		size_t eager_cold_loaded = 0, eager_warm_loaded = 0, lazy_cold_loaded = 0, lazy_warm_loaded = 0;
+
+		// once to get everything into the os's file cache, so that it doesn't favour whichever goes second
+		start(false, false, eager_cold_loaded);
+
+		double eager_cold_ms = start(false, false, eager_cold_loaded);
+		double eager_warm_ms = start(true, false, eager_warm_loaded);
+		double warm_read_ms	 = read_ms;
+		double lazy_cold_ms	 = start(false, true, lazy_cold_loaded);
+
+		// the lazy start that left this behind never loaded anything to learn its hooks from, so warm it up eagerly
+		start(false, false, eager_warm_loaded);
+
+		double lazy_warm_ms = start(true, true, lazy_warm_loaded);
+
+		g_dll.set_index_path("");
+
+		std::vector<suite_result_t> results =
+		{
+			{ "start_eager_cold", eager_cold_ms, "ms" },
+			{ "start_eager_warm", eager_warm_ms, "ms" },
+			{ "start_lazy_cold", lazy_cold_ms, "ms" },
+			{ "start_lazy_warm", lazy_warm_ms, "ms" },
+			{ "loaded_eager_cold", CASTTO(double, eager_cold_loaded), "modules" },
+			{ "loaded_eager_warm", CASTTO(double, eager_warm_loaded), "modules" },
+			{ "ready_lazy_cold", CASTTO(double, lazy_cold_loaded), "modules" },
+			{ "ready_lazy_warm", CASTTO(double, lazy_warm_loaded), "modules" },
+			{ "index_read", warm_read_ms, "ms" },
+			{ "index_size", fs::file_size(index_path, ec) / 1024.0, "KB" },
+		};
+
+		for (const auto& result : results)
+			printmsg(std::format("{:<24} {:>12.3f} {}", result.name, result.value, result.unit));
+
+		printmsg(std::format("index : eager start {:.2f}x faster warm, lazy start has {} of {} module(s) that update ready warm against {} cold",
+			eager_warm_ms > 0.0 ? eager_cold_ms / eager_warm_ms : 0.0, lazy_warm_loaded, _count, lazy_cold_loaded));
+
+		write_results(_json, "index", _count, 0, results);
+	}
+}
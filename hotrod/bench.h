@@ -0,0 +1,78 @@
+//
+//	bench.h | Finn Le Var
+//
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//
+// synthetic benchmarks for the engine's hot paths, run from the command line rather than
+// as part of a normal run, see main()
+//
+namespace bench
+{
+	//
+	// builds _modules fake modules in memory and times walking them for _ticks ticks, the old
+	// way through the pool's map and each module's context, against the flat dispatch tables
+	//
+	void dispatch(size_t _modules = 10000, size_t _ticks = 1000);
+
+	//
+	// builds _modules fake modules in memory whose on_update each keep a thread busy for _work_ns, and
+	// times updating them one after the other against through the update graph, for a few different
+	// layouts of what they say they read and write
+	//
+	void graph(size_t _modules = 256, size_t _work_ns = 10000, size_t _ticks = 50);
+
+	//
+	// has _producers threads each publish _events events to one channel as fast as they can,
+	// while this thread flushes it like the main loop would, and times how long it takes
+	//
+	void events(size_t _producers = 4, size_t _events = 1000000);
+
+	//
+	// has _threads threads each make _allocs small scratch allocations a tick for _ticks ticks, through
+	// the heap and through the frame arenas, and times both
+	//
+	void frame(size_t _threads = 4, size_t _allocs = 1000, size_t _ticks = 1000);
+
+	//
+	// has _threads threads each make _allocs mixed size allocations, freeing them a few at a time,
+	// through the heap and through the pool allocator, and times both
+	//
+	void alloc(size_t _threads = 4, size_t _allocs = 1000000);
+
+	//
+	// runs the whole suite against the synthetic modules modgen made, which the build puts in
+	// _dir/modules, with the two builds of its reload module in _dir/reload/a and _dir/reload/b
+	//
+	// times cold and warm starts, reloading a single module _runs times, dispatching update to
+	// every module, a module's subsystem lookups, and logging from the engine and from a module,
+	// and writes the results to _json so that they can be compared from one release to the next
+	//
+	void suite(const std::string& _dir, const std::string& _json, size_t _runs = 20);
+
+	//
+	// reloads the suite's reload module _reloads times while every module keeps ticking, swapping
+	// between its two builds or just touching it, and watches what the process is holding on to
+	//
+	// tracks memory, descriptors, mappings, threads, and shadows left in current/, along with
+	// reload latency, and returns false if any of them keeps growing, writing the results to _json
+	//
+	bool soak(const std::string& _dir, const std::string& _json, size_t _reloads = 5000);
+
+	//
+	// starts the suite's modules eagerly, then lazily with only _used in every 100 of them being
+	// needed, and compares how long each took to start and how much memory each holds on to after
+	// ticking for a while, then how long it takes the lazy ones to be evicted once they're not needed
+	//
+	void lazy(const std::string& _dir, const std::string& _json, size_t _used = 10);
+
+	//
+	// starts _count copies of the suite's modules cold, with no module index, then warm, with the
+	// index the cold start left behind, both eagerly and lazily, where a lazy start is ready once
+	// everything that updates every frame is loaded, and compares how long each took
+	//
+	void index(const std::string& _dir, const std::string& _json, size_t _count = 1000);
+}
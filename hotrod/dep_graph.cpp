@@ -0,0 +1,267 @@
+//
+//	dep_graph.cpp | Finn Le Var
+//
+#include "dep_graph.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <functional>
+
+//
+// static vars
+//
+namespace
+{
+	// what a module that we dont have depends on
+	const std::vector<std::string> s_none;
+}
+
+//
+// adds a module, or replaces what it depends on
+//
+void dep_graph_t::add(const std::string& _name, const char* const* _depends)
+{
+	// forget what it used to depend on, a new build might not anymore
+	if (auto it = m_depends.find(_name); it != m_depends.end())
+	{
+		for (const auto& dep : it->second)
+			std::erase(m_dependents[dep], _name);
+	}
+
+	auto& depends = m_depends[_name];
+
+	depends.clear();
+
+	for (auto dep = _depends; dep && *dep; ++dep)
+	{
+		// saying it twice doesn't make it depend on it any more
+		if (std::find(depends.begin(), depends.end(), *dep) != depends.end())
+			continue;
+
+		depends.push_back(*dep);
+		m_dependents[*dep].push_back(_name);
+	}
+}
+
+//
+// removes a module
+//
+void dep_graph_t::remove(const std::string& _name)
+{
+	auto it = m_depends.find(_name);
+
+	if (it == m_depends.end())
+		return;
+
+	for (const auto& dep : it->second)
+		std::erase(m_dependents[dep], _name);
+
+	m_depends.erase(it);
+}
+
+//
+// what the given module depends on
+//
+const std::vector<std::string>& dep_graph_t::depends(const std::string& _name) const
+{
+	auto it = m_depends.find(_name);
+
+	return it != m_depends.end() ? it->second : s_none;
+}
+
+//
+// sorts the given modules into waves
+//
+std::vector<std::vector<std::string>> dep_graph_t::waves(const std::vector<std::string>& _names, std::vector<std::string>& _stuck) const
+{
+	const uint32_t count = CASTTO(uint32_t, _names.size());
+
+	std::unordered_map<std::string, uint32_t> index;
+
+	// a name that's given twice is only ever placed once, where it first appears
+	std::vector<bool> duplicate(count, false);
+
+	for (uint32_t i = 0; i < count; ++i)
+		duplicate[i] = !index.emplace(_names[i], i).second;
+
+	// how many of the given modules each one is still waiting on, and who's waiting on it
+	std::vector<uint32_t>			   waiting(count, 0);
+	std::vector<std::vector<uint32_t>> successors(count);
+
+	// whether it depends on something that we dont have, so can never go
+	std::vector<bool> missing(count, false);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (duplicate[i])
+			continue;
+
+		for (const auto& dep : depends(_names[i]))
+		{
+			if (auto it = index.find(dep); it != index.end())
+			{
+				successors[it->second].push_back(i);
+				waiting[i]++;
+			}
+			else if (!contains(dep))
+			{
+				missing[i] = true;
+			}
+		}
+	}
+
+	std::vector<std::vector<std::string>> waves;
+	std::vector<bool>					  placed(duplicate);
+
+	std::vector<uint32_t> current;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (waiting[i] == 0 && !missing[i] && !duplicate[i])
+			current.push_back(i);
+	}
+
+	while (!current.empty())
+	{
+		auto& wave = waves.emplace_back();
+
+		std::vector<uint32_t> next;
+
+		for (uint32_t i : current)
+		{
+			wave.push_back(_names[i]);
+			placed[i] = true;
+
+			for (uint32_t successor : successors[i])
+			{
+				if (--waiting[successor] == 0 && !missing[successor])
+					next.push_back(successor);
+			}
+		}
+
+		// keep each wave in the order we were given, so the result doesn't depend on the edges
+		std::sort(next.begin(), next.end());
+
+		current = std::move(next);
+	}
+
+	// whatever's left is waiting on something that never went
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (!placed[i])
+			_stuck.push_back(_names[i]);
+	}
+
+	return waves;
+}
+
+//
+// every module that depends on the given one
+//
+std::vector<std::string> dep_graph_t::dependents(const std::string& _name) const
+{
+	std::vector<std::string>		found;
+	std::vector<std::string>		frontier = { _name };
+	std::unordered_set<std::string> seen	 = { _name };
+
+	// everyone that depends on it, then everyone that depends on them, and so on
+	while (!frontier.empty())
+	{
+		std::string name = std::move(frontier.back());
+
+		frontier.pop_back();
+
+		auto it = m_dependents.find(name);
+
+		if (it == m_dependents.end())
+			continue;
+
+		for (const auto& dependent : it->second)
+		{
+			if (!seen.insert(dependent).second)
+				continue;
+
+			found.push_back(dependent);
+			frontier.push_back(dependent);
+		}
+	}
+
+	std::sort(found.begin(), found.end());
+
+	// the given module is outside the set we're sorting, so what depends on it can go straight away
+	std::vector<std::string> stuck;
+	std::vector<std::string> ordered;
+
+	for (auto& wave : waves(found, stuck))
+		ordered.insert(ordered.end(), wave.begin(), wave.end());
+
+	// a cycle between them, they've still got to be reloaded, but the order's a guess
+	ordered.insert(ordered.end(), stuck.begin(), stuck.end());
+
+	return ordered;
+}
+
+//
+// finds a cycle that goes through the given module
+//
+std::vector<std::string> dep_graph_t::cycle(const std::string& _name) const
+{
+	std::vector<std::string>		path = { _name };
+	std::unordered_set<std::string> visited;
+
+	std::function<bool(const std::string&)> visit = [&](const std::string& _from)
+	{
+		for (const auto& dep : depends(_from))
+		{
+			if (dep == _name)
+				return true;
+
+			if (!visited.insert(dep).second)
+				continue;
+
+			path.push_back(dep);
+
+			if (visit(dep))
+				return true;
+
+			path.pop_back();
+		}
+
+		return false;
+	};
+
+	if (!visit(_name))
+		return {};
+
+	return path;
+}
+
+//
+// explains why the given module is stuck
+//
+std::string dep_graph_t::why_stuck(const std::string& _name, const std::vector<std::string>& _stuck) const
+{
+	for (const auto& dep : depends(_name))
+	{
+		if (!contains(dep))
+			return "it depends on '" + dep + "', which isn't loaded";
+	}
+
+	if (auto members = cycle(_name); !members.empty())
+	{
+		std::string chain;
+
+		for (const auto& member : members)
+			chain += member + " -> ";
+
+		return "it's part of a dependency cycle, " + chain + _name;
+	}
+
+	for (const auto& dep : depends(_name))
+	{
+		if (std::find(_stuck.begin(), _stuck.end(), dep) != _stuck.end())
+			return "it depends on '" + dep + "', which can't be loaded";
+	}
+
+	return "its dependencies couldn't be loaded";
+}
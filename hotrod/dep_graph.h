@@ -0,0 +1,92 @@
+//
+//	dep_graph.h | Finn Le Var
+//
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+//
+// which modules depend on which, from what each one said in its module_context_t::depends
+//
+// used to work out what order to initialise modules in, so that everything a module calls into
+// is already running by the time it's loaded, and what else has to be reloaded along with a module,
+// so that nothing is left calling into one of its builds that's been unloaded
+//
+// only ever built and used on the main thread, and only for as long as it takes to load or reload
+//
+class dep_graph_t
+{
+private:
+
+	// what each module depends on, and what depends on each module
+	std::unordered_map<std::string, std::vector<std::string>> m_depends;
+	std::unordered_map<std::string, std::vector<std::string>> m_dependents;
+
+public:
+
+	//
+	// adds a module, or replaces what it depends on if we already have it, _depends is the
+	// list from its context, which can be null
+	//
+	void add(const std::string& _name, const char* const* _depends);
+
+	//
+	// removes a module, what it depends on no longer has it as a dependent, but anything that
+	// depends on it still says so
+	//
+	void remove(const std::string& _name);
+
+	//
+	// whether we have the given module
+	//
+	bool contains(const std::string& _name) const
+	{
+		return m_depends.contains(_name);
+	}
+
+	//
+	// what the given module depends on, empty if we dont have it
+	//
+	const std::vector<std::string>& depends(const std::string& _name) const;
+
+	//
+	// whether anything we have depends on the given module directly
+	//
+	bool depended_on(const std::string& _name) const
+	{
+		auto it = m_dependents.find(_name);
+
+		return it != m_dependents.end() && !it->second.empty();
+	}
+
+	//
+	// sorts the given modules into waves, where each only depends on modules in earlier waves, or
+	// modules that we have that aren't in _names, so each wave can be initialised all at once
+	//
+	// anything that depends on a module we dont have, is part of a cycle, or depends on something
+	// that's stuck for either reason, is left out and added to _stuck instead, in the order given
+	// a name that's in _names more than once is only placed, or stuck, once
+	//
+	std::vector<std::vector<std::string>> waves(const std::vector<std::string>& _names, std::vector<std::string>& _stuck) const;
+
+	//
+	// every module that depends on the given one, directly or through others, in an order where
+	// each comes after everything it depends on, not including the given module
+	//
+	std::vector<std::string> dependents(const std::string& _name) const;
+
+	//
+	// finds a cycle that goes through the given module, returns the modules in it in the order that
+	// they depend on each other, empty if there isn't one
+	//
+	std::vector<std::string> cycle(const std::string& _name) const;
+
+	//
+	// explains why the given module ended up in waves()'s _stuck, for printing
+	//
+	std::string why_stuck(const std::string& _name, const std::vector<std::string>& _stuck) const;
+};
@@ -0,0 +1,204 @@
+//
+//	dispatch.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "dll.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "update_graph.h"
+
+//
+// the hooks that we broadcast to every module that implements them
+//
+enum hook_t : uint8_t
+{
+	HOOK_UPDATE = 0,
+	HOOK_FIXED_UPDATE,
+	HOOK_INPUT,
+	HOOK_RELOAD,
+
+	HOOK_COUNT,
+};
+
+// each hook is timed as the trace event with the same value
+static_assert(CASTTO(int, HOOK_UPDATE) == TRACE_UPDATE && CASTTO(int, HOOK_FIXED_UPDATE) == TRACE_FIXED_UPDATE &&
+	CASTTO(int, HOOK_INPUT) == TRACE_INPUT && CASTTO(int, HOOK_RELOAD) == TRACE_RELOAD, "hooks and their trace events must line up");
+
+//
+// returns the string value for the given hook
+//
+inline const char* to_string(hook_t _hook)
+{
+	switch (_hook)
+	{
+	case HOOK_UPDATE:		return "update";
+	case HOOK_FIXED_UPDATE:	return "fixed update";
+	case HOOK_INPUT:		return "input";
+	case HOOK_RELOAD:		return "reload";
+	default:				return "unknown";
+	}
+}
+
+// the signatures of our hooks
+using hook_fn_t	  = void(*)();
+using update_fn_t = void(*)(float, uint64_t);
+
+//
+// a single module's hook, everything we need to call it without going back through its dll
+//
+struct hook_entry_t
+{
+	// the module's function, cast back to the hook's signature when it's called
+	hook_fn_t fn;
+
+	// the module it belongs to
+	module_context_t* mod;
+
+	// where its calls are timed, null if they aren't
+	trace_hist_t* hist;
+
+	// how many frames go between its updates, and which of those frames it updates on, so
+	// that modules with the same divisor are spread out rather than all landing on one frame,
+	// taken from its name so that it stays the same however often the table's rebuilt around it
+	uint32_t divisor;
+	uint32_t phase;
+};
+
+//
+// a flat array of hook entries for each hook, holding only the modules that implement it,
+// so that a tick is a walk over contiguous memory rather than a pointer chase per module
+//
+// it's built from a set of images and points straight into them, so it's only valid for as
+// long as they are, the manager keeps one in each pool snapshot and rebuilds it whenever a
+// dll is loaded, unloaded, or reloaded, which is also when a module's tick divisor is read
+//
+struct dispatch_table_t
+{
+	std::vector<hook_entry_t> hooks[HOOK_COUNT];
+
+	// the order on_update's can run in across the thread pool, see update_parallel()
+	update_graph_t graph;
+
+	//
+	// rebuilds our tables from the given dlls' current images, in the order given
+	//
+	void build(const std::vector<dll_t*>& _dlls)
+	{
+		for (auto& table : hooks)
+		{
+			table.clear();
+			table.reserve(_dlls.size());
+		}
+
+		for (auto dll : _dlls)
+		{
+			dll_image_t* image = dll->image();
+
+			if (!image || !image->loaded())
+				continue;
+
+			module_context_t& ctx = image->ctx;
+
+			uint32_t divisor = std::clamp(ctx.tick_divisor, 1u, CASTTO(uint32_t, SCHED_MAX_DIVISOR));
+
+			// not its place in the table, which moves whenever anything before it is loaded or unloaded
+			uint32_t phase = divisor > 1 ? CASTTO(uint32_t, exports::hash(dll->m_name) % divisor) : 0;
+
+			auto add = [&](hook_t _hook, auto _fn)
+			{
+				if (!_fn)
+					return;
+
+				auto& table = hooks[_hook];
+
+				trace_hist_t* hist = image->trace ? image->trace->hist(CASTTO(trace_event_t, _hook)) : nullptr;
+
+				table.push_back({ .fn = RECAST(hook_fn_t, _fn), .mod = &ctx, .hist = hist, .divisor = divisor, .phase = phase });
+			};
+
+			add(HOOK_UPDATE,	   ctx.CTX_UPDATE_FN);
+			add(HOOK_FIXED_UPDATE, ctx.CTX_FIXED_FN);
+			add(HOOK_INPUT,		   ctx.CTX_INPUT_FN);
+			add(HOOK_RELOAD,	   ctx.CTX_RELOAD_FN);
+		}
+
+		graph.build(hooks[HOOK_UPDATE]);
+	}
+
+	//
+	// calls the given hook on every module that implements it, for hooks that dont take anything
+	//
+	void dispatch(hook_t _hook) const
+	{
+		if (_hook == HOOK_UPDATE || _hook == HOOK_FIXED_UPDATE)
+			printerret(;, "hook '" << to_string(_hook) << "' takes a timestep, use update() or fixed_update()");
+
+		// each call is timed from the end of the last one
+		trace_laps_t laps;
+
+		for (const auto& entry : hooks[_hook])
+		{
+			entry.fn();
+
+			laps.lap(entry.hist);
+		}
+	}
+
+	//
+	// calls on_update on every module that's due this frame, passing each one the time since its last update
+	//
+	void update(const frame_t& _frame) const
+	{
+		trace_laps_t laps;
+
+		for (const auto& entry : hooks[HOOK_UPDATE])
+		{
+			if (entry.divisor > 1 && (_frame.index + entry.phase) % entry.divisor != 0)
+				continue;
+
+			RECAST(update_fn_t, entry.fn)(_frame.dt_for(entry.divisor), _frame.index);
+
+			laps.lap(entry.hist);
+		}
+	}
+
+	//
+	// calls on_update like update(), but runs modules that dont conflict with each other at the same
+	// time across the thread pool, see update_graph_t, walks the table if nothing could run at once
+	//
+	void update_parallel(const frame_t& _frame) const
+	{
+		if (!graph.parallel())
+			return update(_frame);
+
+		graph.run(hooks[HOOK_UPDATE], _frame);
+	}
+
+	//
+	// calls on_fixed_update on every module that implements it, for a single fixed step
+	//
+	void fixed_update(float _dt, uint64_t _step) const
+	{
+		trace_laps_t laps;
+
+		for (const auto& entry : hooks[HOOK_FIXED_UPDATE])
+		{
+			RECAST(update_fn_t, entry.fn)(_dt, _step);
+
+			laps.lap(entry.hist);
+		}
+	}
+
+	//
+	// returns the number of modules that implement the given hook
+	//
+	size_t count(hook_t _hook) const
+	{
+		return hooks[_hook].size();
+	}
+};
@@ -3,20 +3,36 @@
 //
 #pragma once
 
-#include <windows.h>
 #include <unordered_map>
 #include <filesystem>
 #include <chrono>
+#include <atomic>
+#include <functional>
+#include <deque>
 
 #include "util.h"
+#include "shadow.h"
+#include "hash.h"
+#include "exports.h"
+#include "epoch.h"
+#include "thread_pool.h"
+#include "event_bus.h"
+#include "state.h"
+#include "allocator.h"
+#include "trace.h"
+#include "profiler.h"
 #include "shared/print.h"
 #include "shared/context.h"
 
 // for functions and variables that we're reading from the dll
 #define HOT_LOAD extern "C"
 
-// folder that stores all of our currently loaded dlls
-#define CUR_FOLDER "current"
+// the extension of the modules we look for
+#ifdef _WIN32
+#define MOD_EXT ".dll"
+#else
+#define MOD_EXT ".so"
+#endif
 
 // so that we can load functions of different return types that have
 // the same base function sig that we're looking for
@@ -27,38 +43,128 @@ using dllfn_t = type_t(*)();
 // todo : replace module_context_t* with void* so that we can use different context structs rather than a single generic struct
 using module_load_fn_t = void(*)(module_context_t*);
 
+//
+// a single loaded build of a dll, a reload stages a new image next to the old one and
+// then swaps it in, so everything that belongs to one build of the dll lives here
+//
+struct dll_image_t
+{
+    // the handle of our loaded shadow
+    lib_handle_t handle = nullptr;
+
+    // every export it has, read once when it's staged
+    export_table_t exports;
+
+    // the shadow of the dll that we actually loaded
+    shadow_t shadow;
+
+    // the context that this build's module_load filled in
+    module_context_t ctx = {};
+
+    // the write time of the file this image was built from
+    std::filesystem::file_time_type write_time = {};
+
+    // fingerprint of this build, 0 if we didn't take one
+    uint64_t hash = 0;
+
+    // how long it took to fingerprint and to stage this image, in nanoseconds
+    uint64_t hash_ns  = 0;
+    uint64_t stage_ns = 0;
+
+    // where its calls and reload phases are timed, shared by every build of the same dll
+    trace_module_t* trace = nullptr;
+
+    //
+    // returns true if this image was loaded and its module set itself up
+    //
+    bool loaded() const
+    {
+        return handle && ctx.loaded;
+    }
+
+    //
+    // finds the export with the given name, from our table if we managed to read one
+    //
+    void* find(uint64_t _hash, const char* _name) const
+    {
+        if (exports.built())
+            return exports.find(_hash, _name);
+
+        return util::find_sym(handle, _name);
+    }
+
+    void* find(const export_name_t& _name) const
+    {
+        return find(_name.hash, _name.name);
+    }
+};
+
 //
 // dll handle container
 // note : dll lifecycle is now managed by dll_manager_t, see dll_manager.h
 //
 struct dll_t
 {
-    // our dll's handle
-    HMODULE m_handle = nullptr;
+    // the build of our dll that is currently running, swapped atomically so that other threads
+    // can call into it while we reload, always read it through image() from inside an epoch guard
+    std::atomic<dll_image_t*> m_image = nullptr;
 
     // the path to our dll
     std::string m_path;
 
-    // the path to the copied dll that we actually load
-    std::string m_copy_path;
-
     // the dlls filename
     std::string m_name;
 
     // the last time our dll was updated
     std::filesystem::file_time_type m_last_update;
 
-    // our modules context
-    module_context_t m_ctx = {};
+    // how we fingerprint our dll to tell if a rebuild actually changed it
+    hash_mode_t m_hash_mode = HASH_SECTIONS;
+
+    // how many fingerprints we've taken and how long they took in total, in nanoseconds
+    uint64_t m_hash_count   = 0;
+    uint64_t m_hash_ns      = 0;
+
+    // how many times the write time changed but the fingerprint didn't, so we skipped the reload
+    uint64_t m_skipped_reloads = 0;
+
+    // how many times a new build failed to load or initialise, so we kept running the old one
+    uint64_t m_failed_reloads = 0;
+
+    // where our reload phases are timed, see trace()
+    trace_module_t* m_trace = nullptr;
+
+    // every export that's been bound, see bind(), a deque so that handles to them stay put as more are added
+    std::deque<export_slot_t> m_exports;
+
+    // where reload() sends the build it swapped out, the manager sets this so that it can stop
+    // dispatching to it before it's retired, if it isn't set then it's retired straight away
+    std::function<void(dll_image_t*)> m_retire;
 
     //
     // loads our module
     //
-    dll_t(std::string _path = "") : m_path(std::move(_path))
+    dll_t(std::string _path = "", hash_mode_t _hash_mode = HASH_SECTIONS) : m_path(std::move(_path)), m_hash_mode(_hash_mode)
     {
 	    reload(true);
     }
 
+    //
+    // wraps an image that has already been staged, see stage()
+    //
+    dll_t(std::string _path, hash_mode_t _hash_mode, dll_image_t* _image) : m_path(std::move(_path)), m_hash_mode(_hash_mode)
+    {
+        m_name = std::filesystem::path(m_path).stem().string();
+
+        dll_image_t* retired = nullptr;
+
+        install(_image, retired);
+        release(retired);
+    }
+
+    dll_t(const dll_t&) = delete;
+    dll_t& operator=(const dll_t&) = delete;
+
     //
     // unloads our module
     //
@@ -67,235 +173,596 @@ struct dll_t
 	    unload();
     }
 
+    //
+    // gets the build that is currently running, the image stays valid for as long as the
+    // caller holds an epoch guard, the main thread can use it freely between ticks
+    //
+    dll_image_t* image() const
+    {
+        return m_image.load(std::memory_order_acquire);
+    }
+
     // 
     // returns true if the current module is loaded
     // 
     bool loaded() const
     {
-        return m_ctx.loaded && m_handle;
+        dll_image_t* image = this->image();
+
+        return image && image->loaded();
     }
 
     //
-    // loads the dll at the given path into memory
+    // builds a new image of the dll at the given path, shadowing it, loading it, and running its
+    // module_load, but not its on_load, that happens when the image is installed
     //
-    bool load(const std::string& _path, const std::filesystem::file_time_type& _last_update = {})
+    // _hash is the fingerprint the file is already known to have, see module_index_t, so that
+    // it doesn't have to be taken again, 0 if it isn't known
+    //
+    // doesn't touch any dll_t so that it can run on the loader thread, returns nullptr if anything failed
+    //
+    static dll_image_t* stage(const std::string& _path, hash_mode_t _hash_mode, std::filesystem::file_time_type _write_time = {}, uint64_t _hash = 0)
     {
-        if (m_handle)
-            printerret(false, "dll already loaded");
-
         // no path given, cant load nothing
         if (_path.empty())
-            printerret(false, std::format("dll at path '{}' does not exist!", _path));
+            printerret(nullptr, "no dll path given");
 
-        printdebug("loading dll from '" << _path << "'");
+        printdebug("staging dll from '" << _path << "'");
 
-        // path to the folder for the dll that is currently loaded
-        std::filesystem::path current_dir = CUR_FOLDER;
+        auto stem  = std::filesystem::path(_path).stem().string();
+        auto start = std::chrono::steady_clock::now();
+        auto image = new dll_image_t;
 
-        // create current folder if it doesn't exist
-        if (!std::filesystem::exists(current_dir))
-            std::filesystem::create_directory(current_dir);
+        image->trace = g_trace.module(stem);
 
-        // get the file's info for us to build a unique path name using
-        auto filename   = std::filesystem::path(_path).filename();
-        auto stem       = filename.stem();
-        auto extension  = filename.extension();
-        auto timestamp  = std::chrono::system_clock::now().time_since_epoch().count();
+        // time each phase, and the whole thing
+        TRACE_SCOPE(image->trace, TRACE_STAGE);
 
-        // build the path and store it
-        m_copy_path = std::format("current/{}_{}{}", stem.string(), timestamp, extension.string());
+        trace_laps_t laps(image->trace);
 
-        // copy the dll to the current folder
-        try
+        // make a shadow of the dll so that the original isn't locked and can be rebuilt while we're running
+        if (!shadow::create(_path, image->shadow))
         {
-            std::filesystem::copy_file(_path, m_copy_path, std::filesystem::copy_options::overwrite_existing);
+            delete image;
+            printerret(nullptr, std::format("failed to shadow dll '{}'", stem));
         }
-        catch (const std::filesystem::filesystem_error& e)
+
+        laps.lap(TRACE_SHADOW);
+
+        // try load our shadow
+        image->handle = util::load_lib(image->shadow.path);
+
+        laps.lap(TRACE_LOAD_LIB);
+
+        // check if we failed
+        if (!image->handle)
         {
-            // clear the copy path since we didnt load anything
-            m_copy_path = "";
+            // grab the error before releasing the shadow can overwrite it
+            std::string error = util::last_lib_error();
+
+            release(image);
 
-            printerret(false, std::format("failed to copy dll '{}' : {}", stem.string(), e.what()));
+            printerret(nullptr, std::format("failed to load dll '{}' : {}", stem, error));
         }
 
-        printdebug("dll '" << stem.string() << "' copied to '" << m_copy_path << "'");
+        // so that samples in it are credited to us rather than our shadow
+        g_profiler.map(image->shadow.path, stem);
 
-        // try load our copied dll
-        m_handle = LoadLibraryA(m_copy_path.c_str());
+        // record how long this strategy took us
+        shadow::record(image->shadow.type, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
 
-        // check if we failed
-        if (!m_handle)
-            printerret(false, "failed to load dll");
+        // read every export it has, so that nothing has to ask the os's loader for them again
+        laps.restart();
 
-        // successfully loaded
+        if (!image->exports.build(image->handle))
+            printdebug("couldn't read the exports of dll '" << stem << "', looking them up one at a time instead");
 
-        // store the original path, filename, and last update time
-        m_path = _path;
-        m_name = stem.string();
+        // find the module load func
+        auto fn = RECAST(module_load_fn_t, image->find(MOD_LOAD_STR));
+
+        laps.lap(TRACE_FIND_SYM);
+
+        if (!fn)
+        {
+            std::string error = image->exports.built() ? "it isn't exported" : util::last_lib_error();
+
+            release(image);
+
+            printerret(nullptr, std::format("unable to find func '{}' in dll '{}', {}", MOD_LOAD_STR, stem, error));
+        }
+
+        printdebug("found load fn for '" << stem << "'");
+
+        // the module prints straight out until it's given our logger, so get what we've queued out first
+        hot_log::flush();
+
+        laps.restart();
+
+        // load our module and get its context
+        (*fn)(&image->ctx);
+
+        laps.lap(TRACE_MODULE_LOAD);
+
+        // every build gets its own id, so that cleaning up after an old build never touches the new one
+        static std::atomic<uint32_t> s_next_id = 1;
+
+        image->ctx.id = s_next_id.fetch_add(1, std::memory_order_relaxed);
+
+        // make sure it set itself up
+        if (!image->ctx.loaded)
+        {
+            release(image);
+
+            printerret(nullptr, std::format("module_load for dll '{}' didn't finish setting up its context", stem));
+        }
+
+        // fingerprint what we actually loaded so that we can tell if a later rebuild changed anything
+        if (_hash_mode != HASH_OFF && _hash)
+        {
+            image->hash = _hash;
+        }
+        else if (_hash_mode != HASH_OFF)
+        {
+            auto hash_start = std::chrono::steady_clock::now();
+
+            TRACE_SCOPE(image->trace, TRACE_HASH);
+
+            if (!hash::fingerprint_file(image->shadow.path, _hash_mode, image->hash))
+                image->hash = 0;
+
+            image->hash_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - hash_start).count();
+        }
 
         // if no time was given then use the current timestamp, otherwise use the given one
         // so that we dont have to call last_write_time() too often
-        m_last_update = (_last_update.time_since_epoch() == std::filesystem::file_time_type::duration{}) ? std::filesystem::last_write_time(m_path) : _last_update;
+        std::error_code ec;
+
+        image->write_time = (_write_time.time_since_epoch() == std::filesystem::file_time_type::duration{}) ? std::filesystem::last_write_time(_path, ec) : _write_time;
+        image->stage_ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        return image;
+    }
+
+    //
+    // frees the given image's dll and shadow, doesn't call into the module so it's safe to
+    // do off the main thread
+    //
+    static void release(dll_image_t* _image)
+    {
+        if (!_image)
+            return;
+
+        // the name lives in the module, so grab it while we still can
+        const uint32_t	  id   = _image->ctx.id;
+        const std::string name = _image->ctx.name ? _image->ctx.name : "";
+
+        // anything sampled in it has to be credited while it's still loaded
+        if (_image->handle)
+            g_profiler.unmap(_image->shadow.path);
+
+        util::free_lib(_image->handle);
+
+        // something else is holding a reference to it, so its code and statics are staying mapped
+        if (_image->handle && util::lib_loaded(_image->shadow.path))
+            printerror("module '" << name << "' is still loaded after being freed, its memory wont be given back");
+
+        // delete our shadow
+        shadow::release(_image->shadow);
+
+        delete _image;
+
+        // its static destructors have run now, so anything it still has allocated has leaked
+        if (id)
+            g_allocator.report(id, name);
+    }
+
+    //
+    // retires an image that has been swapped out, readers on other threads may still be inside
+    // its hooks, so its on_unload and release are put off until the epoch says they've all left
+    // _release frees it once it's been shut down, defaults to freeing it right there
+    //
+    static void retire(dll_image_t* _image, std::function<void(dll_image_t*)> _release = &dll_t::release)
+    {
+        if (!_image)
+            return;
+
+        g_epoch.retire([_image, release = std::move(_release)]()
+        {
+            shutdown(_image);
+
+            release(_image);
+        });
+    }
+
+    //
+    // lets a build shut itself down, then makes sure that none of the work it handed to the
+    // engine's subsystems is still queued or running, since its code is about to be freed
+    //
+    static void shutdown(dll_image_t* _image)
+    {
+        {
+            TRACE_SCOPE(_image->trace, TRACE_ON_UNLOAD);
+
+            _image->ctx.on_unload();
+        }
+
+        // anything it left behind we clean up for it, but it should have done it itself
+        const size_t subscriptions = g_event_bus.unsubscribe_all(_image->ctx.id);
+        const size_t tasks		   = g_thread_pool.cancel(_image->ctx.id);
+
+        if (subscriptions || tasks)
+            printerror("module '" << (_image->ctx.name ? _image->ctx.name : "?") << "' left " << subscriptions << " subscription(s) and " << tasks << " task(s) behind when it unloaded");
+
+        // let go of its state, or roll it back if this build upgraded it and the old one's still running
+        g_state.release_all(_image->ctx.id);
+    }
+
+    //
+    // swaps the given staged image in as our running build
+    //
+    // the new build is initialised while the old one is still in place, and we only switch
+    // over once its on_load succeeds, otherwise the old build keeps running untouched
+    // passing nullptr just unloads the current build
+    //
+    // on success _retired is set to the old build, which must be handed to retire() since
+    // other threads may still be calling into it, on failure it's set to the rejected new
+    // build, which nobody else has seen and can be released straight away
+    // returns true if the new image is now the running one
+    //
+    // must be called from the main thread between ticks
+    //
+    bool install(dll_image_t* _image, dll_image_t*& _retired)
+    {
+        _retired = nullptr;
+
+        if (_image && !initialise(_image))
+        {
+            _retired = _image;
+            return false;
+        }
+
+        _retired = swap(_image);
 
         return true;
     }
 
     //
-    // checks if its dll has been edited and reloads if so
+    // the first half of install(), calls the given staged image's on_load while our current build
+    // keeps running, returns false if it failed, in which case it's already been shut down
     //
-    module_context_t* reload(bool _init = false)
+    // a build that initialised must either be swap()'d in, or shut down and released if something
+    // else stops it from going in, see dll_manager_t::reload()
+    //
+    bool initialise(dll_image_t* _image)
     {
-        // the last time our dll was updated
-        std::filesystem::file_time_type update_time;
+        TRACE_SCOPE(_image->trace, TRACE_INSTALL);
 
-        // wrapping in a try in case the dll no longer exists
-        try
+        // keep track of how long fingerprinting costs us
+        if (_image->hash_ns)
+            record_hash(_image->hash_ns);
+
+        // test to make sure we loaded
+        _image->ctx.print_info();
+
+        bool initialised = false;
+
+        // pass our engine ctx to the new build for it to access the subsystems
         {
-            // check the last time our dll was updated
-            update_time = std::filesystem::last_write_time(m_path);
+            TRACE_SCOPE(_image->trace, TRACE_ON_LOAD);
+
+            initialised = _image->ctx.on_load(&g_engine);
         }
-        catch (const std::filesystem::filesystem_error& e)
+
+        if (!initialised)
         {
-            printerret(nullptr, std::format("failed to stat dll '{}', {}", m_name, e.what()));
+            // give it a chance to clean up whatever it managed to set up
+            shutdown(_image);
+
+            fail(_image->write_time);
+
+            printerret(false, "module '" << m_name << "' failed to initialise, " << (image() ? "keeping the previous build" : "not loaded"));
         }
 
+        return true;
+    }
+
+    //
+    // the second half of install(), switches over to the given image, which has been initialised,
+    // returns the build it replaced, which must be handed to retire()
+    //
+    dll_image_t* swap(dll_image_t* _image)
+    {
+        // swap in our new build, readers that already have the old one keep using it until they leave
+        dll_image_t* old = m_image.exchange(_image, std::memory_order_acq_rel);
+
+        // and point our handles at it, anyone that read one a moment ago has the old build's, which is fine for the same reason
+        for (auto& slot : m_exports)
+            slot.address.store(_image ? _image->find(slot.hash, slot.name.c_str()) : nullptr, std::memory_order_release);
+
+        if (_image)
+        {
+            m_last_update = _image->write_time;
+
+            printdebug("module '" << m_name << "' loaded!");
+        }
+
+        return old;
+    }
+
+    //
+    // records a build that failed to load, we remember its write time so that we dont
+    // keep retrying the same broken build, the next rebuild will have a new one
+    //
+    void fail(const std::filesystem::file_time_type& _write_time)
+    {
+        m_failed_reloads++;
+
+        if (_write_time.time_since_epoch() != std::filesystem::file_time_type::duration{})
+            m_last_update = _write_time;
+
+        printerror("dll '" << m_name << "' failed to reload (" << m_failed_reloads << " failure(s))");
+    }
+
+    //
+    // loads the dll at the given path into memory
+    //
+    bool load(const std::string& _path, const std::filesystem::file_time_type& _last_update = {})
+    {
+        if (image())
+            printerret(false, "dll already loaded");
+
+        auto image = stage(_path, m_hash_mode, _last_update);
+
+        if (!image)
+            return false;
+
+        // store the original path and filename
+        m_path = _path;
+        m_name = std::filesystem::path(_path).stem().string();
+
+        dll_image_t* retired = nullptr;
+
+        bool installed = install(image, retired);
+
+        if (installed)
+            retire(retired);
+        else
+            release(retired);
+
+        return installed;
+    }
+
+    //
+    // checks if its dll has been edited and reloads if so
+    //
+    module_context_t* reload(bool _init = false)
+    {
         if (_init)
         {
             printdebug("loading module '" << m_path << "'");
 
             // if we've already loaded our module, then just return its context
-            if (m_handle)
-                return &m_ctx;
+            if (image())
+                return &image()->ctx;
+
+            std::filesystem::file_time_type update_time;
+
+            if (!stat(update_time))
+                return nullptr;
+
+            // load our module into memory and run its load funcs
+            if (!load(m_path, update_time))
+                return nullptr;
+
+            return &image()->ctx;
         }
 
-        // printdebug("update time : " << update_time);
-        // printdebug("last update : " << m_last_update);
+        auto image = stage_changed();
+
+        if (!image)
+            return nullptr;
 
-        // has it changed ? or is this the initialising call
-        if (update_time != m_last_update || _init == true)
+        dll_image_t* retired = nullptr;
+
+        if (!install(image, retired))
         {
-            // if so, then reload our dll
+            release(retired);
+            return nullptr;
+        }
+
+        if (m_retire)
+            m_retire(retired);
+        else
+            retire(retired);
+
+        return &image->ctx;
+    }
+
+    //
+    // stages a new build if our dll has changed since the one we're running, returns nullptr if
+    // it hasn't, or if the new build failed to load, it's up to the caller to install() it
+    //
+    dll_image_t* stage_changed()
+    {
+        // the last time our dll was updated
+        std::filesystem::file_time_type update_time;
 
-            if (!_init)
-				printdebug("reloading...");
+        if (!stat(update_time) || update_time == m_last_update)
+            return nullptr;
 
-            // unload
-            unload();
+        // build systems love to touch outputs without changing them, so check if the contents
+        // actually changed before we throw away our module's state for nothing
+        if (unchanged(update_time))
+            return nullptr;
 
-            // load our module into memory
-            load(m_path, update_time);
+        printdebug("reloading...");
 
-            // find and run our modules load func
-            find_and_load();
+        // build the new version next to the old one, which keeps running if anything goes wrong
+        auto image = stage(m_path, m_hash_mode, update_time);
 
-            printdebug("module '" << m_name << "' loaded!");
+        if (!image)
+            fail(update_time);
+
+        return image;
+    }
+
+    //
+    // gets the last time our dll was written to, returns false if we couldn't stat it
+    //
+    bool stat(std::filesystem::file_time_type& _update_time)
+    {
+        // wrapping in a try in case the dll no longer exists
+        try
+        {
+            TRACE_SCOPE(trace(), TRACE_STAT);
 
-            return &m_ctx;
+            // check the last time our dll was updated
+            _update_time = std::filesystem::last_write_time(m_path);
+        }
+        catch (const std::filesystem::filesystem_error& e)
+        {
+            printerret(false, std::format("failed to stat dll '{}', {}", m_name, e.what()));
         }
 
-        return nullptr;
+        return true;
     }
 
     //
-    // unloads our dll
+    // checks if the dll on disk has the same fingerprint as the one we're running, if so then
+    // a rebuild didn't change anything so we just take its new write time
     //
-    void unload()
+    bool unchanged(const std::filesystem::file_time_type& _update_time)
     {
-        if (!m_handle)
-            return;
+        dll_image_t* image = this->image();
 
-        FreeLibrary(m_handle);
+        if (!image || !image->hash || m_hash_mode == HASH_OFF)
+            return false;
 
-        m_handle = nullptr;
+        uint64_t hash  = 0;
+        auto     start = std::chrono::steady_clock::now();
+
+        bool result = false;
 
-        // delete the copied dll file if it exists
-        if (!m_copy_path.empty() && std::filesystem::exists(m_copy_path))
         {
-            try
-            {
-                std::filesystem::remove(m_copy_path);
-            }
-            catch (const std::filesystem::filesystem_error& e)
-            {
-                printerror(std::format("failed to delete copied dll '{}' : {}", m_name, e.what()));
-            }
+            TRACE_SCOPE(trace(), TRACE_HASH);
+
+            result = hash::fingerprint_file(m_path, m_hash_mode, hash);
         }
 
-        printdebug("dll '" << m_name << "' unloaded");
+        record_hash(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
 
-        // only clear the copy path, we dont want to clear m_path bc thats the file
-        // we're watching and dont want to lose it
-        m_copy_path.clear();
+        if (!result)
+            printerret(false, "failed to fingerprint dll '" << m_path << "'");
 
-        // clear our context and last update time
-        m_ctx           = {};
-        m_last_update   = {};
+        if (hash != image->hash)
+            return false;
+
+        skip(_update_time);
+
+        return true;
     }
 
     //
-    // tries to find the func with the given name in our dll and returns it
+    // takes the new write time of a rebuild that didn't change anything
     //
-    template<typename type_t>
-    dllfn_t<type_t> find(const std::string& _func)
+    void skip(const std::filesystem::file_time_type& _update_time)
     {
-        if (!m_handle)
-            printerret(nullptr, "no dll loaded");
+        printdebug("dll '" << m_name << "' touched but unchanged, skipping reload");
 
-        // try to find our function in our dll's memory
-        auto fn = RECAST(dllfn_t<type_t>, GetProcAddress(m_handle, _func.c_str()));
+        m_last_update = _update_time;
+        m_skipped_reloads++;
+    }
 
-        if (!fn)
-            printerret(nullptr, std::format("unable to find func '{}' in dll '{}'", _func, m_name));
+    //
+    // gets where our reload phases are timed, by our dll's name so that it's the same one our builds use
+    //
+    trace_module_t* trace()
+    {
+        if (!m_trace)
+            m_trace = g_trace.module(std::filesystem::path(m_path).stem().string());
 
-        return fn;
+        return m_trace;
     }
 
     //
-    // finds the module load function and returns it 
+    // keeps track of how long our fingerprints are taking
     //
-    std::optional<module_load_fn_t> find_load_fn() const
+    void record_hash(uint64_t _ns)
     {
-        if (!m_handle)
-            printerret(std::nullopt, "dll '" << m_name << "' not loaded");
+        m_hash_ns += _ns;
+        m_hash_count++;
+    }
 
-        // try to find our function in our dll's memory
-        auto fn = RECAST(module_load_fn_t, GetProcAddress(m_handle, MOD_LOAD_STR));
+    //
+    // unloads our dll
+    //
+    void unload()
+    {
+        if (!image())
+            return;
 
-        if (!fn)
-            printerret(std::nullopt, std::format("unable to find func '{}' in dll '{}', {}", MOD_LOAD_STR, m_name, util::format_win32_error(GetLastError())));
+        dll_image_t* retired = nullptr;
 
-        return fn;
+        install(nullptr, retired);
+        retire(retired);
+
+        printdebug("dll '" << m_name << "' unloaded");
+
+        // clear our last update time, we dont want to clear m_path bc thats the file
+        // we're watching and dont want to lose it
+        m_last_update = {};
     }
 
     //
-    // runs the given module load function, passing the given module context arg
+    // tries to find the func with the given name in our dll and returns it, a string literal is
+    // hashed at compile time, anything else has to go through export_name_t::runtime()
     //
-    void loadfn(const module_load_fn_t& _fn) { (*_fn)(&m_ctx); }
+    template<typename type_t>
+    dllfn_t<type_t> find(const export_name_t& _func)
+    {
+        dll_image_t* image = this->image();
+
+        if (!image)
+            printerret(nullptr, "no dll loaded");
+
+        // try to find our function in our dll's memory, it's only valid while the caller holds an epoch guard
+        auto fn = RECAST(dllfn_t<type_t>, image->find(_func));
+
+        if (!fn)
+            printerret(nullptr, std::format("unable to find func '{}' in dll '{}'", _func.name, m_name));
+
+        return fn;
+    }
 
     //
-    // finds the load fn then runs it
+    // gets a handle to the export with the given name, which keeps pointing at the running build's
+    // export as we're reloaded, so it can be held on to instead of calling find() every time
     //
-    void find_and_load()
+    // binding the same name twice gives the same handle, a build that doesn't export it leaves
+    // the handle null until one does, must be called from the main thread
+    //
+    template<typename fn_t>
+    export_handle_t<fn_t> bind(const export_name_t& _name)
     {
-        // find the module load func
-        auto fn = find_load_fn();
-
-        // did we load it ?
-        if (fn != std::nullopt)
+        for (const auto& slot : m_exports)
         {
-            // loaded
+            if (slot.hash == _name.hash && slot.name == _name.name)
+                return export_handle_t<fn_t>(&slot);
+        }
 
-            printdebug("found load fn for '" << m_name << "'");
+        auto& slot = m_exports.emplace_back();
 
-            // load our module and get its context
-            loadfn(*fn);
+        slot.name = _name.name;
+        slot.hash = _name.hash;
 
-            // test to make sure we loaded
-            m_ctx.print_info();
+        dll_image_t* image = this->image();
 
-            // pass our engine ctx to the module for it to access the subsystems
-            m_ctx.on_load(&g_engine);
-        }
+        slot.address.store(image ? image->find(slot.hash, slot.name.c_str()) : nullptr, std::memory_order_release);
+
+        if (image && !slot.address.load(std::memory_order_relaxed))
+            printdebug("dll '" << m_name << "' doesn't export '" << _name.name << "' yet, its handle will be null until it does");
+
+        return export_handle_t<fn_t>(&slot);
     }
 
     //
@@ -303,6 +770,6 @@ struct dll_t
     //
     bool operator !() const
     {
-        return !m_handle;
+        return !image();
     }
-};
+};
\ No newline at end of file
@@ -4,64 +4,1553 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <filesystem>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <utility>
 
 #include "dll.h"
+#include "dispatch.h"
+#include "dep_graph.h"
+#include "module_index.h"
+#include "frame_arena.h"
+#include "logger.h"
+#include "epoch.h"
+#include "loader.h"
+#include "watcher.h"
 #include "shared/print.h"
 #include "shared/assert.h"
 
 
+//
+// an immutable snapshot of the loaded dlls, the manager never changes one once it's been
+// published, it builds a new one and swaps it in, so readers can walk it without locking
+//
+struct dll_pool_t
+{
+	// loaded dlls, keyed by filename without extension
+	std::unordered_map<std::string, dll_t*> map;
+
+	// the same dlls sorted by name, for dispatching to them in a stable order
+	std::vector<dll_t*> list;
+
+	// each hook's implementations, in the same order as list
+	dispatch_table_t dispatch;
+};
+
 //
 // dll manager class
 // handles finding, loading, storing, and managing all dlls
 //
+// the pool can be read from any thread, readers hold an epoch guard (g_epoch.enter()) while
+// they use anything they got from it, and replaced dlls, images, and pools are only freed once
+// they've all left, everything that changes the pool must happen on the main thread
+//
 class dll_manager_t
 {
 private:
 
-	// pool of loaded dlls, keyed by filename without extension
-	// todo : mutex ?
-	std::unordered_map<std::string, dll_t*> m_pool;
+	// the current snapshot of our pool, never null
+	std::atomic<const dll_pool_t*> m_pool = new dll_pool_t;
+
+	// the pool we're building while editing, copied from the current one the first time an edit
+	// changes something, published as the new snapshot once the outermost edit finishes
+	dll_pool_t* m_edit = nullptr;
+
+	// how deeply nested our edits are
+	uint32_t m_edit_depth = 0;
+
+	// images swapped out during the current edit, only retired once a pool that doesn't
+	// dispatch to them has been published
+	std::vector<dll_image_t*> m_edit_retired;
+
+	// dlls removed from the pool during the current edit, in the order they're to be shut down,
+	// only retired once a pool that doesn't have them in it has been published, same as above
+	std::vector<dll_t*> m_edit_removed;
+
+	// how many pools we've published, and how long rebuilding them took in total, in nanoseconds
+	uint64_t m_publish_count = 0;
+	uint64_t m_publish_ns	 = 0;
+
+	// list of paths we're watching for dlls
+	std::vector<std::string> m_paths;
+
+	// os file watcher for our paths, if it isn't active then we fall back to polling
+	watcher_t m_watcher;
+
+	// how new dlls fingerprint themselves to skip reloads that dont change anything
+	hash_mode_t m_hash_mode = HASH_SECTIONS;
+
+	// background loader that stages reloads off the main thread
+	loader_t m_loader;
+
+	// whether reloads go through the loader or happen inline
+	bool m_async = true;
+
+	// whether modules that said what they touch are updated across the thread pool
+	bool m_parallel = true;
+
+	// how long installing staged images has taken at the tick boundary, in nanoseconds
+	uint64_t m_install_count	= 0;
+	uint64_t m_install_total_ns = 0;
+	uint64_t m_install_max_ns	= 0;
+
+	// how many threads discovery loads dlls across, 0 uses one per core
+	size_t m_load_threads = 0;
+
+	// whether on_load is called for newly discovered dlls one at a time in path order on the
+	// calling thread, or across the load threads, a wave of dlls that dont depend on each other at a time
+	bool m_ordered_init = true;
+
+	// the last discovery that loaded anything, how many it loaded, how long it took, and the
+	// total of how long each dll took, in nanoseconds, so that we can see how well it overlapped
+	size_t	 m_cold_count	  = 0;
+	size_t	 m_cold_threads	  = 0;
+	uint64_t m_cold_wall_ns	  = 0;
+	uint64_t m_cold_module_ns = 0;
+
+	// how many waves the last discovery's dependencies split it into
+	size_t m_cold_waves = 0;
+
+	// builds that are being initialised as part of a reload, but haven't been swapped in yet, so
+	// that the modules that depend on them find them rather than the builds they're replacing
+	std::unordered_map<std::string, dll_image_t*> m_initialising;
+
+	// how many reloads took modules that depend on the one that changed with them, and how many
+	// modules that was in total
+	uint64_t m_cascade_count   = 0;
+	uint64_t m_cascade_modules = 0;
+
+	//
+	// a module that discovery found while loading lazily, it's only loaded once something needs it
+	//
+	struct lazy_module_t
+	{
+		std::string path;
+
+		// the last time something needed it, see require()
+		std::chrono::steady_clock::time_point used;
+
+		// the hooks it implemented the last time it was loaded, as bits of hook_t, so that
+		// require_hook() knows to load it again, nothing until it's been loaded once, unless
+		// the index remembers them from an earlier run
+		uint32_t hooks = 0;
+
+		// how many times it's been loaded and evicted
+		uint32_t loads	   = 0;
+		uint32_t evictions = 0;
+	};
+
+	// whether discovery only registers the dlls it finds, rather than loading them
+	bool m_lazy = false;
+
+	// every dll discovery has registered while loading lazily, loaded or not, by name
+	std::unordered_map<std::string, lazy_module_t> m_registered;
+
+	// registered modules that are loaded as soon as they're found and never evicted
+	std::unordered_set<std::string> m_pinned;
+
+	// the hooks, as bits of hook_t, that a registered module that isn't loaded implements, so that the
+	// tick only looks through what's registered when it might have something to load, worked out again
+	// whenever what's registered or what's loaded changes
+	uint32_t m_missing_hooks = 0;
+	bool	 m_missing_stale = true;
+
+	// the hooks the tick has dispatched since we last looked for modules to evict, every module that
+	// implements one was needed then, so it's counted as needed once per sweep rather than once per tick
+	uint32_t m_dispatched = 0;
+
+	// registered modules that are being loaded on demand right now, so that a cycle between them ends
+	std::unordered_set<std::string> m_requiring;
+
+	// how long a registered module can go unneeded before it's evicted, zero to never evict them for it
+	std::chrono::milliseconds m_idle_timeout = std::chrono::seconds(30);
+
+	// how many registered modules can be loaded at once before the least recently needed are evicted, 0 for no limit
+	size_t m_max_resident = 0;
+
+	// when we last looked for modules to evict
+	std::chrono::steady_clock::time_point m_last_sweep;
+
+	// how many modules have been loaded on demand, how long that took in total, in nanoseconds, and how many were evicted
+	uint64_t m_demand_loads	  = 0;
+	uint64_t m_demand_load_ns = 0;
+	uint64_t m_evictions	  = 0;
+
+	// what we knew about every module the last time it was loaded, so that starting up doesn't have
+	// to scan watch paths that haven't changed, or fingerprint modules that haven't
+	module_index_t m_index;
+
+	// where our index is kept, empty to not keep one
+	std::string m_index_path = CUR_FOLDER "/modules.index";
+
+	// how long reading and last writing the index took, in nanoseconds, and how many watch path scans it saved
+	uint64_t m_index_read_ns  = 0;
+	uint64_t m_index_write_ns = 0;
+	uint64_t m_scans_skipped  = 0;
+
+	// how many modules discovery loaded that the index was up to date for, and how many it wasn't,
+	// counted from the load threads
+	std::atomic<uint64_t> m_index_hits	 = 0;
+	std::atomic<uint64_t> m_index_misses = 0;
+
+	// whether the manager has been initialised
+	bool m_init = false;
+
+	//
+	// batches changes to the pool into a single new snapshot for as long as it's alive
+	//
+	class edit_t
+	{
+	private:
+
+		dll_manager_t& m_manager;
+
+	public:
+
+		explicit edit_t(dll_manager_t& _manager) : m_manager(_manager)
+		{
+			m_manager.begin_edit();
+		}
+
+		edit_t(const edit_t&) = delete;
+		edit_t& operator=(const edit_t&) = delete;
+
+		~edit_t()
+		{
+			m_manager.end_edit();
+		}
+	};
+
+private:
+
+	//
+	// hide constructor so we can't create more instances
+	// touching the epoch and our subsystems first makes sure they're destroyed after us, since we
+	// need them to shut our dlls down
+	//
+	dll_manager_t()
+	{
+		logger_t::getinst();
+		tracer_t::getinst();
+		profiler_t::getinst();
+		epoch_t::getinst();
+		thread_pool_t::getinst();
+		event_bus_t::getinst();
+		state_heap_t::getinst();
+		pool_allocator_t::getinst();
+	}
+
+	//
+	// starts an edit, nothing is copied until something actually changes
+	//
+	void begin_edit()
+	{
+		m_edit_depth++;
+	}
+
+	//
+	// gets the pool we're building, copying the current one if this is the first change in
+	// this edit, must be inside an edit
+	//
+	dll_pool_t& changing()
+	{
+		if (!m_edit)
+			m_edit = new dll_pool_t(*m_pool.load(std::memory_order_relaxed));
+
+		return *m_edit;
+	}
+
+	//
+	// publishes the pool we've been building once the outermost edit finishes, if anything changed
+	//
+	void end_edit()
+	{
+		if (--m_edit_depth != 0 || !m_edit)
+			return;
+
+		auto start = std::chrono::steady_clock::now();
+
+		m_edit->list.clear();
+		m_edit->list.reserve(m_edit->map.size());
+
+		for (const auto& [name, dll] : m_edit->map)
+			m_edit->list.push_back(dll);
+
+		std::sort(m_edit->list.begin(), m_edit->list.end(), [](const dll_t* _a, const dll_t* _b) { return _a->m_name < _b->m_name; });
+
+		// point our hooks at everyone's current builds
+		m_edit->dispatch.build(m_edit->list);
+
+		const dll_pool_t* old = m_pool.exchange(m_edit, std::memory_order_acq_rel);
+
+		m_edit = nullptr;
+
+		// readers may still be walking the old one
+		g_epoch.retire([old]() { delete old; });
+
+		// nothing published dispatches to these anymore, so they can go the same way, once no
+		// reader can be in them, they're shut down on the main thread then handed to the loader to free
+		for (auto image : m_edit_retired)
+			dll_t::retire(image, [this](dll_image_t* _old) { m_loader.release(_old); });
+
+		m_edit_retired.clear();
+
+		// retired after the pool that dropped them, so that a reader who pinned the epoch their retire
+		// bumped to is guaranteed to see a pool without them, rather than the old one
+		for (auto dll : m_edit_removed)
+			g_epoch.retire([dll]() { delete dll; });
+
+		m_edit_removed.clear();
+
+		// what's loaded has changed, so what the tick might have to load has too
+		m_missing_stale = true;
+
+		m_publish_count++;
+		m_publish_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//
+	// the pool as the main thread sees it, including changes made by an edit in progress
+	//
+	const dll_pool_t& writable() const
+	{
+		return m_edit ? *m_edit : *m_pool.load(std::memory_order_relaxed);
+	}
+
+	//
+	// retires an image that one of our dlls swapped out, the published pool's dispatch tables
+	// still point into it, so we publish a new one first and retire it after
+	//
+	void retire(dll_image_t* _image)
+	{
+		if (!_image)
+			return;
+
+		edit_t edit(*this);
+
+		changing();
+
+		m_edit_retired.push_back(_image);
+	}
+
+	//
+	// creates a dll for the given path that sends the builds it swaps out to us to retire
+	//
+	template<typename... args_t>
+	dll_t* create(args_t&&... _args)
+	{
+		auto dll = new dll_t(std::forward<args_t>(_args)...);
+
+		dll->m_retire = [this](dll_image_t* _image) { retire(_image); };
+
+		return dll;
+	}
+
+	//
+	// a dll that's been staged but hasn't been added to the pool yet
+	//
+	struct pending_t
+	{
+		std::string name;
+		std::string path;
+
+		dll_image_t* image = nullptr;
+		dll_t*		 dll   = nullptr;
+
+		// how long it took to stage and initialise, in nanoseconds
+		uint64_t ns = 0;
+	};
+
+	//
+	// calls _fn with every index up to _count, spread across up to _threads threads, the
+	// calling thread included, blocking until they're all done
+	//
+	template<typename fn_t>
+	static void spread(size_t _count, size_t _threads, fn_t&& _fn)
+	{
+		// each thread takes the next index until there are none left
+		std::atomic<size_t> next = 0;
+
+		auto worker = [&]()
+		{
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < _count;)
+				_fn(i);
+		};
+
+		_threads = std::min(_threads, _count);
+
+		// the calling thread works too, so we only need to start the rest
+		std::vector<std::thread> pool;
+
+		for (size_t i = 1; i < _threads; ++i)
+			pool.emplace_back(worker);
+
+		worker();
+
+		for (auto& thread : pool)
+			thread.join();
+	}
+
+	//
+	// what every dll in the pool depends on, as the main thread sees it
+	//
+	dep_graph_t dependencies() const
+	{
+		dep_graph_t graph;
+
+		for (const auto& [name, dll] : writable().map)
+		{
+			dll_image_t* image = dll->image();
+
+			graph.add(name, image ? image->ctx.depends : nullptr);
+		}
+
+		return graph;
+	}
+
+	//
+	// the dlls in the pool, in an order where each comes after everything it depends on
+	//
+	std::vector<dll_t*> ordered() const
+	{
+		const auto& map = writable().map;
+
+		std::vector<std::string> names;
+		names.reserve(map.size());
+
+		for (const auto& [name, dll] : map)
+			names.push_back(name);
+
+		std::sort(names.begin(), names.end());
+
+		std::vector<std::string> stuck;
+		std::vector<dll_t*>		 dlls;
+
+		for (const auto& wave : dependencies().waves(names, stuck))
+		{
+			for (const auto& name : wave)
+				dlls.push_back(map.at(name));
+		}
+
+		// a new build can't bring in a cycle, but whatever's there still has to be in the list
+		for (const auto& name : stuck)
+			dlls.push_back(map.at(name));
+
+		return dlls;
+	}
+
+	//
+	// the hooks the given module implements, as bits of hook_t
+	//
+	static uint32_t hooks_of(const module_context_t& _ctx)
+	{
+		return (_ctx.CTX_UPDATE_FN ? 1u << HOOK_UPDATE : 0) | (_ctx.CTX_FIXED_FN ? 1u << HOOK_FIXED_UPDATE : 0) |
+			   (_ctx.CTX_INPUT_FN ? 1u << HOOK_INPUT : 0) | (_ctx.CTX_RELOAD_FN ? 1u << HOOK_RELOAD : 0);
+	}
+
+	//
+	// records what we know about the given module in the index, from the build it's running
+	//
+	void remember(const std::string& _name, const dll_t* _dll)
+	{
+		dll_image_t* image = _dll->image();
+
+		if (m_index_path.empty() || !image)
+			return;
+
+		std::error_code ec;
+
+		index_entry_t entry =
+		{
+			.path		= _dll->m_path,
+			.size		= std::filesystem::file_size(_dll->m_path, ec),
+			.write_time = image->write_time,
+			.hash		= image->hash,
+			.hash_mode	= _dll->m_hash_mode,
+			.major		= image->ctx.major,
+			.minor		= image->ctx.minor,
+			.hooks		= hooks_of(image->ctx),
+		};
+
+		// it's gone already, so there's nothing to be right about
+		if (ec)
+		{
+			m_index.erase(_name);
+			return;
+		}
+
+		for (auto dep = image->ctx.depends; dep && *dep; ++dep)
+			entry.depends.push_back(*dep);
+
+		m_index.set(_name, std::move(entry));
+	}
+
+	//
+	// stages a new dll, taking its fingerprint from the index if it hasn't changed since the index
+	// saw it, safe to call from the load threads as long as nothing is changing the index
+	//
+	dll_image_t* stage_known(const std::string& _name, const std::string& _path)
+	{
+		const index_entry_t* known = m_index.find(_name, _path);
+
+		if (!known || !known->hash || known->hash_mode != m_hash_mode)
+		{
+			m_index_misses++;
+
+			return dll_t::stage(_path, m_hash_mode);
+		}
+
+		m_index_hits++;
+
+		return dll_t::stage(_path, m_hash_mode, known->write_time, known->hash);
+	}
+
+	//
+	// writes the index out if anything in it has changed
+	//
+	void save_index()
+	{
+		if (m_index_path.empty() || !m_index.dirty())
+			return;
+
+		auto start = std::chrono::steady_clock::now();
+
+		if (m_index.save(m_index_path))
+			printdebug("saved " << m_index.entries().size() << " module(s) to the index at '" << m_index_path << "'");
+
+		m_index_write_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//
+	// loads whatever in the given list of dependencies has only been registered so far, other than
+	// anything in _loading, which is being loaded along with whoever depends on it
+	//
+	void require_depends(const char* const* _depends, const std::vector<pending_t>& _loading = {})
+	{
+		for (auto dep = _depends; dep && *dep; ++dep)
+		{
+			if (writable().map.contains(*dep) || !m_registered.contains(*dep))
+				continue;
+
+			if (std::any_of(_loading.begin(), _loading.end(), [&](const pending_t& _pending) { return _pending.name == *dep; }))
+				continue;
+
+			require(*dep);
+		}
+	}
+
+	//
+	// creates dlls for the given staged images and adds them to the pool, a wave at a time so that
+	// every module is initialised after everything it depends on, anything that depends on a module
+	// that isn't loaded, or is part of a cycle, is released without being initialised
+	//
+	// with ordered init each wave is initialised one at a time in the order given, otherwise their
+	// on_loads are spread across up to _threads threads, _waves is set to how many waves there were
+	// returns the number of dlls that loaded
+	//
+	size_t install_new(std::vector<pending_t>& _pending, size_t _threads = 1, size_t* _waves = nullptr)
+	{
+		edit_t edit(*this);
+
+		// anything they depend on that's only been registered has to be loaded before them
+		for (const auto& pending : _pending)
+		{
+			if (pending.image)
+				require_depends(pending.image->ctx.depends, _pending);
+		}
+
+		dep_graph_t graph = dependencies();
+
+		std::vector<std::string>					names;
+		std::unordered_map<std::string, pending_t*> by_name;
+
+		for (auto& pending : _pending)
+		{
+			// anything that depends on it is stuck below
+			if (!pending.image)
+			{
+				printerror("failed to load dll '" << pending.name << "'");
+				continue;
+			}
+
+			graph.add(pending.name, pending.image->ctx.depends);
+
+			// only ever one build of a module, the later one's the newer, so it replaces the first
+			if (auto [it, added] = by_name.try_emplace(pending.name, &pending); !added)
+			{
+				printerror("dll '" << pending.name << "' was staged twice, only installing its newest build");
+
+				m_loader.release(std::exchange(it->second->image, nullptr));
+				it->second = &pending;
+
+				continue;
+			}
+
+			names.push_back(pending.name);
+		}
+
+		std::vector<std::string> stuck;
+
+		auto waves = graph.waves(names, stuck);
+
+		for (const auto& name : stuck)
+		{
+			printerror("not loading module '" << name << "', " << graph.why_stuck(name, stuck));
+
+			m_loader.release(std::exchange(by_name[name]->image, nullptr));
+		}
+
+		// anything that failed to initialise, so that whatever depends on it isn't initialised either
+		std::unordered_set<std::string> failed;
+
+		size_t loaded_count = 0;
+
+		for (const auto& wave : waves)
+		{
+			std::vector<pending_t*> ready;
+
+			for (const auto& name : wave)
+			{
+				pending_t* pending = by_name[name];
+
+				const auto& depends = graph.depends(name);
+
+				auto dep = std::find_if(depends.begin(), depends.end(), [&](const std::string& _dep) { return failed.contains(_dep); });
+
+				if (dep != depends.end())
+				{
+					printerror("not loading module '" << name << "', it depends on '" << *dep << "', which failed to load");
+
+					m_loader.release(std::exchange(pending->image, nullptr));
+					failed.insert(name);
+
+					continue;
+				}
+
+				ready.push_back(pending);
+			}
+
+			// run its on_load now that everything it depends on is running
+			auto initialise = [&](size_t _index)
+			{
+				pending_t& pending = *ready[_index];
+
+				auto start = std::chrono::steady_clock::now();
+
+				pending.dll = create(pending.path, m_hash_mode, std::exchange(pending.image, nullptr));
+				pending.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			};
+
+			spread(ready.size(), m_ordered_init ? 1 : _threads, initialise);
+
+			// add the wave to the pool we're building before the next one goes, so that it can find them
+			for (pending_t* pending : ready)
+			{
+				if (!pending->dll || !pending->dll->loaded())
+				{
+					printerror("failed to load dll '" << pending->name << "'");
+
+					delete std::exchange(pending->dll, nullptr);
+					failed.insert(pending->name);
+
+					continue;
+				}
+
+				changing().map[pending->name] = pending->dll;
+
+				// so that we know when it was last needed, and when it's needed again once it's been evicted
+				if (auto it = m_registered.find(pending->name); it != m_registered.end())
+				{
+					it->second.used	 = std::chrono::steady_clock::now();
+					it->second.hooks = hooks_of(pending->dll->image()->ctx);
+					it->second.loads++;
+				}
+
+				remember(pending->name, pending->dll);
+
+				printmsg("dll '" << pending->name << "' loaded successfully");
+
+				loaded_count++;
+			}
+		}
+
+		if (_waves)
+			*_waves = waves.size();
+
+		return loaded_count;
+	}
+
+	//
+	// swaps in a new build of the given dll, along with a new build of everything that depends on
+	// it, directly or not, so that nothing is left calling into the build it replaces
+	//
+	// every new build is initialised, dependencies first, before any of them are swapped in, so if
+	// any of them fail then they're all thrown away and every old build carries on untouched
+	//
+	// _staged has builds that were staged for this tick already, which are used rather than staging
+	// their dlls again, and taken out of it
+	// returns the number of dlls that were reloaded, 0 if the new build was rejected
+	//
+	size_t reload(dll_t* _dll, dll_image_t* _image, std::unordered_map<std::string, dll_image_t*>& _staged)
+	{
+		// publish everything that changed as a single new pool
+		edit_t edit(*this);
+
+		// the new build might not depend on the same things as the old one
+		require_depends(_image->ctx.depends);
+
+		dep_graph_t graph = dependencies();
+
+		graph.add(_dll->m_name, _image->ctx.depends);
+
+		std::string rejected;
+
+		for (const auto& dep : graph.depends(_dll->m_name))
+		{
+			if (!graph.contains(dep))
+				rejected = "it depends on '" + dep + "', which isn't loaded";
+		}
+
+		if (rejected.empty() && !graph.cycle(_dll->m_name).empty())
+			rejected = graph.why_stuck(_dll->m_name, {});
+
+		if (!rejected.empty())
+		{
+			printerror("rejecting the new build of module '" << _dll->m_name << "', " << rejected);
+
+			_dll->fail(_image->write_time);
+			m_loader.release(_image);
+
+			return 0;
+		}
+
+		//
+		// a dll we're swapping a new build into
+		//
+		struct swap_t
+		{
+			dll_t*		 dll;
+			dll_image_t* image;
+		};
+
+		std::vector<swap_t> swaps = { { _dll, _image } };
+
+		for (const auto& name : graph.dependents(_dll->m_name))
+		{
+			dll_image_t* staged = nullptr;
+
+			if (auto it = _staged.find(name); it != _staged.end())
+			{
+				staged = it->second;
+				_staged.erase(it);
+			}
+
+			swaps.push_back({ writable().map.at(name), staged });
+		}
+
+		// stage everything else that depends on it again, across the pool since there could be a lot of them
+		g_thread_pool.parallel_for(0, swaps.size(), 1, [](void* _swaps, size_t _begin, size_t _end)
+		{
+			for (size_t i = _begin; i < _end; ++i)
+			{
+				swap_t& swap = (*CASTTO(std::vector<swap_t>*, _swaps))[i];
+
+				if (!swap.image)
+					swap.image = dll_t::stage(swap.dll->m_path, swap.dll->m_hash_mode);
+			}
+		}, &swaps, TASK_HIGH);
+
+		// initialise them in order, each one finds the new builds of what it depends on
+		size_t initialised = 0;
+
+		for (; initialised < swaps.size(); ++initialised)
+		{
+			swap_t& swap = swaps[initialised];
+
+			if (!swap.image)
+			{
+				printerror("failed to stage a new build of module '" << swap.dll->m_name << "'");
+				break;
+			}
+
+			m_initialising[swap.dll->m_name] = swap.image;
+
+			// it's shut itself down if it failed
+			if (!swap.dll->initialise(swap.image))
+				break;
+		}
+
+		m_initialising.clear();
+
+		if (initialised != swaps.size())
+		{
+			const std::string& culprit = swaps[initialised].dll->m_name;
+
+			// it's the new build that did it, so we dont keep trying it
+			if (initialised != 0)
+			{
+				_dll->fail(_image->write_time);
+
+				printerror("rejecting the new build of module '" << _dll->m_name << "', '" << culprit << "' depends on it and couldn't be reloaded with it");
+			}
+
+			// the ones that initialised are undone in reverse, none of them were ever seen
+			for (size_t i = initialised; i-- > 0;)
+				dll_t::shutdown(swaps[i].image);
+
+			for (auto& swap : swaps)
+				m_loader.release(swap.image);
+
+			return 0;
+		}
+
+		std::vector<dll_image_t*> retired;
+
+		for (auto& swap : swaps)
+			retired.push_back(swap.dll->swap(swap.image));
+
+		// the old builds that depend on the others are shut down first, they might still call into them
+		for (auto it = retired.rbegin(); it != retired.rend(); ++it)
+			retire(*it);
+
+		for (auto& swap : swaps)
+		{
+			swap.image->ctx.on_reload();
+
+			// a new build can have different hooks, and was needed just now
+			if (auto it = m_registered.find(swap.dll->m_name); it != m_registered.end())
+			{
+				it->second.used	 = std::chrono::steady_clock::now();
+				it->second.hooks = hooks_of(swap.image->ctx);
+			}
+
+			remember(swap.dll->m_name, swap.dll);
+		}
+
+		if (swaps.size() > 1)
+		{
+			m_cascade_count++;
+			m_cascade_modules += swaps.size() - 1;
+
+			printmsg("reloaded " << swaps.size() - 1 << " module(s) that depend on '" << _dll->m_name << "' along with it");
+		}
+
+		return swaps.size();
+	}
+
+	//
+	// loads whatever's registered for a hook that the tick dispatches, see require_hook(), and notes
+	// that it was dispatched for evict_idle(), only looks through what's registered when what's
+	// registered or loaded has changed, and something that implements the hook might not be loaded
+	//
+	void require_tick_hook(hook_t _hook)
+	{
+		m_dispatched |= 1u << _hook;
+
+		if (m_registered.empty())
+			return;
+
+		if (m_missing_stale)
+		{
+			const auto& map = writable().map;
+
+			m_missing_hooks = 0;
+			m_missing_stale = false;
+
+			for (const auto& [name, module] : m_registered)
+			{
+				if (module.hooks && !map.contains(name))
+					m_missing_hooks |= module.hooks;
+			}
+		}
+
+		if (!(m_missing_hooks & (1u << _hook)))
+			return;
+
+		// anything it can't load now, for being over the resident limit, waits until something changes
+		m_missing_hooks &= ~(1u << _hook);
+
+		require_hook(_hook);
+	}
+
+	//
+	// removes a dll from the pool and deletes it once nobody can be using it
+	//
+	void remove(const std::string& _name)
+	{
+		auto& map = changing().map;
+		auto  it  = map.find(_name);
+
+		if (it == map.end())
+			return;
+
+		dll_t* dll = it->second;
+
+		map.erase(it);
+
+		// delete the dll (calls destructor which unloads it) once the pool without it is published and
+		// nobody can be using it
+		m_edit_removed.push_back(dll);
+	}
+
+public:
+
+	//
+	// destructor - unloads all dlls
+	//
+	~dll_manager_t()
+	{
+		unload_all();
+
+		// wait for readers to leave so that every old build gets shut down and freed
+		g_epoch.barrier();
+
+		m_loader.stop();
+
+		delete m_pool.load();
+	}
+
+	//
+	// gets the current snapshot of our pool, the caller must hold an epoch guard for as long
+	// as it uses it or anything in it, unless it's the main thread
+	//
+	const dll_pool_t* pool() const
+	{
+		return m_pool.load(std::memory_order_acquire);
+	}
+
+	//
+	// initialises the manager with the given paths
+	// _debounce is how long a changed dll has to go untouched before we reload it
+	//
+	void init(const std::vector<std::string>& _paths = { "." }, std::chrono::milliseconds _debounce = std::chrono::milliseconds(150))
+	{
+		if (m_init)
+			printerret(;, "dll manager already initialised");
+
+		m_paths = _paths;
+		m_init  = true;
+
+		printdebug("dll manager initialised with " << m_paths.size() << " watch path(s)");
+
+		for (const auto& path : m_paths)
+			printdebug("+    " << path);
+
+		// start watching our paths so that we dont have to poll them
+		if (!m_watcher.init(m_paths, MOD_EXT, _debounce))
+			printerror("failed to start file watcher, falling back to polling");
+
+		if (m_async)
+			m_loader.start();
+
+		set_index_path(m_index_path);
+	}
+
+	//
+	// sets whether reloads are staged on the loader thread and swapped in at the next tick
+	// boundary, or done inline, must be called before init()
+	//
+	void set_async(bool _async)
+	{
+		if (m_init)
+			printerret(;, "cant change async loading after the dll manager has been initialised");
+
+		m_async = _async;
+	}
+
+	//
+	// sets whether modules that said what their on_update reads and writes are updated across
+	// the thread pool, or all of them one after the other on the main thread
+	//
+	void set_parallel(bool _parallel)
+	{
+		m_parallel = _parallel;
+	}
+
+	//
+	// sets how many threads discovery loads dlls across, 0 uses one per core, 1 loads them
+	// all on the calling thread
+	//
+	void set_load_threads(size_t _threads)
+	{
+		m_load_threads = _threads;
+	}
+
+	//
+	// sets whether newly discovered dlls have their on_load called one at a time in path order,
+	// turn it off if none of your modules touch anything that isn't thread safe when they load,
+	// and the on_loads of modules that dont depend on each other will run in parallel too
+	//
+	void set_ordered_init(bool _ordered)
+	{
+		m_ordered_init = _ordered;
+	}
+
+	//
+	// sets where the module index is kept, and reads it from there if we've been initialised,
+	// otherwise init() does, empty to not keep one, see module_index_t
+	//
+	void set_index_path(const std::string& _path)
+	{
+		m_index_path = _path;
+
+		m_index.clear();
+
+		if (!m_init || m_index_path.empty())
+			return;
+
+		auto start = std::chrono::steady_clock::now();
+
+		if (m_index.load(m_index_path))
+			printdebug("read " << m_index.entries().size() << " module(s) from the index at '" << m_index_path << "'");
+
+		m_index_read_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//
+	// sets whether discovery loads every dll it finds, or only registers them and loads each one
+	// the first time it's needed, see require(), turning it off forgets every registered dll that
+	// isn't loaded, so that the next discovery loads them
+	//
+	void set_lazy(bool _lazy)
+	{
+		m_lazy = _lazy;
+
+		if (_lazy)
+			return;
+
+		std::erase_if(m_registered, [this](const auto& _module) { return !writable().map.contains(_module.first); });
+
+		m_missing_stale = true;
+	}
+
+	//
+	// sets how long a registered module can go without being needed before it's evicted, zero
+	// to only ever evict them to stay under the limit set by set_max_resident()
+	//
+	void set_idle_timeout(std::chrono::milliseconds _timeout)
+	{
+		m_idle_timeout = _timeout;
+	}
+
+	//
+	// sets how many registered modules can be loaded at once, past that the least recently
+	// needed are evicted, pinned modules dont count, 0 for no limit
+	//
+	void set_max_resident(size_t _max)
+	{
+		m_max_resident = _max;
+	}
+
+	//
+	// pins the named module, so that discovery loads it straight away even when it's loading lazily,
+	// and it's never evicted, must be called before it's discovered for that to happen then
+	//
+	void pin(const std::string& _name)
+	{
+		m_pinned.insert(_name);
+	}
+
+	//
+	// unpins the named module, if it was registered it can be evicted from now on
+	//
+	void unpin(const std::string& _name)
+	{
+		m_pinned.erase(_name);
+	}
+
+	//
+	// gets the named module, loading it first if discovery only registered it, along with anything
+	// it depends on that's only been registered, and counts it as needed right now, so that it isn't
+	// evicted for being idle, returns nullptr if it isn't loaded and hasn't been registered, or if
+	// it failed to load
+	//
+	// must be called from the main thread between ticks, since it might have to load it
+	//
+	dll_t* require(const std::string& _name)
+	{
+		auto now		= std::chrono::steady_clock::now();
+		auto registered = m_registered.find(_name);
+
+		if (auto it = writable().map.find(_name); it != writable().map.end())
+		{
+			if (registered != m_registered.end())
+				registered->second.used = now;
+
+			return it->second;
+		}
+
+		if (registered == m_registered.end())
+			printerret(nullptr, "dll '" << _name << "' isn't loaded, and hasn't been discovered");
+
+		// something it depends on, directly or not, depends on it
+		if (!m_requiring.insert(_name).second)
+			printerret(nullptr, "not loading module '" << _name << "', it's part of a dependency cycle");
+
+		printdebug("loading module '" << _name << "' on demand");
+
+		const std::string path = registered->second.path;
+
+		std::vector<pending_t> pending = { { .name = _name, .path = path, .image = stage_known(_name, path) } };
+
+		install_new(pending);
+
+		m_requiring.erase(_name);
+
+		if (!pending[0].dll)
+			return nullptr;
+
+		m_demand_loads++;
+		m_demand_load_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - now).count();
+
+		return pending[0].dll;
+	}
+
+	//
+	// loads every registered module that implemented the given hook the last time it was loaded,
+	// and counts every one of them as needed right now, returns how many had to be loaded
+	//
+	// a module that's never been loaded hasn't told us what hooks it has, so unless the index
+	// remembers them from an earlier run, it's only loaded by this once something else has needed it,
+	// and it never loads more than would take us over the limit set by set_max_resident(), so
+	// that what's loaded for a hook that runs every tick isn't evicted again straight away
+	//
+	size_t require_hook(hook_t _hook)
+	{
+		if (m_registered.empty())
+			return 0;
+
+		const auto& map = writable().map;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<std::filesystem::path> paths;
+
+		// how many of them count towards the limit
+		size_t resident = 0;
+
+		for (auto& [name, module] : m_registered)
+		{
+			const bool loaded = map.contains(name);
+
+			if (loaded && !m_pinned.contains(name))
+				resident++;
+
+			if (!(module.hooks & (1u << _hook)))
+				continue;
+
+			if (loaded)
+				module.used = start;
+			else
+				paths.push_back(module.path);
+		}
+
+		if (paths.empty())
+			return 0;
+
+		if (m_max_resident)
+			paths.resize(std::min(paths.size(), resident < m_max_resident ? m_max_resident - resident : 0));
+
+		// all at once across the load threads, since after a warm start that can be most of them
+		size_t loaded = load_parallel(std::move(paths));
+
+		if (loaded)
+		{
+			m_demand_loads	 += loaded;
+			m_demand_load_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		return loaded;
+	}
+
+	//
+	// unloads registered modules that haven't been needed for longer than the idle timeout, then
+	// the least recently needed until we're back under our limit, anything another loaded module
+	// depends on stays until that module goes, and pinned modules always stay
+	// only looks every so often, so it's cheap enough to call every tick
+	// returns the number of modules that were evicted
+	//
+	size_t evict_idle()
+	{
+		if (m_registered.empty())
+			return 0;
+
+		auto now = std::chrono::steady_clock::now();
+
+		if (now - m_last_sweep < std::chrono::milliseconds(100))
+			return 0;
+
+		m_last_sweep = now;
+
+		// anything that implements a hook the tick has dispatched since the last sweep was needed for it
+		if (m_dispatched)
+		{
+			for (auto& [name, module] : m_registered)
+			{
+				if (module.hooks & m_dispatched)
+					module.used = now;
+			}
+
+			m_dispatched = 0;
+		}
+
+		// publish everything we evict as a single new pool
+		edit_t edit(*this);
+
+		size_t evicted = 0;
+
+		// built once, then kept up to date as we evict, rather than built again for every module
+		dep_graph_t graph = dependencies();
+
+		// what we could evict, least recently needed first
+		std::vector<std::pair<std::chrono::steady_clock::time_point, std::string>> resident;
+
+		for (const auto& [name, module] : m_registered)
+		{
+			if (writable().map.contains(name) && !m_pinned.contains(name))
+				resident.push_back({ module.used, name });
+		}
+
+		std::sort(resident.begin(), resident.end());
+
+		size_t count = resident.size();
+
+		// evicting a module can leave what it depended on free to go, so keep going until nothing does
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+
+			std::vector<std::pair<std::chrono::steady_clock::time_point, std::string>> kept;
+			kept.reserve(resident.size());
+
+			for (auto& entry : resident)
+			{
+				const auto& [used, name] = entry;
+
+				bool idle = m_idle_timeout.count() && now - used >= m_idle_timeout;
+				bool over = m_max_resident && count > m_max_resident;
+
+				// not due yet, or something that's still loaded needs it
+				if ((!idle && !over) || graph.depended_on(name))
+				{
+					kept.push_back(std::move(entry));
+					continue;
+				}
+
+				if (idle)
+					printdebug(std::format("evicting module '{}', it hasn't been needed for {:.1f}s", name, std::chrono::duration<double>(now - used).count()));
+				else
+					printdebug(std::format("evicting module '{}', it's the least recently needed and we're over the limit of {} loaded", name, m_max_resident));
+
+				unload(name);
+				graph.remove(name);
+
+				m_registered[name].evictions++;
+				m_evictions++;
+
+				count--;
+				evicted++;
+				changed = true;
+			}
+
+			resident = std::move(kept);
+		}
+
+		return evicted;
+	}
+
+	//
+	// gets how many dlls have been registered for loading lazily, loaded or not
+	//
+	size_t registered() const
+	{
+		return m_registered.size();
+	}
+
+	//
+	// asks the loader to check the given dll and stage a new image if it changed
+	//
+	void request_reload(dll_t* _dll, bool _force = false)
+	{
+		m_loader.request({
+			.name		= _dll->m_name,
+			.path		= _dll->m_path,
+			.hash_mode	= _dll->m_hash_mode,
+			.write_time = _dll->m_last_update,
+			.hash		= _dll->image() ? _dll->image()->hash : 0,
+			.force		= _force,
+		});
+	}
+
+	//
+	// installs everything the loader has finished staging, this is the only part of a reload
+	// that runs on the main thread, so it must be called at a tick boundary
+	// returns the number of dlls that were loaded or reloaded
+	//
+	size_t install_staged()
+	{
+		// free whatever readers have finished with since last time
+		g_epoch.collect();
+
+		if (!m_loader.ready())
+			return 0;
+
+		auto start = std::chrono::steady_clock::now();
+
+		size_t count = 0;
+
+		// publish everything that changed as a single new pool
+		edit_t edit(*this);
+
+		// new builds of the dlls we have, and dlls we didn't have before
+		std::unordered_map<std::string, dll_image_t*> staged;
+		std::vector<pending_t>						  fresh;
+
+		// where each new dll is in fresh, so that a second build of one replaces the first
+		std::unordered_map<std::string, size_t> fresh_at;
+
+		for (auto& result : m_loader.take())
+		{
+			dll_t* dll = get(result.name);
+
+			if (dll && result.hash_ns)
+				dll->record_hash(result.hash_ns);
+
+			switch (result.status)
+			{
+			case LOAD_UNCHANGED:
+			{
+				if (dll && result.skipped)
+					dll->skip(result.write_time);
+
+				break;
+			}
+
+			case LOAD_FAILED:
+			{
+				// the old build, if there is one, is still running, so all we do is note it
+				if (dll)
+					dll->fail(result.write_time);
+				else
+					printerror("failed to stage dll '" << result.name << "'");
+
+				break;
+			}
+
+			case LOAD_STAGED:
+			{
+				// only the newest build of each is worth installing
+				if (dll)
+					m_loader.release(std::exchange(staged[result.name], result.image));
+				else if (auto [it, added] = fresh_at.try_emplace(result.name, fresh.size()); added)
+					fresh.push_back({ .name = result.name, .path = result.path, .image = result.image });
+				else
+					m_loader.release(std::exchange(fresh[it->second].image, result.image));
+
+				break;
+			}
+			}
+		}
+
+		// reload in dependency order, so that if a module and something that depends on it both
+		// changed, the dependent is reloaded once, along with the module, with its new build
+		for (auto dll : ordered())
+		{
+			auto it = staged.find(dll->m_name);
+
+			if (it == staged.end())
+				continue;
+
+			dll_image_t* image = it->second;
+
+			staged.erase(it);
+
+			// a rejected build was never seen by anyone so the loader can free it straight away
+			count += reload(dll, image, staged);
+		}
+
+		// then add the new ones, they might depend on something that was just reloaded
+		count += install_new(fresh);
+
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		m_install_count++;
+		m_install_total_ns += ns;
+		m_install_max_ns	= std::max(m_install_max_ns, ns);
+
+		return count;
+	}
+
+	//
+	// sets how dlls loaded from now on fingerprint themselves
+	//
+	void set_hash_mode(hash_mode_t _mode)
+	{
+		m_hash_mode = _mode;
+	}
+
+	//
+	// returns true if the loader has anything queued, in flight, or waiting to be installed
+	//
+	bool loading() const
+	{
+		return m_loader.busy() || m_loader.ready();
+	}
+
+	//
+	// returns true if we're being notified of changes rather than polling for them
+	//
+	bool watching() const
+	{
+		return m_watcher.active();
+	}
+
+	//
+	// blocks until a watched dll has changed, a staged dll is ready, or the timeout expires
+	// returns true if there are changes for process_events() or install_staged() to handle
+	//
+	bool wait(std::chrono::milliseconds _timeout)
+	{
+		// the loader doesn't wake us, so dont sleep long while it's working
+		if (m_loader.busy())
+			_timeout = std::min(_timeout, std::chrono::milliseconds(1));
+
+		return m_watcher.wait(_timeout) || m_loader.ready();
+	}
+
+	//
+	// handles any settled changes from our watcher, loading new dlls, reloading
+	// modified ones, and unloading removed ones
+	// returns the number of dlls that were loaded, reloaded, or unloaded
+	//
+	size_t process_events()
+	{
+		if (!m_init)
+			printerret(0, "dll manager not initialised");
+
+		// no watcher, so do it the slow way
+		if (!m_watcher.active())
+			return find_and_load() + reload_modified();
+
+		size_t count = 0;
+
+		for (const auto& event : m_watcher.poll())
+		{
+			// we lost track of what changed, so check everything
+			if (event.type == WATCH_RESCAN)
+			{
+				count += find_and_load() + reload_modified();
+				continue;
+			}
+
+			const std::string name = event.path.stem().string();
+
+			printdebug("dll '" << name << "' " << to_string(event.type));
+
+			// the file is gone, so unload its module
+			if (event.type == WATCH_REMOVED)
+			{
+				m_registered.erase(name);
+				m_index.erase(name);
+
+				m_missing_stale = true;
 
-	// list of paths we're watching for dlls
-	std::vector<std::string> m_paths;
+				if (has(name))
+				{
+					unload(name);
+					count++;
+				}
 
-	// whether the manager has been initialised
-	bool m_init = false;
+				continue;
+			}
 
-private:
+			// created or modified, if we dont know about it yet then it's new
+			dll_t* dll = get(name);
 
-	// hide constructor so we can't create more instances
-	dll_manager_t() = default;
+			// it'll be loaded from its new file when it's next needed
+			if (!dll && m_lazy && !m_pinned.contains(name))
+			{
+				m_registered[name].path = event.path.string();
+				m_missing_stale = true;
 
-public:
+				continue;
+			}
 
-	//
-	// destructor - unloads all dlls
-	//
-	~dll_manager_t()
-	{
-		unload_all();
+			// hand it to the loader, it'll be installed at the next tick boundary
+			if (m_async)
+			{
+				if (dll)
+					request_reload(dll, true);
+				else
+					m_loader.request({ .name = name, .path = event.path.string(), .hash_mode = m_hash_mode, .force = true });
+
+				continue;
+			}
+
+			if (!dll)
+			{
+				if (load(event.path))
+					count++;
+
+				continue;
+			}
+
+			// otherwise reload it, and whatever depends on it, this only stats the one file that changed
+			if (auto image = dll->stage_changed())
+			{
+				std::unordered_map<std::string, dll_image_t*> staged;
+
+				count += reload(dll, image, staged);
+			}
+		}
+
+		return count;
 	}
 
 	//
-	// initialises the manager with the given paths
+	// gets the given export from the named module for the given module, see sub_modules_ctx_t
+	// only the modules it said it depends on can be asked, and only from its on_load, so it's
+	// always on the main thread, or on a load thread while the main thread waits for it
 	//
-	void init(const std::vector<std::string>& _paths = { "." })
+	void* find_export(const module_context_t* _mod, const char* _module, const char* _symbol) const
 	{
-		if (m_init)
-			printerret(;, "dll manager already initialised");
+		if (!_mod || !_module || !_symbol)
+			printerret(nullptr, "find_export needs a module, the name of the module to look in, and a symbol");
 
-		m_paths = _paths;
-		m_init  = true;
+		const char* name = _mod->name ? _mod->name : "?";
 
-		printdebug("dll manager initialised with " << m_paths.size() << " watch path(s)");
+		bool declared = false;
 
-		for (const auto& path : m_paths)
-			printdebug("+    " << path);
+		for (auto dep = _mod->depends; dep && *dep && !declared; ++dep)
+			declared = std::strcmp(*dep, _module) == 0;
+
+		// we wouldn't know to reload it when the module it got this from is reloaded
+		if (!declared)
+			printerret(nullptr, "module '" << name << "' asked for '" << _symbol << "' from '" << _module << "', which it doesn't depend on");
+
+		// a module being reloaded along with it gets its new build
+		dll_image_t* image = nullptr;
+
+		if (auto it = m_initialising.find(_module); it != m_initialising.end())
+			image = it->second;
+		else if (auto it = writable().map.find(_module); it != writable().map.end())
+			image = it->second->image();
+
+		if (!image)
+			printerret(nullptr, "module '" << name << "' asked for '" << _symbol << "' from '" << _module << "', which isn't loaded");
+
+		void* symbol = image->find(export_name_t::runtime(_symbol));
+
+		if (!symbol)
+			printerror("module '" << _module << "' doesn't export '" << _symbol << "', which '" << name << "' asked for");
+
+		return symbol;
 	}
 
 	//
@@ -69,16 +1558,23 @@ public:
 	//
 	bool has(const std::string& _name) const
 	{
-		return m_pool.contains(_name);
+		auto guard = g_epoch.enter();
+
+		return pool()->map.contains(_name);
 	}
 
 	//
 	// gets a dll from the pool by name (without extension)
+	// the dll is only safe to use while the caller holds an epoch guard, unless it's the main thread
 	//
 	dll_t* get(const std::string& _name) const
 	{
-		auto    it = m_pool.find(_name);
-		return (it != m_pool.end()) ? it->second : nullptr;
+		auto guard = g_epoch.enter();
+
+		const auto& map = pool()->map;
+
+		auto    it = map.find(_name);
+		return (it != map.end()) ? it->second : nullptr;
 	}
 
 	//
@@ -91,31 +1587,20 @@ public:
 		const std::string filename = _path.stem().string();
 
 		// check if already loaded
-		if (has(filename))
+		if (auto it = writable().map.find(filename); it != writable().map.end())
 		{
 			printdebug("dll '" << filename << "' already loaded, returning existing instance");
-			return get(filename);
+			return it->second;
 		}
 
 		printdebug("loading dll '" << filename << "' from '" << _path.string() << "'");
 
-		// create new dll instance
-		auto dll = new dll_t(_path.string());
-
-		// check that we loaded successfully
-		if (!dll->loaded())
-		{
-			printerror("failed to load dll '" << filename << "'");
-			delete dll;
-			return nullptr;
-		}
-
-		// store in pool using filename as key
-		m_pool[filename] = dll;
+		std::vector<pending_t> pending = { { .name = filename, .path = _path.string(), .image = dll_t::stage(_path.string(), m_hash_mode) } };
 
-		printmsg("dll '" << filename << "' loaded successfully");
+		// everything it depends on has to be loaded already
+		install_new(pending);
 
-		return dll;
+		return pending[0].dll;
 	}
 
 	//
@@ -123,16 +1608,23 @@ public:
 	//
 	void unload(const std::string& _name)
 	{
-		auto it = m_pool.find(_name);
-
-		if (it == m_pool.end())
+		if (!writable().map.contains(_name))
 			printerret(;, "dll '" << _name << "' not found in pool");
 
-		// delete the dll (calls destructor which unloads it)
-		delete it->second;
+		edit_t edit(*this);
+
+		auto dependents = dependencies().dependents(_name);
+
+		// anything that depends on it would be left calling into a module that's gone, so they go
+		// too, before it, so that each is shut down before anything it depends on
+		for (auto it = dependents.rbegin(); it != dependents.rend(); ++it)
+		{
+			printmsg("unloading dll '" << *it << "' too, it depends on '" << _name << "'");
+
+			remove(*it);
+		}
 
-		// remove from pool
-		m_pool.erase(it);
+		remove(_name);
 
 		printdebug("dll '" << _name << "' unloaded and removed from pool");
 	}
@@ -144,10 +1636,22 @@ public:
 	{
 		printdebug("unloading all dlls...");
 
-		for (auto& [name, dll] : m_pool)
-			delete dll;
+		// while it still has everything that's loaded in it
+		save_index();
+
+		edit_t edit(*this);
+
+		auto dlls = ordered();
 
-		m_pool.clear();
+		// everything is shut down before what it depends on, once the empty pool is published
+		for (auto it = dlls.rbegin(); it != dlls.rend(); ++it)
+			m_edit_removed.push_back(*it);
+
+		changing().map.clear();
+
+		// the next discovery starts over
+		m_registered.clear();
+		m_missing_stale = true;
 
 		printdebug("all dlls unloaded");
 	}
@@ -161,10 +1665,51 @@ public:
 		if (!m_init)
 			printerret(0, "dll manager not initialised");
 
-		size_t loaded_count = 0;
-
 		printdebug("searching for dlls in stored paths...");
 
+		size_t loaded_count = load_discovered(discover());
+
+		save_index();
+
+		printmsg("discovery complete : " << loaded_count << " dll(s) loaded" << (m_lazy ? std::format(", {} registered to load lazily", m_registered.size()) : ""));
+
+		return loaded_count;
+	}
+
+	//
+	// discovers dlls matching a specific name pattern
+	// useful for loading specific dlls like "mod_*.dll"
+	//
+	size_t find_and_load_pattern(const std::string& _pattern)
+	{
+		if (!m_init)
+			printerret(0, "dll manager not initialised");
+
+		printdebug("finding dlls matching pattern '" << _pattern << "'...");
+
+		size_t loaded_count = load_discovered(discover(_pattern));
+
+		save_index();
+
+		printmsg("pattern discovery complete : " << loaded_count << " dll(s) loaded");
+
+		return loaded_count;
+	}
+
+	//
+	// finds all the dlls in our watch paths that we haven't loaded yet, optionally only the
+	// ones whose name contains _pattern, if two paths have a dll with the same name then the
+	// one in the earlier path wins
+	//
+	// a path that hasn't changed since it was last scanned isn't scanned again, everything in it
+	// is already in the index, anything that's been added, removed, or renamed since moves its
+	// write time on, so that it's scanned like any other
+	//
+	std::vector<std::filesystem::path> discover(const std::string& _pattern = "")
+	{
+		std::vector<std::filesystem::path> found;
+		std::unordered_set<std::string> names;
+
 		// iterate through each watch path
 		for (const auto& watch_path : m_paths)
 		{
@@ -182,114 +1727,262 @@ public:
 				continue;
 			}
 
+			// skip if it's in the "current" folder (those are our copies)
+			if (watch_path.find(CUR_FOLDER) != std::string::npos)
+				continue;
+
+			auto wanted = [&](const std::string& _filename)
+			{
+				// simple pattern matching (contains for now)
+				// you could use regex here for more complex patterns
+				if (!_pattern.empty() && _filename.find(_pattern) == std::string::npos)
+					return false;
+
+				// already loaded or registered, or already found in an earlier path
+				return !writable().map.contains(_filename) && !m_registered.contains(_filename) && names.insert(_filename).second;
+			};
+
+			std::error_code ec;
+
+			auto dir_time = std::filesystem::last_write_time(watch_path, ec);
+
+			// nothing's been added, removed, or renamed since we last looked, so the index already has everything in it
+			if (!ec && !m_index_path.empty() && m_index.unchanged(watch_path, dir_time))
+			{
+				std::vector<std::filesystem::path> listed;
+
+				for (const auto& [name, entry] : m_index.entries())
+				{
+					std::filesystem::path path = entry.path;
+
+					if (path == std::filesystem::path(watch_path) / path.filename() && wanted(name))
+						listed.push_back(std::move(path));
+				}
+
+				// in the order a scan would have found them in, so that which one wins doesn't change
+				std::sort(listed.begin(), listed.end());
+
+				found.insert(found.end(), listed.begin(), listed.end());
+
+				m_scans_skipped++;
+				continue;
+			}
+
+			std::unordered_set<std::string> seen;
+
 			// iterate through directory
 			for (const auto& entry : std::filesystem::directory_iterator(watch_path))
 			{
-				// skip if not a regular file
-				if (!entry.is_regular_file())
-					continue;
-
-				// check if it's a dll
-				// todo : custom extension
-				if (entry.path().extension() != ".dll")
+				// skip if not a regular file, or if it isn't a module
+				if (!entry.is_regular_file() || entry.path().extension() != MOD_EXT)
 					continue;
 
 				// get the filename without extension
 				std::string filename = entry.path().stem().string();
 
-				// skip if it's in the "current" folder (those are our copies)
-				if (watch_path.find(CUR_FOLDER) != std::string::npos)
+				// every module in it goes in the index, even ones we aren't loading, so that the
+				// next time we skip this scan we still know about them
+				if (!m_index_path.empty() && seen.insert(filename).second && !names.contains(filename))
+					m_index.add(filename, entry.path().string());
+
+				if (!wanted(filename))
 					continue;
 
-				// try to load it
-				if (load(entry.path()))
-					loaded_count++;
+				found.push_back(entry.path());
 			}
-		}
 
-		printmsg("discovery complete : " << loaded_count << " dll(s) loaded");
+			if (m_index_path.empty() || ec)
+				continue;
 
-		return loaded_count;
+			// anything it had in here that's gone has been removed or renamed
+			m_index.prune([&](const std::string& _name, const index_entry_t& _entry)
+			{
+				std::filesystem::path path = _entry.path;
+
+				return path != std::filesystem::path(watch_path) / path.filename() || seen.contains(_name);
+			});
+
+			// the time from before we scanned, so that anything added while we were scanning gets found next time
+			m_index.scanned(watch_path, dir_time);
+		}
+
+		return found;
 	}
 
 	//
-	// discovers dlls matching a specific name pattern
-	// useful for loading specific dlls like "mod_*.dll"
+	// loads the dlls that discovery found, or registers them if we're loading lazily, loading only
+	// the pinned ones, returns the number of dlls that were loaded
 	//
-	size_t find_and_load_pattern(const std::string& _pattern)
+	size_t load_discovered(std::vector<std::filesystem::path> _paths)
 	{
-		if (!m_init)
-			printerret(0, "dll manager not initialised");
-
-		size_t loaded_count = 0;
+		if (!m_lazy)
+			return load_parallel(std::move(_paths));
 
-		printdebug("finding dlls matching pattern '" << _pattern << "'...");
+		std::vector<std::filesystem::path> pinned;
 
-		for (const auto& watch_path : m_paths)
+		for (auto& path : _paths)
 		{
-			if (!std::filesystem::exists(watch_path) || !std::filesystem::is_directory(watch_path))
-				continue;
+			std::string name = path.stem().string();
 
-			for (const auto& entry : std::filesystem::directory_iterator(watch_path))
+			if (m_pinned.contains(name))
 			{
-				if (!entry.is_regular_file() || entry.path().extension() != ".dll")
-					continue;
+				pinned.push_back(std::move(path));
+				continue;
+			}
 
-				std::string filename = entry.path().stem().string();
+			auto& module = m_registered[name];
 
-				// skip current folder copies
-				if (watch_path.find(CUR_FOLDER) != std::string::npos)
-					continue;
+			module.path = path.string();
 
-				// simple pattern matching (startsWith for now)
-				// you could use regex here for more complex patterns
-				if (filename.find(_pattern) != std::string::npos)
-				{
-					if (load(entry.path()))
-						loaded_count++;
-				}
-			}
+			// so that require_hook() can load it before it's ever been loaded this run
+			if (const index_entry_t* known = m_index.find(name, module.path))
+				module.hooks = known->hooks;
 		}
 
-		printmsg("pattern discovery complete : " << loaded_count << " dll(s) loaded");
+		// so that they're evicted like anything else once they're unpinned
+		for (const auto& path : pinned)
+			m_registered[path.stem().string()].path = path.string();
+
+		m_missing_stale = true;
+
+		return load_parallel(std::move(pinned));
+	}
+
+	//
+	// loads the given dlls across our load threads, everything up to on_load overlaps, then they're
+	// initialised in waves, each after the ones that it depends on, and in path order within each
+	// wave so that the result doesn't depend on which thread finished first, without ordered init
+	// each wave's on_loads are spread across the load threads too
+	// returns the number of dlls that loaded
+	//
+	size_t load_parallel(std::vector<std::filesystem::path> _paths)
+	{
+		if (_paths.empty())
+			return 0;
+
+		std::sort(_paths.begin(), _paths.end());
+
+		std::vector<pending_t> loads(_paths.size());
+
+		for (size_t i = 0; i < _paths.size(); ++i)
+			loads[i] = { .name = _paths[i].stem().string(), .path = _paths[i].string() };
+
+		auto start = std::chrono::steady_clock::now();
+
+		size_t threads = m_load_threads ? m_load_threads : std::max(1u, std::thread::hardware_concurrency());
+
+		threads = std::min(threads, loads.size());
+
+		spread(loads.size(), threads, [&](size_t _index)
+		{
+			pending_t& load = loads[_index];
+
+			auto load_start = std::chrono::steady_clock::now();
+
+			load.image = stage_known(load.name, load.path);
+			load.ns	   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - load_start).count();
+		});
+
+		// commit them all as a single new pool
+		size_t loaded_count = install_new(loads, threads, &m_cold_waves);
+
+		uint64_t module_ns = 0;
+
+		for (const auto& load : loads)
+			module_ns += load.ns;
+
+		m_cold_count	 = loaded_count;
+		m_cold_threads	 = threads;
+		m_cold_wall_ns	 = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		m_cold_module_ns = module_ns;
+
+		printdebug(std::format("loaded {} dll(s) in {} wave(s) on {} thread(s) in {:.3f}ms, {:.3f}ms summed across dlls ({:.2f}x)", loaded_count, m_cold_waves, threads,
+			m_cold_wall_ns / 1e6, m_cold_module_ns / 1e6, m_cold_wall_ns ? CASTTO(double, m_cold_module_ns) / m_cold_wall_ns : 0.0));
 
 		return loaded_count;
 	}
 
 	//
-	// reloads all dlls in the pool that have been modified
-	// returns the number of dlls that were reloaded
+	// reloads all dlls in the pool that have been modified, along with whatever depends on them
+	// returns the number of dlls that were reloaded, when loading asynchronously they're only
+	// queued here and get counted by install_staged() instead
 	//
 	size_t reload_modified()
 	{
+		// let the loader stat them so that we're not doing it on the main thread
+		if (m_async)
+		{
+			for (auto dll : pool()->list)
+				request_reload(dll);
+
+			return 0;
+		}
+
+		// publish everything that changed as a single new pool
+		edit_t edit(*this);
+
 		size_t reload_count = 0;
 
-		for (auto& [name, dll] : m_pool)
+		std::unordered_map<std::string, dll_image_t*> staged;
+
+		// in dependency order, so that a dependent that changed along with what it depends on is
+		// reloaded with it, and is up to date by the time we get to it
+		for (auto dll : ordered())
 		{
-			if (dll->reload())
-			{
-				// dll was reloaded, run reload callback if present
-				dll->m_ctx.on_reload();
-				reload_count++;
-			}
+			if (auto image = dll->stage_changed())
+				reload_count += reload(dll, image, staged);
 		}
 
 		return reload_count;
 	}
 
 	//
-	// updates all loaded dlls (calls their on_update callback)
+	// calls the given hook on every loaded dll that implements it, for hooks that dont take anything
+	// safe to call from any thread, even while the main thread is reloading, it never locks
 	//
-	void update_all()
+	void dispatch(hook_t _hook)
 	{
-		for (auto& [name, dll] : m_pool)
-		{
-			if (dll->loaded())
-			{
-				// todo : ? abillity to pass args, probs dont need, just pass via the custom context for each mod
-				dll->m_ctx.on_update();
-			}
-		}
+		auto guard = g_epoch.enter();
+
+		pool()->dispatch.dispatch(_hook);
+	}
+
+	//
+	// updates all loaded dlls that are due this frame (calls their on_update callback)
+	// when loading lazily this first loads any registered module that updates, and counts every
+	// one that does as needed, so it has to be called from the main thread between reloads
+	//
+	void update_all(const frame_t& _frame)
+	{
+		require_tick_hook(HOOK_UPDATE);
+
+		auto guard = g_epoch.enter();
+
+		if (m_parallel)
+			pool()->dispatch.update_parallel(_frame);
+		else
+			pool()->dispatch.update(_frame);
+	}
+
+	//
+	// runs a single fixed step on all loaded dlls that want one (calls their on_fixed_update callback)
+	// the same as update_all() for modules that are loaded lazily
+	//
+	void fixed_update_all(float _dt, uint64_t _step)
+	{
+		require_tick_hook(HOOK_FIXED_UPDATE);
+
+		auto guard = g_epoch.enter();
+
+		pool()->dispatch.fixed_update(_dt, _step);
+	}
+
+	//
+	// passes input to all loaded dlls (calls their on_input callback)
+	//
+	void input_all()
+	{
+		dispatch(HOOK_INPUT);
 	}
 
 	//
@@ -297,7 +1990,9 @@ public:
 	//
 	size_t count() const
 	{
-		return m_pool.size();
+		auto guard = g_epoch.enter();
+
+		return pool()->list.size();
 	}
 
 	//
@@ -305,23 +2000,119 @@ public:
 	//
 	void dump() const
 	{
+		auto guard = g_epoch.enter();
+
+		const dll_pool_t* pool = this->pool();
+
 		printdebug("dumping dll manager state...");
-		printdebug("loaded dlls : " << m_pool.size());
+		printdebug("loaded dlls : " << pool->list.size());
 
-		for (const auto& [name, dll] : m_pool)
+		for (auto dll : pool->list)
 		{
-			printdebug("+    " << name << " @ " << dll->m_path);
+			printdebug("+    " << dll->m_name << " @ " << dll->m_path);
 
-			if (dll->loaded())
+			dll_image_t* image = dll->image();
+
+			if (image && image->loaded())
 			{
 				printdebug("      status: loaded");
-				printdebug("      module : " << dll->m_ctx.name);
+				printdebug("      module : " << image->ctx.name);
+				printdebug("      exports : " << (image->exports.built() ? std::to_string(image->exports.size()) : "unread") << ", " << dll->m_exports.size() << " bound");
 			}
 			else
 			{
 				printdebug("      status : not loaded");
 			}
+
+			if (dll->m_hash_mode != HASH_OFF)
+			{
+				printdebug(std::format("      fingerprint : {:016x} ({})", image ? image->hash : 0, to_string(dll->m_hash_mode)));
+				printdebug(std::format("      fingerprint cost : {} taken, avg {:.3f}ms", dll->m_hash_count, dll->m_hash_count ? dll->m_hash_ns / 1e6 / dll->m_hash_count : 0.0));
+				printdebug("      skipped reloads : " << dll->m_skipped_reloads);
+			}
+
+			printdebug("      failed reloads : " << dll->m_failed_reloads);
+
+			// what it's initialised after, and reloaded along with
+			if (image && image->ctx.depends && *image->ctx.depends)
+			{
+				std::string depends;
+
+				for (auto dep = image->ctx.depends; *dep; ++dep)
+					depends += std::string(depends.empty() ? "" : ", ") + *dep;
+
+				printdebug("      depends on : " << depends);
+			}
+		}
+
+		// how long each shadow strategy has been taking
+		shadow::dump();
+
+		// how many modules each hook goes to
+		for (int i = 0; i < HOOK_COUNT; ++i)
+			printdebug("hook " << to_string(CASTTO(hook_t, i)) << " : " << pool->dispatch.count(CASTTO(hook_t, i)) << " module(s)");
+
+		const update_graph_t& graph = pool->dispatch.graph;
+
+		printdebug("update graph : " << graph.segments() << " segment(s), " << graph.edges() << " edge(s), " << graph.depth() << " deep, "
+			<< (m_parallel && graph.parallel() ? "parallel" : "serial"));
+
+		if (m_publish_count)
+			printdebug(std::format("pool rebuilds : {}, avg {:.3f}ms", m_publish_count, m_publish_ns / 1e6 / m_publish_count));
+
+		// how much is waiting on readers to be freed
+		g_epoch.dump();
+
+		// who's been using the thread pool
+		g_thread_pool.dump();
+
+		// and the event bus
+		g_event_bus.dump();
+
+		// what we're keeping across reloads
+		g_state.dump();
+
+		// and our scratch memory
+		g_frame_arena.dump();
+
+		// and everything else
+		g_allocator.dump();
+
+		// and whether we've been dropping prints
+		g_logger.dump();
+
+		// how long everyone's hooks and reloads have been taking
+		g_trace.dump();
+
+		// and where the cpu's been going, if we've been sampling
+		g_profiler.dump();
+
+		// how well our last discovery overlapped
+		if (m_cold_count)
+			printdebug(std::format("last discovery : {} dll(s) in {} wave(s) on {} thread(s), {:.3f}ms wall, {:.3f}ms summed across dlls", m_cold_count, m_cold_waves,
+				m_cold_threads, m_cold_wall_ns / 1e6, m_cold_module_ns / 1e6));
+
+		// how well loading lazily has been going
+		if (!m_registered.empty())
+		{
+			size_t resident = std::count_if(m_registered.begin(), m_registered.end(), [pool](const auto& _module) { return pool->map.contains(_module.first); });
+
+			printdebug(std::format("lazy modules : {} registered, {} loaded, {} pinned, {} loaded on demand (avg {:.3f}ms), {} evicted", m_registered.size(), resident,
+				m_pinned.size(), m_demand_loads, m_demand_loads ? m_demand_load_ns / 1e6 / m_demand_loads : 0.0, m_evictions));
 		}
+
+		// how much the index has been saving us
+		if (!m_index_path.empty())
+			printdebug(std::format("module index : {} module(s), {} up to date and {} not at load, {} scan(s) skipped, read in {:.3f}ms, last written in {:.3f}ms", m_index.entries().size(),
+				m_index_hits.load(), m_index_misses.load(), m_scans_skipped, m_index_read_ns / 1e6, m_index_write_ns / 1e6));
+
+		// how much reloading dependents has been costing us
+		if (m_cascade_count)
+			printdebug(std::format("cascading reloads : {}, avg {:.1f} dependent(s) reloaded with each", m_cascade_count, CASTTO(double, m_cascade_modules) / m_cascade_count));
+
+		// how long reloads have been stalling our ticks
+		if (m_install_count)
+			printdebug(std::format("tick boundary installs : {}, avg {:.3f}ms, max {:.3f}ms", m_install_count, m_install_total_ns / 1e6 / m_install_count, m_install_max_ns / 1e6));
 	}
 
 	//
@@ -329,31 +2120,42 @@ public:
 	//
 	std::vector<std::string> get_all_names() const
 	{
+		auto guard = g_epoch.enter();
+
+		const dll_pool_t* pool = this->pool();
+
 		std::vector<std::string> names;
-		names.reserve(m_pool.size());
+		names.reserve(pool->list.size());
 
-		for (const auto& [name, dll] : m_pool)
+		for (auto dll : pool->list)
 		{
-			names.push_back(name);
+			names.push_back(dll->m_name);
 		}
 
 		return names;
 	}
 
+	//
+	// gets the number of times the given dll has failed to reload, -1 if it isn't in the pool
+	//
+	int64_t failed_reloads(const std::string& _name) const
+	{
+		auto guard = g_epoch.enter();
+
+		dll_t* dll = get(_name);
+
+		return dll ? CASTTO(int64_t, dll->m_failed_reloads) : -1;
+	}
+
 	//
 	// gets all dll pointers in the pool
+	// the dlls are only safe to use while the caller holds an epoch guard, unless it's the main thread
 	//
 	std::vector<dll_t*> get_all_dlls() const
 	{
-		std::vector<dll_t*> dlls;
-		dlls.reserve(m_pool.size());
+		auto guard = g_epoch.enter();
 
-		for (const auto& [name, dll] : m_pool)
-		{
-			dlls.push_back(dll);
-		}
-
-		return dlls;
+		return pool()->list;
 	}
 
 	// make this class a singleton
@@ -0,0 +1,205 @@
+//
+//	epoch.cpp | Finn Le Var
+//
+#include "epoch.h"
+
+#include <thread>
+#include <algorithm>
+
+//
+// static vars
+//
+namespace
+{
+	//
+	// the calling thread's reader state, gives its slot back when the thread exits
+	//
+	struct reader_t
+	{
+		// our claimed slot's epoch and used flag
+		std::atomic<uint64_t>* epoch = nullptr;
+		std::atomic<bool>*	   used	 = nullptr;
+
+		// how deeply nested our guards are, we only pin on the outermost one
+		uint32_t depth = 0;
+
+		~reader_t()
+		{
+			if (!used)
+				return;
+
+			epoch->store(0, std::memory_order_release);
+			used->store(false, std::memory_order_release);
+		}
+	};
+
+	thread_local reader_t t_reader;
+}
+
+//
+// enters a read side section
+//
+epoch_t::guard_t epoch_t::enter()
+{
+	reader_t& reader = t_reader;
+
+	if (reader.depth++ == 0)
+	{
+		if (!reader.epoch)
+		{
+			slot_t* slot = claim();
+
+			reader.epoch = &slot->epoch;
+			reader.used	 = &slot->used;
+		}
+
+		// this has to be visible before we read anything shared, otherwise a writer could miss us
+		// and free what we're about to read, the seq_cst store orders it before our later loads
+		reader.epoch->store(m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+	}
+
+	return guard_t(this);
+}
+
+//
+// leaves the calling thread's read section
+//
+void epoch_t::leave()
+{
+	reader_t& reader = t_reader;
+
+	if (--reader.depth == 0)
+		reader.epoch->store(0, std::memory_order_release);
+}
+
+//
+// claims a slot for the calling thread
+//
+epoch_t::slot_t* epoch_t::claim()
+{
+	bool warned = false;
+
+	while (true)
+	{
+		for (auto& slot : m_slots)
+		{
+			bool expected = false;
+
+			if (!slot.used.load(std::memory_order_relaxed) && slot.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+				return &slot;
+		}
+
+		// every slot is taken, all we can do is wait for a thread to exit
+		if (!warned)
+		{
+			printerror("all " << EPOCH_MAX_READERS << " epoch reader slots are in use, waiting for one to free up");
+			warned = true;
+		}
+
+		std::this_thread::yield();
+	}
+}
+
+//
+// returns the oldest epoch pinned by any reader
+//
+uint64_t epoch_t::oldest() const
+{
+	uint64_t oldest = UINT64_MAX;
+
+	for (const auto& slot : m_slots)
+	{
+		if (!slot.used.load(std::memory_order_acquire))
+			continue;
+
+		uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+
+		if (epoch)
+			oldest = std::min(oldest, epoch);
+	}
+
+	return oldest;
+}
+
+//
+// hands something that has already been unpublished to us to free later
+//
+void epoch_t::retire(std::function<void()> _free)
+{
+	if (!_free)
+		return;
+
+	LGUARD(m_mutex);
+
+	// readers that pinned this epoch or earlier might have seen it, anyone who enters after
+	// the bump is guaranteed to see whatever replaced it, since it was unpublished before now
+	m_retired.push_back({ .epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst), .free = std::move(_free) });
+
+	m_max_pending = std::max(m_max_pending, m_retired.size());
+	m_pending.store(m_retired.size(), std::memory_order_relaxed);
+}
+
+//
+// frees everything that no reader can still be using
+//
+size_t epoch_t::collect()
+{
+	if (!pending())
+		return 0;
+
+	std::vector<retired_t> ready;
+
+	{
+		LGUARD(m_mutex);
+
+		// everything retired before the oldest reader pinned its epoch is safe
+		uint64_t oldest = this->oldest();
+
+		auto it = std::find_if(m_retired.begin(), m_retired.end(), [oldest](const retired_t& _retired) { return _retired.epoch >= oldest; });
+
+		ready.assign(std::make_move_iterator(m_retired.begin()), std::make_move_iterator(it));
+		m_retired.erase(m_retired.begin(), it);
+
+		m_freed += ready.size();
+		m_pending.store(m_retired.size(), std::memory_order_relaxed);
+	}
+
+	// run these without the lock held since they're allowed to retire more
+	for (auto& retired : ready)
+		retired.free();
+
+	return ready.size();
+}
+
+//
+// waits for every reader to leave and frees everything
+//
+void epoch_t::barrier()
+{
+	if (t_reader.depth)
+		printerret(;, "cant wait for readers from inside a read section");
+
+	while (pending())
+	{
+		if (!collect())
+			std::this_thread::yield();
+	}
+}
+
+//
+// prints the current epoch and how much we've freed
+//
+void epoch_t::dump()
+{
+	LGUARD(m_mutex);
+
+	size_t readers = 0;
+
+	for (const auto& slot : m_slots)
+	{
+		if (slot.used.load(std::memory_order_relaxed))
+			readers++;
+	}
+
+	printdebug("epoch : " << m_epoch.load() << ", " << readers << " reader thread(s), " << m_retired.size() << " waiting to be freed (max " << m_max_pending << "), " << m_freed << " freed");
+}
@@ -0,0 +1,171 @@
+//
+//	epoch.h | Finn Le Var
+//
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "shared/macros.h"		// includes shared/print.h
+
+// the most threads that can be reading at once, each one that has ever entered holds a slot until it exits
+#define EPOCH_MAX_READERS 128
+
+//
+// epoch based reclamation, lets readers walk shared structures without taking any locks while
+// a writer swaps them out from under them
+//
+// readers enter() before touching anything shared and hold the guard for as long as they use
+// what they read, writers unpublish something then retire() it, and it's only freed by collect()
+// once every reader that could have seen it has left
+//
+// entering and leaving are a couple of atomic stores to a slot owned by the calling thread,
+// so readers never block and never block writers, retire() and collect() take a mutex but
+// are only called by writers
+//
+class epoch_t
+{
+private:
+
+	//
+	// a reader's slot, padded so that readers on different threads dont share a cache line
+	//
+	struct alignas(64) slot_t
+	{
+		// the epoch this slot's reader pinned when it entered, 0 while it isn't reading
+		std::atomic<uint64_t> epoch = 0;
+
+		// whether a thread has claimed this slot
+		std::atomic<bool> used = false;
+	};
+
+	//
+	// something waiting to be freed once no reader can still be using it
+	//
+	struct retired_t
+	{
+		// the global epoch when it was retired, readers that pinned this epoch or earlier may still hold it
+		uint64_t epoch;
+
+		// frees it
+		std::function<void()> free;
+	};
+
+	// our readers' slots
+	slot_t m_slots[EPOCH_MAX_READERS];
+
+	// the global epoch, bumped every time something is retired, starts at 1 so that 0 can mean not reading
+	std::atomic<uint64_t> m_epoch = 1;
+
+	// guards m_retired
+	std::mutex m_mutex;
+
+	// everything waiting to be freed, in the order it was retired so oldest first
+	std::vector<retired_t> m_retired;
+
+	// how many things are waiting to be freed, so that collect() can bail without locking
+	std::atomic<size_t> m_pending = 0;
+
+	// how many things we've freed, and the most that have ever been waiting at once
+	uint64_t m_freed	   = 0;
+	size_t	 m_max_pending = 0;
+
+private:
+
+	// hide constructor so we can't create more instances
+	epoch_t() = default;
+
+public:
+
+	//
+	// pins the current epoch for the calling thread until it's destroyed, anything read while
+	// a guard is held stays alive until it's destroyed, guards can be nested
+	//
+	class guard_t
+	{
+	private:
+
+		epoch_t* m_owner = nullptr;
+
+	public:
+
+		explicit guard_t(epoch_t* _owner) : m_owner(_owner) {}
+
+		guard_t(guard_t&& _other) noexcept : m_owner(_other.m_owner)
+		{
+			_other.m_owner = nullptr;
+		}
+
+		guard_t(const guard_t&) = delete;
+		guard_t& operator=(const guard_t&) = delete;
+		guard_t& operator=(guard_t&&) = delete;
+
+		~guard_t()
+		{
+			if (m_owner)
+				m_owner->leave();
+		}
+	};
+
+	//
+	// enters a read side section, never blocks once the calling thread has its slot
+	//
+	[[nodiscard]] guard_t enter();
+
+	//
+	// hands something that has already been unpublished to us to free once every reader
+	// that might still be using it has left
+	//
+	void retire(std::function<void()> _free);
+
+	//
+	// frees everything that no reader can still be using, returns how many things were freed
+	// call from the writer, the free funcs run on the calling thread
+	//
+	size_t collect();
+
+	//
+	// waits for every reader to leave and frees everything, including anything retired by
+	// the things being freed, the calling thread must not be inside a read section
+	//
+	void barrier();
+
+	//
+	// returns how many things are waiting to be freed
+	//
+	size_t pending() const
+	{
+		return m_pending.load(std::memory_order_relaxed);
+	}
+
+	//
+	// prints the current epoch and how much we've freed
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(epoch_t);
+
+private:
+
+	//
+	// leaves the calling thread's read section
+	//
+	void leave();
+
+	//
+	// claims a slot for the calling thread
+	//
+	slot_t* claim();
+
+	//
+	// returns the oldest epoch pinned by any reader, or UINT64_MAX if nobody is reading
+	//
+	uint64_t oldest() const;
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(epoch_t, epoch)
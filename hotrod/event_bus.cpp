@@ -0,0 +1,327 @@
+//
+//	event_bus.cpp | Finn Le Var
+//
+#include "event_bus.h"
+
+#include <bit>
+#include <cstring>
+#include <algorithm>
+
+// shorthand for our recursive lock
+#define RGUARD(_mutex) std::lock_guard<std::recursive_mutex> _lock(_mutex)
+
+//
+// creates a channel with room for at least _capacity events
+//
+event_channel_t::event_channel_t(const std::string& _name, uint32_t _size, uint32_t _capacity, event_policy_t _policy)
+	: name(_name), size(_size), policy(_policy)
+{
+	capacity = std::bit_ceil(std::max(_capacity, 2u));
+	mask	 = capacity - 1;
+
+	sequences = std::make_unique<std::atomic<size_t>[]>(capacity);
+	slots	  = std::make_unique<std::byte[]>(CASTTO(size_t, capacity) * size);
+	batch	  = std::make_unique<std::byte[]>(CASTTO(size_t, capacity) * size);
+
+	// every slot starts out free for the lap that begins at its index
+	for (size_t i = 0; i < capacity; ++i)
+		sequences[i].store(i, std::memory_order_relaxed);
+}
+
+//
+// copies an event into the ring
+//
+bool event_channel_t::push(const void* _event)
+{
+	size_t pos = head.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		size_t seq	= sequences[pos & mask].load(std::memory_order_acquire);
+		auto   diff = CASTTO(intptr_t, seq) - CASTTO(intptr_t, pos);
+
+		// the slot's free, try and claim it
+		if (diff == 0)
+		{
+			if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		// the slot still holds last lap's event, so we're full
+		else if (diff < 0)
+			return false;
+		// someone else claimed it first
+		else
+			pos = head.load(std::memory_order_relaxed);
+	}
+
+	std::memcpy(&slots[(pos & mask) * size], _event, size);
+
+	// it's ready to read
+	sequences[pos & mask].store(pos + 1, std::memory_order_release);
+
+	return true;
+}
+
+//
+// copies the oldest event out of the ring
+//
+bool event_channel_t::pop(void* _out)
+{
+	size_t pos = tail.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		size_t seq	= sequences[pos & mask].load(std::memory_order_acquire);
+		auto   diff = CASTTO(intptr_t, seq) - CASTTO(intptr_t, pos + 1);
+
+		// the slot's ready, try and claim it
+		if (diff == 0)
+		{
+			if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		// nothing's been written here yet, so we're empty
+		else if (diff < 0)
+			return false;
+		// someone else read it first
+		else
+			pos = tail.load(std::memory_order_relaxed);
+	}
+
+	if (_out)
+		std::memcpy(_out, &slots[(pos & mask) * size], size);
+
+	// it's free for the next lap
+	sequences[pos & mask].store(pos + mask + 1, std::memory_order_release);
+
+	return true;
+}
+
+//
+// gets the channel with the given name, creating it if it doesn't exist
+//
+event_channel_t* event_bus_t::channel(const std::string& _name, uint32_t _size, uint32_t _capacity, event_policy_t _policy)
+{
+	if (_name.empty())
+		printerret(nullptr, "no channel name given");
+
+	if (_size == 0)
+		printerret(nullptr, "events for channel '" << _name << "' have no size");
+
+	RGUARD(m_mutex);
+
+	const auto& it = m_channels.find(_name);
+
+	if (it != m_channels.end())
+	{
+		// someone's using a different event under the same name, probably an old build
+		if (it->second->size != _size)
+			printerret(nullptr, "channel '" << _name << "' has " << it->second->size << " byte events, not " << _size);
+
+		return it->second.get();
+	}
+
+	auto channel = std::make_unique<event_channel_t>(_name, _size, _capacity, _policy);
+	auto ptr	 = channel.get();
+
+	m_channels.emplace(_name, std::move(channel));
+	m_order.push_back(ptr);
+
+	printdebug("created channel '" << _name << "' for " << ptr->capacity << " " << _size << " byte event(s)");
+
+	return ptr;
+}
+
+//
+// copies an event into the channel
+//
+bool event_bus_t::publish(event_channel_t* _channel, const void* _event)
+{
+	if (!_channel || !_event)
+		return false;
+
+	if (_channel->push(_event))
+	{
+		_channel->published.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// we're full, so drop something
+	_channel->dropped.fetch_add(1, std::memory_order_relaxed);
+
+	if (_channel->policy == EVENT_DROP_NEWEST)
+		return false;
+
+	// make room by throwing away the oldest, someone else could take the space we make so
+	// only try a few times rather than spinning
+	for (int attempt = 0; attempt < 4; ++attempt)
+	{
+		_channel->pop(nullptr);
+
+		if (_channel->push(_event))
+		{
+			_channel->published.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// subscribes the given module to the channel
+//
+uint64_t event_bus_t::subscribe(uint32_t _module, event_channel_t* _channel, event_fn_t _fn, void* _user)
+{
+	if (!_channel || !_fn)
+		printerret(0, "no channel or subscriber func given");
+
+	RGUARD(m_mutex);
+
+	uint64_t id = m_next_id++;
+
+	_channel->subscribers.push_back({ .id = id, .fn = _fn, .user = _user, .module = _module });
+
+	return id;
+}
+
+//
+// removes a subscription
+//
+void event_bus_t::unsubscribe(uint64_t _id)
+{
+	RGUARD(m_mutex);
+
+	for (auto channel : m_order)
+	{
+		for (auto& sub : channel->subscribers)
+		{
+			if (sub.id != _id)
+				continue;
+
+			sub.fn = nullptr;
+			m_dirty = true;
+		}
+	}
+
+	if (!m_flushing)
+		compact();
+}
+
+//
+// removes all of the given module's subscriptions
+//
+size_t event_bus_t::unsubscribe_all(uint32_t _module)
+{
+	// if a flush is running on another thread then this waits for it
+	RGUARD(m_mutex);
+
+	size_t removed = 0;
+
+	for (auto channel : m_order)
+	{
+		for (auto& sub : channel->subscribers)
+		{
+			if (sub.module != _module || !sub.fn)
+				continue;
+
+			sub.fn = nullptr;
+			m_dirty = true;
+
+			removed++;
+		}
+	}
+
+	if (!m_flushing)
+		compact();
+
+	if (removed)
+		printdebug("removed " << removed << " subscription(s) for module " << _module);
+
+	return removed;
+}
+
+//
+// hands every subscriber everything that was published since the last flush
+//
+size_t event_bus_t::flush()
+{
+	RGUARD(m_mutex);
+
+	// a subscriber is flushing, there's nothing new for it yet anyway
+	if (m_flushing)
+		return 0;
+
+	m_flushing = true;
+
+	size_t total = 0;
+
+	// by index, a subscriber could create a channel while we're going
+	for (size_t c = 0; c < m_order.size(); ++c)
+	{
+		event_channel_t& channel = *m_order[c];
+
+		// only take what's there now, so that subscribers that publish to their own channel dont keep us here forever
+		size_t count = 0;
+		size_t limit = std::min<size_t>(channel.pending(), channel.capacity);
+
+		while (count < limit && channel.pop(&channel.batch[count * channel.size]))
+			count++;
+
+		if (count == 0)
+			continue;
+
+		// by index, and by copy, since a subscriber could subscribe someone else and move things around
+		for (size_t s = 0; s < channel.subscribers.size(); ++s)
+		{
+			event_subscription_t sub = channel.subscribers[s];
+
+			if (sub.fn)
+				sub.fn(sub.user, channel.batch.get(), count);
+		}
+
+		channel.delivered += count;
+		channel.batches++;
+		channel.max_batch  = std::max(channel.max_batch, count);
+
+		total += count;
+	}
+
+	m_flushing = false;
+
+	compact();
+
+	return total;
+}
+
+//
+// removes subscriptions that were marked as removed
+//
+void event_bus_t::compact()
+{
+	if (!m_dirty)
+		return;
+
+	for (auto channel : m_order)
+		std::erase_if(channel->subscribers, [](const event_subscription_t& _sub) { return _sub.fn == nullptr; });
+
+	m_dirty = false;
+}
+
+//
+// prints each channel's stats
+//
+void event_bus_t::dump()
+{
+	RGUARD(m_mutex);
+
+	printdebug("event bus : " << m_order.size() << " channel(s)");
+
+	for (auto channel : m_order)
+	{
+		printdebug("+    " << channel->name << " : " << channel->subscribers.size() << " subscriber(s), "
+			<< channel->published.load() << " published, " << channel->dropped.load() << " dropped, "
+			<< channel->delivered << " delivered in " << channel->batches << " batch(es), biggest batch " << channel->max_batch
+			<< " of " << channel->capacity);
+	}
+}
@@ -0,0 +1,187 @@
+//
+//	event_bus.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+//
+// a module's subscription to a channel
+//
+struct event_subscription_t
+{
+	uint64_t   id	  = 0;
+	event_fn_t fn	  = nullptr;
+	void*	   user	  = nullptr;
+
+	// the id of the module that subscribed
+	uint32_t   module = 0;
+};
+
+//
+// a named channel of fixed size events
+//
+// events go through a bounded multi producer multi consumer ring, each slot has a sequence number
+// that says whether it's free to write or ready to read, so publishers and the flush only ever
+// race on a compare and swap of the head or tail, and never block each other
+//
+struct event_channel_t
+{
+	std::string	   name;
+	uint32_t	   size		= 0;
+	uint32_t	   capacity = 0;
+	event_policy_t policy	= EVENT_DROP_NEWEST;
+
+	// our ring, capacity is a power of two so that the mask can wrap our positions
+	size_t								   mask = 0;
+	std::unique_ptr<std::atomic<size_t>[]> sequences;
+	std::unique_ptr<std::byte[]>		   slots;
+
+	// where the next event is written and read, on their own cache lines since they're hammered by different threads
+	alignas(64) std::atomic<size_t> head = 0;
+	alignas(64) std::atomic<size_t> tail = 0;
+
+	// events published, and dropped because we were full
+	alignas(64) std::atomic<uint64_t> published = 0;
+	std::atomic<uint64_t>			  dropped	= 0;
+
+	// what the flush drains into and hands to our subscribers, only touched while flushing
+	std::unique_ptr<std::byte[]> batch;
+
+	// our subscribers, guarded by the bus's mutex
+	std::vector<event_subscription_t> subscribers;
+
+	// events delivered, how many flushes had events, and the biggest batch we've delivered
+	uint64_t delivered = 0;
+	uint64_t batches   = 0;
+	size_t	 max_batch = 0;
+
+	//
+	// creates a channel with room for at least _capacity events of _size bytes
+	//
+	event_channel_t(const std::string& _name, uint32_t _size, uint32_t _capacity, event_policy_t _policy);
+
+	//
+	// copies an event into the ring, returns false if it's full
+	//
+	bool push(const void* _event);
+
+	//
+	// copies the oldest event out of the ring into _out, or just drops it if _out is null,
+	// returns false if it's empty
+	//
+	bool pop(void* _out);
+
+	//
+	// how many events are waiting, only a snapshot since anyone could be publishing
+	//
+	size_t pending() const
+	{
+		size_t h = head.load(std::memory_order_acquire);
+		size_t t = tail.load(std::memory_order_acquire);
+
+		return h > t ? h - t : 0;
+	}
+};
+
+//
+// typed event channels between modules, see sub_dispatcher_ctx_t
+//
+// publishing is lock free and never allocates, the only lock is taken by the flush and by
+// anything that changes a channel's subscribers, subscribing, unsubscribing, and unloading,
+// so once unsubscribe_all() returns we know none of our threads are calling into that module
+//
+class event_bus_t
+{
+private:
+
+	// all of our channels, by name, never removed so that handles stay valid across reloads
+	std::unordered_map<std::string, std::unique_ptr<event_channel_t>> m_channels;
+
+	// the same channels in the order they were created, what the flush walks
+	std::vector<event_channel_t*> m_order;
+
+	// guards our channels and their subscribers, it's recursive so that subscribers can
+	// subscribe and unsubscribe while they're being flushed
+	std::recursive_mutex m_mutex;
+
+	// the id of the next subscription
+	uint64_t m_next_id = 1;
+
+	// whether we're in the middle of a flush, so removed subscriptions are cleaned up afterwards
+	// rather than while we're walking them
+	bool m_flushing = false;
+	bool m_dirty	= false;
+
+private:
+
+	// hide constructor so we can't create more instances
+	event_bus_t() = default;
+
+public:
+
+	//
+	// gets the channel with the given name, creating it if it doesn't exist
+	//
+	event_channel_t* channel(const std::string& _name, uint32_t _size, uint32_t _capacity = 4096, event_policy_t _policy = EVENT_DROP_NEWEST);
+
+	//
+	// copies an event into the channel, returns false if it was dropped
+	//
+	bool publish(event_channel_t* _channel, const void* _event);
+
+	//
+	// subscribes the given module to the channel, returns the subscription's id, 0 if it failed
+	//
+	uint64_t subscribe(uint32_t _module, event_channel_t* _channel, event_fn_t _fn, void* _user);
+
+	//
+	// removes a subscription
+	//
+	void unsubscribe(uint64_t _id);
+
+	//
+	// removes all of the given module's subscriptions, waiting for a flush if one is running,
+	// returns the number removed
+	//
+	size_t unsubscribe_all(uint32_t _module);
+
+	//
+	// how many events are waiting to be delivered on the given channel
+	//
+	size_t pending(event_channel_t* _channel) const
+	{
+		return _channel ? _channel->pending() : 0;
+	}
+
+	//
+	// hands every subscriber everything that was published to their channels since the last flush,
+	// anything published while we're delivering waits until next time, returns the number of events delivered
+	//
+	size_t flush();
+
+	//
+	// prints each channel's stats
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(event_bus_t);
+
+private:
+
+	//
+	// removes subscriptions that were marked as removed during a flush
+	//
+	void compact();
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(event_bus_t, event_bus)
@@ -0,0 +1,251 @@
+//
+//	exports.cpp | Finn Le Var
+//
+#include "exports.h"
+
+#include <algorithm>
+#include <bit>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+//
+// static vars
+//
+namespace
+{
+	// an export we've found but not put in the table yet
+	struct found_t
+	{
+		const char* name;
+		void*		address;
+	};
+
+#ifdef _WIN32
+
+	//
+	// reads an unaligned little endian integer
+	//
+	template<typename type_t>
+	type_t read(const uint8_t* _ptr)
+	{
+		type_t value;
+		std::memcpy(&value, _ptr, sizeof(type_t));
+		return value;
+	}
+
+	//
+	// walks the export directory of a loaded pe image (.dll), which the loader has already mapped
+	// at its rvas, so everything in it is just an offset from the module's base
+	//
+	bool read_exports(lib_handle_t _handle, std::vector<found_t>& _found)
+	{
+		const uint8_t* base = RECAST(const uint8_t*, _handle);
+
+		if (!base || base[0] != 'M' || base[1] != 'Z')
+			return false;
+
+		const uint8_t* pe = base + read<uint32_t>(base + 0x3C);
+
+		if (std::memcmp(pe, "PE\0\0", 4) != 0)
+			return false;
+
+		const uint8_t* optional		 = pe + 24;
+		uint16_t	   optional_size = read<uint16_t>(pe + 20);
+
+		// pe32 and pe32+ have their data directories in different places
+		uint16_t magic		  = read<uint16_t>(optional);
+		size_t	 dir_offset	  = magic == 0x20B ? 112 : 96;
+		size_t	 count_offset = magic == 0x20B ? 108 : 92;
+
+		// IMAGE_DIRECTORY_ENTRY_EXPORT, a dll with nothing exported doesn't have one
+		if (count_offset + 4 > optional_size || read<uint32_t>(optional + count_offset) == 0 || dir_offset + 8 > optional_size)
+			return true;
+
+		uint32_t dir_rva  = read<uint32_t>(optional + dir_offset);
+		uint32_t dir_size = read<uint32_t>(optional + dir_offset + 4);
+
+		if (!dir_rva)
+			return true;
+
+		// IMAGE_EXPORT_DIRECTORY, only the exports that have names, we never look anything up by ordinal
+		const uint8_t* dir = base + dir_rva;
+
+		uint32_t name_count	   = read<uint32_t>(dir + 24);
+		uint32_t functions_rva = read<uint32_t>(dir + 28);
+		uint32_t names_rva	   = read<uint32_t>(dir + 32);
+		uint32_t ordinals_rva  = read<uint32_t>(dir + 36);
+
+		for (uint32_t i = 0; i < name_count; ++i)
+		{
+			const char* name	= RECAST(const char*, base + read<uint32_t>(base + names_rva + i * 4));
+			uint16_t	ordinal = read<uint16_t>(base + ordinals_rva + i * 2);
+			uint32_t	rva		= read<uint32_t>(base + functions_rva + ordinal * 4);
+
+			// forwarded to another dll, its rva points at a "dll.name" string inside the directory
+			// instead, so let the loader chase it for us, once
+			if (rva >= dir_rva && rva < dir_rva + dir_size)
+			{
+				if (void* address = util::find_sym(_handle, name))
+					_found.push_back({ name, address });
+
+				continue;
+			}
+
+			_found.push_back({ name, RECAST(void*, const_cast<uint8_t*>(base + rva)) });
+		}
+
+		return true;
+	}
+
+#else
+
+	//
+	// counts the symbols in a dynamic symbol table, which doesn't say how big it is, from its
+	// gnu hash table, by finding the highest bucket and following its chain to the end
+	//
+	size_t gnu_hash_count(const uint32_t* _table)
+	{
+		const uint32_t bucket_count = _table[0];
+		const uint32_t first		= _table[1];
+		const uint32_t bloom_size	= _table[2];
+
+		const uint32_t* buckets = _table + 4 + bloom_size * (sizeof(ElfW(Addr)) / 4);
+		const uint32_t* chains	= buckets + bucket_count;
+
+		uint32_t last = 0;
+
+		for (uint32_t i = 0; i < bucket_count; ++i)
+			last = std::max(last, buckets[i]);
+
+		if (last < first)
+			return first;
+
+		// the low bit marks the end of a chain
+		while (!(chains[last - first] & 1))
+			last++;
+
+		return last + 1;
+	}
+
+	//
+	// walks the dynamic symbol table of a loaded elf image (.so), which we find through the
+	// dynamic section that the loader keeps in its link map
+	//
+	bool read_exports(lib_handle_t _handle, std::vector<found_t>& _found)
+	{
+		link_map* map = nullptr;
+
+		if (dlinfo(_handle, RTLD_DI_LINKMAP, &map) != 0 || !map || !map->l_ld)
+			return false;
+
+		const ElfW(Addr) base = map->l_addr;
+
+		// glibc relocates the dynamic section's pointers in place, others leave them as offsets from the base
+		auto address = [base](ElfW(Addr) _ptr) { return _ptr < base ? _ptr + base : _ptr; };
+
+		const ElfW(Sym)* symbols  = nullptr;
+		const char*		 strings  = nullptr;
+		const uint32_t*	 hash	  = nullptr;
+		const uint32_t*	 gnu_hash = nullptr;
+
+		for (const ElfW(Dyn)* dyn = map->l_ld; dyn->d_tag != DT_NULL; ++dyn)
+		{
+			switch (dyn->d_tag)
+			{
+			case DT_SYMTAB:	  symbols  = RECAST(const ElfW(Sym)*, address(dyn->d_un.d_ptr)); break;
+			case DT_STRTAB:	  strings  = RECAST(const char*, address(dyn->d_un.d_ptr)); break;
+			case DT_HASH:	  hash	   = RECAST(const uint32_t*, address(dyn->d_un.d_ptr)); break;
+			case DT_GNU_HASH: gnu_hash = RECAST(const uint32_t*, address(dyn->d_un.d_ptr)); break;
+			default:		  break;
+			}
+		}
+
+		if (!symbols || !strings || (!hash && !gnu_hash))
+			return false;
+
+		// the sysv hash table's chain count is the symbol count, the gnu one has to be walked
+		const size_t count = hash ? hash[1] : gnu_hash_count(gnu_hash);
+
+		// the first symbol is always the null one
+		for (size_t i = 1; i < count; ++i)
+		{
+			const ElfW(Sym)& symbol = symbols[i];
+
+			const unsigned binding = symbol.st_info >> 4;
+			const unsigned type	   = symbol.st_info & 0xF;
+
+			// only what it defines, not what it imports
+			if (symbol.st_shndx == SHN_UNDEF || !symbol.st_name)
+				continue;
+
+			if (binding != STB_GLOBAL && binding != STB_WEAK && binding != STB_GNU_UNIQUE)
+				continue;
+
+			// thread locals dont have a single address, and sections and files aren't things we'd call
+			if (type == STT_TLS || type == STT_SECTION || type == STT_FILE)
+				continue;
+
+			const char* name = strings + symbol.st_name;
+
+			// the address has to come from calling its resolver, so let the loader do that, once
+			if (type == STT_GNU_IFUNC)
+			{
+				if (void* resolved = util::find_sym(_handle, name))
+					_found.push_back({ name, resolved });
+
+				continue;
+			}
+
+			_found.push_back({ name, RECAST(void*, base + symbol.st_value) });
+		}
+
+		return true;
+	}
+
+#endif
+}
+
+//
+// reads every export out of the given loaded dll/so
+//
+bool export_table_t::build(lib_handle_t _handle)
+{
+	m_entries.clear();
+	m_count = 0;
+
+	std::vector<found_t> found;
+
+	if (!read_exports(_handle, found))
+		return false;
+
+	// at most half full, so that a probe almost never goes past the first slot
+	m_entries.resize(std::bit_ceil(std::max<size_t>(16, found.size() * 2)));
+
+	for (const auto& entry : found)
+		insert(entry.name, entry.address);
+
+	return true;
+}
+
+//
+// adds an export, keeping the first if a name turns up twice
+//
+void export_table_t::insert(const char* _name, void* _address)
+{
+	const uint64_t hash = exports::hash(_name);
+	const size_t   mask = m_entries.size() - 1;
+
+	size_t i = hash & mask;
+
+	for (; m_entries[i].name; i = (i + 1) & mask)
+	{
+		if (m_entries[i].hash == hash && std::strcmp(m_entries[i].name, _name) == 0)
+			return;
+	}
+
+	m_entries[i] = { .hash = hash, .name = _name, .address = _address };
+	m_count++;
+}
@@ -0,0 +1,195 @@
+//
+//	exports.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "util.h"
+#include "shared/macros.h"
+
+//
+//
+//
+namespace exports
+{
+	//
+	// fnv-1a, constexpr so that a name we know at compile time is hashed at compile time
+	//
+	constexpr uint64_t hash(std::string_view _name)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+
+		for (char c : _name)
+		{
+			hash ^= CASTTO(uint8_t, c);
+			hash *= 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+}
+
+//
+// the name of an export along with its hash, a string literal converts straight to one and is
+// hashed at compile time, so looking it up only costs the table probe
+//
+struct export_name_t
+{
+	const char* name = nullptr;
+	uint64_t	hash = 0;
+
+	template<size_t _size>
+	consteval export_name_t(const char (&_name)[_size]) : name(_name), hash(exports::hash({ _name, _size - 1 }))
+	{
+	}
+
+	//
+	// for a name we only know at runtime, which is hashed here instead, _name has to outlive us
+	//
+	static export_name_t runtime(const char* _name)
+	{
+		export_name_t name;
+
+		name.name = _name;
+		name.hash = exports::hash(_name);
+
+		return name;
+	}
+
+private:
+
+	export_name_t() = default;
+};
+
+//
+// every export of a single loaded build, read out of its export directory (pe) or dynamic symbol
+// table (elf) once when it's staged, so that finding one is a hash probe rather than a trip
+// through GetProcAddress/dlsym, the names point into the build so it's only valid while it's loaded
+//
+class export_table_t
+{
+private:
+
+	struct entry_t
+	{
+		uint64_t	hash	= 0;
+		const char* name	= nullptr;
+		void*		address = nullptr;
+	};
+
+	// open addressed, a power of two in size and never more than half full, empty if we couldn't read the build
+	std::vector<entry_t> m_entries;
+
+	// how many exports we hold
+	size_t m_count = 0;
+
+public:
+
+	//
+	// reads every export out of the given loaded dll/so, returns false if its format wasn't one we
+	// can read, in which case lookups have to fall back to util::find_sym
+	//
+	bool build(lib_handle_t _handle);
+
+	//
+	// finds the export with the given name, nullptr if there isn't one
+	//
+	void* find(uint64_t _hash, const char* _name) const
+	{
+		if (m_entries.empty())
+			return nullptr;
+
+		const size_t mask = m_entries.size() - 1;
+
+		for (size_t i = _hash & mask; m_entries[i].name; i = (i + 1) & mask)
+		{
+			// the hash almost always settles it, the name is only compared to rule out a collision
+			if (m_entries[i].hash == _hash && std::strcmp(m_entries[i].name, _name) == 0)
+				return m_entries[i].address;
+		}
+
+		return nullptr;
+	}
+
+	void* find(const export_name_t& _name) const
+	{
+		return find(_name.hash, _name.name);
+	}
+
+	//
+	// whether build() managed to read the build
+	//
+	bool built() const
+	{
+		return !m_entries.empty();
+	}
+
+	//
+	// how many exports we hold
+	//
+	size_t size() const
+	{
+		return m_count;
+	}
+
+private:
+
+	//
+	// adds an export, keeping the first if a name turns up twice
+	//
+	void insert(const char* _name, void* _address);
+};
+
+//
+// where a handle points, one per export that's been bound on a dll_t, which re-points it at every
+// build that it swaps in, and clears it when it's unloaded
+//
+struct export_slot_t
+{
+	std::atomic<void*> address = nullptr;
+
+	std::string name;
+	uint64_t	hash = 0;
+};
+
+//
+// a stable handle to one of a module's exports, see dll_t::bind(), it's kept pointing at the running
+// build's export across reloads, so it can be cached instead of being looked up again
+//
+// what it returns is only valid while the caller holds an epoch guard, same as the build it's in,
+// and the handle itself only for as long as the dll_t it came from
+//
+template<typename fn_t>
+class export_handle_t
+{
+private:
+
+	const export_slot_t* m_slot = nullptr;
+
+public:
+
+	export_handle_t() = default;
+
+	explicit export_handle_t(const export_slot_t* _slot) : m_slot(_slot)
+	{
+	}
+
+	//
+	// gets the running build's export, nullptr if it doesn't have one or nothing's loaded
+	//
+	fn_t get() const
+	{
+		return m_slot ? RECAST(fn_t, m_slot->address.load(std::memory_order_acquire)) : nullptr;
+	}
+
+	explicit operator bool() const
+	{
+		return get() != nullptr;
+	}
+};
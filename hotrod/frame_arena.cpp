@@ -0,0 +1,246 @@
+//
+//	frame_arena.cpp | Finn Le Var
+//
+#include "frame_arena.h"
+
+#include <new>
+#include <algorithm>
+
+// what the arenas themselves are aligned to
+#define FRAME_ARENA_ALIGN 64
+
+//
+// the calling thread's arena, handed back when the thread exits so that short lived threads
+// like the loader's dont leave arenas behind
+//
+struct frame_local_t
+{
+	frame_arena_t::arena_t* arena = nullptr;
+
+	~frame_local_t()
+	{
+		if (arena)
+			g_frame_arena.give_back(arena);
+	}
+};
+
+//
+// static vars
+//
+namespace
+{
+	thread_local frame_local_t t_local;
+}
+
+//
+// frees our arenas
+//
+frame_arena_t::~frame_arena_t()
+{
+	for (auto& arena : m_arenas)
+	{
+		for (auto [ptr, align] : arena->overflow)
+			::operator delete(ptr, std::align_val_t(align));
+
+		::operator delete(arena->base, std::align_val_t(FRAME_ARENA_ALIGN));
+	}
+}
+
+//
+// sets how big each thread's arena is
+//
+void frame_arena_t::init(size_t _size)
+{
+	LGUARD(m_mutex);
+
+	m_size = std::max<size_t>(_size, 4096);
+
+	printdebug("frame arenas are " << m_size << " byte(s) per thread");
+}
+
+//
+// allocates from the calling thread's arena
+//
+void* frame_arena_t::alloc(uint32_t _module, size_t _size, size_t _align)
+{
+	arena_t& arena = local();
+
+	if (_size == 0)
+		_size = 1;
+
+	_align = std::max<size_t>(_align, 1);
+
+	// where the allocation would start once it's aligned
+	auto   addr	 = RECAST(uintptr_t, arena.base + arena.offset);
+	size_t start = arena.offset + ((_align - addr % _align) % _align);
+
+	// who's this for, usually the same module as last time
+	module_usage_t* usage = nullptr;
+
+	if (!arena.usage.empty() && arena.usage.back().module == _module)
+		usage = &arena.usage.back();
+	else
+	{
+		auto it = std::find_if(arena.usage.begin(), arena.usage.end(), [&](const module_usage_t& _usage) { return _usage.module == _module; });
+
+		if (it != arena.usage.end())
+		{
+			// keep it at the back for next time
+			std::iter_swap(it, arena.usage.end() - 1);
+		}
+		else
+			arena.usage.push_back({ .module = _module, .bytes = 0, .overflows = 0, .overflow_bytes = 0 });
+
+		usage = &arena.usage.back();
+	}
+
+	// it fits, which is nearly always
+	if (start + _size <= arena.capacity)
+	{
+		arena.offset	 = start + _size;
+		arena.high_water = std::max(arena.high_water, arena.offset);
+
+		usage->bytes += _size;
+
+		return arena.base + start;
+	}
+
+	// it doesn't, so it has to come from the heap, and we remember it so it goes at the end of the tick
+	_align = std::max<size_t>(_align, alignof(std::max_align_t));
+
+	void* ptr = ::operator new(_size, std::align_val_t(_align));
+
+	arena.overflow.emplace_back(ptr, _align);
+
+	usage->overflows++;
+	usage->overflow_bytes += _size;
+
+	return ptr;
+}
+
+//
+// bytes left in the calling thread's arena
+//
+size_t frame_arena_t::remaining()
+{
+	arena_t& arena = local();
+
+	return arena.capacity - arena.offset;
+}
+
+//
+// frees everything allocated this tick
+//
+void frame_arena_t::reset()
+{
+	uint64_t generation = m_generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+	// ours is rewound now since we're here anyway, everyone else's is when they next allocate
+	if (t_local.arena)
+		rewind(*t_local.arena, generation);
+}
+
+//
+// gets each module's usage
+//
+std::unordered_map<uint32_t, frame_usage_t> frame_arena_t::usage()
+{
+	LGUARD(m_mutex);
+
+	return m_usage;
+}
+
+//
+// prints our arenas and each module's usage
+//
+void frame_arena_t::dump()
+{
+	LGUARD(m_mutex);
+
+	printdebug("frame arenas : " << m_arenas.size() << " arena(s) of " << m_size << " byte(s), " << m_free.size() << " free, generation " << m_generation.load());
+
+	for (size_t i = 0; i < m_arenas.size(); ++i)
+		printdebug("+    arena " << i << " : high water " << m_arenas[i]->high_water << " byte(s)");
+
+	for (const auto& [module, usage] : m_usage)
+		printdebug("+    module " << module << " : high water " << usage.high_water << " byte(s), " << usage.overflows << " overflow(s) totalling " << usage.overflow_bytes << " byte(s)");
+}
+
+//
+// gets the calling thread's arena
+//
+frame_arena_t::arena_t& frame_arena_t::local()
+{
+	if (!t_local.arena)
+	{
+		LGUARD(m_mutex);
+
+		if (!m_free.empty())
+		{
+			t_local.arena = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			auto arena = std::make_unique<arena_t>();
+
+			arena->capacity = m_size;
+			arena->base		= CASTTO(std::byte*, ::operator new(m_size, std::align_val_t(FRAME_ARENA_ALIGN)));
+
+			t_local.arena = arena.get();
+
+			m_arenas.push_back(std::move(arena));
+		}
+	}
+
+	arena_t& arena = *t_local.arena;
+
+	uint64_t generation = m_generation.load(std::memory_order_acquire);
+
+	if (arena.generation != generation)
+		rewind(arena, generation);
+
+	return arena;
+}
+
+//
+// rewinds an arena for a new tick
+//
+void frame_arena_t::rewind(arena_t& _arena, uint64_t _generation)
+{
+	if (!_arena.usage.empty())
+	{
+		LGUARD(m_mutex);
+
+		for (const auto& usage : _arena.usage)
+		{
+			frame_usage_t& total = m_usage[usage.module];
+
+			total.high_water	  = std::max(total.high_water, usage.bytes);
+			total.overflows		 += usage.overflows;
+			total.overflow_bytes += usage.overflow_bytes;
+		}
+	}
+
+	for (auto [ptr, align] : _arena.overflow)
+		::operator delete(ptr, std::align_val_t(align));
+
+	_arena.overflow.clear();
+	_arena.usage.clear();
+
+	_arena.offset	  = 0;
+	_arena.generation = _generation;
+}
+
+//
+// gives an arena back when its thread exits
+//
+void frame_arena_t::give_back(arena_t* _arena)
+{
+	// nothing the thread allocated can be in use anymore
+	rewind(*_arena, m_generation.load(std::memory_order_acquire));
+
+	LGUARD(m_mutex);
+
+	m_free.push_back(_arena);
+}
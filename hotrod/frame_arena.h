@@ -0,0 +1,159 @@
+//
+//	frame_arena.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+// how big each thread's arena is unless we're told otherwise
+#define FRAME_ARENA_SIZE (1024 * 1024)
+
+//
+// how much of the frame arenas a module has been using, so we know how big to make them
+//
+struct frame_usage_t
+{
+	// the most the module has allocated from a single arena in a single tick
+	size_t high_water = 0;
+
+	// how many of its allocations didn't fit and went to the heap, and how many bytes that was
+	uint64_t overflows		= 0;
+	uint64_t overflow_bytes = 0;
+};
+
+//
+// per thread bump allocators that are all reset at the end of each tick, see sub_frame_ctx_t
+//
+// resetting is just bumping a generation, each arena notices the next time its thread allocates
+// from it and rewinds itself then, so reset() costs the same no matter how many threads there are
+// and never touches another thread's arena
+//
+class frame_arena_t
+{
+private:
+
+	//
+	// a module's usage of an arena in the current tick
+	//
+	struct module_usage_t
+	{
+		uint32_t module;
+		size_t	 bytes;
+		uint64_t overflows;
+		uint64_t overflow_bytes;
+	};
+
+	//
+	// a single thread's arena
+	//
+	struct arena_t
+	{
+		std::byte* base		= nullptr;
+		size_t	   capacity = 0;
+		size_t	   offset	= 0;
+
+		// the generation we last rewound for
+		uint64_t generation = 0;
+
+		// allocations that didn't fit, and their alignment, freed when we rewind
+		std::vector<std::pair<void*, size_t>> overflow;
+
+		// who's allocated from us this tick
+		std::vector<module_usage_t> usage;
+
+		// the most we've had allocated in a tick
+		size_t high_water = 0;
+	};
+
+	// every arena we've made, kept for reuse when their thread exits
+	std::vector<std::unique_ptr<arena_t>> m_arenas;
+	std::vector<arena_t*>				  m_free;
+
+	// the current generation, bumped by reset()
+	std::atomic<uint64_t> m_generation = 1;
+
+	// how big new arenas are
+	size_t m_size = FRAME_ARENA_SIZE;
+
+	// guards our arena lists and m_usage
+	std::mutex m_mutex;
+
+	// each module's usage across every arena and tick
+	std::unordered_map<uint32_t, frame_usage_t> m_usage;
+
+private:
+
+	// hide constructor so we can't create more instances
+	frame_arena_t() = default;
+
+public:
+
+	~frame_arena_t();
+
+	//
+	// sets how big each thread's arena is, only affects arenas that haven't been made yet
+	//
+	void init(size_t _size = FRAME_ARENA_SIZE);
+
+	//
+	// allocates from the calling thread's arena for the given module, falling back to the heap if it's full
+	//
+	void* alloc(uint32_t _module, size_t _size, size_t _align = alignof(std::max_align_t));
+
+	//
+	// bytes left in the calling thread's arena
+	//
+	size_t remaining();
+
+	//
+	// frees everything allocated this tick, called by the main loop at the end of each tick
+	//
+	void reset();
+
+	//
+	// the current generation, so callers can check whether frame memory they're holding is stale
+	//
+	uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+	//
+	// gets each module's usage
+	//
+	std::unordered_map<uint32_t, frame_usage_t> usage();
+
+	//
+	// prints our arenas and each module's usage
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(frame_arena_t);
+
+private:
+
+	//
+	// gets the calling thread's arena, making or reusing one if it doesn't have one yet,
+	// rewinding it if it's from an old tick
+	//
+	arena_t& local();
+
+	//
+	// rewinds an arena for a new tick, folding its usage into the totals and freeing its overflow
+	//
+	void rewind(arena_t& _arena, uint64_t _generation);
+
+	//
+	// gives an arena back when its thread exits
+	//
+	void give_back(arena_t* _arena);
+
+	friend struct frame_local_t;
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(frame_arena_t, frame_arena)
@@ -0,0 +1,581 @@
+//
+//	hash.cpp | Finn Le Var
+//
+#include "hash.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HASH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "util.h"
+#include "shared/macros.h"
+
+//
+// static vars
+//
+namespace
+{
+	// number of stripes between scrambles
+	constexpr size_t STRIPES_PER_BLOCK = 16;
+
+	// 32 bit prime used to scramble our accumulators
+	constexpr uint64_t PRIME32 = 0x9E3779B1ull;
+
+	// 64 bit primes for our initial state and final avalanche
+	constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+
+	// key that each stripe is mixed with, one per lane
+	alignas(32) constexpr uint64_t KEY[8] =
+	{
+		0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+		0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+	};
+
+	//
+	// reads an unaligned little endian integer
+	//
+	template<typename type_t>
+	type_t read(const uint8_t* _ptr)
+	{
+		type_t value;
+		std::memcpy(&value, _ptr, sizeof(type_t));
+		return value;
+	}
+
+	//
+	// 64x64 -> 128 bit multiply, folded back down to 64 bits
+	//
+	uint64_t mul_fold(uint64_t _a, uint64_t _b)
+	{
+#if defined(__SIZEOF_INT128__)
+		__uint128_t product = CASTTO(__uint128_t, _a) * _b;
+		return CASTTO(uint64_t, product) ^ CASTTO(uint64_t, product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		uint64_t high = 0;
+		uint64_t low  = _umul128(_a, _b, &high);
+		return low ^ high;
+#else
+		// split into 32 bit halves
+		uint64_t a_lo = _a & 0xFFFFFFFF, a_hi = _a >> 32;
+		uint64_t b_lo = _b & 0xFFFFFFFF, b_hi = _b >> 32;
+
+		uint64_t lo_lo = a_lo * b_lo;
+		uint64_t hi_lo = a_hi * b_lo;
+		uint64_t lo_hi = a_lo * b_hi;
+		uint64_t hi_hi = a_hi * b_hi;
+
+		uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+		uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+		uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+		return lower ^ upper;
+#endif
+	}
+
+	//
+	// accumulates a single 64 byte stripe, every lane gets the product of the low and high
+	// halves of its keyed input, plus the raw input of its neighbour
+	//
+	// the simd versions below must produce exactly the same result as this one
+	//
+	[[maybe_unused]] void accumulate_scalar(uint64_t* _acc, const uint8_t* _stripe)
+	{
+		for (size_t i = 0; i < 8; ++i)
+		{
+			uint64_t data  = read<uint64_t>(_stripe + i * 8);
+			uint64_t keyed = data ^ KEY[i];
+
+			_acc[i ^ 1] += data;
+			_acc[i]		+= (keyed & 0xFFFFFFFF) * (keyed >> 32);
+		}
+	}
+
+	//
+	// stops our accumulators from drifting into a bad state over long inputs
+	//
+	[[maybe_unused]] void scramble_scalar(uint64_t* _acc)
+	{
+		for (size_t i = 0; i < 8; ++i)
+		{
+			uint64_t acc = _acc[i];
+
+			acc ^= acc >> 47;
+			acc ^= KEY[i];
+			acc *= PRIME32;
+
+			_acc[i] = acc;
+		}
+	}
+
+#if defined(HASH_AVX2)
+
+	void accumulate(uint64_t* _acc, const uint8_t* _stripe)
+	{
+		for (size_t i = 0; i < 2; ++i)
+		{
+			__m256i acc	  = _mm256_load_si256(RECAST(const __m256i*, _acc) + i);
+			__m256i data  = _mm256_loadu_si256(RECAST(const __m256i*, _stripe) + i);
+			__m256i key	  = _mm256_load_si256(RECAST(const __m256i*, KEY) + i);
+			__m256i keyed = _mm256_xor_si256(data, key);
+
+			// low 32 bits * high 32 bits of each keyed lane
+			__m256i product = _mm256_mul_epu32(keyed, _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+
+			// swap neighbouring lanes so each lane gets its neighbour's raw input
+			__m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+			acc = _mm256_add_epi64(acc, _mm256_add_epi64(product, swapped));
+
+			_mm256_store_si256(RECAST(__m256i*, _acc) + i, acc);
+		}
+	}
+
+	void scramble(uint64_t* _acc)
+	{
+		const __m256i prime = _mm256_set1_epi32(CASTTO(int, PRIME32));
+
+		for (size_t i = 0; i < 2; ++i)
+		{
+			__m256i acc = _mm256_load_si256(RECAST(const __m256i*, _acc) + i);
+			__m256i key = _mm256_load_si256(RECAST(const __m256i*, KEY) + i);
+
+			acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+			acc = _mm256_xor_si256(acc, key);
+
+			// 64 bit * 32 bit multiply from two 32x32 multiplies
+			__m256i low	 = _mm256_mul_epu32(acc, prime);
+			__m256i high = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+
+			acc = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+
+			_mm256_store_si256(RECAST(__m256i*, _acc) + i, acc);
+		}
+	}
+
+#elif defined(HASH_SSE2)
+
+	void accumulate(uint64_t* _acc, const uint8_t* _stripe)
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			__m128i acc	  = _mm_load_si128(RECAST(const __m128i*, _acc) + i);
+			__m128i data  = _mm_loadu_si128(RECAST(const __m128i*, _stripe) + i);
+			__m128i key	  = _mm_load_si128(RECAST(const __m128i*, KEY) + i);
+			__m128i keyed = _mm_xor_si128(data, key);
+
+			__m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+			__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+			acc = _mm_add_epi64(acc, _mm_add_epi64(product, swapped));
+
+			_mm_store_si128(RECAST(__m128i*, _acc) + i, acc);
+		}
+	}
+
+	void scramble(uint64_t* _acc)
+	{
+		const __m128i prime = _mm_set1_epi32(CASTTO(int, PRIME32));
+
+		for (size_t i = 0; i < 4; ++i)
+		{
+			__m128i acc = _mm_load_si128(RECAST(const __m128i*, _acc) + i);
+			__m128i key = _mm_load_si128(RECAST(const __m128i*, KEY) + i);
+
+			acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+			acc = _mm_xor_si128(acc, key);
+
+			__m128i low	 = _mm_mul_epu32(acc, prime);
+			__m128i high = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+
+			acc = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+
+			_mm_store_si128(RECAST(__m128i*, _acc) + i, acc);
+		}
+	}
+
+#else
+
+	void accumulate(uint64_t* _acc, const uint8_t* _stripe) { accumulate_scalar(_acc, _stripe); }
+	void scramble(uint64_t* _acc)							{ scramble_scalar(_acc); }
+
+#endif
+
+	//
+	// a byte range of a file
+	//
+	struct range_t
+	{
+		size_t begin;
+		size_t end;
+	};
+
+	//
+	// finds the file offset of the given rva in a pe image, returns 0 if it isn't backed by the file
+	//
+	size_t pe_rva_to_offset(const uint8_t* _sections, uint16_t _count, uint32_t _rva)
+	{
+		for (uint16_t i = 0; i < _count; ++i)
+		{
+			const uint8_t* section = _sections + i * 40;
+
+			uint32_t virtual_size	= read<uint32_t>(section + 8);
+			uint32_t virtual_addr	= read<uint32_t>(section + 12);
+			uint32_t raw_size		= read<uint32_t>(section + 16);
+			uint32_t raw_offset		= read<uint32_t>(section + 20);
+
+			if (_rva >= virtual_addr && _rva < virtual_addr + std::max(virtual_size, raw_size))
+				return _rva - virtual_addr + raw_offset;
+		}
+
+		return 0;
+	}
+
+	//
+	// finds the code and data sections of a pe image (.dll), skipping the debug directory and the
+	// codeview record it points to, since those hold the pdb's guid and change on every link
+	//
+	bool pe_ranges(const uint8_t* _data, size_t _size, std::vector<range_t>& _include, std::vector<range_t>& _exclude)
+	{
+		if (_size < 0x40 || _data[0] != 'M' || _data[1] != 'Z')
+			return false;
+
+		uint32_t pe = read<uint32_t>(_data + 0x3C);
+
+		if (CASTTO(size_t, pe) + 24 > _size || std::memcmp(_data + pe, "PE\0\0", 4) != 0)
+			return false;
+
+		uint16_t section_count	 = read<uint16_t>(_data + pe + 6);
+		uint16_t optional_size	 = read<uint16_t>(_data + pe + 20);
+
+		const uint8_t* optional = _data + pe + 24;
+		const uint8_t* sections = optional + optional_size;
+
+		if (CASTTO(size_t, sections - _data) + section_count * 40 > _size)
+			return false;
+
+		// pe32 and pe32+ have their data directories in different places
+		uint16_t magic		  = read<uint16_t>(optional);
+		size_t	 dir_offset	  = magic == 0x20B ? 112 : 96;
+		size_t	 count_offset = magic == 0x20B ? 108 : 92;
+
+		for (uint16_t i = 0; i < section_count; ++i)
+		{
+			const uint8_t* section = sections + i * 40;
+
+			uint32_t raw_size		= read<uint32_t>(section + 16);
+			uint32_t raw_offset		= read<uint32_t>(section + 20);
+			uint32_t characteristics = read<uint32_t>(section + 36);
+
+			// IMAGE_SCN_CNT_CODE | IMAGE_SCN_CNT_INITIALIZED_DATA
+			if (!(characteristics & (0x20 | 0x40)))
+				continue;
+
+			// mingw style dwarf sections are marked as data
+			if (std::memcmp(section, ".debug", 6) == 0)
+				continue;
+
+			_include.push_back({ raw_offset, std::min(_size, CASTTO(size_t, raw_offset) + raw_size) });
+		}
+
+		if (count_offset + 4 > optional_size)
+			return true;
+
+		uint32_t dir_count = read<uint32_t>(optional + count_offset);
+
+		// IMAGE_DIRECTORY_ENTRY_EXPORT, the export directory's timestamp changes on every link
+		if (dir_count > 0 && dir_offset + 8 <= optional_size)
+		{
+			uint32_t rva = read<uint32_t>(optional + dir_offset);
+
+			if (size_t offset = pe_rva_to_offset(sections, section_count, rva); rva && offset)
+				_exclude.push_back({ offset + 4, offset + 8 });
+		}
+
+		// IMAGE_DIRECTORY_ENTRY_DEBUG
+		if (dir_count > 6 && dir_offset + 6 * 8 + 8 <= optional_size)
+		{
+			uint32_t rva  = read<uint32_t>(optional + dir_offset + 6 * 8);
+			uint32_t size = read<uint32_t>(optional + dir_offset + 6 * 8 + 4);
+
+			size_t offset = rva ? pe_rva_to_offset(sections, section_count, rva) : 0;
+
+			if (offset && offset + size <= _size)
+			{
+				_exclude.push_back({ offset, offset + size });
+
+				// each IMAGE_DEBUG_DIRECTORY is 28 bytes and points at its raw data
+				for (size_t entry = offset; entry + 28 <= offset + size; entry += 28)
+				{
+					uint32_t data_size	 = read<uint32_t>(_data + entry + 16);
+					uint32_t data_offset = read<uint32_t>(_data + entry + 24);
+
+					if (data_offset && data_size)
+						_exclude.push_back({ data_offset, CASTTO(size_t, data_offset) + data_size });
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//
+	// finds the loadable segments of an elf image (.so), skipping the notes since the build id
+	// is a hash of the whole file, debug info included
+	//
+	bool elf_ranges(const uint8_t* _data, size_t _size, std::vector<range_t>& _include, std::vector<range_t>& _exclude)
+	{
+		// only little endian for now, everything else falls back to the whole file
+		if (_size < 0x34 || std::memcmp(_data, "\x7F" "ELF", 4) != 0 || _data[5] != 1)
+			return false;
+
+		bool is64 = _data[4] == 2;
+
+		if (is64 && _size < 0x40)
+			return false;
+
+		uint64_t phoff		= is64 ? read<uint64_t>(_data + 0x20) : read<uint32_t>(_data + 0x1C);
+		uint16_t ehsize		= read<uint16_t>(_data + (is64 ? 0x34 : 0x28));
+		uint16_t phentsize	= read<uint16_t>(_data + (is64 ? 0x36 : 0x2A));
+		uint16_t phnum		= read<uint16_t>(_data + (is64 ? 0x38 : 0x2C));
+
+		if (phoff + CASTTO(uint64_t, phentsize) * phnum > _size)
+			return false;
+
+		// the header holds the section header offset, which moves when debug info changes size
+		_exclude.push_back({ 0, ehsize });
+
+		for (uint16_t i = 0; i < phnum; ++i)
+		{
+			const uint8_t* phdr = _data + phoff + i * phentsize;
+
+			uint32_t type	= read<uint32_t>(phdr);
+			uint64_t offset = is64 ? read<uint64_t>(phdr + 8)  : read<uint32_t>(phdr + 4);
+			uint64_t filesz = is64 ? read<uint64_t>(phdr + 32) : read<uint32_t>(phdr + 16);
+
+			range_t range = { CASTTO(size_t, std::min<uint64_t>(offset, _size)), CASTTO(size_t, std::min<uint64_t>(offset + filesz, _size)) };
+
+			// PT_LOAD
+			if (type == 1)
+				_include.push_back(range);
+
+			// PT_NOTE
+			else if (type == 4)
+				_exclude.push_back(range);
+		}
+
+		return true;
+	}
+
+	//
+	// feeds the include ranges minus the exclude ranges into the given state
+	//
+	void hash_ranges(hash::state_t& _state, const uint8_t* _data, std::vector<range_t>& _include, std::vector<range_t>& _exclude)
+	{
+		auto by_begin = [](const range_t& _a, const range_t& _b) { return _a.begin < _b.begin; };
+
+		std::sort(_include.begin(), _include.end(), by_begin);
+		std::sort(_exclude.begin(), _exclude.end(), by_begin);
+
+		// segments can overlap, so track how far we've already hashed
+		size_t hashed = 0;
+
+		for (const auto& range : _include)
+		{
+			size_t pos = std::max(range.begin, hashed);
+
+			while (pos < range.end)
+			{
+				size_t end = range.end;
+
+				for (const auto& skip : _exclude)
+				{
+					// inside an excluded range, jump past it
+					if (skip.begin <= pos && pos < skip.end)
+					{
+						pos = skip.end;
+						end = pos;
+						break;
+					}
+
+					// stop at the next excluded range
+					if (skip.begin > pos)
+					{
+						end = std::min(end, skip.begin);
+						break;
+					}
+				}
+
+				if (end > pos)
+				{
+					_state.update(_data + pos, end - pos);
+					pos = end;
+				}
+			}
+
+			hashed = std::max(hashed, range.end);
+		}
+	}
+}
+
+//
+//
+//
+namespace hash
+{
+	state_t::state_t()
+	{
+		m_acc[0] = PRIME32;
+		m_acc[1] = PRIME64_1;
+		m_acc[2] = PRIME64_2;
+		m_acc[3] = PRIME64_3;
+		m_acc[4] = PRIME32 ^ PRIME64_1;
+		m_acc[5] = PRIME64_2 ^ PRIME64_3;
+		m_acc[6] = PRIME64_1 ^ PRIME64_3;
+		m_acc[7] = PRIME32 ^ PRIME64_2;
+	}
+
+	//
+	// processes the given number of whole stripes
+	//
+	void state_t::consume(const uint8_t* _data, size_t _count)
+	{
+		for (size_t i = 0; i < _count; ++i)
+		{
+			accumulate(m_acc, _data + i * 64);
+
+			if (++m_stripes == STRIPES_PER_BLOCK)
+			{
+				scramble(m_acc);
+				m_stripes = 0;
+			}
+		}
+	}
+
+	//
+	// feeds the given bytes into the fingerprint
+	//
+	void state_t::update(const void* _data, size_t _size)
+	{
+		auto data = CASTTO(const uint8_t*, _data);
+
+		m_length += _size;
+
+		// top up our partial stripe first
+		if (m_buffered)
+		{
+			size_t take = std::min(_size, sizeof(m_buffer) - m_buffered);
+
+			std::memcpy(m_buffer + m_buffered, data, take);
+
+			m_buffered += take;
+			data	   += take;
+			_size	   -= take;
+
+			if (m_buffered < sizeof(m_buffer))
+				return;
+
+			consume(m_buffer, 1);
+			m_buffered = 0;
+		}
+
+		// then straight from the input
+		size_t stripes = _size / 64;
+
+		consume(data, stripes);
+
+		data  += stripes * 64;
+		_size -= stripes * 64;
+
+		// keep the rest for later
+		std::memcpy(m_buffer, data, _size);
+		m_buffered = _size;
+	}
+
+	//
+	// returns the fingerprint of everything fed in so far
+	//
+	uint64_t state_t::digest() const
+	{
+		alignas(32) uint64_t acc[8];
+		std::memcpy(acc, m_acc, sizeof(acc));
+
+		// zero pad whatever is left into a final stripe
+		if (m_buffered)
+		{
+			alignas(32) uint8_t last[64] = {};
+			std::memcpy(last, m_buffer, m_buffered);
+
+			accumulate(acc, last);
+		}
+
+		uint64_t result = m_length * PRIME64_1;
+
+		for (size_t i = 0; i < 8; i += 2)
+			result += mul_fold(acc[i] ^ KEY[(i + 3) & 7], acc[i + 1] ^ KEY[(i + 4) & 7]);
+
+		// avalanche
+		result ^= result >> 37;
+		result *= PRIME64_3;
+		result ^= result >> 32;
+
+		return result;
+	}
+
+	//
+	// fingerprints the given bytes in one go
+	//
+	uint64_t fingerprint(const void* _data, size_t _size)
+	{
+		state_t state;
+		state.update(_data, _size);
+		return state.digest();
+	}
+
+	//
+	// fingerprints the module at the given path
+	//
+	bool fingerprint_file(const std::string& _path, hash_mode_t _mode, uint64_t& _out)
+	{
+		mapped_file_t file;
+
+		if (!file.open(_path))
+			return false;
+
+		if (_mode == HASH_SECTIONS)
+		{
+			std::vector<range_t> include;
+			std::vector<range_t> exclude;
+
+			if (pe_ranges(file.data, file.size, include, exclude) || elf_ranges(file.data, file.size, include, exclude))
+			{
+				state_t state;
+
+				hash_ranges(state, file.data, include, exclude);
+
+				_out = state.digest();
+
+				return true;
+			}
+
+			// not an image we understand, just do the whole thing
+		}
+
+		_out = fingerprint(file.data, file.size);
+
+		return true;
+	}
+}
@@ -0,0 +1,99 @@
+//
+//	hash.h | Finn Le Var
+//
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+//
+// what part of a module we fingerprint to decide if it has actually changed
+//
+enum hash_mode_t : uint8_t
+{
+	// dont fingerprint, reload whenever the write time changes
+	HASH_OFF = 0,
+
+	// fingerprint the whole file
+	HASH_FILE,
+
+	// only fingerprint the code and data that gets loaded, so rebuilds that only
+	// change debug info, timestamps, or build ids dont cause a reload
+	HASH_SECTIONS,
+};
+
+//
+// returns the string value for the given hash mode
+//
+inline const char* to_string(hash_mode_t _mode)
+{
+	switch (_mode)
+	{
+	case HASH_OFF:		return "off";
+	case HASH_FILE:		return "file";
+	case HASH_SECTIONS:	return "sections";
+	default:			return "unknown";
+	}
+}
+
+//
+//
+//
+namespace hash
+{
+	//
+	// streaming 64 bit fingerprint, processes 64 byte stripes using sse2/avx2 when available
+	// not cryptographic, just fast and well mixed enough to tell builds apart
+	//
+	class state_t
+	{
+	private:
+
+		// our 8 lane accumulator
+		alignas(32) uint64_t m_acc[8];
+
+		// partial stripe that we haven't processed yet
+		alignas(32) uint8_t m_buffer[64];
+
+		size_t m_buffered = 0;
+
+		// total bytes fed to us
+		uint64_t m_length = 0;
+
+		// stripes processed since our last scramble
+		size_t m_stripes = 0;
+
+	public:
+
+		state_t();
+
+		//
+		// feeds the given bytes into the fingerprint
+		//
+		void update(const void* _data, size_t _size);
+
+		//
+		// returns the fingerprint of everything fed in so far
+		//
+		uint64_t digest() const;
+
+	private:
+
+		//
+		// processes the given number of whole stripes
+		//
+		void consume(const uint8_t* _data, size_t _count);
+	};
+
+	//
+	// fingerprints the given bytes in one go
+	//
+	uint64_t fingerprint(const void* _data, size_t _size);
+
+	//
+	// fingerprints the module at the given path using the given mode
+	// returns false if the file couldn't be read
+	//
+	bool fingerprint_file(const std::string& _path, hash_mode_t _mode, uint64_t& _out);
+}
@@ -0,0 +1,247 @@
+//
+//	loader.cpp | Finn Le Var
+//
+#include "loader.h"
+
+//
+// starts our worker thread
+//
+void loader_t::start()
+{
+	{
+		LGUARD(m_mutex);
+
+		if (m_running)
+			printerret(;, "loader already running");
+
+		m_running = true;
+	}
+
+	m_thread = std::thread(&loader_t::run, this);
+
+	printdebug("loader started");
+}
+
+//
+// finishes any outstanding work then stops our worker thread
+//
+void loader_t::stop()
+{
+	{
+		LGUARD(m_mutex);
+
+		if (!m_running)
+			return;
+
+		m_running = false;
+	}
+
+	m_cv.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	// nobody is going to install these now
+	for (auto& result : m_results)
+		dll_t::release(result.image);
+
+	m_results.clear();
+	m_deferred.clear();
+	m_busy.clear();
+	m_ready = 0;
+
+	printdebug("loader stopped");
+}
+
+//
+// returns true if our worker thread is running
+//
+bool loader_t::running() const
+{
+	LGUARD(m_mutex);
+	return m_running;
+}
+
+//
+// queues a dll to be checked and staged
+//
+void loader_t::request(load_job_t _job)
+{
+	{
+		LGUARD(m_mutex);
+
+		// already working on it, so check it again once it's done in case it changed mid stage
+		if (m_busy.contains(_job.name))
+		{
+			m_deferred[_job.name] = std::move(_job);
+			return;
+		}
+
+		m_busy.insert(_job.name);
+		m_jobs.push_back(std::move(_job));
+	}
+
+	m_cv.notify_one();
+}
+
+//
+// queues an image to be freed on our thread
+//
+void loader_t::release(dll_image_t* _image)
+{
+	if (!_image)
+		return;
+
+	{
+		LGUARD(m_mutex);
+
+		// no thread to hand it to, just free it here
+		if (!m_running)
+		{
+			dll_t::release(_image);
+			return;
+		}
+
+		m_releases.push_back(_image);
+	}
+
+	m_cv.notify_one();
+}
+
+//
+// returns true if we have jobs queued or in flight
+//
+bool loader_t::busy() const
+{
+	LGUARD(m_mutex);
+	return !m_busy.empty();
+}
+
+//
+// takes all the finished results
+//
+std::vector<load_result_t> loader_t::take()
+{
+	std::vector<load_result_t> results;
+
+	if (!ready())
+		return results;
+
+	LGUARD(m_mutex);
+
+	results.swap(m_results);
+
+	m_ready.store(0, std::memory_order_release);
+
+	return results;
+}
+
+//
+// our worker thread's loop
+//
+void loader_t::run()
+{
+	while (true)
+	{
+		std::vector<dll_image_t*> releases;
+		load_job_t job;
+		bool has_job = false;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			m_cv.wait(lock, [this] { return !m_running || !m_jobs.empty() || !m_releases.empty(); });
+
+			releases.swap(m_releases);
+
+			if (!m_jobs.empty())
+			{
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+				has_job = true;
+			}
+			else if (!m_running && releases.empty())
+			{
+				// nothing left to do
+				return;
+			}
+		}
+
+		// free old images first, they're quick and hold on to memory and shadows
+		for (auto image : releases)
+			dll_t::release(image);
+
+		if (!has_job)
+			continue;
+
+		load_result_t result = process(job);
+
+		{
+			LGUARD(m_mutex);
+
+			m_results.push_back(std::move(result));
+			m_ready.store(m_results.size(), std::memory_order_release);
+
+			m_busy.erase(job.name);
+
+			// it changed again while we were staging it, go again
+			if (auto it = m_deferred.find(job.name); it != m_deferred.end())
+			{
+				m_busy.insert(job.name);
+				m_jobs.push_back(std::move(it->second));
+				m_deferred.erase(it);
+			}
+		}
+	}
+}
+
+//
+// checks and stages a single job
+//
+load_result_t loader_t::process(const load_job_t& _job)
+{
+	load_result_t result = { .status = LOAD_FAILED, .name = _job.name, .path = _job.path };
+
+	std::error_code ec;
+
+	// check the last time our dll was updated
+	result.write_time = std::filesystem::last_write_time(_job.path, ec);
+
+	if (ec)
+	{
+		printerror("failed to stat dll '" << _job.name << "', " << ec.message());
+		return result;
+	}
+
+	// hasn't changed since we last loaded it
+	if (!_job.force && result.write_time == _job.write_time)
+	{
+		result.status = LOAD_UNCHANGED;
+		return result;
+	}
+
+	// touched but not actually changed
+	if (_job.hash && _job.hash_mode != HASH_OFF)
+	{
+		uint64_t hash  = 0;
+		auto	 start = std::chrono::steady_clock::now();
+
+		bool hashed = hash::fingerprint_file(_job.path, _job.hash_mode, hash);
+
+		result.hash_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		if (hashed && hash == _job.hash)
+		{
+			result.status  = LOAD_UNCHANGED;
+			result.skipped = true;
+			return result;
+		}
+	}
+
+	result.image = dll_t::stage(_job.path, _job.hash_mode, result.write_time);
+
+	if (result.image)
+		result.status = LOAD_STAGED;
+
+	return result;
+}
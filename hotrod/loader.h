@@ -0,0 +1,182 @@
+//
+//	loader.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+#include <atomic>
+
+#include "dll.h"
+
+//
+// a request for the loader to build a new image of a dll
+//
+struct load_job_t
+{
+	// the name of the dll in the pool, and the path to build it from
+	std::string name;
+	std::string path;
+
+	// how to fingerprint it
+	hash_mode_t hash_mode = HASH_SECTIONS;
+
+	// the write time and fingerprint of the build we're currently running, so that the
+	// loader can tell if the file actually changed without touching the dll_t
+	std::filesystem::file_time_type write_time = {};
+	uint64_t hash = 0;
+
+	// skip the write time check, for when we know it changed
+	bool force = false;
+};
+
+//
+// what the loader did with a job
+//
+enum load_status_t : uint8_t
+{
+	// a new image is ready to be installed
+	LOAD_STAGED = 0,
+
+	// the file hasn't changed, or changed but has the same fingerprint
+	LOAD_UNCHANGED,
+
+	// failed to stat, shadow, load, or set up the module
+	LOAD_FAILED,
+};
+
+//
+// the result of a job, handed back to the main thread to install at the next tick boundary
+//
+struct load_result_t
+{
+	load_status_t status = LOAD_FAILED;
+
+	std::string name;
+	std::string path;
+
+	// the staged image, only set for LOAD_STAGED
+	dll_image_t* image = nullptr;
+
+	// the file's write time when we checked it
+	std::filesystem::file_time_type write_time = {};
+
+	// set if the write time changed but the fingerprint didn't
+	bool skipped = false;
+
+	// how long the fingerprint check took, in nanoseconds
+	uint64_t hash_ns = 0;
+};
+
+//
+// background loader, does all the slow parts of a reload (stat, fingerprint, shadow copy,
+// LoadLibrary/dlopen, symbol lookup, module_load) off the main thread, so that all the main
+// thread has to do is swap the new image in at the start of a tick
+//
+// also frees old images, since unloading a library can be just as slow as loading one
+//
+class loader_t
+{
+private:
+
+	// our worker thread
+	std::thread m_thread;
+
+	// guards everything below
+	mutable std::mutex m_mutex;
+
+	// wakes our thread when there's work
+	std::condition_variable m_cv;
+
+	// jobs waiting to be staged
+	std::deque<load_job_t> m_jobs;
+
+	// images waiting to be freed
+	std::vector<dll_image_t*> m_releases;
+
+	// finished jobs waiting for the main thread to pick up
+	std::vector<load_result_t> m_results;
+
+	// names of the dlls that have a job queued or in flight, so we dont stage the same dll twice
+	std::unordered_set<std::string> m_busy;
+
+	// jobs that came in while the same dll was in flight, re-queued once it finishes
+	std::unordered_map<std::string, load_job_t> m_deferred;
+
+	// whether our thread should keep running
+	bool m_running = false;
+
+	// number of results waiting, so the main thread can check without locking
+	std::atomic<size_t> m_ready = 0;
+
+public:
+
+	loader_t() = default;
+
+	loader_t(const loader_t&) = delete;
+	loader_t& operator=(const loader_t&) = delete;
+
+	~loader_t()
+	{
+		stop();
+	}
+
+	//
+	// starts our worker thread
+	//
+	void start();
+
+	//
+	// finishes any outstanding work then stops our worker thread
+	//
+	void stop();
+
+	//
+	// returns true if our worker thread is running
+	//
+	bool running() const;
+
+	//
+	// queues a dll to be checked and, if it changed, staged
+	//
+	void request(load_job_t _job);
+
+	//
+	// queues an image to be freed on our thread
+	//
+	void release(dll_image_t* _image);
+
+	//
+	// returns true if we have jobs queued or in flight
+	//
+	bool busy() const;
+
+	//
+	// returns true if there are results waiting to be installed
+	//
+	bool ready() const { return m_ready.load(std::memory_order_acquire) > 0; }
+
+	//
+	// takes all the finished results, called from the main thread at a tick boundary
+	//
+	std::vector<load_result_t> take();
+
+private:
+
+	//
+	// our worker thread's loop
+	//
+	void run();
+
+	//
+	// checks and stages a single job
+	//
+	load_result_t process(const load_job_t& _job);
+};
@@ -0,0 +1,468 @@
+//
+//	logger.cpp | Finn Le Var
+//
+#include "logger.h"
+
+#include <sstream>
+#include <chrono>
+
+// the level that marks padding at the end of a ring, where a record didn't fit before it wrapped
+#define LOG_PAD 0xff
+
+// records are kept 8 byte aligned in the rings
+#define LOG_ALIGN(_size) (((_size) + 7) & ~size_t(7))
+
+//
+// the calling thread's ring, handed over to the writer to free once the thread exits
+//
+struct log_local_t
+{
+	logger_t::ring_t* ring = nullptr;
+
+	// we've exited, anything printed from here on, by other thread locals' destructors say, is written straight out
+	bool exited = false;
+
+	~log_local_t()
+	{
+		if (ring)
+			ring->orphaned.store(true, std::memory_order_release);
+
+		ring   = nullptr;
+		exited = true;
+	}
+};
+
+//
+// static vars
+//
+namespace
+{
+	thread_local log_local_t t_local;
+
+	// set once our logger's gone, so that static destructors after it still get their prints out
+	constinit std::atomic<bool> g_dead = false;
+}
+
+// the level the engine prints at
+constinit std::atomic<uint8_t> hot_log::g_engine_level = LOG_DEBUG;
+
+//
+// queues one of the engine's prints
+//
+void hot_log::submit(log_record_t& _record)
+{
+	_record.finish(LOG_SOURCE_ENGINE);
+
+	if (g_dead.load(std::memory_order_acquire))
+		return write(&_record.header(), "");
+
+	g_logger.submit(_record.data(), _record.size());
+}
+
+//
+// blocks until everything printed so far has been written out
+//
+void hot_log::flush()
+{
+	if (!g_dead.load(std::memory_order_acquire))
+		g_logger.flush();
+}
+
+//
+// sets up the engine's source
+//
+logger_t::logger_t()
+{
+	// the engine's prints are always source 0, its level is hot_log::g_engine_level though
+	m_sources.emplace_back("", LOG_DEBUG);
+}
+
+//
+// writes out anything still queued and stops our writer
+//
+logger_t::~logger_t()
+{
+	// anything printed from here on is written straight out
+	g_dead.store(true, std::memory_order_release);
+
+	{
+		LGUARD(m_writer_mutex);
+
+		m_running.store(false, std::memory_order_release);
+	}
+
+	m_wake.notify_all();
+
+	if (m_writer.joinable())
+		m_writer.join();
+}
+
+//
+// queues a finished record from the calling thread
+//
+void logger_t::submit(const void* _record, size_t _size)
+{
+	auto record = CASTTO(const log_header_t*, _record);
+
+	if (_size < sizeof(log_header_t) || _size > LOG_RECORD_SIZE || record->size != _size)
+		printerret(;, "invalid record of " << _size << " byte(s)");
+
+	ring_t* ring = local();
+
+	// our thread is exiting, so write it out ourselves, after everything it queued before
+	if (!ring)
+	{
+		flush();
+
+		std::string name;
+
+		{
+			LGUARD(m_sources_mutex);
+
+			if (record->source < m_sources.size())
+				name = m_sources[record->source].name;
+		}
+
+		return hot_log::write(record, name);
+	}
+
+	const size_t need = LOG_ALIGN(_size);
+
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+	// records never wrap, if it doesn't fit before the end then we skip to the start
+	const size_t pos = head % LOG_RING_SIZE;
+	const size_t pad = pos + need > LOG_RING_SIZE ? LOG_RING_SIZE - pos : 0;
+
+	while (head + pad + need - ring->tail.load(std::memory_order_acquire) > LOG_RING_SIZE)
+	{
+		// errors are worth waiting for, everything else only if we've been told to
+		if (record->level < LOG_ERROR && m_policy.load(std::memory_order_relaxed) == LOG_DROP)
+		{
+			// only we write to our dropped count
+			ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+
+			return;
+		}
+
+		m_wake.notify_one();
+
+		std::this_thread::yield();
+	}
+
+	std::byte* data = ring->data.get();
+
+	// the writer skips anything too small to hold a header by itself
+	if (pad >= sizeof(log_header_t))
+		*RECAST(log_header_t*, data + pos) = { .size = CASTTO(uint32_t, pad), .source = LOG_SOURCE_ENGINE, .level = LOG_PAD, .flags = 0, .seq = 0 };
+
+	head += pad;
+
+	std::byte* dest = data + head % LOG_RING_SIZE;
+
+	std::memcpy(dest, _record, _size);
+
+	// only orders us against the other threads as far as the writer can see, since another thread can take a later
+	// seq and publish it before we publish ours
+	RECAST(log_header_t*, dest)->seq = m_seq.fetch_add(1, std::memory_order_relaxed);
+
+	ring->head.store(head + need, std::memory_order_release);
+}
+
+//
+// blocks until everything queued so far has been written out
+//
+void logger_t::flush()
+{
+	uint64_t target = m_seq.load(std::memory_order_acquire);
+
+	while (m_written.load(std::memory_order_acquire) < target && m_running.load(std::memory_order_acquire))
+	{
+		m_wake.notify_one();
+
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+}
+
+//
+// gets the id for the given name's prints
+//
+uint16_t logger_t::source(const char* _name, const std::atomic<uint8_t>** _level)
+{
+	LGUARD(m_sources_mutex);
+
+	uint16_t id = LOG_SOURCE_ENGINE;
+
+	if (_name)
+	{
+		for (size_t i = 1; i < m_sources.size(); ++i)
+		{
+			if (m_sources[i].name == _name)
+			{
+				id = CASTTO(uint16_t, i);
+				break;
+			}
+		}
+
+		// a reloaded module gets the id it had before, along with its level
+		if (id == LOG_SOURCE_ENGINE && m_sources.size() < LOG_SOURCE_MAX)
+		{
+			id = CASTTO(uint16_t, m_sources.size());
+			m_sources.emplace_back(_name, LOG_DEBUG);
+		}
+	}
+
+	if (_level)
+		*_level = id == LOG_SOURCE_ENGINE ? &hot_log::g_engine_level : &m_sources[id].level;
+
+	return id;
+}
+
+//
+// changes the level the given source prints at
+//
+void logger_t::set_level(const char* _name, log_level_t _level)
+{
+	if (!_name)
+	{
+		hot_log::g_engine_level.store(_level, std::memory_order_relaxed);
+		return;
+	}
+
+	const std::atomic<uint8_t>* level = nullptr;
+
+	source(_name, &level);
+
+	// only ever handed out as const so that modules can't change it behind our back
+	const_cast<std::atomic<uint8_t>*>(level)->store(_level, std::memory_order_relaxed);
+}
+
+//
+// prints our rings and sources
+//
+void logger_t::dump()
+{
+	size_t rings = 0;
+
+	{
+		LGUARD(m_rings_mutex);
+		rings = m_rings.size();
+	}
+
+	printdebug("logger : " << rings << " ring(s) of " << LOG_RING_SIZE << " byte(s), " << m_written.load() << " print(s) written, "
+		<< m_dropped.load() << " dropped, " << (m_policy.load() == LOG_DROP ? "dropping" : "blocking") << " when full");
+
+	// copied so that we're not printing while holding the lock
+	std::vector<std::pair<std::string, uint32_t>> sources;
+
+	{
+		LGUARD(m_sources_mutex);
+
+		for (size_t i = 1; i < m_sources.size(); ++i)
+			sources.emplace_back(m_sources[i].name, m_sources[i].level.load());
+	}
+
+	for (const auto& [name, level] : sources)
+		printdebug("+    source '" << name << "' : level " << level);
+}
+
+//
+// gets the calling thread's ring
+//
+logger_t::ring_t* logger_t::local()
+{
+	if (t_local.ring)
+		return t_local.ring;
+
+	if (t_local.exited)
+		return nullptr;
+
+	auto ring = std::make_unique<ring_t>();
+
+	ring->data = std::make_unique<std::byte[]>(LOG_RING_SIZE);
+
+	t_local.ring = ring.get();
+
+	{
+		LGUARD(m_rings_mutex);
+		m_rings.push_back(std::move(ring));
+	}
+
+	start();
+
+	return t_local.ring;
+}
+
+//
+// starts our writer if it isn't running
+//
+void logger_t::start()
+{
+	LGUARD(m_writer_mutex);
+
+	if (m_running.load(std::memory_order_acquire) || g_dead.load(std::memory_order_acquire))
+		return;
+
+	m_running.store(true, std::memory_order_release);
+
+	m_writer = std::thread(&logger_t::write_loop, this);
+}
+
+//
+// our writer thread
+//
+void logger_t::write_loop()
+{
+	while (m_running.load(std::memory_order_acquire))
+	{
+		if (drain() > 0)
+			continue;
+
+		std::unique_lock lock(m_wake_mutex);
+
+		m_wake.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_MS));
+	}
+
+	// everything that was queued before we were stopped
+	while (drain() > 0);
+}
+
+//
+// writes out everything queued so far
+//
+size_t logger_t::drain()
+{
+	// every ring, and how far they'd got, so that we hold our lock as little as possible
+	std::vector<ring_t*>  rings;
+	std::vector<uint64_t> heads;
+
+	{
+		LGUARD(m_rings_mutex);
+
+		// rings whose threads have gone and that we've emptied
+		std::erase_if(m_rings, [](const std::unique_ptr<ring_t>& _ring)
+		{
+			return _ring->orphaned.load(std::memory_order_acquire) && _ring->tail.load(std::memory_order_relaxed) == _ring->head.load(std::memory_order_acquire);
+		});
+
+		for (auto& ring : m_rings)
+		{
+			rings.push_back(ring.get());
+			heads.push_back(ring->head.load(std::memory_order_acquire));
+		}
+	}
+
+	{
+		LGUARD(m_sources_mutex);
+
+		for (size_t i = m_names.size(); i < m_sources.size(); ++i)
+			m_names.push_back(m_sources[i].name);
+	}
+
+	std::ostringstream out;
+	bool			   errors  = false;
+	size_t			   written = 0;
+
+	auto write_out = [&]()
+	{
+		if (out.view().empty())
+			return;
+
+		auto& stream = errors ? std::cerr : std::cout;
+
+		stream << out.view();
+		stream.flush();
+
+		out.str("");
+	};
+
+	// take the oldest record across every ring until they're all empty, so each thread's prints come out in the order it
+	// printed them, and everyone's are interleaved by when they were queued, as far as what's landed in the rings so far goes
+	while (true)
+	{
+		size_t				index  = rings.size();
+		const log_header_t* oldest = nullptr;
+
+		for (size_t i = 0; i < rings.size(); ++i)
+		{
+			const log_header_t* record = front(*rings[i], heads[i]);
+
+			if (record && (!oldest || record->seq < oldest->seq))
+			{
+				oldest = record;
+				index  = i;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		// keep stdout and stderr in order with each other
+		if ((oldest->level >= LOG_ERROR) != errors)
+		{
+			write_out();
+			errors = !errors;
+		}
+
+		hot_log::format(out, oldest, oldest->source < m_names.size() ? m_names[oldest->source] : "?");
+
+		rings[index]->tail.fetch_add(LOG_ALIGN(oldest->size), std::memory_order_release);
+
+		written++;
+	}
+
+	// let them know we've been dropping their prints
+	for (auto ring : rings)
+	{
+		uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+
+		if (dropped == ring->reported)
+			continue;
+
+		if (!errors)
+		{
+			write_out();
+			errors = true;
+		}
+
+		out << "[error] logger | dropped " << dropped - ring->reported << " print(s), a thread's ring was full\n";
+
+		ring->reported = dropped;
+	}
+
+	write_out();
+
+	m_written.fetch_add(written, std::memory_order_release);
+
+	return written;
+}
+
+//
+// gets the oldest record in a ring
+//
+const log_header_t* logger_t::front(ring_t& _ring, uint64_t _head)
+{
+	uint64_t tail = _ring.tail.load(std::memory_order_relaxed);
+
+	while (tail < _head)
+	{
+		size_t pos = tail % LOG_RING_SIZE;
+
+		auto record = RECAST(const log_header_t*, _ring.data.get() + pos);
+
+		// padding, skip to the start
+		if (LOG_RING_SIZE - pos < sizeof(log_header_t) || record->level == LOG_PAD)
+		{
+			tail += LOG_RING_SIZE - pos;
+
+			_ring.tail.store(tail, std::memory_order_release);
+
+			continue;
+		}
+
+		return record;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,188 @@
+//
+//	logger.h | Finn Le Var
+//
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+// how big each thread's ring of queued prints is
+#define LOG_RING_SIZE (256 * 1024)
+
+// how long the writer sleeps for when there's nothing to write, in milliseconds
+#define LOG_IDLE_MS 2
+
+// the most sources we can have, the engine's included
+#define LOG_SOURCE_MAX 0xfffe
+
+//
+// what a thread does when its ring is full
+//
+enum log_policy_t : uint8_t
+{
+	LOG_DROP = 0,	// the print is dropped and counted, so printing never stalls a tick
+	LOG_BLOCK,		// we wait for the writer to make room, so nothing is lost
+};
+
+//
+// asynchronous logger behind every print in the engine and its modules, see sub_log_ctx_t
+//
+// each thread copies its prints into its own single producer ring, nothing is formatted and
+// nothing is locked, and a single writer thread takes them off every ring, formats them, and
+// writes them out in batches
+//
+// each thread's prints come out in the order it printed them, and prints from different threads
+// are interleaved by when they were queued, but that's only best effort, a print that's still
+// being copied into its ring when the writer looks comes out after anything queued after it
+// that had already landed
+//
+class logger_t
+{
+private:
+
+	//
+	// a single thread's queued prints, only its thread writes to head, and only the writer to tail
+	//
+	struct ring_t
+	{
+		std::unique_ptr<std::byte[]> data;
+
+		alignas(64) std::atomic<uint64_t> head = 0;
+		alignas(64) std::atomic<uint64_t> tail = 0;
+
+		// prints dropped because we were full, and how many of them the writer has reported
+		alignas(64) std::atomic<uint64_t> dropped  = 0;
+		uint64_t						  reported = 0;
+
+		// our thread has exited, so we can go once we're empty
+		std::atomic<bool> orphaned = false;
+	};
+
+	//
+	// somewhere prints come from, the engine or a module, kept for good so that a reloaded
+	// module keeps its id and its level
+	//
+	struct source_t
+	{
+		std::string			 name;
+		std::atomic<uint8_t> level = LOG_DEBUG;
+
+		source_t(const char* _name, log_level_t _level) : name(_name), level(_level) {}
+	};
+
+	// every thread's ring, guarded by m_rings_mutex, rings are only freed by the writer
+	std::vector<std::unique_ptr<ring_t>> m_rings;
+	std::mutex							 m_rings_mutex;
+
+	// every source by id, a deque so that their levels never move, guarded by m_sources_mutex
+	std::deque<source_t> m_sources;
+	std::mutex			 m_sources_mutex;
+
+	// the writer's copy of our sources' names, so that it doesn't hold the lock while it formats
+	std::vector<std::string> m_names;
+
+	// the next print's place in the order, and how many prints have been written out
+	alignas(64) std::atomic<uint64_t> m_seq		= 0;
+	alignas(64) std::atomic<uint64_t> m_written = 0;
+
+	// prints dropped across every ring
+	std::atomic<uint64_t> m_dropped = 0;
+
+	std::atomic<log_policy_t> m_policy = LOG_DROP;
+
+	// our writer thread, started with the first print
+	std::thread		  m_writer;
+	std::atomic<bool> m_running = false;
+	std::mutex		  m_writer_mutex;
+
+	// wakes the writer early, when someone's waiting on it
+	std::mutex				m_wake_mutex;
+	std::condition_variable m_wake;
+
+private:
+
+	// hide constructor so we can't create more instances
+	logger_t();
+
+public:
+
+	~logger_t();
+
+	//
+	// queues a finished record from the calling thread, see log_record_t
+	//
+	void submit(const void* _record, size_t _size);
+
+	//
+	// blocks until everything queued so far has been written out
+	//
+	void flush();
+
+	//
+	// gets the id for the given name's prints, registering it if it's new, and the level it prints at
+	//
+	uint16_t source(const char* _name, const std::atomic<uint8_t>** _level);
+
+	//
+	// changes the level the given source prints at, null for the engine
+	//
+	void set_level(const char* _name, log_level_t _level);
+
+	//
+	// what threads do when their ring is full, errors always wait
+	//
+	void set_policy(log_policy_t _policy) { m_policy.store(_policy, std::memory_order_relaxed); }
+
+	//
+	// prints dropped because a thread's ring was full
+	//
+	uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	//
+	// prints our rings and sources
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(logger_t);
+
+private:
+
+	//
+	// gets the calling thread's ring, making one if it doesn't have one, null once it's exiting
+	//
+	ring_t* local();
+
+	//
+	// starts our writer if it isn't running
+	//
+	void start();
+
+	//
+	// our writer thread
+	//
+	void write_loop();
+
+	//
+	// writes out everything queued so far, returns how many prints were written
+	//
+	size_t drain();
+
+	//
+	// gets the oldest record in a ring, skipping padding, null if it's empty
+	//
+	const log_header_t* front(ring_t& _ring, uint64_t _head);
+
+	friend struct log_local_t;
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(logger_t, logger)
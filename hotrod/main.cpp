@@ -6,6 +6,16 @@
 
 #include "dll.h"
 #include "dll_manager.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "event_bus.h"
+#include "state.h"
+#include "frame_arena.h"
+#include "allocator.h"
+#include "logger.h"
+#include "trace.h"
+#include "profiler.h"
+#include "bench.h"
 #include "test.h"
 #include "shared/subsystem.h"
 
@@ -31,12 +41,89 @@ namespace ctx
 		.print = [](const std::string& _str) { test::print(_str); },
 	};
 
-	// all of our sub systems
-	subsystem_info_t m_subsystems[] =
+	// scheduler context
+	sub_scheduler_ctx_t m_scheduler =
 	{
-		//{ "pool", &m_pool },
-		{.name = "test", .data = &m_test },
+		.frame	  = []() { return g_scheduler.frame().index; },
+		.time	  = []() { return g_scheduler.time(); },
+		.fixed_dt = []() { return g_scheduler.frame().fixed_dt; },
+		.alpha	  = []() { return g_scheduler.frame().alpha; },
 	};
+
+	// thread pool context
+	sub_thread_pool_ctx_t m_thread_pool =
+	{
+		.submit		   = [](module_context_t* _mod, task_fn_t _fn, void* _data, task_priority_t _priority, task_group_t* _group) { return g_thread_pool.submit(_mod ? _mod->id : 0, _fn, _data, _priority, _group); },
+		.create_group  = [](module_context_t* _mod) { auto group = new task_group_t; group->module = _mod ? _mod->id : 0; return group; },
+		.destroy_group = [](task_group_t* _group) { g_thread_pool.wait(_group); delete _group; },
+		.wait		   = [](task_group_t* _group) { g_thread_pool.wait(_group); },
+		.parallel_for  = [](module_context_t* _mod, size_t _count, size_t _grain, range_fn_t _fn, void* _data, task_priority_t _priority) { g_thread_pool.parallel_for(_mod ? _mod->id : 0, _count, _grain, _fn, _data, _priority); },
+		.worker_count  = []() { return g_thread_pool.worker_count(); },
+	};
+
+	// dispatcher context
+	sub_dispatcher_ctx_t m_dispatcher =
+	{
+		.channel	 = [](const char* _name, uint32_t _size, uint32_t _capacity, event_policy_t _policy) { return _name ? g_event_bus.channel(_name, _size, _capacity, _policy) : nullptr; },
+		.publish	 = [](event_channel_t* _channel, const void* _event) { return g_event_bus.publish(_channel, _event); },
+		.subscribe	 = [](module_context_t* _mod, event_channel_t* _channel, event_fn_t _fn, void* _user) { return g_event_bus.subscribe(_mod ? _mod->id : 0, _channel, _fn, _user); },
+		.unsubscribe = [](uint64_t _id) { g_event_bus.unsubscribe(_id); },
+		.pending	 = [](event_channel_t* _channel) { return g_event_bus.pending(_channel); },
+	};
+
+	// state context
+	sub_state_ctx_t m_state =
+	{
+		.acquire = [](module_context_t* _mod, const char* _name, uint32_t _size, uint32_t _version, state_upgrade_fn_t _upgrade, state_status_t* _status)
+		{
+			return _mod ? g_state.acquire(_mod->id, _mod->name, _name, _size, _version, _upgrade, _status) : nullptr;
+		},
+		.release = [](module_context_t* _mod, const char* _name) { if (_mod) g_state.release(_mod->id, _mod->name, _name); },
+	};
+
+	// frame arena context
+	sub_frame_ctx_t m_frame =
+	{
+		.alloc	   = [](module_context_t* _mod, size_t _size, size_t _align) { return g_frame_arena.alloc(_mod ? _mod->id : 0, _size, _align); },
+		.remaining = []() { return g_frame_arena.remaining(); },
+	};
+
+	// allocator context
+	sub_alloc_ctx_t m_alloc =
+	{
+		.alloc	  = [](module_context_t* _mod, size_t _size, size_t _align) { return g_allocator.alloc(_mod ? _mod->id : 0, _size, _align); },
+		.free	  = [](void* _ptr) { g_allocator.free(_ptr); },
+		.transfer = [](void* _ptr, module_context_t* _mod) { g_allocator.transfer(_ptr, _mod ? _mod->id : 0); },
+		.live	  = [](module_context_t* _mod) { return CASTTO(size_t, std::max<int64_t>(0, g_allocator.stats(_mod ? _mod->id : 0).live_bytes())); },
+	};
+
+	// log context
+	sub_log_ctx_t m_log =
+	{
+		.source	   = [](const char* _name, const std::atomic<uint8_t>** _level) { return g_logger.source(_name, _level); },
+		.submit	   = [](const void* _record, size_t _size) { g_logger.submit(_record, _size); },
+		.flush	   = []() { g_logger.flush(); },
+		.set_level = [](const char* _name, log_level_t _level) { g_logger.set_level(_name, _level); },
+	};
+
+	// modules context
+	sub_modules_ctx_t m_modules =
+	{
+		.find = [](module_context_t* _mod, const char* _module, const char* _symbol) { return g_dll.find_export(_mod, _module, _symbol); },
+	};
+
+	// all of our sub systems, indexed by their type, built at compile time so that there's
+	// nothing to register at startup
+	constinit subsystem_table_t m_subsystems = subsystem_table_t{}
+		.set<SUB_TEST>(&m_test)
+		.set<SUB_SCHEDULER>(&m_scheduler)
+		.set<SUB_THREAD_POOL>(&m_thread_pool)
+		.set<SUB_DISPATCHER>(&m_dispatcher)
+		.set<SUB_STATE>(&m_state)
+		.set<SUB_FRAME>(&m_frame)
+		.set<SUB_ALLOC>(&m_alloc)
+		.set<SUB_LOG>(&m_log)
+		.set<SUB_MODULES>(&m_modules);
 }
 
 // only the engine context is exposed to the engine, as it will be using the subsystems
@@ -48,18 +135,114 @@ namespace ctx
 //
 engine_context_t g_engine =
 {
-	.subsystems = ctx::m_subsystems,
-	.subsystem_count = std::size(ctx::m_subsystems)
+	.subsystems		 = ctx::m_subsystems.entries,
+	.subsystem_count = SUB_COUNT
 };
 
 
 //
 // main entry point
 //
-int main()
+int main(int argc, char** argv)
 {
+    // run a benchmark instead, eg. hotrod --bench-dispatch [modules] [ticks]
+    if (argc > 1 && std::string(argv[1]) == "--bench-dispatch")
+    {
+        bench::dispatch(argc > 2 ? std::stoull(argv[2]) : 10000, argc > 3 ? std::stoull(argv[3]) : 1000);
+        return 0;
+    }
+
+    // eg. hotrod --bench-graph [modules] [work per module in ns] [ticks]
+    if (argc > 1 && std::string(argv[1]) == "--bench-graph")
+    {
+        bench::graph(argc > 2 ? std::stoull(argv[2]) : 256, argc > 3 ? std::stoull(argv[3]) : 10000, argc > 4 ? std::stoull(argv[4]) : 50);
+        return 0;
+    }
+
+    // eg. hotrod --bench-alloc [threads] [allocations per thread]
+    if (argc > 1 && std::string(argv[1]) == "--bench-alloc")
+    {
+        bench::alloc(argc > 2 ? std::stoull(argv[2]) : 4, argc > 3 ? std::stoull(argv[3]) : 1000000);
+        return 0;
+    }
+
+    // eg. hotrod --bench-frame [threads] [allocations per tick] [ticks]
+    if (argc > 1 && std::string(argv[1]) == "--bench-frame")
+    {
+        bench::frame(argc > 2 ? std::stoull(argv[2]) : 4, argc > 3 ? std::stoull(argv[3]) : 1000, argc > 4 ? std::stoull(argv[4]) : 1000);
+        return 0;
+    }
+
+    // eg. hotrod --bench-events [producers] [events per producer]
+    if (argc > 1 && std::string(argv[1]) == "--bench-events")
+    {
+        bench::events(argc > 2 ? std::stoull(argv[2]) : 4, argc > 3 ? std::stoull(argv[3]) : 1000000);
+        return 0;
+    }
+
+    // run the whole suite against modgen's modules and write the results out as json,
+    // eg. hotrod --bench-suite [dir] [json] [reloads], see CMakeLists.txt
+    if (argc > 1 && std::string(argv[1]) == "--bench-suite")
+    {
+        bench::suite(argc > 2 ? argv[2] : "bench", argc > 3 ? argv[3] : "bench.json", argc > 4 ? std::stoull(argv[4]) : 20);
+        return 0;
+    }
+
+    // reload a module thousands of times while ticking and fail if anything keeps growing,
+    // eg. hotrod --soak [dir] [json] [reloads], see CMakeLists.txt
+    if (argc > 1 && std::string(argv[1]) == "--soak")
+    {
+        bool passed = bench::soak(argc > 2 ? argv[2] : "bench", argc > 3 ? argv[3] : "soak.json", argc > 4 ? std::stoull(argv[4]) : 5000);
+        return passed ? 0 : 1;
+    }
+
+    // eg. hotrod --bench-lazy [dir] [json] [modules used in every 100], see CMakeLists.txt
+    if (argc > 1 && std::string(argv[1]) == "--bench-lazy")
+    {
+        bench::lazy(argc > 2 ? argv[2] : "bench", argc > 3 ? argv[3] : "lazy.json", argc > 4 ? std::stoull(argv[4]) : 10);
+        return 0;
+    }
+
+    // eg. hotrod --bench-index [dir] [json] [modules], see CMakeLists.txt
+    if (argc > 1 && std::string(argv[1]) == "--bench-index")
+    {
+        bench::index(argc > 2 ? argv[2] : "bench", argc > 3 ? argv[3] : "index.json", argc > 4 ? std::stoull(argv[4]) : 1000);
+        return 0;
+    }
+
+    // capture a chrome trace of our first few frames, eg. hotrod --trace [file] [frames]
+    std::string trace_path;
+    int         trace_frames = 0;
+
+    if (argc > 1 && std::string(argv[1]) == "--trace")
+    {
+        trace_path   = argc > 2 ? argv[2] : "trace.json";
+        trace_frames = argc > 3 ? std::stoi(argv[3]) : 300;
+
+        // before anything loads, so that the first loads are in it
+        g_trace.begin_capture();
+    }
+
+    // sample where the cpu goes for our first few frames, eg. hotrod --profile [file] [frames] [hz]
+    std::string profile_path;
+    int         profile_frames = 0;
+
+    if (argc > 1 && std::string(argv[1]) == "--profile")
+    {
+        profile_path   = argc > 2 ? argv[2] : "profile.folded";
+        profile_frames = argc > 3 ? std::stoi(argv[3]) : 300;
+
+        g_profiler.start(argc > 4 ? std::stoul(argv[4]) : PROF_HZ);
+    }
+
     printmsg("hotrod starting...");
 
+    // start our workers before any modules load, so that they can use them straight away
+    g_thread_pool.init();
+
+    // same for our scratch memory
+    g_frame_arena.init(FRAME_ARENA_SIZE);
+
     // initialise the dll manager with paths to look for dlls in
     g_dll.init({"."});
 
@@ -71,28 +254,56 @@ int main()
 
     printdebug("starting main loop...");
 
+    // start pacing our frames
+    g_scheduler.init({ .frame_rate = 60.0, .fixed_rate = 50.0 });
+
     // whether we're running
     bool running = true;
 
-    // current tick of our program
-    int ticks = 0;
+    // number of frames we've run
+    int frames = 0;
 
-    // max number of ticks before we exit
+    // max number of frames before we exit
     // will kill the program if set to a negative number
-    constexpr int max_ticks = 5;
+    constexpr int max_frames = 600;
+
+    // how often to look for new and changed dlls when we're not being notified of changes
+    constexpr auto search_delay = 2s;
+
+    // when we last looked for new and changed dlls
+    auto last_search = std::chrono::steady_clock::now();
 
-    // how often to look for new dlls, in ticks
-    constexpr int search_delay = 1;
+    // how often to print how long everyone's hooks have been taking lately, and when we last did
+    constexpr auto summary_delay = 10s;
 
-    // how long to sleep at the end of a tick
-    constexpr std::chrono::duration<long long> sleep_dur = 2s;
+    auto last_summary = last_search;
+
+    // longest a tick has taken us, and the longest one that had to install a reload, in nanoseconds
+    uint64_t max_tick_ns        = 0;
+    uint64_t max_reload_tick_ns = 0;
 
     // while we're running
     while (running)
 	{
-        // look for new dlls every few ticks
-        if (ticks % search_delay == 0)
+        const frame_t& frame = g_scheduler.begin_frame();
+
+        auto tick_start = std::chrono::steady_clock::now();
+
+        // swap in anything the loader finished staging since last tick, this is a tick boundary
+        // so nothing is running module code
+        size_t installed = g_dll.install_staged();
+
+        if (installed > 0)
+            printdebug(installed << " module(s) installed");
+
+        // unload anything we loaded lazily that's gone unneeded for too long
+        g_dll.evict_idle();
+
+        // if we're not being notified of changes then we have to go looking for them
+        if (!g_dll.watching() && tick_start - last_search >= search_delay)
         {
+            last_search = tick_start;
+
             printdebug("checking for new dlls...");
 
             // check for modules and get how many were loaded, if any
@@ -100,28 +311,85 @@ int main()
 
             if (count > 0)
                 printdebug(count << " new module(s) found and loaded");
-        }
 
-        // check and reload any modified dlls
-        size_t reloaded = g_dll.reload_modified();
+            // check and reload any modified dlls
+            size_t reloaded = g_dll.reload_modified();
 
-        if (reloaded > 0)
-            printdebug(reloaded << " module(s) reloaded");
+            if (reloaded > 0)
+                printdebug(reloaded << " module(s) reloaded");
+        }
+
+        // catch our fixed rate modules up to now
+        for (uint32_t i = 0; i < frame.fixed_steps; ++i)
+            g_dll.fixed_update_all(frame.fixed_dt, frame.first_step + i);
 
         // update all loaded modules
-        g_dll.update_all();
+        g_dll.update_all(frame);
+
+        // hand out everything our modules published this tick
+        g_event_bus.flush();
+
+        // nobody's allowed to hold on to this tick's scratch memory past here
+        g_frame_arena.reset();
+
+        g_scheduler.end_frame();
 
-        // sleep for our set duration
-        std::this_thread::sleep_for(sleep_dur);
+        // keep track of how long our ticks take, so we can see that reloads aren't stalling them
+        uint64_t tick_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tick_start).count();
+
+        max_tick_ns = std::max(max_tick_ns, tick_ns);
+
+        if (installed > 0)
+            max_reload_tick_ns = std::max(max_reload_tick_ns, tick_ns);
+
+        // until our next frame is due, wake up to handle any dll changes as soon as they settle
+        // so that we're not waiting a whole tick to reload something, leaving the last bit of
+        // the wait to the scheduler so that we start the next frame on time
+        while (g_dll.watching())
+        {
+            auto remaining = g_scheduler.remaining() - g_scheduler.config().spin;
+
+            if (remaining <= std::chrono::milliseconds(1))
+                break;
+
+            if (g_dll.wait(std::chrono::duration_cast<std::chrono::milliseconds>(remaining)))
+            {
+                size_t changed = g_dll.process_events();
+
+                // we're between ticks, so anything that's been staged can go in now
+                changed += g_dll.install_staged();
+
+                if (changed > 0)
+                    printdebug(changed << " module(s) changed");
+            }
+        }
+
+        g_scheduler.sleep();
 
         // increase our counter
-        ticks++;
+        frames++;
 
-        ASSERT(ticks >= max_ticks, "finished running, killing...");
+        if (tick_start - last_summary >= summary_delay)
+        {
+            last_summary = tick_start;
+
+            g_trace.summary();
+
+            if (g_profiler.running())
+                g_profiler.summary();
+        }
+
+        if (!trace_path.empty() && frames == trace_frames)
+            g_trace.end_capture(trace_path);
+
+        if (!profile_path.empty() && frames == profile_frames)
+            g_profiler.stop(profile_path);
+
+        ASSERT(frames >= max_frames, "finished running, killing...");
 
         // check if we should stop, used for debugging
-        // if we set max_ticks to a negative then this will alway trigger
-        if (max_ticks > 0 && ticks >= max_ticks)
+        // if we set max_frames to a negative then this will alway trigger
+        if (max_frames > 0 && frames >= max_frames)
         {
             running = false;
         }
@@ -129,12 +397,24 @@ int main()
 
     printdebug("finishing...");
 
+    printdebug(std::format("longest tick : {:.3f}ms, longest tick with a reload : {:.3f}ms", max_tick_ns / 1e6, max_reload_tick_ns / 1e6));
+
+    // how well we kept to our frame rate
+    g_scheduler.dump();
+
     // dump manager state before shutdown
     g_dll.dump();
 
     // unload all dlls (this happens automatically in dll_manager destructor, but explicit is nice)
     g_dll.unload_all();
 
+    // unloading only retires each build, so wait for them to actually go here, while the pool and
+    // subsystems their shutdown uses are still around, rather than during static destruction
+    g_epoch.barrier();
+
+    // every module's shut down and gone, so nothing else can be submitted
+    g_thread_pool.shutdown();
+
     // cleanup subsystems
     g_subsystem.cleanup();
 
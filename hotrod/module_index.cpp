@@ -0,0 +1,396 @@
+//
+//	module_index.cpp | Finn Le Var
+//
+#include "module_index.h"
+
+#include <fstream>
+#include <cstring>
+
+#include "util.h"
+#include "shared/macros.h"
+#include "shared/print.h"
+
+//
+// static vars
+//
+namespace
+{
+	// bumped whenever the layout below changes, an index from another version is just ignored
+	constexpr char		INDEX_MAGIC[4] = { 'H', 'R', 'I', 'X' };
+	constexpr uint32_t	INDEX_VERSION  = 1;
+
+	//
+	// the start of the file
+	//
+	struct header_t
+	{
+		char	 magic[4];
+		uint32_t version;
+		uint32_t dir_count;
+		uint32_t entry_count;
+		uint32_t strings_size;
+		uint32_t reserved;
+	};
+
+	//
+	// a watch path, and its write time when it was last scanned
+	//
+	struct dir_t
+	{
+		uint32_t path;
+		uint32_t reserved;
+		int64_t	 write_time;
+	};
+
+	//
+	// a single module, strings are offsets into the string table, and its dependencies are
+	// depends_count strings one after the other from depends
+	//
+	struct record_t
+	{
+		uint32_t name;
+		uint32_t path;
+		uint32_t depends;
+		uint32_t depends_count;
+		uint64_t size;
+		int64_t	 write_time;
+		uint64_t hash;
+		uint32_t hooks;
+		uint8_t	 hash_mode;
+		uint8_t	 major;
+		uint8_t	 minor;
+		uint8_t	 reserved;
+	};
+
+	static_assert(sizeof(header_t) == 24 && sizeof(dir_t) == 16 && sizeof(record_t) == 48, "the index's layout has to be the same everywhere");
+
+	//
+	// reads a struct out of the file, which doesn't promise to be aligned
+	//
+	template<typename type_t>
+	type_t read(const uint8_t* _ptr)
+	{
+		type_t value;
+		std::memcpy(&value, _ptr, sizeof(type_t));
+		return value;
+	}
+
+	//
+	// appends a struct to the file we're building
+	//
+	template<typename type_t>
+	void append(std::string& _out, const type_t& _value)
+	{
+		_out.append(RECAST(const char*, &_value), sizeof(type_t));
+	}
+
+	//
+	// the string table we're building, each string is only stored once
+	//
+	class strings_t
+	{
+	private:
+
+		std::string								  m_data;
+		std::unordered_map<std::string, uint32_t> m_offsets;
+
+	public:
+
+		uint32_t add(const std::string& _string)
+		{
+			auto [it, added] = m_offsets.try_emplace(_string, CASTTO(uint32_t, m_data.size()));
+
+			if (added)
+				m_data.append(_string.c_str(), _string.size() + 1);
+
+			return it->second;
+		}
+
+		const std::string& data() const { return m_data; }
+	};
+
+	std::filesystem::file_time_type to_time(int64_t _count)
+	{
+		return std::filesystem::file_time_type(std::filesystem::file_time_type::duration(_count));
+	}
+
+	int64_t from_time(std::filesystem::file_time_type _time)
+	{
+		return CASTTO(int64_t, _time.time_since_epoch().count());
+	}
+}
+
+//
+// reads the index at the given path
+//
+bool module_index_t::load(const std::string& _path)
+{
+	clear();
+
+	mapped_file_t file;
+
+	if (!file.open(_path))
+		return false;
+
+	const uint8_t* data = file.data;
+	const size_t   size = file.size;
+
+	if (size < sizeof(header_t))
+		printerret(false, "module index '" << _path << "' is too small to be one, ignoring it");
+
+	const header_t header = read<header_t>(data);
+
+	if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.version != INDEX_VERSION)
+		printerret(false, "module index '" << _path << "' is from a different version, ignoring it");
+
+	const size_t dirs_at	= sizeof(header_t);
+	const size_t records_at = dirs_at + CASTTO(size_t, header.dir_count) * sizeof(dir_t);
+	const size_t strings_at = records_at + CASTTO(size_t, header.entry_count) * sizeof(record_t);
+
+	// every string ends in a nul, so as long as the table does too, reading any of them stops inside it
+	if (strings_at + header.strings_size != size || (header.strings_size && data[size - 1] != '\0'))
+		printerret(false, "module index '" << _path << "' is damaged, ignoring it");
+
+	const char* strings = RECAST(const char*, data + strings_at);
+
+	auto string = [&](uint32_t _offset, std::string& _out)
+	{
+		if (_offset >= header.strings_size)
+			return false;
+
+		_out = strings + _offset;
+
+		return true;
+	};
+
+	for (uint32_t i = 0; i < header.dir_count; ++i)
+	{
+		const dir_t dir = read<dir_t>(data + dirs_at + i * sizeof(dir_t));
+
+		std::string path;
+
+		if (!string(dir.path, path))
+		{
+			clear();
+			printerret(false, "module index '" << _path << "' is damaged, ignoring it");
+		}
+
+		m_dirs[path] = to_time(dir.write_time);
+	}
+
+	for (uint32_t i = 0; i < header.entry_count; ++i)
+	{
+		const record_t record = read<record_t>(data + records_at + i * sizeof(record_t));
+
+		std::string	  name;
+		index_entry_t entry;
+
+		bool valid = string(record.name, name) && string(record.path, entry.path);
+
+		// its dependencies are one after the other, each starting just past the last one's nul
+		for (uint32_t dep = 0, offset = record.depends; valid && dep < record.depends_count; ++dep)
+		{
+			valid = string(offset, entry.depends.emplace_back());
+			offset += CASTTO(uint32_t, entry.depends.back().size() + 1);
+		}
+
+		if (!valid)
+		{
+			clear();
+			printerret(false, "module index '" << _path << "' is damaged, ignoring it");
+		}
+
+		entry.size		 = record.size;
+		entry.write_time = to_time(record.write_time);
+		entry.hash		 = record.hash;
+		entry.hash_mode	 = CASTTO(hash_mode_t, record.hash_mode);
+		entry.major		 = record.major;
+		entry.minor		 = record.minor;
+		entry.hooks		 = record.hooks;
+
+		m_entries[name] = std::move(entry);
+	}
+
+	return true;
+}
+
+//
+// writes us to the given path
+//
+bool module_index_t::save(const std::string& _path)
+{
+	strings_t strings;
+
+	std::string dirs;
+	std::string records;
+
+	for (const auto& [path, write_time] : m_dirs)
+		append(dirs, dir_t{ .path = strings.add(path), .write_time = from_time(write_time) });
+
+	for (const auto& [name, entry] : m_entries)
+	{
+		record_t record =
+		{
+			.name		   = strings.add(name),
+			.path		   = strings.add(entry.path),
+			.depends_count = CASTTO(uint32_t, entry.depends.size()),
+			.size		   = entry.size,
+			.write_time	   = from_time(entry.write_time),
+			.hash		   = entry.hash,
+			.hooks		   = entry.hooks,
+			.hash_mode	   = CASTTO(uint8_t, entry.hash_mode),
+			.major		   = entry.major,
+			.minor		   = entry.minor,
+		};
+
+		// they have to be one after the other, so they're added as a single string with nuls in between
+		if (!entry.depends.empty())
+		{
+			std::string depends;
+
+			for (const auto& dep : entry.depends)
+				depends += dep + '\0';
+
+			depends.pop_back();
+
+			record.depends = strings.add(depends);
+		}
+
+		append(records, record);
+	}
+
+	header_t header = {};
+
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+
+	header.version		= INDEX_VERSION;
+	header.dir_count	= CASTTO(uint32_t, m_dirs.size());
+	header.entry_count	= CASTTO(uint32_t, m_entries.size());
+	header.strings_size = CASTTO(uint32_t, strings.data().size());
+
+	std::error_code ec;
+
+	if (auto parent = std::filesystem::path(_path).parent_path(); !parent.empty())
+		std::filesystem::create_directories(parent, ec);
+
+	const std::string temp = _path + ".tmp";
+
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+
+		if (!file)
+			printerret(false, "couldn't open '" << temp << "' to write the module index to");
+
+		file.write(RECAST(const char*, &header), sizeof(header));
+		file.write(dirs.data(), dirs.size());
+		file.write(records.data(), records.size());
+		file.write(strings.data().data(), strings.data().size());
+
+		if (!file)
+			printerret(false, "failed to write the module index to '" << temp << "'");
+	}
+
+	std::filesystem::rename(temp, _path, ec);
+
+	if (ec)
+		printerret(false, "failed to replace the module index at '" << _path << "', " << ec.message());
+
+	m_dirty = false;
+
+	return true;
+}
+
+//
+// gets the entry for the given module, if its file hasn't changed since
+//
+const index_entry_t* module_index_t::find(const std::string& _name, const std::string& _path) const
+{
+	auto it = m_entries.find(_name);
+
+	if (it == m_entries.end() || it->second.path != _path)
+		return nullptr;
+
+	std::error_code ec;
+
+	auto write_time = std::filesystem::last_write_time(_path, ec);
+
+	if (ec || write_time != it->second.write_time)
+		return nullptr;
+
+	auto size = std::filesystem::file_size(_path, ec);
+
+	if (ec || size != it->second.size)
+		return nullptr;
+
+	return &it->second;
+}
+
+//
+// records what we know about the given module
+//
+void module_index_t::set(const std::string& _name, index_entry_t _entry)
+{
+	auto [it, added] = m_entries.try_emplace(_name);
+
+	if (!added && it->second == _entry)
+		return;
+
+	it->second = std::move(_entry);
+	m_dirty	   = true;
+}
+
+//
+// records that the given module exists
+//
+void module_index_t::add(const std::string& _name, const std::string& _path)
+{
+	auto it = m_entries.find(_name);
+
+	if (it != m_entries.end() && it->second.path == _path)
+		return;
+
+	set(_name, { .path = _path });
+}
+
+//
+// forgets the given module
+//
+void module_index_t::erase(const std::string& _name)
+{
+	m_dirty |= m_entries.erase(_name) > 0;
+}
+
+//
+// whether the given watch path hasn't changed since it was last scanned
+//
+bool module_index_t::unchanged(const std::string& _dir, std::filesystem::file_time_type _write_time) const
+{
+	auto it = m_dirs.find(_dir);
+
+	return it != m_dirs.end() && it->second == _write_time;
+}
+
+//
+// records the write time the given watch path had when it was scanned
+//
+void module_index_t::scanned(const std::string& _dir, std::filesystem::file_time_type _write_time)
+{
+	auto [it, added] = m_dirs.try_emplace(_dir, _write_time);
+
+	if (!added && it->second == _write_time)
+		return;
+
+	it->second = _write_time;
+	m_dirty	   = true;
+}
+
+//
+// forgets everything
+//
+void module_index_t::clear()
+{
+	m_entries.clear();
+	m_dirs.clear();
+
+	m_dirty = false;
+}
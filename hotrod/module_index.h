@@ -0,0 +1,134 @@
+//
+//	module_index.h | Finn Le Var
+//
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <cstdint>
+
+#include "hash.h"
+
+//
+// what we knew about a module the last time it was loaded, see module_index_t
+//
+struct index_entry_t
+{
+	std::string path;
+
+	// the file we learnt all this from, if it's still the same size and write time then it's still right
+	uint64_t						size	   = 0;
+	std::filesystem::file_time_type write_time = {};
+
+	// its fingerprint, and the mode it was taken with
+	uint64_t	hash	  = 0;
+	hash_mode_t hash_mode = HASH_OFF;
+
+	// its version, the hooks it implements as bits of hook_t, and the modules it depends on
+	uint8_t					 major = 0;
+	uint8_t					 minor = 0;
+	uint32_t				 hooks = 0;
+	std::vector<std::string> depends;
+
+	bool operator==(const index_entry_t&) const = default;
+};
+
+//
+// a persistent index of every module we've loaded, keyed by name, so that the next run doesn't
+// have to learn everything about them again before it can start loading
+//
+// it's saved as a single compact file, a header, then the watch paths and the write times they had
+// when they were last scanned, then a fixed size record per module, then every string they point
+// to, which is mapped and read in one go on startup
+//
+// an entry is only trusted while its file has the same size and write time it had when it was
+// recorded, and a watch path's scan is only skipped while its directory's write time hasn't moved,
+// which it does whenever a file in it is added, removed, or renamed
+//
+class module_index_t
+{
+private:
+
+	std::unordered_map<std::string, index_entry_t> m_entries;
+
+	// each watch path's write time the last time it was scanned
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_dirs;
+
+	// whether anything has changed since we were loaded or saved
+	bool m_dirty = false;
+
+public:
+
+	//
+	// reads the index at the given path, returns false if there isn't one, or it's from a different
+	// version of the format or is damaged, in which case we start empty
+	//
+	bool load(const std::string& _path);
+
+	//
+	// writes us to the given path, through a temporary file so that a crash part way through
+	// leaves the old index rather than half of a new one, returns false if it couldn't be written
+	//
+	bool save(const std::string& _path);
+
+	//
+	// gets the entry for the given module, only if it's from the file at the given path and that file
+	// hasn't changed since, stats the file to check, so it's safe to call from any thread as long as
+	// nothing is changing us
+	//
+	const index_entry_t* find(const std::string& _name, const std::string& _path) const;
+
+	//
+	// records what we know about the given module
+	//
+	void set(const std::string& _name, index_entry_t _entry);
+
+	//
+	// forgets the given module
+	//
+	void erase(const std::string& _name);
+
+	//
+	// records that the given module exists, without knowing anything else about it yet, unless we
+	// already have it at that path, so that it's still listed if it doesn't load
+	//
+	void add(const std::string& _name, const std::string& _path);
+
+	//
+	// forgets every module for which _keep, given its name and entry, returns false
+	//
+	template<typename fn_t>
+	void prune(fn_t&& _keep)
+	{
+		m_dirty |= std::erase_if(m_entries, [&](const auto& _entry) { return !_keep(_entry.first, _entry.second); }) > 0;
+	}
+
+	//
+	// whether the given watch path's directory still has the write time it had when it was last
+	// scanned, in which case every module in it is already in the index
+	//
+	bool unchanged(const std::string& _dir, std::filesystem::file_time_type _write_time) const;
+
+	//
+	// records the write time the given watch path had when it was scanned, take it before the scan
+	// so that anything added during it moves it on, and the next run scans again
+	//
+	void scanned(const std::string& _dir, std::filesystem::file_time_type _write_time);
+
+	//
+	// every module we have an entry for, whether its file has changed or not
+	//
+	const std::unordered_map<std::string, index_entry_t>& entries() const { return m_entries; }
+
+	//
+	// whether anything has changed since we were loaded or saved
+	//
+	bool dirty() const { return m_dirty; }
+
+	//
+	// forgets everything
+	//
+	void clear();
+};
@@ -0,0 +1,568 @@
+//
+//	profiler.cpp | Finn Le Var
+//
+#include "profiler.h"
+
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <ucontext.h>
+#include <execinfo.h>
+#include <sys/time.h>
+#include <link.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#endif
+
+// what samples that weren't in any of our modules are credited to
+#define PROF_ENGINE "engine"
+
+//
+// static vars
+//
+namespace
+{
+	// the profiler the signal handler queues samples for, null once it's gone
+	std::atomic<profiler_t*> g_active = nullptr;
+
+	// our handler stays installed once it has been, so that a signal that was already on its way
+	// when we stopped doesn't get the default action, which would kill us
+	bool g_installed = false;
+}
+
+//
+// our SIGPROF handler
+//
+struct prof_signal_t
+{
+#ifdef __linux__
+	static void handle(int, siginfo_t*, void* _context)
+	{
+		// we interrupted someone who might be about to check it
+		int error = errno;
+
+		if (profiler_t* profiler = g_active.load(std::memory_order_acquire))
+			profiler->sample(_context);
+
+		errno = error;
+	}
+#endif
+};
+
+//
+// makes our queue
+//
+profiler_t::profiler_t()
+{
+	m_queue = std::make_unique<sample_t[]>(PROF_SAMPLES);
+
+	// each slot starts out ready for the producer that gets it first time round
+	for (uint64_t i = 0; i < PROF_SAMPLES; ++i)
+		m_queue[i].seq.store(i, std::memory_order_relaxed);
+}
+
+//
+// stops sampling
+//
+profiler_t::~profiler_t()
+{
+	if (running())
+		stop();
+
+	g_active.store(nullptr, std::memory_order_release);
+}
+
+//
+// starts sampling
+//
+bool profiler_t::start(uint32_t _hz)
+{
+#ifndef __linux__
+	printerret(false, "the sampling profiler is only supported on linux");
+#else
+	if (_hz == 0)
+		printerret(false, "can't sample at 0hz");
+
+	if (m_running.load(std::memory_order_acquire))
+		printerret(false, "we're already sampling");
+
+	{
+		LGUARD(m_mutex);
+
+		// take off anything a previous run left behind
+		collect();
+
+		m_stacks.clear();
+		m_shares.clear();
+		m_samples = 0;
+		m_stale	  = true;
+
+		m_dropped.store(0, std::memory_order_relaxed);
+	}
+
+	// backtrace loads the unwinder the first time it's called, which isn't safe to do in a signal handler
+	void* prime[4];
+	backtrace(prime, 4);
+
+	if (!g_installed)
+	{
+		struct sigaction action = {};
+
+		action.sa_sigaction = &prof_signal_t::handle;
+		action.sa_flags		= SA_SIGINFO | SA_RESTART;
+
+		sigemptyset(&action.sa_mask);
+
+		if (sigaction(SIGPROF, &action, nullptr) != 0)
+			printerret(false, "failed to install our SIGPROF handler : " << std::strerror(errno));
+
+		g_installed = true;
+	}
+
+	m_hz = _hz;
+
+	g_active.store(this, std::memory_order_release);
+	m_running.store(true, std::memory_order_release);
+
+	m_collector = std::thread(&profiler_t::collect_loop, this);
+
+	// counts cpu time across every thread, and the signal goes to whichever one was using it
+	itimerval timer = {};
+
+	// tv_usec has to stay under a second, so anything at or below 1hz goes in tv_sec
+	const long period_us = std::max<long>(1, 1000000 / CASTTO(long, _hz));
+
+	timer.it_interval.tv_sec  = period_us / 1000000;
+	timer.it_interval.tv_usec = period_us % 1000000;
+	timer.it_value			  = timer.it_interval;
+
+	if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+	{
+		int error = errno;
+
+		stop();
+
+		printerret(false, "failed to start our SIGPROF timer : " << std::strerror(error));
+	}
+
+	printdebug("sampling at " << _hz << "hz");
+
+	return true;
+#endif
+}
+
+//
+// stops sampling
+//
+bool profiler_t::stop(const std::string& _path)
+{
+	if (!m_running.exchange(false, std::memory_order_acq_rel))
+		printerret(false, "we're not sampling");
+
+#ifdef __linux__
+	itimerval timer = {};
+
+	setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+
+	m_wake.notify_all();
+
+	if (m_collector.joinable())
+		m_collector.join();
+
+	LGUARD(m_mutex);
+
+	// whatever came in since the collector last ran
+	collect();
+
+	print_shares();
+
+	return _path.empty() || write(_path);
+}
+
+//
+// tells us that a build of the given module was loaded from the given shadow
+//
+void profiler_t::map(const std::string& _shadow, const std::string& _name)
+{
+	LGUARD(m_mutex);
+
+	m_shadows[_shadow] = _name;
+
+	// the loader might have been handed a path that it tidied up
+	std::error_code ec;
+	auto			canonical = std::filesystem::weakly_canonical(_shadow, ec);
+
+	if (!ec)
+		m_shadows[canonical.string()] = _name;
+
+	m_stale = true;
+}
+
+//
+// tells us that the build loaded from the given shadow is about to be unloaded
+//
+void profiler_t::unmap(const std::string& _shadow)
+{
+	LGUARD(m_mutex);
+
+	// credit what we've got while its addresses still point into it, anything sampled between
+	// here and it actually being unloaded ends up as unknown, or in whatever's loaded there next
+	if (m_running.load(std::memory_order_acquire))
+		collect();
+
+	std::error_code ec;
+	auto			canonical = std::filesystem::weakly_canonical(_shadow, ec).string();
+
+	std::erase_if(m_shadows, [&](const auto& _entry) { return _entry.first == _shadow || _entry.first == canonical; });
+
+	// something else might be loaded where it was
+	m_symbols.clear();
+
+	m_stale = true;
+}
+
+//
+// prints each module's share of everything we've sampled so far
+//
+void profiler_t::summary()
+{
+	LGUARD(m_mutex);
+
+	if (m_samples > 0)
+		print_shares();
+}
+
+//
+// prints what we're sampling
+//
+void profiler_t::dump()
+{
+	LGUARD(m_mutex);
+
+	printdebug("profiler : " << (running() ? std::format("sampling at {}hz", m_hz) : std::string("stopped")) << ", " << m_samples << " sample(s), "
+		<< m_dropped.load() << " dropped, " << m_stacks.size() << " unique stack(s), " << m_objects.size() << " object(s) loaded");
+}
+
+//
+// queues the interrupted thread's stack
+//
+void profiler_t::sample(void* _context)
+{
+#ifdef __linux__
+	if (!m_running.load(std::memory_order_relaxed))
+		return;
+
+	// where we were interrupted, the unwinder's frames start in our handler
+	auto*	  context = CASTTO(ucontext_t*, _context);
+	uintptr_t pc	  = 0;
+
+#if defined(__x86_64__)
+	pc = CASTTO(uintptr_t, context->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__i386__)
+	pc = CASTTO(uintptr_t, context->uc_mcontext.gregs[REG_EIP]);
+#elif defined(__aarch64__)
+	pc = CASTTO(uintptr_t, context->uc_mcontext.pc);
+#endif
+
+	void* frames[PROF_DEPTH + 4];
+	int	  count = backtrace(frames, PROF_DEPTH + 4);
+
+	// claim a slot, we can't wait for the collector in here so if we're full it's dropped
+	uint64_t  pos  = m_head.load(std::memory_order_relaxed);
+	sample_t* slot = nullptr;
+
+	while (true)
+	{
+		slot = &m_queue[pos & (PROF_SAMPLES - 1)];
+
+		int64_t diff = CASTTO(int64_t, slot->seq.load(std::memory_order_acquire) - pos);
+
+		if (diff == 0 && m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			break;
+
+		if (diff < 0)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (diff > 0)
+			pos = m_head.load(std::memory_order_relaxed);
+	}
+
+	uint32_t depth = 0;
+	int		 from  = 2;
+
+	// skip our handler and the signal trampoline, up to the frame that we interrupted
+	if (pc)
+	{
+		slot->frames[depth++] = pc;
+
+		from = count;
+
+		for (int i = 0; i < std::min(count, 4); ++i)
+		{
+			if (RECAST(uintptr_t, frames[i]) == pc)
+			{
+				from = i + 1;
+				break;
+			}
+		}
+	}
+
+	for (int i = from; i < count && depth < PROF_DEPTH; ++i)
+		slot->frames[depth++] = RECAST(uintptr_t, frames[i]);
+
+	slot->depth = depth;
+
+	slot->seq.store(pos + 1, std::memory_order_release);
+#else
+	(void)_context;
+#endif
+}
+
+//
+// our collector thread
+//
+void profiler_t::collect_loop()
+{
+	std::unique_lock lock(m_mutex);
+
+	while (m_running.load(std::memory_order_acquire))
+	{
+		m_wake.wait_for(lock, std::chrono::milliseconds(PROF_COLLECT_MS), [this]() { return !m_running.load(std::memory_order_acquire); });
+
+		collect();
+	}
+}
+
+//
+// takes everything off the queue and credits it
+//
+void profiler_t::collect()
+{
+	std::string				 stack;
+	std::vector<std::string> seen;
+
+	while (true)
+	{
+		sample_t& slot = m_queue[m_tail & (PROF_SAMPLES - 1)];
+
+		if (slot.seq.load(std::memory_order_acquire) != m_tail + 1)
+			break;
+
+		if (m_stale)
+			refresh();
+
+		const object_t* owner	  = nullptr;
+		bool			refreshed = false;
+
+		stack.clear();
+		seen.clear();
+
+		// root first, like flamegraph.pl wants
+		for (uint32_t i = slot.depth; i-- > 0; )
+		{
+			// return addresses point after the call, so step back into it
+			uintptr_t address = slot.frames[i] - (i > 0 ? 1 : 0);
+
+			const object_t* object = find(address);
+
+			// something was loaded that we weren't told about
+			if (!object && !refreshed)
+			{
+				refresh();
+
+				refreshed = true;
+				object	  = find(address);
+			}
+
+			if (!stack.empty())
+				stack += ';';
+
+			stack += object ? symbol(address, *object) : "[unknown]";
+
+			if (object && object->module)
+			{
+				// the innermost module is who the cpu was being used for, even if it was
+				// down in the engine or a system library on its behalf
+				owner = object;
+
+				if (std::find(seen.begin(), seen.end(), object->name) == seen.end())
+					seen.push_back(object->name);
+			}
+		}
+
+		m_stacks[stack]++;
+
+		m_shares[owner ? owner->name : PROF_ENGINE].self++;
+
+		for (const auto& name : seen)
+			m_shares[name].total++;
+
+		if (!owner)
+			m_shares[PROF_ENGINE].total++;
+
+		m_samples++;
+
+		// hand the slot back for the producer that gets it next time round
+		slot.seq.store(m_tail + PROF_SAMPLES, std::memory_order_release);
+
+		m_tail++;
+	}
+}
+
+//
+// finds everything that's loaded and where
+//
+void profiler_t::refresh()
+{
+	m_objects.clear();
+	m_ranges.clear();
+
+#ifdef __linux__
+	dl_iterate_phdr([](dl_phdr_info* _info, size_t, void* _data)
+	{
+		auto profiler = CASTTO(profiler_t*, _data);
+
+		object_t object = { .base = CASTTO(uintptr_t, _info->dlpi_addr) };
+
+		std::string path = _info->dlpi_name ? _info->dlpi_name : "";
+
+		// the first one is always our executable
+		if (profiler->m_objects.empty() && path.empty())
+			object.name = program_invocation_short_name;
+		else if (auto shadow = profiler->m_shadows.find(path); shadow != profiler->m_shadows.end())
+		{
+			object.name	  = shadow->second;
+			object.module = true;
+		}
+		else
+			object.name = std::filesystem::path(path).filename().string();
+
+		if (object.name.empty())
+			object.name = "[unknown]";
+
+		for (int i = 0; i < _info->dlpi_phnum; ++i)
+		{
+			const auto& header = _info->dlpi_phdr[i];
+
+			if (header.p_type != PT_LOAD)
+				continue;
+
+			uintptr_t start = object.base + header.p_vaddr;
+
+			profiler->m_ranges.push_back({ start, start + header.p_memsz, CASTTO(uint32_t, profiler->m_objects.size()) });
+		}
+
+		profiler->m_objects.push_back(std::move(object));
+
+		return 0;
+	}, this);
+#endif
+
+	std::sort(m_ranges.begin(), m_ranges.end(), [](const range_t& _a, const range_t& _b) { return _a.start < _b.start; });
+
+	m_stale = false;
+}
+
+//
+// gets the object the given address is in
+//
+const profiler_t::object_t* profiler_t::find(uintptr_t _address) const
+{
+	auto range = std::upper_bound(m_ranges.begin(), m_ranges.end(), _address, [](uintptr_t _address, const range_t& _range) { return _address < _range.start; });
+
+	if (range == m_ranges.begin())
+		return nullptr;
+
+	--range;
+
+	return _address < range->end ? &m_objects[range->object] : nullptr;
+}
+
+//
+// gets a name for the given address in the given object
+//
+const std::string& profiler_t::symbol(uintptr_t _address, const object_t& _object)
+{
+	auto& name = m_symbols[_address];
+
+	if (!name.empty())
+		return name;
+
+#ifdef __linux__
+	Dl_info info = {};
+
+	if (dladdr(RECAST(void*, _address), &info) && info.dli_sname)
+	{
+		int	  status	= 0;
+		char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+		name = _object.name + "!" + (status == 0 && demangled ? demangled : info.dli_sname);
+
+		std::free(demangled);
+
+		return name;
+	}
+#endif
+
+	// no symbol for it, its offset is enough to look it up in the original file
+	name = std::format("{}+0x{:x}", _object.name, _address - _object.base);
+
+	return name;
+}
+
+//
+// writes our collapsed stacks to the given file
+//
+bool profiler_t::write(const std::string& _path)
+{
+	std::ofstream file(_path, std::ios::trunc);
+
+	if (!file)
+		printerret(false, "couldn't open '" << _path << "' to write our stacks to");
+
+	std::vector<std::pair<std::string, uint64_t>> stacks(m_stacks.begin(), m_stacks.end());
+
+	std::sort(stacks.begin(), stacks.end());
+
+	for (const auto& [stack, count] : stacks)
+		file << stack << " " << count << "\n";
+
+	if (!file)
+		printerret(false, "failed to write our stacks to '" << _path << "'");
+
+	printmsg("wrote " << stacks.size() << " collapsed stack(s) from " << m_samples << " sample(s) to '" << _path << "'");
+
+	return true;
+}
+
+//
+// prints each module's share
+//
+void profiler_t::print_shares()
+{
+	printdebug("profile : " << m_samples << " sample(s) at " << m_hz << "hz, " << m_dropped.load() << " dropped");
+
+	if (m_samples == 0)
+		return;
+
+	std::vector<std::pair<std::string, share_t>> shares(m_shares.begin(), m_shares.end());
+
+	// busiest first
+	std::sort(shares.begin(), shares.end(), [](const auto& _a, const auto& _b) { return _a.second.self > _b.second.self || (_a.second.self == _b.second.self && _a.first < _b.first); });
+
+	for (const auto& [name, share] : shares)
+	{
+		printdebug("+    " << name << " : " << std::format("{:.1f}% self, {:.1f}% total", 100.0 * share.self / m_samples, 100.0 * share.total / m_samples)
+			<< " (" << share.self << " sample(s))");
+	}
+}
@@ -0,0 +1,221 @@
+//
+//	profiler.h | Finn Le Var
+//
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "shared/macros.h"		// includes shared/print.h
+
+// how many times a second of cpu time we sample by default, prime so that we dont line up with our ticks
+#define PROF_HZ 997
+
+// the deepest stack we keep for a sample, anything deeper loses its outermost frames
+#define PROF_DEPTH 64
+
+// how many samples can be waiting for the collector, a power of two, anything past it is dropped
+#define PROF_SAMPLES 8192
+
+// how often the collector takes samples off the queue, in milliseconds
+#define PROF_COLLECT_MS 20
+
+//
+// in process sampling profiler, linux only, see start()
+//
+// a SIGPROF timer interrupts whichever thread is using the cpu, the signal handler grabs its
+// stack and queues the raw addresses, and a collector thread maps each address to the loaded
+// object it's in through dl_iterate_phdr, so every sample is credited to the module it was
+// running, by the module's name rather than the shadow under current/ that was actually loaded
+//
+// the results are each module's share of the cpu, and collapsed stacks for flamegraph.pl
+//
+class profiler_t
+{
+private:
+
+	//
+	// a single sample, seq tells producers and the collector whose turn it is with it
+	//
+	struct sample_t
+	{
+		std::atomic<uint64_t> seq = 0;
+
+		uint32_t  depth = 0;
+		uintptr_t frames[PROF_DEPTH];
+	};
+
+	//
+	// something that's loaded, a hot module or any other library or our executable
+	//
+	struct object_t
+	{
+		std::string name;
+
+		// where it was loaded, for offsets of addresses we dont have a symbol for
+		uintptr_t base = 0;
+
+		// whether it's one of our modules, rather than the engine or a system library
+		bool module = false;
+	};
+
+	//
+	// an address range that an object is mapped at
+	//
+	struct range_t
+	{
+		uintptr_t start;
+		uintptr_t end;
+		uint32_t  object;
+	};
+
+	//
+	// how many samples a module was in
+	//
+	struct share_t
+	{
+		// it was the innermost module on the stack, so the cpu was being used for it
+		uint64_t self = 0;
+
+		// it was anywhere on the stack
+		uint64_t total = 0;
+	};
+
+	// samples waiting for the collector, a bounded queue that the signal handler can push to without locking
+	std::unique_ptr<sample_t[]> m_queue;
+	alignas(64) std::atomic<uint64_t> m_head = 0;
+	alignas(64) uint64_t			  m_tail = 0;
+
+	// samples dropped because the queue was full
+	std::atomic<uint64_t> m_dropped = 0;
+
+	// guards everything below
+	std::mutex m_mutex;
+
+	// the modules we've loaded, by the path of the shadow they were loaded from
+	std::unordered_map<std::string, std::string> m_shadows;
+
+	// everything that's loaded, and where, sorted by address, rebuilt whenever it might have changed
+	std::vector<object_t> m_objects;
+	std::vector<range_t>  m_ranges;
+	bool				  m_stale = true;
+
+	// names for addresses we've already looked up, cleared whenever something's unloaded
+	std::unordered_map<uintptr_t, std::string> m_symbols;
+
+	// every stack we've seen, root first, and how many samples it was in
+	std::unordered_map<std::string, uint64_t> m_stacks;
+
+	// each module's share of our samples, and how many we've taken in total
+	std::unordered_map<std::string, share_t> m_shares;
+	uint64_t								 m_samples = 0;
+
+	// our collector, and whether we're sampling
+	std::thread				m_collector;
+	std::atomic<bool>		m_running = false;
+	std::condition_variable m_wake;
+	uint32_t				m_hz = 0;
+
+private:
+
+	// hide constructor so we can't create more instances
+	profiler_t();
+
+public:
+
+	~profiler_t();
+
+	//
+	// starts sampling the given number of times a second of cpu time, throwing away anything we
+	// sampled before, returns false if we're already sampling or it isn't supported here
+	//
+	bool start(uint32_t _hz = PROF_HZ);
+
+	//
+	// stops sampling, prints each module's share, and writes our collapsed stacks to the given
+	// file if there is one, returns false if we weren't sampling or the file couldn't be written
+	//
+	bool stop(const std::string& _path = "");
+
+	//
+	// whether we're sampling
+	//
+	bool running() const { return m_running.load(std::memory_order_relaxed); }
+
+	//
+	// tells us that a build of the given module was loaded from the given shadow
+	//
+	void map(const std::string& _shadow, const std::string& _name);
+
+	//
+	// tells us that the build loaded from the given shadow is about to be unloaded, anything
+	// sampled in it so far is credited first, while its addresses still mean something
+	//
+	void unmap(const std::string& _shadow);
+
+	//
+	// prints each module's share of everything we've sampled so far
+	//
+	void summary();
+
+	//
+	// prints what we're sampling
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(profiler_t);
+
+private:
+
+	//
+	// called from the signal handler with the interrupted thread's context, queues its stack
+	//
+	void sample(void* _context);
+
+	//
+	// our collector thread
+	//
+	void collect_loop();
+
+	//
+	// takes everything off the queue and credits it, must hold m_mutex
+	//
+	void collect();
+
+	//
+	// finds everything that's loaded and where, must hold m_mutex
+	//
+	void refresh();
+
+	//
+	// gets the object the given address is in, null if it isn't in one
+	//
+	const object_t* find(uintptr_t _address) const;
+
+	//
+	// gets a name for the given address in the given object, for its frame in a stack
+	//
+	const std::string& symbol(uintptr_t _address, const object_t& _object);
+
+	//
+	// writes our collapsed stacks to the given file, must hold m_mutex
+	//
+	bool write(const std::string& _path);
+
+	//
+	// prints each module's share, must hold m_mutex
+	//
+	void print_shares();
+
+	friend struct prof_signal_t;
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(profiler_t, profiler)
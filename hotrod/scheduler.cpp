@@ -0,0 +1,191 @@
+//
+//	scheduler.cpp | Finn Le Var
+//
+#include "scheduler.h"
+
+#include <thread>
+#include <cmath>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <timeapi.h>
+
+#pragma comment(lib, "winmm.lib")
+#endif
+
+//
+// gives the timer resolution back
+//
+scheduler_t::~scheduler_t()
+{
+#ifdef _WIN32
+	if (m_init)
+		timeEndPeriod(1);
+#endif
+}
+
+//
+// starts the clock with the given config
+//
+void scheduler_t::init(const scheduler_config_t& _config)
+{
+	if (m_init)
+		printerret(;, "scheduler already initialised");
+
+	m_config = _config;
+
+	m_period   = m_config.frame_rate > 0.0 ? std::chrono::duration_cast<steady_clock_t::duration>(std::chrono::duration<double>(1.0 / m_config.frame_rate)) : steady_clock_t::duration{};
+	m_fixed_dt = m_config.fixed_rate > 0.0 ? 1.0 / m_config.fixed_rate : 0.0;
+
+#ifdef _WIN32
+	// windows sleeps in 15.6ms chunks by default, which is most of a frame
+	timeBeginPeriod(1);
+#endif
+
+	m_start	   = steady_clock_t::now();
+	m_deadline = m_start;
+	m_init	   = true;
+
+	printdebug(std::format("scheduler started at {:.1f} fps, fixed steps at {:.1f}hz", m_config.frame_rate, m_config.fixed_rate));
+}
+
+//
+// starts a new frame
+//
+const frame_t& scheduler_t::begin_frame()
+{
+	auto now = steady_clock_t::now();
+
+	bool first = m_stats.frames == 0;
+
+	// how far off we were from when this frame was due
+	if (!first && m_period.count() > 0)
+	{
+		uint64_t jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(now > m_deadline ? now - m_deadline : m_deadline - now).count();
+
+		m_stats.jitter_total_ns += jitter;
+		m_stats.jitter_max_ns	 = std::max(m_stats.jitter_max_ns, jitter);
+	}
+
+	double dt = std::chrono::duration<double>(now - (first ? m_start : m_frame_start)).count();
+
+	dt = std::min(dt, m_config.max_dt);
+
+	m_frame_start = now;
+
+	m_frame.index = m_stats.frames++;
+	m_frame.time += dt;
+	m_frame.dt	  = CASTTO(float, dt);
+
+	// the time since each of our last few frames started, for modules that dont update every frame
+	for (uint64_t n = 1; n <= SCHED_MAX_DIVISOR; ++n)
+	{
+		double since = n > m_frame.index ? m_frame.time : m_frame.time - m_history[(m_frame.index - n) % SCHED_MAX_DIVISOR];
+
+		m_frame.dt_over[n - 1] = CASTTO(float, since);
+	}
+
+	m_history[m_frame.index % SCHED_MAX_DIVISOR] = m_frame.time;
+
+	// work out how many fixed steps we owe
+	m_frame.fixed_steps = 0;
+	m_frame.first_step	= m_next_step;
+	m_frame.fixed_dt	= CASTTO(float, m_fixed_dt);
+	m_frame.alpha		= 0.0f;
+
+	if (m_fixed_dt > 0.0)
+	{
+		m_accumulator += dt;
+
+		uint64_t steps = CASTTO(uint64_t, std::floor(m_accumulator / m_fixed_dt));
+
+		// too far behind to catch up, drop the rest rather than let it snowball
+		if (steps > m_config.max_catch_up)
+		{
+			m_stats.dropped_steps += steps - m_config.max_catch_up;
+			steps = m_config.max_catch_up;
+
+			m_accumulator = std::fmod(m_accumulator, m_fixed_dt) + steps * m_fixed_dt;
+		}
+
+		m_accumulator -= steps * m_fixed_dt;
+
+		m_frame.fixed_steps = CASTTO(uint32_t, steps);
+		m_frame.alpha		= CASTTO(float, m_accumulator / m_fixed_dt);
+
+		m_next_step			+= steps;
+		m_stats.fixed_steps += steps;
+	}
+
+	return m_frame;
+}
+
+//
+// finishes the current frame and works out when the next one is due
+//
+void scheduler_t::end_frame()
+{
+	auto now = steady_clock_t::now();
+
+	if (m_period.count() <= 0)
+	{
+		m_deadline = now;
+		return;
+	}
+
+	// took longer than we had
+	auto work = now - m_frame_start;
+
+	if (work > m_period)
+	{
+		m_stats.overruns++;
+		m_stats.overrun_max_ns = std::max(m_stats.overrun_max_ns, CASTTO(uint64_t, std::chrono::duration_cast<std::chrono::nanoseconds>(work - m_period).count()));
+	}
+
+	// keep to a steady cadence, but if we've fallen behind then start again from now rather
+	// than rushing through frames to catch up
+	m_deadline += m_period;
+
+	if (m_deadline < now)
+		m_deadline = now;
+}
+
+//
+// returns how long until the next frame is due
+//
+scheduler_t::steady_clock_t::duration scheduler_t::remaining() const
+{
+	auto now = steady_clock_t::now();
+
+	return m_deadline > now ? m_deadline - now : steady_clock_t::duration{};
+}
+
+//
+// waits until the next frame is due
+//
+void scheduler_t::sleep() const
+{
+	// sleep until we're close, then spin the rest, since waking up from a sleep can be late
+	auto wake = m_deadline - m_config.spin;
+
+	if (steady_clock_t::now() < wake)
+		std::this_thread::sleep_until(wake);
+
+	while (steady_clock_t::now() < m_deadline)
+		std::this_thread::yield();
+}
+
+//
+// prints our stats
+//
+void scheduler_t::dump() const
+{
+	printdebug("scheduler :");
+	printdebug(std::format("+    frames : {} in {:.3f}s, dt {:.3f}ms", m_stats.frames, m_frame.time, m_frame.dt * 1e3));
+
+	if (m_stats.frames > 1)
+		printdebug(std::format("+    jitter : avg {:.3f}ms, max {:.3f}ms", m_stats.jitter_total_ns / 1e6 / (m_stats.frames - 1), m_stats.jitter_max_ns / 1e6));
+
+	printdebug(std::format("+    overruns : {}, worst by {:.3f}ms", m_stats.overruns, m_stats.overrun_max_ns / 1e6));
+	printdebug(std::format("+    fixed steps : {} run, {} dropped", m_stats.fixed_steps, m_stats.dropped_steps));
+}
@@ -0,0 +1,201 @@
+//
+//	scheduler.h | Finn Le Var
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#include "shared/macros.h"		// includes shared/print.h
+
+// the most frames a module can ask to go between its updates, see module_context_t::tick_divisor
+#define SCHED_MAX_DIVISOR 32
+
+//
+// how the scheduler paces frames
+//
+struct scheduler_config_t
+{
+	// how many frames a second we aim for, 0 to run as fast as we can
+	double frame_rate = 60.0;
+
+	// how many fixed steps a second, 0 to turn fixed updates off
+	double fixed_rate = 50.0;
+
+	// the most fixed steps we'll run in one frame to catch up, anything past that is dropped,
+	// otherwise a slow frame means more steps next frame, which makes that one slow too, and so on
+	uint32_t max_catch_up = 5;
+
+	// the longest a single frame's dt can be, so that a breakpoint or a stall doesn't hand modules a huge step
+	double max_dt = 0.25;
+
+	// how close to a deadline we stop sleeping and start spinning, since sleeping is only
+	// good to a millisecond or so on most platforms
+	std::chrono::microseconds spin = std::chrono::microseconds(1000);
+};
+
+//
+// everything about the current frame
+//
+struct frame_t
+{
+	// the index of this frame, starts at 0
+	uint64_t index = 0;
+
+	// seconds since the scheduler started, only counting clamped dts
+	double time = 0.0;
+
+	// seconds since the last frame started, clamped to max_dt
+	float dt = 0.0f;
+
+	// how many fixed steps to run this frame, the index of the first one, and their timestep
+	uint32_t fixed_steps = 0;
+	uint64_t first_step	 = 0;
+	float	 fixed_dt	 = 0.0f;
+
+	// how far we are between the last fixed step and the next one, 0 to 1, for interpolating
+	float alpha = 0.0f;
+
+	// dt over the last n + 1 frames, so that a module that updates every n frames gets the
+	// time since its last update, dt_over[0] is dt
+	float dt_over[SCHED_MAX_DIVISOR] = {};
+
+	//
+	// gets the time since a module with the given tick divisor last updated
+	//
+	float dt_for(uint32_t _divisor) const
+	{
+		return dt_over[std::clamp(_divisor, 1u, CASTTO(uint32_t, SCHED_MAX_DIVISOR)) - 1];
+	}
+};
+
+//
+// how well we've been keeping to our frame rate
+//
+struct scheduler_stats_t
+{
+	// number of frames we've run
+	uint64_t frames = 0;
+
+	// how far frames started from when they were meant to, in nanoseconds
+	uint64_t jitter_total_ns = 0;
+	uint64_t jitter_max_ns	 = 0;
+
+	// frames whose work took longer than a frame, and by how much the worst one did, in nanoseconds
+	uint64_t overruns		 = 0;
+	uint64_t overrun_max_ns	 = 0;
+
+	// fixed steps we ran, and ones we dropped because we were too far behind
+	uint64_t fixed_steps	 = 0;
+	uint64_t dropped_steps	 = 0;
+};
+
+//
+// frame pacing and timesteps for the main loop
+//
+// every frame the main loop calls begin_frame(), runs its fixed steps then its update, calls
+// end_frame(), then does whatever it likes until remaining() runs out, and sleep() to finish
+// off the wait precisely
+//
+class scheduler_t
+{
+public:
+
+	using steady_clock_t = std::chrono::steady_clock;
+
+private:
+
+	scheduler_config_t m_config;
+
+	// how long a frame is, and a fixed step, zero if they're turned off
+	steady_clock_t::duration m_period = {};
+	double m_fixed_dt = 0.0;
+
+	// when we started, when the current frame started, and when the next one is due
+	steady_clock_t::time_point m_start		 = {};
+	steady_clock_t::time_point m_frame_start = {};
+	steady_clock_t::time_point m_deadline	 = {};
+
+	// the current frame
+	frame_t m_frame;
+
+	// time that hasn't been taken up by fixed steps yet, in seconds
+	double m_accumulator = 0.0;
+
+	// the index of the next fixed step
+	uint64_t m_next_step = 0;
+
+	// frame.time at the start of each of our last frames, indexed by frame index
+	double m_history[SCHED_MAX_DIVISOR] = {};
+
+	scheduler_stats_t m_stats;
+
+	// whether we've started
+	bool m_init = false;
+
+private:
+
+	// hide constructor so we can't create more instances
+	scheduler_t() = default;
+
+public:
+
+	~scheduler_t();
+
+	//
+	// starts the clock with the given config
+	//
+	void init(const scheduler_config_t& _config = {});
+
+	//
+	// starts a new frame, works out its dt and how many fixed steps it needs
+	//
+	const frame_t& begin_frame();
+
+	//
+	// finishes the current frame and works out when the next one is due
+	//
+	void end_frame();
+
+	//
+	// returns how long until the next frame is due, zero if it's already due
+	//
+	steady_clock_t::duration remaining() const;
+
+	//
+	// waits until the next frame is due, sleeping most of the way then spinning the rest
+	//
+	void sleep() const;
+
+	//
+	// gets the current frame
+	//
+	const frame_t& frame() const { return m_frame; }
+
+	//
+	// gets seconds since we started, counting clamped dts
+	//
+	double time() const { return m_frame.time; }
+
+	//
+	// gets how well we've been keeping to our frame rate
+	//
+	const scheduler_stats_t& stats() const { return m_stats; }
+
+	//
+	// gets our config
+	//
+	const scheduler_config_t& config() const { return m_config; }
+
+	//
+	// prints our stats
+	//
+	void dump() const;
+
+	// make this class a singleton
+	MAKE_SINGLETON(scheduler_t);
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(scheduler_t, scheduler)
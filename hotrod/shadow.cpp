@@ -0,0 +1,314 @@
+//
+//	shadow.cpp | Finn Le Var
+//
+#include "shadow.h"
+
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+//
+// static vars
+//
+namespace
+{
+	// mask of the strategies we're allowed to use
+	uint32_t g_allowed = SHADOW_ALL;
+
+	// timings for each strategy, guarded by g_stats_mutex since the loader thread records them too
+	shadow_stats_t g_stats[SHADOW_COUNT] = {};
+	std::mutex g_stats_mutex;
+
+	//
+	// full byte copy, what we used to always do
+	//
+	bool create_copy(const std::string& _src, const std::string& _dst, shadow_t& _out)
+	{
+		try
+		{
+			std::filesystem::copy_file(_src, _dst, std::filesystem::copy_options::overwrite_existing);
+		}
+		catch (const std::filesystem::filesystem_error& e)
+		{
+			printerret(false, "failed to copy '" << _src << "' : " << e.what());
+		}
+
+		_out.path = _dst;
+		_out.file = _dst;
+
+		return true;
+	}
+
+#ifndef _WIN32
+
+	//
+	// copies the module into an anonymous memory file, the kernel does the copy so it never
+	// touches the disk, and there is no file left behind for us to clean up
+	//
+	bool create_memfd(const std::string& _src, const std::string& _dst, shadow_t& _out)
+	{
+		int src = open(_src.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (src < 0)
+			return false;
+
+		struct stat st = {};
+
+		if (fstat(src, &st) != 0)
+		{
+			close(src);
+			return false;
+		}
+
+		// name it after the module so it shows up nicely in /proc/self/maps
+		int fd = memfd_create(std::filesystem::path(_dst).filename().c_str(), MFD_CLOEXEC);
+
+		if (fd < 0)
+		{
+			close(src);
+			return false;
+		}
+
+		off_t offset = 0;
+
+		while (offset < st.st_size)
+		{
+			ssize_t sent = sendfile(fd, src, &offset, CASTTO(size_t, st.st_size - offset));
+
+			if (sent <= 0)
+			{
+				close(src);
+				close(fd);
+				return false;
+			}
+		}
+
+		close(src);
+
+		// we keep the fd open for as long as the module is loaded, which also means that no other
+		// shadow can be given the same /proc/self/fd path while this one is still loaded
+		_out.fd	  = fd;
+		_out.path = "/proc/self/fd/" + std::to_string(fd);
+
+		return true;
+	}
+
+	//
+	// clones the file's extents, the new file shares the original's data until one of them is written
+	//
+	bool create_reflink(const std::string& _src, const std::string& _dst, shadow_t& _out)
+	{
+		int src = open(_src.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (src < 0)
+			return false;
+
+		int dst = open(_dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+
+		if (dst < 0)
+		{
+			close(src);
+			return false;
+		}
+
+		// fails with EOPNOTSUPP or EXDEV if the file system can't do it
+		bool cloned = ioctl(dst, FICLONE, src) == 0;
+
+		close(src);
+		close(dst);
+
+		if (!cloned)
+		{
+			unlink(_dst.c_str());
+			return false;
+		}
+
+		_out.path = _dst;
+		_out.file = _dst;
+
+		return true;
+	}
+
+	//
+	// hardlinks the original into a temp name then renames it into place, so that the shadow
+	// only ever appears fully formed, relies on the build replacing its output with a new inode
+	//
+	bool create_hardlink(const std::string& _src, const std::string& _dst, shadow_t& _out)
+	{
+		const std::string temp = _dst + ".tmp";
+
+		if (link(_src.c_str(), temp.c_str()) != 0)
+			return false;
+
+		if (rename(temp.c_str(), _dst.c_str()) != 0)
+		{
+			unlink(temp.c_str());
+			return false;
+		}
+
+		_out.path = _dst;
+		_out.file = _dst;
+
+		return true;
+	}
+
+#endif
+
+	//
+	// our strategies in the order we try them
+	//
+	// on windows the loader locks the image file for as long as it's mapped, so anything that shares
+	// the original's data would stop the linker from replacing it, so copying is all we can do there
+	//
+	const shadow::strategy_t g_strategies[] =
+	{
+#ifndef _WIN32
+		{ .type = SHADOW_MEMFD,		.create = &create_memfd		},
+		{ .type = SHADOW_REFLINK,	.create = &create_reflink	},
+		{ .type = SHADOW_HARDLINK,	.create = &create_hardlink	},
+#endif
+		{ .type = SHADOW_COPY,		.create = &create_copy		},
+	};
+}
+
+//
+//
+//
+namespace shadow
+{
+	//
+	// sets which strategies we're allowed to use
+	//
+	void set_allowed(uint32_t _mask)
+	{
+		// always leave ourselves a way to load
+		g_allowed = _mask | SHADOW_FLAG(SHADOW_COPY);
+	}
+
+	//
+	// creates a loadable shadow of the given module
+	//
+	bool create(const std::string& _src, shadow_t& _out)
+	{
+		std::filesystem::path current_dir = CUR_FOLDER;
+
+		// create current folder if it doesn't exist
+		std::error_code ec;
+
+		if (!std::filesystem::exists(current_dir, ec))
+			std::filesystem::create_directory(current_dir, ec);
+
+		// build a unique path for the shadow using the module's name and the current time
+		auto filename	= std::filesystem::path(_src).filename();
+		auto timestamp	= std::chrono::system_clock::now().time_since_epoch().count();
+
+		const std::string dst = std::format("{}/{}_{}{}", CUR_FOLDER, filename.stem().string(), timestamp, filename.extension().string());
+
+		for (const auto& strategy : g_strategies)
+		{
+			if (!(g_allowed & SHADOW_FLAG(strategy.type)))
+				continue;
+
+			_out = {};
+
+			if (strategy.create(_src, dst, _out))
+			{
+				_out.type = strategy.type;
+
+				printdebug("shadowed '" << filename.string() << "' to '" << _out.path << "' using " << to_string(_out.type));
+
+				return true;
+			}
+
+			printdebug("shadow strategy " << to_string(strategy.type) << " failed for '" << filename.string() << "', trying next");
+		}
+
+		_out = {};
+
+		printerret(false, "failed to shadow '" << _src << "'");
+	}
+
+	//
+	// deletes the shadow's file or closes its memfd
+	//
+	void release(shadow_t& _shadow)
+	{
+#ifndef _WIN32
+		if (_shadow.fd >= 0)
+			close(_shadow.fd);
+#endif
+
+		if (!_shadow.file.empty())
+		{
+			std::error_code ec;
+
+			std::filesystem::remove(_shadow.file, ec);
+
+			if (ec)
+				printerror("failed to delete shadow '" << _shadow.file << "' : " << ec.message());
+		}
+
+		_shadow = {};
+	}
+
+	//
+	// records how long it took to create and load a shadow
+	//
+	void record(shadow_type_t _type, uint64_t _ns)
+	{
+		if (_type == SHADOW_NONE || _type >= SHADOW_COUNT)
+			return;
+
+		LGUARD(g_stats_mutex);
+
+		shadow_stats_t& stats = g_stats[_type];
+
+		stats.count++;
+		stats.total_ns += _ns;
+		stats.max_ns	= std::max(stats.max_ns, _ns);
+	}
+
+	//
+	// gets the recorded timings for the given strategy
+	//
+	shadow_stats_t stats(shadow_type_t _type)
+	{
+		LGUARD(g_stats_mutex);
+
+		return g_stats[_type < SHADOW_COUNT ? _type : SHADOW_NONE];
+	}
+
+	//
+	// prints the timings for each strategy that has been used
+	//
+	void dump()
+	{
+		LGUARD(g_stats_mutex);
+
+		printdebug("shadow load times :");
+
+		for (int i = SHADOW_NONE + 1; i < SHADOW_COUNT; ++i)
+		{
+			const shadow_stats_t& stats = g_stats[i];
+
+			if (!stats.count)
+				continue;
+
+			printdebug(std::format("+    {:<8} : {} load(s), avg {:.3f}ms, max {:.3f}ms", to_string(CASTTO(shadow_type_t, i)), stats.count,
+				stats.total_ns / 1e6 / stats.count, stats.max_ns / 1e6));
+		}
+	}
+}
@@ -0,0 +1,135 @@
+//
+//	shadow.h | Finn Le Var
+//
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "shared/macros.h"		// includes shared/print.h
+
+// folder that stores all of our currently loaded dlls
+#define CUR_FOLDER "current"
+
+//
+// the ways we can make a loadable shadow of a module so that the original file
+// isn't locked and can be rebuilt while the module is running, in the order we try them
+//
+enum shadow_type_t : uint8_t
+{
+	SHADOW_NONE = 0,
+
+	// copy into an anonymous memory file and load it from /proc/self/fd, no disk io at all
+	SHADOW_MEMFD,
+
+	// copy on write clone of the file's extents (btrfs, xfs), no data is copied
+	SHADOW_REFLINK,
+
+	// hardlink to the original's inode, only safe when the build replaces its output
+	// rather than writing into it, which is what ld, gold, and lld all do
+	SHADOW_HARDLINK,
+
+	// full byte copy into CUR_FOLDER, always works
+	SHADOW_COPY,
+
+	SHADOW_COUNT,
+};
+
+// all strategies allowed
+#define SHADOW_ALL (~0u)
+
+// the flag for a single strategy in a strategy mask
+#define SHADOW_FLAG(_type) (1u << (_type))
+
+//
+// returns the string value for the given shadow type
+//
+inline const char* to_string(shadow_type_t _type)
+{
+	switch (_type)
+	{
+	case SHADOW_MEMFD:		return "memfd";
+	case SHADOW_REFLINK:	return "reflink";
+	case SHADOW_HARDLINK:	return "hardlink";
+	case SHADOW_COPY:		return "copy";
+	default:				return "none";
+	}
+}
+
+//
+// a shadow of a module that we can load
+//
+struct shadow_t
+{
+	// how this shadow was made
+	shadow_type_t type = SHADOW_NONE;
+
+	// the path we hand to LoadLibrary/dlopen
+	std::string path;
+
+	// the file we created on disk that needs deleting on release, empty if we didn't create one
+	std::string file;
+
+	// the memfd backing this shadow, -1 if there isn't one
+	int fd = -1;
+};
+
+//
+// timings for each strategy so that we can see what each one costs
+//
+struct shadow_stats_t
+{
+	// number of loads that used this strategy
+	uint64_t count = 0;
+
+	// total and worst time to create the shadow and load it, in nanoseconds
+	uint64_t total_ns = 0;
+	uint64_t max_ns	  = 0;
+};
+
+//
+//
+//
+namespace shadow
+{
+	//
+	// a single shadow copy strategy, tried in order until one succeeds
+	//
+	struct strategy_t
+	{
+		shadow_type_t type;
+
+		// creates a shadow of _src, _dst is a unique path in CUR_FOLDER that it can use
+		bool (*create)(const std::string& _src, const std::string& _dst, shadow_t& _out);
+	};
+
+	//
+	// sets which strategies we're allowed to use, as a mask of SHADOW_FLAG()s
+	//
+	void set_allowed(uint32_t _mask);
+
+	//
+	// creates a loadable shadow of the module at _src using the first strategy that works
+	//
+	bool create(const std::string& _src, shadow_t& _out);
+
+	//
+	// deletes the shadow's file or closes its memfd
+	//
+	void release(shadow_t& _shadow);
+
+	//
+	// records how long it took to create and load a shadow with the given strategy
+	//
+	void record(shadow_type_t _type, uint64_t _ns);
+
+	//
+	// gets the recorded timings for the given strategy
+	//
+	shadow_stats_t stats(shadow_type_t _type);
+
+	//
+	// prints the timings for each strategy that has been used
+	//
+	void dump();
+}
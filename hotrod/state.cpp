@@ -0,0 +1,219 @@
+//
+//	state.cpp | Finn Le Var
+//
+#include "state.h"
+
+#include <new>
+#include <cstring>
+#include <algorithm>
+
+//
+// frees everything, nothing's left holding anything by now
+//
+state_heap_t::~state_heap_t()
+{
+	for (auto block : m_blocks)
+	{
+		::operator delete(block->data, std::align_val_t(STATE_ALIGN));
+		delete block;
+	}
+}
+
+//
+// gets the named block for the given build
+//
+void* state_heap_t::acquire(uint32_t _module, const char* _owner, const char* _name, uint32_t _size, uint32_t _version, state_upgrade_fn_t _upgrade, state_status_t* _status)
+{
+	if (!_owner || !_name)
+		printerret(nullptr, "no module or block name given");
+
+	if (_size == 0)
+		printerret(nullptr, "block '" << _name << "' has no size");
+
+	const std::string key = std::string(_owner) + "/" + _name;
+
+	LGUARD(m_mutex);
+
+	state_block_t* block  = nullptr;
+	state_status_t status = STATE_NEW;
+
+	const auto& it = m_current.find(key);
+
+	if (it == m_current.end())
+	{
+		block = create(key, _size, _version);
+	}
+	else if (it->second->size == _size && it->second->version == _version)
+	{
+		block  = it->second;
+		status = STATE_KEPT;
+
+		m_kept++;
+	}
+	else
+	{
+		state_block_t* old = it->second;
+
+		block = create(key, _size, _version);
+
+		// move what we can over, the old block stays as it is for the build that's still using it
+		if (_upgrade && _upgrade(old->data, old->size, old->version, block->data, _size, _version))
+		{
+			status = STATE_UPGRADED;
+			m_upgraded++;
+		}
+		else
+		{
+			// it could have got half way, so start again from nothing
+			std::memset(block->data, 0, _size);
+
+			status = STATE_RESET;
+			m_reset++;
+		}
+
+		printdebug("state '" << key << "' " << (status == STATE_UPGRADED ? "upgraded" : "reset") << " from v" << old->version << " (" << old->size << " bytes) to v" << _version << " (" << _size << " bytes)");
+
+		old->current = false;
+
+		// keep the old one around while someone's still using it, in case we have to roll back to it
+		if (!old->holders.empty())
+			block->previous = old;
+	}
+
+	m_current[key] = block;
+
+	if (std::find(block->holders.begin(), block->holders.end(), _module) == block->holders.end())
+		block->holders.push_back(_module);
+
+	collect();
+
+	if (_status)
+		*_status = status;
+
+	return block->data;
+}
+
+//
+// frees the named block once every build holding it has been unloaded
+//
+void state_heap_t::release(uint32_t _module, const char* _owner, const char* _name)
+{
+	if (!_owner || !_name)
+		printerret(;, "no module or block name given");
+
+	const std::string key = std::string(_owner) + "/" + _name;
+
+	LGUARD(m_mutex);
+
+	const auto& it = m_current.find(key);
+
+	if (it == m_current.end())
+		printerret(;, "no state block '" << key << "'");
+
+	state_block_t* block = it->second;
+
+	std::erase(block->holders, _module);
+
+	// nobody gets it again, and it goes once the builds still holding it are gone
+	block->current = false;
+	m_current.erase(it);
+
+	collect();
+}
+
+//
+// lets go of every block the given build is holding
+//
+void state_heap_t::release_all(uint32_t _module)
+{
+	LGUARD(m_mutex);
+
+	for (auto block : m_blocks)
+		std::erase(block->holders, _module);
+
+	// a build that upgraded a block and then went away before the build it upgraded from did, so
+	// it failed to load, the old build is still running with the old block, so that's current again
+	for (auto& [key, block] : m_current)
+	{
+		if (!block->holders.empty() || !block->previous || block->previous->holders.empty())
+			continue;
+
+		printdebug("state '" << key << "' rolled back to v" << block->previous->version);
+
+		block->current = false;
+		block		   = block->previous;
+		block->current = true;
+	}
+
+	collect();
+}
+
+//
+// prints all of our blocks
+//
+void state_heap_t::dump()
+{
+	LGUARD(m_mutex);
+
+	printdebug("state : " << m_blocks.size() << " block(s), " << m_bytes << " byte(s), " << m_kept << " kept, " << m_upgraded << " upgraded, " << m_reset << " reset");
+
+	for (auto block : m_blocks)
+		printdebug("+    " << block->key << " v" << block->version << " : " << block->size << " byte(s), " << block->holders.size() << " holder(s)" << (block->current ? "" : ", old"));
+}
+
+//
+// allocates a zeroed block
+//
+state_block_t* state_heap_t::create(const std::string& _key, uint32_t _size, uint32_t _version)
+{
+	auto block = new state_block_t;
+
+	block->key	   = _key;
+	block->data	   = ::operator new(_size, std::align_val_t(STATE_ALIGN));
+	block->size	   = _size;
+	block->version = _version;
+	block->current = true;
+
+	std::memset(block->data, 0, _size);
+
+	m_blocks.push_back(block);
+	m_bytes += _size;
+
+	return block;
+}
+
+//
+// frees non current blocks that nobody's holding anymore
+//
+void state_heap_t::collect()
+{
+	std::vector<state_block_t*> dead;
+
+	for (auto block : m_blocks)
+	{
+		if (!block->current && block->holders.empty())
+			dead.push_back(block);
+	}
+
+	for (auto block : dead)
+		destroy(block);
+}
+
+//
+// frees a block and forgets about it
+//
+void state_heap_t::destroy(state_block_t* _block)
+{
+	// nothing can roll back to it now
+	for (auto block : m_blocks)
+	{
+		if (block->previous == _block)
+			block->previous = nullptr;
+	}
+
+	std::erase(m_blocks, _block);
+	m_bytes -= _block->size;
+
+	::operator delete(_block->data, std::align_val_t(STATE_ALIGN));
+	delete _block;
+}
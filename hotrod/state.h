@@ -0,0 +1,121 @@
+//
+//	state.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+// what every state block is aligned to, so that modules can put anything in them
+#define STATE_ALIGN 64
+
+//
+// a named block of persistent state
+//
+struct state_block_t
+{
+	// the owning module's name and the block's name, eg. "mod/cache"
+	std::string key;
+
+	void*	 data	 = nullptr;
+	uint32_t size	 = 0;
+	uint32_t version = 0;
+
+	// the ids of the builds that have acquired this block and haven't been unloaded yet
+	std::vector<uint32_t> holders;
+
+	// the block this one was upgraded from, while a build is still holding it
+	state_block_t* previous = nullptr;
+
+	// whether this is the block that the next build asking for key gets
+	bool current = false;
+};
+
+//
+// the engine's persistent state, see sub_state_ctx_t
+//
+// every block remembers which builds are holding it, so that when a reload changes a block's
+// layout the old build keeps the old block until it's unloaded, and if the new build fails to
+// load then its block is dropped and the old one becomes current again
+//
+class state_heap_t
+{
+private:
+
+	// every block we have, current or not
+	std::vector<state_block_t*> m_blocks;
+
+	// the current block for each key
+	std::unordered_map<std::string, state_block_t*> m_current;
+
+	// guards everything, modules can load on any of the loader's threads
+	std::mutex m_mutex;
+
+	// how much we're holding on to, and what's happened to blocks when they were acquired
+	size_t	 m_bytes	= 0;
+	uint64_t m_kept		= 0;
+	uint64_t m_upgraded = 0;
+	uint64_t m_reset	= 0;
+
+private:
+
+	// hide constructor so we can't create more instances
+	state_heap_t() = default;
+
+public:
+
+	~state_heap_t();
+
+	//
+	// gets the named block for the given build, creating or upgrading it if needed
+	//
+	void* acquire(uint32_t _module, const char* _owner, const char* _name, uint32_t _size, uint32_t _version, state_upgrade_fn_t _upgrade, state_status_t* _status);
+
+	//
+	// frees the named block once every build holding it has been unloaded
+	//
+	void release(uint32_t _module, const char* _owner, const char* _name);
+
+	//
+	// lets go of every block the given build is holding, called when it's unloaded, a block
+	// that it upgraded is rolled back if the build it was upgraded from is still around
+	//
+	void release_all(uint32_t _module);
+
+	//
+	// how much memory we're holding on to
+	//
+	size_t bytes() const { return m_bytes; }
+
+	//
+	// prints all of our blocks
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(state_heap_t);
+
+private:
+
+	//
+	// allocates a zeroed block
+	//
+	state_block_t* create(const std::string& _key, uint32_t _size, uint32_t _version);
+
+	//
+	// frees non current blocks that nobody's holding anymore
+	//
+	void collect();
+
+	//
+	// frees a block and forgets about it
+	//
+	void destroy(state_block_t* _block);
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(state_heap_t, state)
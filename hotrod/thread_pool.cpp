@@ -0,0 +1,492 @@
+//
+//	thread_pool.cpp | Finn Le Var
+//
+#include "thread_pool.h"
+
+#include <algorithm>
+
+//
+// static vars
+//
+namespace
+{
+	// the index of the worker we're running on, or SIZE_MAX if we're not one of ours
+	thread_local size_t t_worker = SIZE_MAX;
+
+	// the counts of the modules this thread has submitted for lately, so that finding them is
+	// almost never a trip through the lock, indexed by module id
+	constexpr size_t COUNTS_CACHE = 16;
+
+	struct cached_counts_t
+	{
+		uint32_t	   module = 0;
+		task_counts_t* counts = nullptr;
+	};
+
+	thread_local cached_counts_t t_counts[COUNTS_CACHE];
+
+	//
+	// a chunk of a parallel for
+	//
+	struct chunk_t
+	{
+		range_fn_t fn;
+		void*	   data;
+		size_t	   begin;
+		size_t	   end;
+	};
+
+	//
+	// runs a chunk of a parallel for
+	//
+	void run_chunk(void* _chunk)
+	{
+		auto chunk = CASTTO(chunk_t*, _chunk);
+
+		chunk->fn(chunk->data, chunk->begin, chunk->end);
+	}
+}
+
+//
+// starts our workers
+//
+void thread_pool_t::init(uint32_t _workers)
+{
+	if (m_running_flag)
+		printerret(;, "thread pool already initialised");
+
+	if (_workers == 0)
+		_workers = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+	m_running_flag = true;
+
+	m_workers.reserve(_workers);
+
+	for (uint32_t i = 0; i < _workers; ++i)
+		m_workers.push_back(std::make_unique<worker_t>());
+
+	// start them once they all exist, since they steal from each other
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i]->thread = std::thread(&thread_pool_t::work, this, i);
+
+	printdebug("thread pool started with " << _workers << " worker(s)");
+}
+
+//
+// cancels everything still queued and stops our workers
+//
+void thread_pool_t::shutdown()
+{
+	if (!m_running_flag.exchange(false))
+		return;
+
+	{
+		LGUARD(m_sleep_mutex);
+	}
+
+	m_sleep_cv.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+
+	// nobody's going to run these now
+	for (auto& worker : m_workers)
+	{
+		for (auto& queue : worker->queues)
+		{
+			for (auto& task : queue)
+				finish(task);
+
+			queue.clear();
+		}
+	}
+
+	m_workers.clear();
+	m_queued = 0;
+
+	printdebug("thread pool stopped");
+}
+
+//
+// queues a task for the given module
+//
+bool thread_pool_t::submit(uint32_t _module, task_fn_t _fn, void* _data, task_priority_t _priority, task_group_t* _group)
+{
+	if (!_fn)
+		printerret(false, "no task func given");
+
+	if (_priority >= TASK_PRIORITY_COUNT)
+		_priority = TASK_NORMAL;
+
+	task_counts_t* counts = this->counts(_module);
+
+	task_t task = { .fn = _fn, .data = _data, .module = _module, .counts = counts, .group = _group };
+
+	if (_group)
+	{
+		_group->pending.fetch_add(1, std::memory_order_relaxed);
+
+		// so that whoever waits on it can help with this
+		int lowest = _group->priority.load(std::memory_order_relaxed);
+
+		while (lowest < _priority && !_group->priority.compare_exchange_weak(lowest, _priority, std::memory_order_relaxed))
+			;
+	}
+
+	// count it as running until it's in a queue, so that a cancel waits for us to get it there
+	// and then sweeps it, rather than missing it in between, and only then look for a cancel, so
+	// that either we see it, or it sees us
+	counts->running.fetch_add(1, std::memory_order_seq_cst);
+
+	// it's being unloaded, so nothing new of its gets to run, including what its running tasks queue up
+	if (counts->cancelling.load(std::memory_order_seq_cst))
+	{
+		counts->cancelled.fetch_add(1, std::memory_order_relaxed);
+		finish(task);
+		stopped(counts);
+
+		return false;
+	}
+
+	counts->submitted.fetch_add(1, std::memory_order_relaxed);
+
+	// no workers, so just run it here
+	if (m_workers.empty() || !m_running_flag)
+	{
+		run(task);
+		return true;
+	}
+
+	// our own workers push to their own queue, everyone else spreads it around
+	size_t index = t_worker < m_workers.size() ? t_worker : m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+	{
+		worker_t& worker = *m_workers[index];
+
+		LGUARD(worker.mutex);
+		worker.queues[_priority].push_back(task);
+	}
+
+	stopped(counts);
+
+	m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+	// a worker counts itself as sleeping before it checks for work, so either it sees this, or we see
+	// it, in which case taking the lock means it can't miss this between checking and going to sleep
+	if (m_sleeping.load(std::memory_order_seq_cst))
+	{
+		{
+			LGUARD(m_sleep_mutex);
+		}
+
+		m_sleep_cv.notify_one();
+	}
+
+	return true;
+}
+
+//
+// blocks until every task in the group is done
+//
+void thread_pool_t::wait(task_group_t* _group)
+{
+	if (!_group)
+		return;
+
+	while (_group->pending.load(std::memory_order_acquire) > 0)
+	{
+		// help out rather than just sitting here, but only with work at least as urgent as ours
+		if (!run_one(CASTTO(task_priority_t, _group->priority.load(std::memory_order_relaxed))))
+			std::this_thread::yield();
+	}
+}
+
+//
+// runs _fn over [0, _count) across the pool
+//
+void thread_pool_t::parallel_for(uint32_t _module, size_t _count, size_t _grain, range_fn_t _fn, void* _data, task_priority_t _priority)
+{
+	if (!_fn || _count == 0)
+		return;
+
+	// a few chunks per thread so that the stealing can even things out
+	if (_grain == 0)
+		_grain = std::max<size_t>(1, _count / ((m_workers.size() + 1) * 4));
+
+	std::vector<chunk_t> chunks;
+	chunks.reserve((_count + _grain - 1) / _grain);
+
+	for (size_t begin = 0; begin < _count; begin += _grain)
+		chunks.push_back({ .fn = _fn, .data = _data, .begin = begin, .end = std::min(begin + _grain, _count) });
+
+	task_group_t group;
+	group.module = _module;
+
+	// keep the first one for ourselves
+	for (size_t i = 1; i < chunks.size(); ++i)
+		submit(_module, &run_chunk, &chunks[i], _priority, &group);
+
+	group.pending.fetch_add(1, std::memory_order_relaxed);
+
+	task_counts_t* counts = this->counts(_module);
+
+	counts->submitted.fetch_add(1, std::memory_order_relaxed);
+
+	run_here({ .fn = &run_chunk, .data = &chunks[0], .module = _module, .counts = counts, .group = &group });
+
+	// our chunks live on our stack, so we can't leave until they're all done
+	wait(&group);
+}
+
+//
+// drops everything the given module has queued, then waits for anything it has running
+//
+size_t thread_pool_t::cancel(uint32_t _module)
+{
+	task_counts_t* counts = this->counts(_module);
+
+	// before we look at what it has running, so that either submit() sees this, or we see its task
+	counts->cancelling.fetch_add(1, std::memory_order_seq_cst);
+
+	size_t cancelled = 0;
+
+	// tasks are counted as running before they leave their queue, and before they're in one, so once
+	// a sweep finds nothing and nothing's running then nothing of theirs is left anywhere
+	auto idle = [counts] { return counts->running.load(std::memory_order_seq_cst) == 0; };
+
+	// a task that's running when we sweep can queue more before it finishes, so keep going until
+	// that's the case, after which submit() refuses anything new of its
+	while (true)
+	{
+		const size_t swept = sweep(_module);
+
+		cancelled += swept;
+		counts->cancelled.fetch_add(swept, std::memory_order_relaxed);
+
+		if (!swept && idle())
+			break;
+
+		std::unique_lock<std::mutex> lock(m_running_mutex);
+
+		m_running_cv.wait(lock, idle);
+	}
+
+	counts->cancelling.fetch_sub(1, std::memory_order_seq_cst);
+
+	if (cancelled)
+		printdebug("cancelled " << cancelled << " task(s) for module " << _module);
+
+	return cancelled;
+}
+
+//
+// drops everything the given module has queued
+//
+size_t thread_pool_t::sweep(uint32_t _module)
+{
+	size_t swept = 0;
+
+	for (auto& worker : m_workers)
+	{
+		LGUARD(worker->mutex);
+
+		for (auto& queue : worker->queues)
+		{
+			auto it = std::remove_if(queue.begin(), queue.end(), [&](const task_t& _task)
+			{
+				if (_task.module != _module)
+					return false;
+
+				finish(_task);
+				swept++;
+
+				return true;
+			});
+
+			queue.erase(it, queue.end());
+		}
+	}
+
+	m_queued.fetch_sub(swept, std::memory_order_relaxed);
+
+	return swept;
+}
+
+//
+// runs a single queued task on the calling thread if there is one
+//
+bool thread_pool_t::run_one(task_priority_t _lowest)
+{
+	task_t task;
+
+	if (!take(t_worker, task, _lowest))
+		return false;
+
+	run(task);
+
+	return true;
+}
+
+//
+// a worker thread's loop
+//
+void thread_pool_t::work(size_t _index)
+{
+	t_worker = _index;
+
+	while (true)
+	{
+		task_t task;
+
+		if (take(_index, task))
+		{
+			run(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+
+		m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_sleep_cv.wait(lock, [this] { return !m_running_flag || m_queued.load(std::memory_order_seq_cst) > 0; });
+		m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+		if (!m_running_flag)
+			return;
+	}
+}
+
+//
+// takes the highest priority task we can find
+//
+bool thread_pool_t::take(size_t _home, task_t& _task, int _lowest)
+{
+	if (m_queued.load(std::memory_order_acquire) == 0 || m_workers.empty())
+		return false;
+
+	const size_t count = m_workers.size();
+
+	// if we're not a worker then we're stealing from everyone, so dont always hit the same one
+	const bool	 owner = _home < count;
+	const size_t start = owner ? _home : m_next.load(std::memory_order_relaxed) % count;
+
+	for (int priority = 0; priority <= _lowest && priority < TASK_PRIORITY_COUNT; ++priority)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			worker_t& worker = *m_workers[(start + i) % count];
+
+			LGUARD(worker.mutex);
+
+			auto& queue = worker.queues[priority];
+
+			if (queue.empty())
+				continue;
+
+			// our own work comes off the back, stolen work off the front
+			if (owner && i == 0)
+			{
+				_task = queue.back();
+				queue.pop_back();
+			}
+			else
+			{
+				_task = queue.front();
+				queue.pop_front();
+			}
+
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+
+			// count it as running while it's still under the queue's lock, so that cancel() can't miss it
+			_task.counts->running.fetch_add(1, std::memory_order_seq_cst);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// runs a task that never went through a queue
+//
+void thread_pool_t::run_here(const task_t& _task)
+{
+	_task.counts->running.fetch_add(1, std::memory_order_seq_cst);
+
+	run(_task);
+}
+
+//
+// runs a task and marks it done
+//
+void thread_pool_t::run(const task_t& _task)
+{
+	_task.fn(_task.data);
+
+	finish(_task);
+
+	_task.counts->completed.fetch_add(1, std::memory_order_relaxed);
+
+	stopped(_task.counts);
+}
+
+//
+// gets the given module's counts
+//
+task_counts_t* thread_pool_t::counts(uint32_t _module)
+{
+	cached_counts_t& cached = t_counts[_module % COUNTS_CACHE];
+
+	if (cached.counts && cached.module == _module)
+		return cached.counts;
+
+	LGUARD(m_running_mutex);
+
+	auto& counts = m_counts[_module];
+
+	if (!counts)
+		counts = std::make_unique<task_counts_t>();
+
+	cached = { .module = _module, .counts = counts.get() };
+
+	return cached.counts;
+}
+
+//
+// counts one of a module's tasks as no longer running
+//
+void thread_pool_t::stopped(task_counts_t* _counts)
+{
+	// a cancel only sleeps while it's cancelling and something's running, and it checks under the lock,
+	// so taking it before we notify means it can't miss this, and nobody else needs the lock
+	if (_counts->running.fetch_sub(1, std::memory_order_seq_cst) == 1 && _counts->cancelling.load(std::memory_order_seq_cst))
+	{
+		LGUARD(m_running_mutex);
+		m_running_cv.notify_all();
+	}
+}
+
+//
+// marks a task as finished
+//
+void thread_pool_t::finish(const task_t& _task)
+{
+	if (_task.group)
+		_task.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+//
+// prints per module task counts
+//
+void thread_pool_t::dump()
+{
+	LGUARD(m_running_mutex);
+
+	printdebug("thread pool : " << m_workers.size() << " worker(s), " << m_queued.load() << " task(s) queued");
+
+	for (const auto& [module, counts] : m_counts)
+		printdebug("+    module " << module << " : " << counts->submitted.load() << " submitted, " << counts->completed.load() << " completed, " << counts->cancelled.load() << " cancelled");
+}
@@ -0,0 +1,235 @@
+//
+//	thread_pool.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+//
+// a group of tasks that can be waited on together
+//
+struct task_group_t
+{
+	// tasks that haven't run or been cancelled yet
+	std::atomic<uint32_t> pending = 0;
+
+	// the module that created it
+	uint32_t module = 0;
+
+	// the least urgent priority any of its tasks were submitted at, wait() only helps out with
+	// tasks at this priority or above, so waiting on urgent work never picks up a long low one
+	std::atomic<int> priority = TASK_HIGH;
+};
+
+//
+// a module's task counts, made once the first time it submits anything and never freed, so that
+// every task can keep a pointer to them and count itself without going through a lock or a lookup
+//
+struct task_counts_t
+{
+	// how many of its tasks are running right now, or are part way through being queued
+	std::atomic<uint32_t> running = 0;
+
+	// how many cancels are in progress for it, while there are any its tasks are refused
+	std::atomic<uint32_t> cancelling = 0;
+
+	// how many tasks it has submitted, completed, and had cancelled, so we can see who's using the pool
+	std::atomic<uint64_t> submitted = 0;
+	std::atomic<uint64_t> completed = 0;
+	std::atomic<uint64_t> cancelled = 0;
+};
+
+//
+// a queued task
+//
+struct task_t
+{
+	task_fn_t fn	= nullptr;
+	void*	  data	= nullptr;
+
+	// the id of the module that submitted it, and its counts
+	uint32_t	   module = 0;
+	task_counts_t* counts = nullptr;
+
+	// the group it's in, if any
+	task_group_t* group = nullptr;
+};
+
+//
+// work stealing thread pool, shared by the engine and all of our modules
+//
+// each worker has its own deques, one per priority, it pushes and pops its own work from the
+// back so that it stays hot in cache, and when it runs dry it steals from the front of everyone
+// else's, tasks submitted from outside the pool are spread across the workers round robin
+//
+// every task is tagged with the id of the module that submitted it, so that when a build is
+// unloaded we can cancel what it has queued and wait for what it has running before its code goes
+//
+class thread_pool_t
+{
+private:
+
+	//
+	// a worker thread and its queues
+	//
+	struct worker_t
+	{
+		std::thread thread;
+
+		// guards our queues, thieves take it too
+		std::mutex mutex;
+
+		// our queued tasks, one queue per priority
+		std::deque<task_t> queues[TASK_PRIORITY_COUNT];
+	};
+
+	std::vector<std::unique_ptr<worker_t>> m_workers;
+
+	// how many tasks are queued across all workers, so idle workers know whether to sleep
+	std::atomic<size_t> m_queued = 0;
+
+	// where the next task from outside the pool goes
+	std::atomic<size_t> m_next = 0;
+
+	// wakes sleeping workers when there's work, or when we're stopping
+	std::mutex				m_sleep_mutex;
+	std::condition_variable m_sleep_cv;
+
+	// how many workers are asleep, or about to be, so that submit() only takes the lock to wake one when there are
+	std::atomic<uint32_t> m_sleeping = 0;
+
+	// guards m_counts, and wakes a cancel waiting for a module's tasks to finish, only taken to make
+	// a module's counts, by cancel(), and when a module that's being cancelled runs out of tasks
+	std::mutex				m_running_mutex;
+	std::condition_variable m_running_cv;
+
+	// each module's task counts, by id
+	std::unordered_map<uint32_t, std::unique_ptr<task_counts_t>> m_counts;
+
+	// whether our workers should keep running
+	std::atomic<bool> m_running_flag = false;
+
+private:
+
+	// hide constructor so we can't create more instances
+	thread_pool_t() = default;
+
+public:
+
+	~thread_pool_t()
+	{
+		shutdown();
+	}
+
+	//
+	// starts our workers, 0 uses one per core, minus one for the main thread
+	//
+	void init(uint32_t _workers = 0);
+
+	//
+	// cancels everything still queued and stops our workers
+	//
+	void shutdown();
+
+	//
+	// queues a task for the given module, returns false if it was refused because the module's
+	// being cancelled, in which case it's counted as finished in its group without running
+	//
+	bool submit(uint32_t _module, task_fn_t _fn, void* _data, task_priority_t _priority = TASK_NORMAL, task_group_t* _group = nullptr);
+
+	//
+	// blocks until every task in the group has run or been cancelled, running tasks at the group's
+	// priority or above while we wait
+	//
+	void wait(task_group_t* _group);
+
+	//
+	// runs _fn over [0, _count) in chunks of about _grain across the pool, blocking until done
+	//
+	void parallel_for(uint32_t _module, size_t _count, size_t _grain, range_fn_t _fn, void* _data, task_priority_t _priority = TASK_NORMAL);
+
+	//
+	// drops everything the given module has queued, then waits for anything it has running, and
+	// refuses anything it submits in the meantime, going round again until it has nothing left
+	// call before unloading a build so that none of our threads are left in its code
+	// returns the number of tasks that were cancelled
+	//
+	size_t cancel(uint32_t _module);
+
+	//
+	// runs a single queued task at _lowest priority or above on the calling thread if there is
+	// one, returns true if it did
+	//
+	bool run_one(task_priority_t _lowest = TASK_LOW);
+
+	//
+	// returns how many worker threads we have
+	//
+	uint32_t worker_count() const
+	{
+		return CASTTO(uint32_t, m_workers.size());
+	}
+
+	//
+	// prints per module task counts
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(thread_pool_t);
+
+private:
+
+	//
+	// a worker thread's loop
+	//
+	void work(size_t _index);
+
+	//
+	// takes the highest priority task we can find, at _lowest priority or above, looking in
+	// _home's queues first
+	//
+	bool take(size_t _home, task_t& _task, int _lowest = TASK_LOW);
+
+	//
+	// drops everything the given module has queued, returns how many that was
+	//
+	size_t sweep(uint32_t _module);
+
+	//
+	// runs a task that's already been counted as running by take(), and marks it done
+	//
+	void run(const task_t& _task);
+
+	//
+	// counts a task that never went through a queue as running, then runs it
+	//
+	void run_here(const task_t& _task);
+
+	//
+	// gets the given module's counts, making them if it hasn't submitted anything before
+	//
+	task_counts_t* counts(uint32_t _module);
+
+	//
+	// counts one of a module's tasks as no longer running, waking a cancel that's waiting on it if it was the last
+	//
+	void stopped(task_counts_t* _counts);
+
+	//
+	// marks a task as finished, either ran or cancelled
+	//
+	static void finish(const task_t& _task);
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(thread_pool_t, thread_pool)
@@ -0,0 +1,321 @@
+//
+//	trace.cpp | Finn Le Var
+//
+#include "trace.h"
+#include "epoch.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+//
+// static vars
+//
+namespace
+{
+	// a small id for each thread that's recorded into a capture, so they get their own rows
+	std::atomic<uint32_t> g_next_thread = 0;
+	thread_local uint32_t t_thread		= UINT32_MAX;
+
+	//
+	// formats a duration in whichever unit reads best
+	//
+	std::string format_ns(double _ns)
+	{
+		if (_ns < 1e3)
+			return std::format("{:.0f}ns", _ns);
+
+		if (_ns < 1e6)
+			return std::format("{:.2f}us", _ns / 1e3);
+
+		return std::format("{:.2f}ms", _ns / 1e6);
+	}
+
+	//
+	// escapes a string for json, our names are dll names so there's not much to worry about
+	//
+	std::string escape(const std::string& _str)
+	{
+		std::string out;
+
+		out.reserve(_str.size());
+
+		for (char c : _str)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+
+			if (CASTTO(unsigned char, c) >= 0x20)
+				out += c;
+		}
+
+		return out;
+	}
+}
+
+//
+// starts our clock
+//
+tracer_t::tracer_t()
+{
+	m_base_ticks = trace::now();
+	m_base_time	 = std::chrono::steady_clock::now();
+}
+
+//
+// gets the module with the given name
+//
+trace_module_t* tracer_t::module(const std::string& _name)
+{
+	LGUARD(m_mutex);
+
+	auto& module = m_modules[_name];
+
+	if (!module)
+	{
+		module		 = std::make_unique<trace_module_t>();
+		module->name = _name;
+	}
+
+	return module.get();
+}
+
+//
+// starts recording every call
+//
+void tracer_t::begin_capture(size_t _size)
+{
+	LGUARD(m_mutex);
+
+	auto capture = new capture_t;
+
+	capture->size	 = std::max<size_t>(_size, 1);
+	capture->records = std::make_unique<record_t[]>(capture->size);
+
+	// anyone still recording into the old one has it pinned, so it's only freed once they're done
+	if (capture_t* old = m_capture.exchange(capture, std::memory_order_acq_rel))
+		g_epoch.retire([old] { delete old; });
+
+	printdebug("capturing up to " << capture->size << " trace event(s)");
+}
+
+//
+// stops recording and writes out what we recorded
+//
+bool tracer_t::end_capture(const std::string& _path)
+{
+	LGUARD(m_mutex);
+
+	// a late record can still be writing into it, so it's retired straight away, and holding a guard
+	// ourselves means it isn't freed until we've written it out either
+	auto guard = g_epoch.enter();
+
+	capture_t* capture = m_capture.exchange(nullptr, std::memory_order_acq_rel);
+
+	if (!capture)
+		printerret(false, "we're not capturing");
+
+	g_epoch.retire([capture] { delete capture; });
+
+	std::ofstream file(_path, std::ios::trunc);
+
+	if (!file)
+		printerret(false, "couldn't open '" << _path << "' to write our trace to");
+
+	size_t count   = std::min(capture->count.load(std::memory_order_acquire), capture->size);
+	size_t written = 0;
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const record_t& record = capture->records[i];
+
+		// still being filled in when we stopped
+		trace_hist_t* hist = record.hist.load(std::memory_order_acquire);
+
+		if (!hist)
+			continue;
+
+		// chrome wants microseconds
+		file << std::format("{}{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}\n",
+			written ? "," : "", to_string(hist->event), escape(hist->module->name), record.thread,
+			to_ns(record.start - m_base_ticks) / 1e3, to_ns(record.ticks) / 1e3);
+
+		written++;
+	}
+
+	file << "]}\n";
+
+	if (!file)
+		printerret(false, "failed to write our trace to '" << _path << "'");
+
+	size_t total   = capture->count.load(std::memory_order_acquire);
+	size_t dropped = total > capture->size ? total - capture->size : 0;
+
+	printmsg("wrote " << written << " trace event(s) to '" << _path << "'" << (dropped ? std::format(", {} dropped once it was full", dropped) : ""));
+
+	return true;
+}
+
+//
+// records a call in our capture
+//
+void tracer_t::capture(trace_hist_t* _hist, uint64_t _start, uint64_t _ticks)
+{
+	auto guard = g_epoch.enter();
+
+	capture_t* capture = m_capture.load(std::memory_order_acquire);
+
+	// it ended since record() looked
+	if (!capture)
+		return;
+
+	size_t index = capture->count.fetch_add(1, std::memory_order_relaxed);
+
+	if (index >= capture->size)
+		return;
+
+	if (t_thread == UINT32_MAX)
+		t_thread = g_next_thread.fetch_add(1, std::memory_order_relaxed);
+
+	record_t& record = capture->records[index];
+
+	record.start  = _start;
+	record.ticks  = _ticks;
+	record.thread = t_thread;
+
+	record.hist.store(_hist, std::memory_order_release);
+}
+
+//
+// converts ticks to nanoseconds
+//
+double tracer_t::to_ns(uint64_t _ticks)
+{
+#ifdef TRACE_TSC
+	// measured against the steady clock over everything since we started, which gets more accurate the longer we run
+	double elapsed_ns = 0.0;
+	double elapsed	  = 0.0;
+
+	do
+	{
+		elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_base_time).count();
+		elapsed	   = CASTTO(double, trace::now() - m_base_ticks);
+	}
+	while (elapsed_ns < 1e6);
+
+	return _ticks * (elapsed_ns / elapsed);
+#else
+	return CASTTO(double, _ticks);
+#endif
+}
+
+//
+// prints each module's timings for everything since the last summary
+//
+void tracer_t::summary()
+{
+	LGUARD(m_mutex);
+
+	std::vector<trace_module_t*> modules;
+
+	for (auto& [name, module] : m_modules)
+		modules.push_back(module.get());
+
+	std::sort(modules.begin(), modules.end(), [](const trace_module_t* _a, const trace_module_t* _b) { return _a->name < _b->name; });
+
+	uint64_t counts[TRACE_BUCKETS];
+
+	for (auto module : modules)
+	{
+		for (auto& slot : module->hists)
+		{
+			trace_hist_t* hist = slot.load(std::memory_order_acquire);
+
+			if (!hist)
+				continue;
+
+			// take the window and start a new one, then fold it into the totals
+			uint64_t count = 0;
+
+			for (uint32_t i = 0; i < TRACE_BUCKETS; ++i)
+			{
+				counts[i]		= hist->window[i].exchange(0, std::memory_order_relaxed);
+				hist->total[i] += counts[i];
+
+				count += counts[i];
+			}
+
+			uint64_t max = hist->window_max.exchange(0, std::memory_order_relaxed);
+
+			hist->total_max = std::max(hist->total_max, max);
+
+			if (count > 0)
+				print(*hist, counts, max, "lately");
+		}
+	}
+}
+
+//
+// prints each module's timings for everything since we started
+//
+void tracer_t::dump()
+{
+	LGUARD(m_mutex);
+
+	printdebug("trace : " << m_modules.size() << " module(s) timed" << (capturing() ? ", capturing" : ""));
+
+	uint64_t counts[TRACE_BUCKETS];
+
+	for (auto& [name, module] : m_modules)
+	{
+		for (auto& slot : module->hists)
+		{
+			trace_hist_t* hist = slot.load(std::memory_order_acquire);
+
+			if (!hist)
+				continue;
+
+			// the totals plus the window we're in the middle of
+			for (uint32_t i = 0; i < TRACE_BUCKETS; ++i)
+				counts[i] = hist->total[i] + hist->window[i].load(std::memory_order_relaxed);
+
+			print(*hist, counts, std::max(hist->total_max, hist->window_max.load(std::memory_order_relaxed)), "overall");
+		}
+	}
+}
+
+//
+// prints the given counts of a histogram
+//
+void tracer_t::print(const trace_hist_t& _hist, const uint64_t* _counts, uint64_t _max, const char* _label)
+{
+	uint64_t count = 0;
+
+	for (uint32_t i = 0; i < TRACE_BUCKETS; ++i)
+		count += _counts[i];
+
+	if (count == 0)
+		return;
+
+	// the first bucket that gets us to the given fraction of calls
+	auto percentile = [&](double _fraction)
+	{
+		uint64_t target = std::max<uint64_t>(1, CASTTO(uint64_t, _fraction * count + 0.5));
+		uint64_t seen	= 0;
+
+		for (uint32_t i = 0; i < TRACE_BUCKETS; ++i)
+		{
+			seen += _counts[i];
+
+			if (seen >= target)
+				return std::min(trace::bucket_max(i), _max);
+		}
+
+		return _max;
+	};
+
+	printdebug("+    " << _hist.module->name << " " << to_string(_hist.event) << " (" << _label << ") : " << count << " call(s), p50 "
+		<< format_ns(to_ns(percentile(0.5))) << ", p99 " << format_ns(to_ns(percentile(0.99))) << ", max " << format_ns(to_ns(_max)));
+}
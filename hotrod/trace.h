@@ -0,0 +1,432 @@
+//
+//	trace.h | Finn Le Var
+//
+#pragma once
+
+#include <bit>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "shared/macros.h"		// includes shared/print.h
+
+// read the cpu's timestamp counter where we can, it's a fraction of the cost of the steady clock
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_TSC
+#endif
+
+// each power of two is split into this many buckets, so a percentile is within 1/8th of the real value
+#define TRACE_SUB_BITS 3
+#define TRACE_SUB	   (1 << TRACE_SUB_BITS)
+
+// enough buckets for anything up to 2^48 ticks, the last one takes everything longer
+#define TRACE_BUCKETS ((48 - TRACE_SUB_BITS + 1) * TRACE_SUB)
+
+// how many events a capture holds unless we're told otherwise, anything past it is dropped
+#define TRACE_CAPTURE_SIZE (256 * 1024)
+
+//
+// everything we time, the hooks first in the same order as hook_t
+//
+enum trace_event_t : uint8_t
+{
+	TRACE_UPDATE = 0,
+	TRACE_FIXED_UPDATE,
+	TRACE_INPUT,
+	TRACE_RELOAD,
+
+	// calls into a build
+	TRACE_ON_LOAD,
+	TRACE_ON_UNLOAD,
+
+	// the phases of a reload
+	TRACE_STAT,
+	TRACE_HASH,
+	TRACE_SHADOW,
+	TRACE_LOAD_LIB,
+	TRACE_FIND_SYM,
+	TRACE_MODULE_LOAD,
+	TRACE_STAGE,
+	TRACE_INSTALL,
+
+	TRACE_EVENT_COUNT,
+};
+
+//
+// returns the string value for the given event
+//
+inline const char* to_string(trace_event_t _event)
+{
+	switch (_event)
+	{
+	case TRACE_UPDATE:		 return "update";
+	case TRACE_FIXED_UPDATE: return "fixed update";
+	case TRACE_INPUT:		 return "input";
+	case TRACE_RELOAD:		 return "reload";
+	case TRACE_ON_LOAD:		 return "on_load";
+	case TRACE_ON_UNLOAD:	 return "on_unload";
+	case TRACE_STAT:		 return "stat";
+	case TRACE_HASH:		 return "hash";
+	case TRACE_SHADOW:		 return "shadow";
+	case TRACE_LOAD_LIB:	 return "load lib";
+	case TRACE_FIND_SYM:	 return "find sym";
+	case TRACE_MODULE_LOAD:	 return "module_load";
+	case TRACE_STAGE:		 return "stage";
+	case TRACE_INSTALL:		 return "install";
+	default:				 return "unknown";
+	}
+}
+
+namespace trace
+{
+	//
+	// the current time in ticks, only good for differences and for passing back to the tracer
+	//
+	inline uint64_t now()
+	{
+#ifdef TRACE_TSC
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	//
+	// the bucket the given number of ticks falls in, exact below TRACE_SUB, then TRACE_SUB per power of two
+	//
+	inline uint32_t bucket(uint64_t _ticks)
+	{
+		if (_ticks < TRACE_SUB)
+			return CASTTO(uint32_t, _ticks);
+
+		uint32_t exp = 63 - std::countl_zero(_ticks);
+		uint32_t sub = CASTTO(uint32_t, (_ticks >> (exp - TRACE_SUB_BITS)) & (TRACE_SUB - 1));
+
+		uint32_t index = (exp - TRACE_SUB_BITS + 1) * TRACE_SUB + sub;
+
+		return index < TRACE_BUCKETS ? index : TRACE_BUCKETS - 1;
+	}
+
+	//
+	// the most ticks that fall in the given bucket
+	//
+	inline uint64_t bucket_max(uint32_t _bucket)
+	{
+		if (_bucket < TRACE_SUB)
+			return _bucket;
+
+		uint32_t exp = _bucket / TRACE_SUB + TRACE_SUB_BITS - 1;
+		uint64_t sub = _bucket % TRACE_SUB;
+
+		return ((TRACE_SUB + sub + 1) << (exp - TRACE_SUB_BITS)) - 1;
+	}
+}
+
+struct trace_module_t;
+
+//
+// how long one thing took one module, as a log linear histogram
+//
+// recording only touches the current window, which the rolling summary folds into the totals
+// every so often, so the summary shows what's happened lately and dump() shows everything
+//
+struct trace_hist_t
+{
+	// who and what we're timing
+	trace_module_t* module = nullptr;
+	trace_event_t	event  = TRACE_EVENT_COUNT;
+
+	// counts for the current window, and the longest it's seen, in ticks
+	std::atomic<uint32_t> window[TRACE_BUCKETS] = {};
+	std::atomic<uint64_t> window_max			= 0;
+
+	// everything before the current window, only touched by the tracer while it holds its lock
+	uint64_t total[TRACE_BUCKETS] = {};
+	uint64_t total_max			  = 0;
+
+	//
+	// records a single call
+	//
+	void add(uint64_t _ticks)
+	{
+		window[trace::bucket(_ticks)].fetch_add(1, std::memory_order_relaxed);
+
+		// it's rare for this to be the longest yet, so only then do we pay for a swap
+		uint64_t max = window_max.load(std::memory_order_relaxed);
+
+		while (_ticks > max && !window_max.compare_exchange_weak(max, _ticks, std::memory_order_relaxed));
+	}
+};
+
+//
+// everything we've timed for one dll, across all of its builds
+//
+struct trace_module_t
+{
+	std::string name;
+
+	// made the first time each event is recorded, so modules only pay for what they use
+	std::atomic<trace_hist_t*> hists[TRACE_EVENT_COUNT] = {};
+
+	//
+	// gets the histogram for the given event, making it if it doesn't exist yet
+	//
+	trace_hist_t* hist(trace_event_t _event)
+	{
+		trace_hist_t* hist = hists[_event].load(std::memory_order_acquire);
+
+		if (hist)
+			return hist;
+
+		auto made = std::make_unique<trace_hist_t>();
+
+		made->module = this;
+		made->event	 = _event;
+
+		// someone else might have beaten us to it
+		if (!hists[_event].compare_exchange_strong(hist, made.get(), std::memory_order_acq_rel))
+			return hist;
+
+		return made.release();
+	}
+
+	~trace_module_t()
+	{
+		for (auto& hist : hists)
+			delete hist.load();
+	}
+};
+
+//
+// per module timing of every hook call and every reload phase, see TRACE_SCOPE
+//
+// timing a hook is a read of the timestamp counter and an add to a histogram bucket, so it's always
+// on, the histograms give each module's p50, p99, and max, both lately through summary() and
+// overall through dump(), a capture records every call too, for a chrome://tracing json file
+//
+class tracer_t
+{
+private:
+
+	//
+	// a single call in a capture
+	//
+	struct record_t
+	{
+		uint64_t start;
+		uint64_t ticks;
+		uint32_t thread;
+
+		// set last, so the writer can tell a record that's still being filled in
+		std::atomic<trace_hist_t*> hist;
+	};
+
+	//
+	// a capture's records, and how many calls have tried to go in it, which can be more than it holds
+	//
+	struct capture_t
+	{
+		std::unique_ptr<record_t[]> records;
+		size_t						size  = 0;
+		std::atomic<size_t>			count = 0;
+	};
+
+	// every module we've timed, by name, never freed so that hook tables can point into them
+	std::unordered_map<std::string, std::unique_ptr<trace_module_t>> m_modules;
+
+	// guards our modules and the histograms' totals
+	std::mutex m_mutex;
+
+	// whether we're timing anything at all
+	std::atomic<bool> m_enabled = true;
+
+	// the capture we're recording into, null while we aren't, a record reads it inside an epoch guard
+	// and whoever takes it down retires it through g_epoch, so a late record never writes into freed memory
+	std::atomic<capture_t*> m_capture = nullptr;
+
+	// where ticks started from, so that we can turn them into nanoseconds
+	uint64_t							  m_base_ticks = 0;
+	std::chrono::steady_clock::time_point m_base_time;
+
+private:
+
+	// hide constructor so we can't create more instances
+	tracer_t();
+
+public:
+
+	~tracer_t()
+	{
+		delete m_capture.exchange(nullptr);
+	}
+
+	//
+	// gets the module with the given name, making it if we haven't seen it before
+	//
+	trace_module_t* module(const std::string& _name);
+
+	//
+	// records a call to the given histogram that ran from _start to _end
+	//
+	void record(trace_hist_t* _hist, uint64_t _start, uint64_t _end)
+	{
+		_hist->add(_end - _start);
+
+		if (m_capture.load(std::memory_order_relaxed))
+			capture(_hist, _start, _end - _start);
+	}
+
+	//
+	// whether we're timing anything, turning it off leaves a branch in each hook call
+	//
+	bool enabled() const		 { return m_enabled.load(std::memory_order_relaxed); }
+	void set_enabled(bool _enabled) { m_enabled.store(_enabled, std::memory_order_relaxed); }
+
+	//
+	// starts recording every call for a chrome trace, throwing away any capture we already had,
+	// safe to call while other threads are recording, the old one is freed once they're done with it
+	//
+	void begin_capture(size_t _size = TRACE_CAPTURE_SIZE);
+
+	//
+	// stops recording and writes everything we recorded to the given file as chrome trace_event
+	// json, returns false if we weren't capturing or the file couldn't be written
+	//
+	bool end_capture(const std::string& _path);
+
+	//
+	// whether we're capturing
+	//
+	bool capturing() const { return m_capture.load(std::memory_order_relaxed) != nullptr; }
+
+	//
+	// converts ticks to nanoseconds
+	//
+	double to_ns(uint64_t _ticks);
+
+	//
+	// prints each module's p50, p99, and max for everything since the last summary
+	//
+	void summary();
+
+	//
+	// prints each module's p50, p99, and max for everything since we started
+	//
+	void dump();
+
+	// make this class a singleton
+	MAKE_SINGLETON(tracer_t);
+
+private:
+
+	//
+	// records a call in our capture
+	//
+	void capture(trace_hist_t* _hist, uint64_t _start, uint64_t _ticks);
+
+	//
+	// prints the given counts of a histogram
+	//
+	void print(const trace_hist_t& _hist, const uint64_t* _counts, uint64_t _max, const char* _label);
+};
+
+// create our alias var for easy access
+MAKE_SINGLETON_ALIAS(tracer_t, trace)
+
+//
+// times the scope it's in, for the given histogram, or the given module and event, either can be null
+//
+class trace_scope_t
+{
+private:
+
+	trace_hist_t* m_hist  = nullptr;
+	uint64_t	  m_start = 0;
+
+public:
+
+	trace_scope_t(trace_hist_t* _hist)
+	{
+		if (_hist && g_trace.enabled())
+		{
+			m_hist	= _hist;
+			m_start = trace::now();
+		}
+	}
+
+	trace_scope_t(trace_module_t* _module, trace_event_t _event)
+		: trace_scope_t(_module ? _module->hist(_event) : nullptr)
+	{
+	}
+
+	~trace_scope_t()
+	{
+		if (m_hist)
+			g_trace.record(m_hist, m_start, trace::now());
+	}
+
+	trace_scope_t(const trace_scope_t&) = delete;
+	trace_scope_t& operator=(const trace_scope_t&) = delete;
+};
+
+#define TRACE_SCOPE(...) trace_scope_t CONCAT(_trace_, __LINE__)(__VA_ARGS__)
+
+//
+// times a run of calls or phases one after the other, each lap() records the time since the
+// last one, so back to back calls only read the clock once each rather than twice
+//
+class trace_laps_t
+{
+private:
+
+	trace_module_t* m_module  = nullptr;
+	bool			m_enabled = false;
+	uint64_t		m_last	  = 0;
+
+public:
+
+	trace_laps_t(trace_module_t* _module = nullptr)
+		: m_module(_module), m_enabled(g_trace.enabled()), m_last(m_enabled ? trace::now() : 0)
+	{
+	}
+
+	//
+	// records the time since the last lap to the given histogram, which can be null
+	//
+	void lap(trace_hist_t* _hist)
+	{
+		if (!m_enabled)
+			return;
+
+		uint64_t now = trace::now();
+
+		if (_hist)
+			g_trace.record(_hist, m_last, now);
+
+		m_last = now;
+	}
+
+	//
+	// records the time since the last lap as the given event for our module
+	//
+	void lap(trace_event_t _event)
+	{
+		lap(m_module && m_enabled ? m_module->hist(_event) : nullptr);
+	}
+
+	//
+	// starts the next lap from now, for anything in between that we dont want counted
+	//
+	void restart()
+	{
+		if (m_enabled)
+			m_last = trace::now();
+	}
+};
@@ -0,0 +1,305 @@
+//
+//	update_graph.cpp | Finn Le Var
+//
+#include "update_graph.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "dispatch.h"
+#include "thread_pool.h"
+
+//
+// copies our graph, but not what a run needs
+//
+update_graph_t::update_graph_t(const update_graph_t& _other)
+	: m_segments(_other.m_segments), m_first(_other.m_first), m_edges(_other.m_edges), m_waits(_other.m_waits), m_roots(_other.m_roots)
+{
+}
+
+update_graph_t& update_graph_t::operator=(const update_graph_t& _other)
+{
+	if (this == &_other)
+		return *this;
+
+	m_segments = _other.m_segments;
+	m_first	   = _other.m_first;
+	m_edges	   = _other.m_edges;
+	m_waits	   = _other.m_waits;
+	m_roots	   = _other.m_roots;
+
+	m_pending.reset();
+	m_tasks.clear();
+
+	return *this;
+}
+
+//
+// works out the graph for the given on_update entries
+//
+void update_graph_t::build(const std::vector<hook_entry_t>& _entries)
+{
+	const uint32_t count = CASTTO(uint32_t, _entries.size());
+
+	m_segments.clear();
+	m_edges.clear();
+	m_roots.clear();
+
+	m_waits.assign(count, 0);
+
+	// built as lists first, then flattened
+	std::vector<std::vector<uint32_t>> successors(count);
+
+	// how far down a chain each module is, for each segment's depth
+	std::vector<uint32_t> level(count, 1);
+
+	// the last module that added an edge to each one, so that we dont add the same edge twice
+	std::vector<uint32_t> stamp(count, UINT32_MAX);
+
+	// for each bit, the last module in this segment that wrote it, and everyone that's read it since
+	uint32_t			  writer[64];
+	std::vector<uint32_t> readers[64];
+
+	segment_t segment;
+
+	auto close = [&](uint32_t _end)
+	{
+		if (_end == segment.begin)
+			return;
+
+		segment.end		  = _end;
+		segment.roots_end = CASTTO(uint32_t, m_roots.size());
+
+		m_segments.push_back(segment);
+	};
+
+	auto reset = [&](uint32_t _begin)
+	{
+		segment = { .begin = _begin, .roots_begin = CASTTO(uint32_t, m_roots.size()) };
+
+		std::fill(std::begin(writer), std::end(writer), UINT32_MAX);
+
+		for (auto& list : readers)
+			list.clear();
+	};
+
+	reset(0);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const module_context_t& ctx = *_entries[i].mod;
+
+		// they didn't say, so they're on their own
+		if (ctx.writes == SUB_ACCESS_ALL)
+		{
+			close(i);
+
+			m_segments.push_back({ .begin = i, .end = i + 1, .depth = 1, .barrier = true });
+
+			reset(i + 1);
+			continue;
+		}
+
+		// writing something means nobody else can be reading it either
+		const uint64_t writes = ctx.writes;
+		const uint64_t reads  = ctx.reads & ~writes;
+
+		auto wait_on = [&](uint32_t _before)
+		{
+			if (_before == UINT32_MAX || stamp[_before] == i)
+				return;
+
+			stamp[_before] = i;
+
+			successors[_before].push_back(i);
+			m_waits[i]++;
+
+			level[i] = std::max(level[i], level[_before] + 1);
+		};
+
+		for (uint64_t bits = writes; bits; bits &= bits - 1)
+		{
+			int bit = std::countr_zero(bits);
+
+			wait_on(writer[bit]);
+
+			for (uint32_t reader : readers[bit])
+				wait_on(reader);
+		}
+
+		for (uint64_t bits = reads; bits; bits &= bits - 1)
+			wait_on(writer[std::countr_zero(bits)]);
+
+		// only once we've worked out who we wait on, since we might read one bit and write another
+		for (uint64_t bits = writes; bits; bits &= bits - 1)
+		{
+			int bit = std::countr_zero(bits);
+
+			writer[bit] = i;
+			readers[bit].clear();
+		}
+
+		for (uint64_t bits = reads; bits; bits &= bits - 1)
+			readers[std::countr_zero(bits)].push_back(i);
+
+		if (m_waits[i] == 0)
+			m_roots.push_back(i);
+
+		segment.depth = std::max(segment.depth, level[i]);
+	}
+
+	close(count);
+
+	m_first.resize(count + 1);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		m_first[i] = CASTTO(uint32_t, m_edges.size());
+		m_edges.insert(m_edges.end(), successors[i].begin(), successors[i].end());
+	}
+
+	m_first[count] = CASTTO(uint32_t, m_edges.size());
+
+	m_pending.reset();
+	m_tasks.clear();
+}
+
+//
+// calls every entry that's due this frame, across the pool wherever the graph allows
+//
+void update_graph_t::run(const std::vector<hook_entry_t>& _entries, const frame_t& _frame) const
+{
+	if (_entries.size() != m_waits.size())
+		printerret(;, "update graph was built from " << m_waits.size() << " entries, but was given " << _entries.size());
+
+	if (!m_pending || m_tasks.size() != _entries.size())
+	{
+		m_pending = std::make_unique<std::atomic<uint32_t>[]>(_entries.size());
+		m_tasks.resize(_entries.size());
+	}
+
+	m_entries = _entries.data();
+	m_frame	  = &_frame;
+
+	for (const auto& segment : m_segments)
+	{
+		// nothing in it can run alongside anything else, so dont bother the pool
+		if (segment.barrier || segment.depth == segment.end - segment.begin || g_thread_pool.worker_count() == 0)
+		{
+			for (uint32_t i = segment.begin; i < segment.end; ++i)
+				call(m_entries[i]);
+
+			continue;
+		}
+
+		run_segment(segment);
+	}
+
+	m_entries = nullptr;
+	m_frame	  = nullptr;
+}
+
+//
+// whether running us would let anything run alongside anything else
+//
+bool update_graph_t::parallel() const
+{
+	return std::any_of(m_segments.begin(), m_segments.end(), [](const segment_t& _segment)
+	{
+		return !_segment.barrier && _segment.depth < _segment.end - _segment.begin;
+	});
+}
+
+//
+// the longest chain of modules that have to run one after the other
+//
+uint32_t update_graph_t::depth() const
+{
+	uint32_t depth = 0;
+
+	for (const auto& segment : m_segments)
+		depth += segment.depth;
+
+	return depth;
+}
+
+//
+// runs a single segment across the pool
+//
+void update_graph_t::run_segment(const segment_t& _segment) const
+{
+	for (uint32_t i = _segment.begin; i < _segment.end; ++i)
+	{
+		m_pending[i].store(m_waits[i], std::memory_order_relaxed);
+		m_tasks[i] = { .graph = this, .node = i };
+	}
+
+	task_group_t group;
+
+	m_group = &group;
+
+	// we take the first root ourselves, and help with the rest until they're done
+	for (uint32_t i = _segment.roots_begin + 1; i < _segment.roots_end; ++i)
+		g_thread_pool.submit(0, &run_node, &m_tasks[m_roots[i]], TASK_HIGH, &group);
+
+	execute(m_roots[_segment.roots_begin]);
+
+	g_thread_pool.wait(&group);
+
+	m_group = nullptr;
+}
+
+//
+// calls the given module, then carries on with one of its successors
+//
+void update_graph_t::execute(uint32_t _node) const
+{
+	while (true)
+	{
+		call(m_entries[_node]);
+
+		uint32_t next = UINT32_MAX;
+
+		for (uint32_t e = m_first[_node]; e < m_first[_node + 1]; ++e)
+		{
+			uint32_t successor = m_edges[e];
+
+			// someone else is still to finish before it can go
+			if (m_pending[successor].fetch_sub(1, std::memory_order_acq_rel) != 1)
+				continue;
+
+			if (next == UINT32_MAX)
+				next = successor;
+			else
+				g_thread_pool.submit(0, &run_node, &m_tasks[successor], TASK_HIGH, m_group);
+		}
+
+		if (next == UINT32_MAX)
+			return;
+
+		_node = next;
+	}
+}
+
+//
+// calls a single entry if it's due this frame
+//
+void update_graph_t::call(const hook_entry_t& _entry) const
+{
+	if (_entry.divisor > 1 && (m_frame->index + _entry.phase) % _entry.divisor != 0)
+		return;
+
+	TRACE_SCOPE(_entry.hist);
+
+	RECAST(update_fn_t, _entry.fn)(m_frame->dt_for(_entry.divisor), m_frame->index);
+}
+
+//
+// a module handed to the pool
+//
+void update_graph_t::run_node(void* _task)
+{
+	auto task = CASTTO(node_task_t*, _task);
+
+	task->graph->execute(task->node);
+}
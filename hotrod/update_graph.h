@@ -0,0 +1,141 @@
+//
+//	update_graph.h | Finn Le Var
+//
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+struct hook_entry_t;
+struct frame_t;
+
+//
+// the order that modules' on_update's have to run in, worked out from the subsystems each one
+// says it reads and writes, see module_context_t::reads
+//
+// a module that comes after another in the table waits for it if either writes something that
+// the other reads or writes, so conflicting modules always run in table order, which is sorted
+// by name, and anything that doesn't conflict is free to run alongside it on the thread pool
+//
+// a module that hasn't said what it touches is a barrier, it's updated on the main thread once
+// everything before it is done, and nothing after it starts until it's finished, so the table is
+// split into segments of modules that did say, with one of those in between each
+//
+class update_graph_t
+{
+private:
+
+	//
+	// a run of modules that said what they touch, or a single one that didn't
+	//
+	struct segment_t
+	{
+		uint32_t begin = 0;
+		uint32_t end   = 0;
+
+		// where its roots, the modules that dont wait on anyone, are in m_roots
+		uint32_t roots_begin = 0;
+		uint32_t roots_end	 = 0;
+
+		// the longest chain of modules in it that have to run one after the other
+		uint32_t depth = 0;
+
+		// whether it's a module that didn't say, so has to run on its own
+		bool barrier = false;
+	};
+
+	//
+	// a module handed to the pool
+	//
+	struct node_task_t
+	{
+		const update_graph_t* graph;
+		uint32_t			  node;
+	};
+
+	std::vector<segment_t> m_segments;
+
+	// each module's successors are m_edges[m_first[i]] up to m_edges[m_first[i + 1]]
+	std::vector<uint32_t> m_first;
+	std::vector<uint32_t> m_edges;
+
+	// how many modules each one waits on
+	std::vector<uint32_t> m_waits;
+
+	// every segment's roots
+	std::vector<uint32_t> m_roots;
+
+	// what the current run needs, only touched by the thread that started it and the tasks it hands out
+	mutable std::unique_ptr<std::atomic<uint32_t>[]> m_pending;
+	mutable std::vector<node_task_t>				 m_tasks;
+	mutable const hook_entry_t*						 m_entries = nullptr;
+	mutable const frame_t*							 m_frame   = nullptr;
+	mutable task_group_t*							 m_group   = nullptr;
+
+public:
+
+	update_graph_t() = default;
+
+	// copies our graph, but not what a run needs, that's made again the first time we're run
+	update_graph_t(const update_graph_t& _other);
+	update_graph_t& operator=(const update_graph_t& _other);
+
+	//
+	// works out the graph for the given on_update entries, in the order given
+	//
+	void build(const std::vector<hook_entry_t>& _entries);
+
+	//
+	// calls every entry that's due this frame, across the thread pool wherever the graph allows,
+	// blocking until they've all been called, must be the entries we were built from
+	//
+	void run(const std::vector<hook_entry_t>& _entries, const frame_t& _frame) const;
+
+	//
+	// whether running us would let anything run alongside anything else, if not then walking the
+	// entries in order does the same without handing anything to the pool
+	//
+	bool parallel() const;
+
+	//
+	// how many modules wait on another
+	//
+	size_t edges() const { return m_edges.size(); }
+
+	//
+	// the longest chain of modules that have to run one after the other, counting barriers
+	//
+	uint32_t depth() const;
+
+	//
+	// how many segments we're split into
+	//
+	size_t segments() const { return m_segments.size(); }
+
+private:
+
+	//
+	// runs a single segment that said what it touches across the pool
+	//
+	void run_segment(const segment_t& _segment) const;
+
+	//
+	// calls the given module, then every successor that it was the last thing waiting on, handing
+	// all but one of them to the pool and carrying on with that one itself
+	//
+	void execute(uint32_t _node) const;
+
+	//
+	// calls a single entry if it's due this frame
+	//
+	void call(const hook_entry_t& _entry) const;
+
+	//
+	// a module handed to the pool
+	//
+	static void run_node(void* _task);
+};
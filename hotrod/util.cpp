@@ -3,11 +3,127 @@
 //
 #include "util.h"
 
+#include <fstream>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <Psapi.h>
+#include <TlHelp32.h>
+#else
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//
+// maps the file at the given path
+//
+bool mapped_file_t::open(const std::string& _path)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size = {};
+
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        close();
+        return false;
+    }
+
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    // cant map an empty file, but it's still a valid file
+    if (size == 0)
+        return true;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    struct stat st = {};
+
+    if (fstat(fd, &st) != 0)
+    {
+        close();
+        return false;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+
+    if (size == 0)
+        return true;
+
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    data = ptr == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(ptr);
+#endif
+
+    if (!data)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+//
+// unmaps the file
+//
+void mapped_file_t::close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+
+    if (mapping)
+        CloseHandle(mapping);
+
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    mapping = nullptr;
+    file    = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+
+    if (fd >= 0)
+        ::close(fd);
+
+    fd = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
+
 //
 //
 //
 namespace util
 {
+#ifdef _WIN32
+
     //
     // gets the error message for the given error code and formats said message
     //
@@ -42,4 +158,162 @@ namespace util
 
         return message;
     }
-}
\ No newline at end of file
+
+#endif
+
+    //
+    // returns the last error from the os's dynamic loader
+    //
+    std::string last_lib_error()
+    {
+#ifdef _WIN32
+        return format_win32_error(GetLastError());
+#else
+        // dlerror clears itself once read, so copy it out
+        const char* error = dlerror();
+
+        return error ? error : "unknown dlerror";
+#endif
+    }
+
+    //
+    // loads the dll/so at the given path, returns nullptr on failure
+    //
+    lib_handle_t load_lib(const std::string& _path)
+    {
+#ifdef _WIN32
+        return LoadLibraryA(_path.c_str());
+#else
+        // resolve everything now so that a bad build fails here rather than on its first call
+        return dlopen(_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+    }
+
+    //
+    // unloads the given dll/so
+    //
+    void free_lib(lib_handle_t _handle)
+    {
+        if (!_handle)
+            return;
+
+#ifdef _WIN32
+        FreeLibrary(_handle);
+#else
+        dlclose(_handle);
+#endif
+    }
+
+    //
+    // finds the exported symbol with the given name in the given dll/so
+    //
+    void* find_sym(lib_handle_t _handle, const char* _name)
+    {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(GetProcAddress(_handle, _name));
+#else
+        return dlsym(_handle, _name);
+#endif
+    }
+
+    //
+    // whether the dll/so at the given path is still loaded
+    //
+    bool lib_loaded(const std::string& _path)
+    {
+        if (_path.empty())
+            return false;
+
+#ifdef _WIN32
+        return GetModuleHandleA(_path.c_str()) != nullptr;
+#else
+        // only finds it if it's already loaded, and takes a reference if it is, so give that back
+        void* handle = dlopen(_path.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+
+        if (!handle)
+            return false;
+
+        dlclose(handle);
+
+        return true;
+#endif
+    }
+
+    //
+    // reads what the process is currently holding on to
+    //
+    process_stats_t process_stats()
+    {
+        process_stats_t stats;
+
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS memory = {};
+
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+            stats.rss = memory.WorkingSetSize;
+
+        DWORD handles = 0;
+
+        if (GetProcessHandleCount(GetCurrentProcess(), &handles))
+            stats.fds = handles;
+
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+
+        if (snapshot != INVALID_HANDLE_VALUE)
+        {
+            THREADENTRY32 entry = { .dwSize = sizeof(THREADENTRY32) };
+
+            for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry))
+            {
+                if (entry.th32OwnerProcessID == GetCurrentProcessId())
+                    stats.threads++;
+            }
+
+            CloseHandle(snapshot);
+        }
+#else
+        // statm is in pages, the second field is what's resident
+        {
+            std::ifstream statm("/proc/self/statm");
+
+            size_t size = 0, resident = 0;
+
+            if (statm >> size >> resident)
+                stats.rss = resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+
+        // the iterator holds a descriptor of its own while it's open
+        {
+            std::error_code ec;
+
+            for (std::filesystem::directory_iterator it("/proc/self/fd", ec), end; !ec && it != end; it.increment(ec))
+                stats.fds++;
+
+            if (stats.fds)
+                stats.fds--;
+        }
+
+        {
+            std::ifstream maps("/proc/self/maps");
+
+            for (std::string line; std::getline(maps, line);)
+                stats.maps++;
+        }
+
+        {
+            std::ifstream status("/proc/self/status");
+
+            for (std::string line; std::getline(status, line);)
+            {
+                if (line.rfind("Threads:", 0) == 0)
+                {
+                    stats.threads = std::stoull(line.substr(8));
+                    break;
+                }
+            }
+        }
+#endif
+
+        return stats;
+    }
+}
@@ -4,12 +4,88 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+
+//
+// handle to a loaded dll/so
+//
+#ifdef _WIN32
+using lib_handle_t = HMODULE;
+#else
+using lib_handle_t = void*;
+#endif
+
+//
+// a read only memory mapping of a whole file
+//
+struct mapped_file_t
+{
+    const uint8_t*  data = nullptr;
+    size_t          size = 0;
+
+#ifdef _WIN32
+    HANDLE          file    = INVALID_HANDLE_VALUE;
+    HANDLE          mapping = nullptr;
+#else
+    int             fd = -1;
+#endif
+
+    mapped_file_t() = default;
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+    ~mapped_file_t() { close(); }
+
+    // maps the file at the given path, returns false if it couldn't be opened
+    bool open(const std::string& _path);
+
+    // unmaps the file
+    void close();
+};
+
+//
+// what the process is holding on to, for spotting leaks across reloads
+//
+struct process_stats_t
+{
+    // resident memory in bytes
+    size_t rss     = 0;
+
+    // open file descriptors, or handles on windows
+    size_t fds     = 0;
+
+    // mapped regions, always 0 on windows
+    size_t maps    = 0;
+
+    // running threads
+    size_t threads = 0;
+};
 
 //
 //
 //
 namespace util
 {
+#ifdef _WIN32
     std::string format_win32_error(DWORD _error_code);
+#endif
+
+    // returns the last error from the os's dynamic loader, formatted
+    std::string last_lib_error();
+
+    // thin wrappers around LoadLibrary/dlopen and friends so that we dont have platform checks everywhere
+    lib_handle_t load_lib(const std::string& _path);
+    void free_lib(lib_handle_t _handle);
+    void* find_sym(lib_handle_t _handle, const char* _name);
+
+    // whether the dll/so at the given path is still loaded, for checking that freeing it worked
+    bool lib_loaded(const std::string& _path);
+
+    // reads what the process is currently holding on to, which isn't cheap, so dont call it every tick
+    process_stats_t process_stats();
 }
@@ -0,0 +1,439 @@
+//
+//	watcher.cpp | Finn Le Var
+//
+#include "watcher.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include "util.h"
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+//
+// starts watching the given directories
+//
+bool watcher_t::init(const std::vector<std::string>& _paths, const std::string& _extension, std::chrono::milliseconds _debounce)
+{
+	if (m_active)
+		printerret(true, "watcher already initialised");
+
+	m_extension = _extension;
+	m_debounce  = _debounce;
+
+#ifdef _WIN32
+
+	for (const auto& path : _paths)
+	{
+		auto dir = new dir_t;
+
+		dir->path = path;
+
+		// open the directory for overlapped change notifications
+		dir->handle = CreateFileW(dir->path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+		if (dir->handle == INVALID_HANDLE_VALUE)
+		{
+			printerror("failed to watch '" << path << "' : " << util::format_win32_error(GetLastError()));
+			delete dir;
+			continue;
+		}
+
+		// manual reset event so that we can wait on it
+		dir->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+		// queue our first read
+		if (!ReadDirectoryChangesW(dir->handle, dir->buffer, sizeof(dir->buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &dir->overlapped, nullptr))
+		{
+			printerror("failed to watch '" << path << "' : " << util::format_win32_error(GetLastError()));
+			CloseHandle(dir->overlapped.hEvent);
+			CloseHandle(dir->handle);
+			delete dir;
+			continue;
+		}
+
+		m_dirs.push_back(dir);
+
+		printdebug("watching '" << path << "'");
+	}
+
+#else
+
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_fd < 0)
+		printerret(false, "failed to create inotify instance : " << std::strerror(errno));
+
+	for (const auto& path : _paths)
+	{
+		// close_write and moved_to mean the writer is done, modify and create just tell us it's in progress
+		int wd = inotify_add_watch(m_fd, path.c_str(), IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+
+		if (wd < 0)
+		{
+			printerror("failed to watch '" << path << "' : " << std::strerror(errno));
+			continue;
+		}
+
+		m_dirs[wd] = path;
+
+		printdebug("watching '" << path << "'");
+	}
+
+	if (m_dirs.empty())
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+
+#endif
+
+	m_active = !m_dirs.empty();
+
+	return m_active;
+}
+
+//
+// stops watching and releases our handles
+//
+void watcher_t::shutdown()
+{
+#ifdef _WIN32
+
+	for (auto dir : m_dirs)
+	{
+		// cancel our outstanding read and wait for it to finish before we free its buffer
+		CancelIoEx(dir->handle, &dir->overlapped);
+
+		DWORD bytes = 0;
+		GetOverlappedResult(dir->handle, &dir->overlapped, &bytes, TRUE);
+
+		CloseHandle(dir->overlapped.hEvent);
+		CloseHandle(dir->handle);
+
+		delete dir;
+	}
+
+#else
+
+	if (m_fd >= 0)
+		close(m_fd);
+
+	m_fd = -1;
+
+#endif
+
+	m_dirs.clear();
+	m_pending.clear();
+
+	m_active = false;
+}
+
+//
+// records an event for the given file
+//
+void watcher_t::push(const std::filesystem::path& _path, watch_event_type_t _type, bool _closed)
+{
+	// only care about our modules
+	if (_path.extension() != m_extension)
+		return;
+
+	auto [it, added] = m_pending.try_emplace(_path.string());
+
+	pending_t& pending = it->second;
+
+	if (added)
+	{
+		pending.type = _type;
+	}
+	else
+	{
+		// removed then created is how most linkers replace their output, so treat it as a modification,
+		// otherwise keep the first type we saw unless it has been removed since
+		if (pending.type == WATCH_REMOVED && _type == WATCH_CREATED)
+			pending.type = WATCH_MODIFIED;
+		else if (_type == WATCH_REMOVED)
+			pending.type = WATCH_REMOVED;
+	}
+
+	// any new write means it isn't closed anymore
+	pending.closed		= _closed;
+	pending.last_event	= steady_clock_t::now();
+}
+
+//
+// reads everything the os has queued for us
+//
+void watcher_t::drain()
+{
+#ifdef _WIN32
+
+	for (auto dir : m_dirs)
+	{
+		DWORD bytes = 0;
+
+		// check if our read has completed without blocking
+		if (!GetOverlappedResult(dir->handle, &dir->overlapped, &bytes, FALSE))
+		{
+			if (GetLastError() != ERROR_IO_INCOMPLETE)
+				printerror("failed to read changes for '" << dir->path.string() << "' : " << util::format_win32_error(GetLastError()));
+
+			continue;
+		}
+
+		// a completed read with no data means the buffer overflowed and we lost events
+		if (bytes == 0)
+			m_overflow = true;
+
+		size_t offset = 0;
+
+		while (bytes > 0)
+		{
+			auto info = RECAST(FILE_NOTIFY_INFORMATION*, dir->buffer + offset);
+
+			std::filesystem::path path = dir->path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+
+			switch (info->Action)
+			{
+			case FILE_ACTION_ADDED:
+			case FILE_ACTION_RENAMED_NEW_NAME:	push(path, WATCH_CREATED);	break;
+			case FILE_ACTION_MODIFIED:			push(path, WATCH_MODIFIED);	break;
+			case FILE_ACTION_REMOVED:
+			case FILE_ACTION_RENAMED_OLD_NAME:	push(path, WATCH_REMOVED);	break;
+			default: break;
+			}
+
+			if (!info->NextEntryOffset)
+				break;
+
+			offset += info->NextEntryOffset;
+		}
+
+		// queue our next read
+		ResetEvent(dir->overlapped.hEvent);
+
+		if (!ReadDirectoryChangesW(dir->handle, dir->buffer, sizeof(dir->buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &dir->overlapped, nullptr))
+		{
+			printerror("failed to rewatch '" << dir->path.string() << "' : " << util::format_win32_error(GetLastError()));
+			m_overflow = true;
+		}
+	}
+
+#else
+
+	// inotify events are variable sized, so align our buffer to the event struct
+	alignas(inotify_event) char buffer[16 * 1024];
+
+	while (true)
+	{
+		ssize_t len = read(m_fd, buffer, sizeof(buffer));
+
+		// EAGAIN means we've read everything
+		if (len <= 0)
+			break;
+
+		for (char* ptr = buffer; ptr < buffer + len; )
+		{
+			auto event = RECAST(const inotify_event*, ptr);
+
+			ptr += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				m_overflow = true;
+				continue;
+			}
+
+			if (!event->len || (event->mask & IN_ISDIR))
+				continue;
+
+			auto dir = m_dirs.find(event->wd);
+
+			if (dir == m_dirs.end())
+				continue;
+
+			std::filesystem::path path = dir->second / event->name;
+
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				push(path, WATCH_REMOVED);
+			else if (event->mask & IN_CREATE)
+				push(path, WATCH_CREATED);
+			else if (event->mask & IN_MOVED_TO)
+				push(path, WATCH_CREATED, true);
+			else if (event->mask & IN_CLOSE_WRITE)
+				push(path, WATCH_MODIFIED, true);
+			else if (event->mask & IN_MODIFY)
+				push(path, WATCH_MODIFIED);
+		}
+	}
+
+#endif
+}
+
+//
+// returns true if the given file is finished being written
+//
+bool watcher_t::stable(const std::string& _path, pending_t& _pending) const
+{
+	std::error_code ec;
+
+	auto size = std::filesystem::file_size(_path, ec);
+
+	// it's gone, nothing more is going to be written to it
+	if (ec)
+		return true;
+
+	auto write_time = std::filesystem::last_write_time(_path, ec);
+
+	if (ec)
+		return true;
+
+#ifdef _WIN32
+
+	// the linker keeps its output open for writing until it's done, so if we can't open it
+	// without sharing write access then someone is still writing to it
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	CloseHandle(file);
+
+#endif
+
+	// the writer closed it and hasn't touched it since, we dont need to double check
+	if (_pending.closed)
+		return true;
+
+	// otherwise make sure it hasn't changed since the last time we looked
+	bool same = size == _pending.size && write_time == _pending.write_time;
+
+	_pending.size		= size;
+	_pending.write_time	= write_time;
+
+	return same;
+}
+
+//
+// returns the time until the earliest pending change is due to settle
+//
+std::chrono::milliseconds watcher_t::next_due() const
+{
+	auto now = steady_clock_t::now();
+	auto due = std::chrono::milliseconds::max();
+
+	for (const auto& [path, pending] : m_pending)
+	{
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - pending.last_event);
+
+		due = std::min(due, std::max(std::chrono::milliseconds(0), m_debounce - elapsed));
+	}
+
+	return due;
+}
+
+//
+// drains the os events then returns the changes that have settled
+//
+std::vector<watch_event_t> watcher_t::poll()
+{
+	std::vector<watch_event_t> events;
+
+	if (!m_active)
+		return events;
+
+	drain();
+
+	// we lost events, everything we know is suspect so just rescan
+	if (m_overflow)
+	{
+		printdebug("watcher overflowed, requesting rescan");
+
+		m_overflow = false;
+		m_pending.clear();
+
+		events.push_back({ .type = WATCH_RESCAN });
+
+		return events;
+	}
+
+	auto now = steady_clock_t::now();
+
+	for (auto it = m_pending.begin(); it != m_pending.end(); )
+	{
+		auto& [path, pending] = *it;
+
+		// still settling
+		if (now - pending.last_event < m_debounce)
+		{
+			++it;
+			continue;
+		}
+
+		// still being written, check again after another debounce period
+		if (!stable(path, pending))
+		{
+			pending.last_event = now;
+			++it;
+			continue;
+		}
+
+		// trust the file system over the event type, the file could have come and gone since
+		bool exists = std::filesystem::exists(path);
+
+		watch_event_type_t type = pending.type;
+
+		if (!exists)
+			type = WATCH_REMOVED;
+		else if (type == WATCH_REMOVED)
+			type = WATCH_MODIFIED;
+
+		events.push_back({ .type = type, .path = path });
+
+		it = m_pending.erase(it);
+	}
+
+	return events;
+}
+
+//
+// blocks until there is something to poll or the timeout expires
+//
+bool watcher_t::wait(std::chrono::milliseconds _timeout)
+{
+	if (!m_active)
+		return false;
+
+	// dont sleep past the time that a pending change is due
+	auto timeout = std::min(_timeout, next_due());
+
+#ifdef _WIN32
+
+	std::vector<HANDLE> handles;
+	handles.reserve(m_dirs.size());
+
+	for (auto dir : m_dirs)
+		handles.push_back(dir->overlapped.hEvent);
+
+	DWORD result = WaitForMultipleObjects(CASTTO(DWORD, handles.size()), handles.data(), FALSE, CASTTO(DWORD, timeout.count()));
+
+	bool signalled = result < WAIT_OBJECT_0 + handles.size();
+
+#else
+
+	pollfd fd = { .fd = m_fd, .events = POLLIN };
+
+	bool signalled = ::poll(&fd, 1, CASTTO(int, timeout.count())) > 0;
+
+#endif
+
+	return signalled || (has_pending() && next_due().count() == 0);
+}
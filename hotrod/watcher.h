@@ -0,0 +1,197 @@
+//
+//	watcher.h | Finn Le Var
+//
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <chrono>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "shared/macros.h"		// includes shared/print.h
+
+//
+// the different things that can happen to a file we're watching
+//
+enum watch_event_type_t : uint8_t
+{
+	WATCH_CREATED = 0,
+	WATCH_MODIFIED,
+	WATCH_REMOVED,
+
+	// the os dropped events (queue overflow), we need to rescan everything
+	WATCH_RESCAN,
+};
+
+//
+// returns the string value for the given event type
+//
+inline const char* to_string(watch_event_type_t _type)
+{
+	switch (_type)
+	{
+	case WATCH_CREATED:		return "created";
+	case WATCH_MODIFIED:	return "modified";
+	case WATCH_REMOVED:		return "removed";
+	case WATCH_RESCAN:		return "rescan";
+	default:				return "unknown";
+	}
+}
+
+//
+// a settled change to a file in one of our watch paths
+//
+struct watch_event_t
+{
+	watch_event_type_t		type;
+	std::filesystem::path	path;
+};
+
+//
+// watches our module folders using the os's change notifications (inotify on linux,
+// ReadDirectoryChangesW on windows) so that we dont have to rescan and stat every
+// module every tick
+//
+// events are debounced, a file is only reported once it has stopped changing for
+// m_debounce, so that we dont try to load half written linker output
+//
+class watcher_t
+{
+private:
+
+	using steady_clock_t = std::chrono::steady_clock;
+
+	//
+	// a file that has changed but hasn't settled yet
+	//
+	struct pending_t
+	{
+		watch_event_type_t	type;
+
+		// the last time the os told us about this file
+		steady_clock_t::time_point last_event;
+
+		// set once the writer has closed the file, so we know it's done with it
+		bool				closed = false;
+
+		// the size and write time we saw the last time we checked if it was stable
+		std::uintmax_t		size = 0;
+		std::filesystem::file_time_type write_time = {};
+	};
+
+#ifdef _WIN32
+
+	//
+	// a single directory handle and its outstanding overlapped read
+	//
+	struct dir_t
+	{
+		std::filesystem::path	path;
+		HANDLE					handle	= INVALID_HANDLE_VALUE;
+		OVERLAPPED				overlapped = {};
+
+		// ReadDirectoryChangesW needs a dword aligned buffer
+		alignas(DWORD) uint8_t	buffer[64 * 1024];
+	};
+
+	// one per watch path
+	std::vector<dir_t*> m_dirs;
+
+#else
+
+	// our inotify instance
+	int m_fd = -1;
+
+	// watch descriptor -> the directory it watches
+	std::unordered_map<int, std::filesystem::path> m_dirs;
+
+#endif
+
+	// files that have changed but haven't settled yet, keyed by path
+	std::unordered_map<std::string, pending_t> m_pending;
+
+	// the extension of the files we care about
+	std::string m_extension;
+
+	// how long a file has to go without changing before we report it
+	std::chrono::milliseconds m_debounce = std::chrono::milliseconds(150);
+
+	// set when the os dropped events and we need to rescan
+	bool m_overflow = false;
+
+	// whether we're watching anything
+	bool m_active = false;
+
+public:
+
+	watcher_t() = default;
+
+	watcher_t(const watcher_t&) = delete;
+	watcher_t& operator=(const watcher_t&) = delete;
+
+	~watcher_t()
+	{
+		shutdown();
+	}
+
+	//
+	// starts watching the given directories for files with the given extension
+	// returns false if the os watcher couldn't be created, the caller should fall back to polling
+	//
+	bool init(const std::vector<std::string>& _paths, const std::string& _extension, std::chrono::milliseconds _debounce);
+
+	//
+	// stops watching and releases our os handles
+	//
+	void shutdown();
+
+	//
+	// returns true if we're successfully watching our paths
+	//
+	bool active() const { return m_active; }
+
+	//
+	// returns true if we have changes that haven't settled yet
+	//
+	bool has_pending() const { return !m_pending.empty(); }
+
+	//
+	// drains any events from the os without blocking, then returns the changes
+	// that have settled since the last call
+	//
+	std::vector<watch_event_t> poll();
+
+	//
+	// blocks until the os has an event for us, a pending change is due to settle,
+	// or the timeout expires, returns true if there is something to poll
+	//
+	bool wait(std::chrono::milliseconds _timeout);
+
+private:
+
+	//
+	// reads everything the os has queued for us into m_pending, doesn't block
+	//
+	void drain();
+
+	//
+	// records an event for the given file, merging it with any event already pending
+	//
+	void push(const std::filesystem::path& _path, watch_event_type_t _type, bool _closed = false);
+
+	//
+	// returns true if the given file is finished being written
+	//
+	bool stable(const std::string& _path, pending_t& _pending) const;
+
+	//
+	// returns the time until the earliest pending change is due to settle
+	//
+	std::chrono::milliseconds next_due() const;
+};
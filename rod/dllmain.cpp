@@ -6,14 +6,20 @@
 
 #include <thread>
 #include <utility>
+#include <atomic>
+#include <vector>
 
 #include "shared/context.h"
 #include "shared/macros.h"		// for HOT_EXPORT
 #include "shared/print.h"
 #include "shared/subsystem.h"
+#include "shared/events.h"
+#include "shared/state.h"
+#include "shared/frame.h"
+#include "shared/alloc.h"
 
-// for functions that we're exporting to the main program
-#define HOT_EXPORT extern "C" _declspec(dllexport)
+// route our operator new and delete through the engine's allocator, where that's possible
+HOT_ROUTE_NEW()
 
 //
 // static vars
@@ -25,6 +31,51 @@ namespace
 
 	// this modules context
 	module_context_t* g_mod = nullptr;
+
+	// seconds since we last printed from on_update
+	float g_elapsed = 0.0f;
+
+	//
+	// what we publish every update, just to show the dispatcher working
+	//
+	struct tick_event_t
+	{
+		uint64_t frame;
+		float	 dt;
+	};
+
+	channel_t<tick_event_t> g_ticks;
+
+	// our subscription to it
+	uint64_t g_ticks_sub = 0;
+
+	// how many tick events we've been handed since we last printed
+	size_t g_ticks_seen = 0;
+
+	//
+	// what we keep across reloads
+	//
+	struct rod_state_t
+	{
+		uint32_t loads;
+		uint64_t updates;
+	};
+
+	rod_state_t* g_state = nullptr;
+
+	// scratch memory for our updates
+	sub_frame_ctx_t* g_frame = nullptr;
+
+	// our last few dts, allocated by the engine so that it can see what we're holding on to
+	std::vector<float, hot_alloc::allocator_t<float>> g_history;
+
+	//
+	// called once a tick with every tick event published since the last one
+	//
+	void on_ticks(const tick_event_t* _events, size_t _count)
+	{
+		g_ticks_seen += _count;
+	}
 }
 
 //
@@ -41,11 +92,10 @@ bool MOD_INIT_FN(engine_context_t* _ctx)
 
 	// initialise stuff
 
-	// initialise our subsys manager and parse the subsystems in our engine ctx
-	// this could maybe be done in the engine
+	// point our subsys manager at the engine's subsystem table
 	g_subsystem.init(_ctx);
 
-	sub_test_ctx_t* test = g_subsystem.find<sub_test_ctx_t>(SUB_TEST);
+	sub_test_ctx_t* test = g_subsystem.find<SUB_TEST>();
 
 	if (test)
 	{
@@ -57,6 +107,49 @@ bool MOD_INIT_FN(engine_context_t* _ctx)
 			test->dump(g_mod);
 	}
 
+	sub_thread_pool_ctx_t* pool = g_subsystem.find<SUB_THREAD_POOL>();
+
+	if (pool)
+	{
+		// sum some numbers across the engine's workers, just to show it working
+		std::atomic<uint64_t> sum = 0;
+
+		pool->parallel_for(g_mod, 100000, 0, [](void* _sum, size_t _begin, size_t _end)
+		{
+			uint64_t total = 0;
+
+			for (size_t i = _begin; i < _end; ++i)
+				total += i;
+
+			CASTTO(std::atomic<uint64_t>*, _sum)->fetch_add(total);
+		}, &sum, TASK_NORMAL);
+
+		printmsg("summed " << sum.load() << " across " << pool->worker_count() << " worker(s)");
+	}
+
+	// the channel outlives us, so a reload picks up the same one, but we have to subscribe again
+	if (g_ticks.open(g_subsystem.find<SUB_DISPATCHER>(), "rod.ticks"))
+		g_ticks_sub = g_ticks.subscribe<&on_ticks>(g_mod);
+
+	g_frame = g_subsystem.find<SUB_FRAME>();
+
+	// everything we allocate from here on is counted against us by the engine
+	hot_alloc::init(g_subsystem.find<SUB_ALLOC>(), g_mod);
+
+	g_history.reserve(256);
+
+	// pick up where the last build left off
+	state_status_t status = STATE_NEW;
+
+	g_state = acquire_state<rod_state_t>(g_subsystem.find<SUB_STATE>(), g_mod, "rod", 1, nullptr, &status);
+
+	if (g_state)
+	{
+		g_state->loads++;
+
+		printmsg("loaded " << g_state->loads << " time(s), " << g_state->updates << " update(s) so far" << (status == STATE_KEPT ? ", state kept" : ""));
+	}
+
 	printmsg("initialised");
 
 	return g_engine != nullptr;
@@ -73,17 +166,50 @@ void MOD_INPUT_FN()
 }
 
 //
-// called on update
+// called on update, _dt is the seconds since our last update
 //
-void MOD_UPDATE_FN()
+void MOD_UPDATE_FN(float _dt, uint64_t _frame)
 {
 	//DO_ONCE(printmsg("on_update"));
 
 	//printmsg("on_update");
 
-	printmsg("dllzNUTZ");
-	printmsg("haaaah");
-	printmsg("GOTTEEEM");
+	g_ticks.publish({ .frame = _frame, .dt = _dt });
+
+	if (g_state)
+		g_state->updates++;
+
+	if (g_history.size() == g_history.capacity())
+		g_history.clear();
+
+	g_history.push_back(_dt);
+
+	// we're updated every frame or so, dont want to spam
+	g_elapsed += _dt;
+
+	if (g_elapsed < 2.0f)
+		return;
+
+	g_elapsed = 0.0f;
+
+	// build our message in this tick's scratch memory rather than on the heap
+	frame_resource_t scratch(g_frame, g_mod);
+	std::pmr::string msg(&scratch);
+
+	msg  = "dllzNUTZ @ frame ";
+	msg += std::to_string(_frame);
+
+	printdebug(msg << ", " << g_ticks_seen << " tick event(s) since last time");
+
+	g_ticks_seen = 0;
+}
+
+//
+// called at a fixed rate, _dt is the fixed timestep
+//
+void MOD_FIXED_FN(float _dt, uint64_t _step)
+{
+	DO_ONCE(printmsg("on_fixed_update, step " << _step << " of " << _dt << "s"));
 }
 
 //
@@ -94,11 +220,25 @@ bool MOD_UNLOAD_FN()
 {
 	DO_ONCE(printmsg("on_unload"));
 
-	// todo : unload everything
+	// the engine drops anything we leave subscribed, but it complains about it
+	g_ticks.unsubscribe(g_ticks_sub);
+	g_ticks.close();
+
+	g_ticks_seen = 0;
+	g_elapsed	 = 0.0f;
+
+	// give back what we allocated, anything left once we're gone is reported as a leak
+	g_history = {};
 
+	// our state block is kept for the next build, we just stop pointing at it
 	g_mod	 = nullptr;
+	g_state	 = nullptr;
+	g_frame	 = nullptr;
 	g_engine = nullptr;
 
+	// stops our prints going through the engine's logger, which outlives us
+	g_subsystem.cleanup();
+
 	// succesfully unloaded
 	return true;
 }
@@ -134,8 +274,17 @@ HOT_EXPORT void MOD_LOAD_FN(module_context_t* _mod)
 	_mod->CTX_INPUT_FN  = &MOD_INPUT_FN;
 	_mod->CTX_UPDATE_FN = &MOD_UPDATE_FN;
 	_mod->CTX_UNLOAD_FN = &MOD_UNLOAD_FN;
+	_mod->CTX_FIXED_FN	= &MOD_FIXED_FN;
 	// _mod->CTX_RELOAD_FN	= &MOD_RELOAD_FN;	// not implemented so dont need to set it
 
+	// we dont need updating every frame
+	_mod->tick_divisor	= 4;
+
+	// our on_update publishes ticks and bumps our state, and only borrows scratch memory otherwise,
+	// so we can be updated alongside anyone that doesn't publish or keep state
+	_mod->reads			= SUB_MASK(SUB_FRAME);
+	_mod->writes		= SUB_MASK(SUB_DISPATCHER) | SUB_MASK(SUB_STATE);
+
 	// if on_init, on_input, on_update, and on_unload were set then the module is considered loaded
 	_mod->loaded = _mod->CTX_INIT_FN && _mod->CTX_INPUT_FN && _mod->CTX_UPDATE_FN && _mod->CTX_UNLOAD_FN;
 
@@ -0,0 +1,148 @@
+//
+//	alloc.h | Finn Le Var
+//
+#pragma once
+
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+#include "shared/context.h"		// includes shared/macros.h
+
+//
+// module side of the engine's allocator, see sub_alloc_ctx_t
+//
+// call hot_alloc::init() in on_load, anything allocated before that, by static constructors say,
+// comes from the module's own heap with a local header so that it's still freed in the right place
+//
+namespace hot_alloc
+{
+	// our allocator and module, never cleared, since static destructors can free things after on_unload
+	inline sub_alloc_ctx_t*	 g_ctx = nullptr;
+	inline module_context_t* g_mod = nullptr;
+
+	//
+	// starts routing our allocations through the engine
+	//
+	inline void init(sub_alloc_ctx_t* _ctx, module_context_t* _mod)
+	{
+		g_ctx = _ctx;
+		g_mod = _mod;
+	}
+
+	//
+	// gets the header in front of an allocation
+	//
+	inline alloc_header_t* header(void* _ptr)
+	{
+		return RECAST(alloc_header_t*, CASTTO(std::byte*, _ptr) - sizeof(alloc_header_t));
+	}
+
+	//
+	// allocates through the engine, or from our own heap if we haven't been given it yet
+	//
+	inline void* allocate(size_t _size, size_t _align = alignof(std::max_align_t))
+	{
+		if (g_ctx)
+			return g_ctx->alloc(g_mod, _size, _align);
+
+		if (_align < alignof(std::max_align_t))
+			_align = alignof(std::max_align_t);
+
+		auto raw = CASTTO(std::byte*, std::malloc(_size + _align + sizeof(alloc_header_t)));
+
+		if (!raw)
+			return nullptr;
+
+		// leave room for the header, then align
+		auto addr = RECAST(uintptr_t, raw + sizeof(alloc_header_t));
+		auto user = raw + sizeof(alloc_header_t) + ((_align - addr % _align) % _align);
+
+		*header(user) = { .module = 0, .size_class = ALLOC_CLASS_LOCAL, .offset = CASTTO(uint16_t, user - raw - sizeof(alloc_header_t)), .size = _size };
+
+		return user;
+	}
+
+	//
+	// frees something from allocate(), or that the engine handed us
+	//
+	inline void deallocate(void* _ptr)
+	{
+		if (!_ptr)
+			return;
+
+		alloc_header_t* head = header(_ptr);
+
+		if (head->size_class == ALLOC_CLASS_LOCAL)
+			std::free(RECAST(std::byte*, head) - head->offset);
+		else if (g_ctx)
+			g_ctx->free(_ptr);
+	}
+
+	//
+	// an stl allocator over the engine's allocator, for containers whose buffers are handed
+	// across the boundary
+	//
+	template<typename type_t>
+	struct allocator_t
+	{
+		using value_type = type_t;
+
+		allocator_t() = default;
+
+		template<typename other_t>
+		allocator_t(const allocator_t<other_t>&) {}
+
+		type_t* allocate(size_t _count)
+		{
+			void* ptr = hot_alloc::allocate(_count * sizeof(type_t), alignof(type_t));
+
+			if (!ptr)
+				throw std::bad_alloc();
+
+			return CASTTO(type_t*, ptr);
+		}
+
+		void deallocate(type_t* _ptr, size_t)
+		{
+			hot_alloc::deallocate(_ptr);
+		}
+
+		template<typename other_t>
+		bool operator==(const allocator_t<other_t>&) const { return true; }
+	};
+}
+
+//
+// routes all of a module's operator new and delete through the engine's allocator, put it in
+// exactly one of the module's source files
+//
+// only on windows, where each module has its own runtime, which is the problem this solves, on
+// other platforms every module shares the process's runtime, and its standard library allocates
+// some of a module's strings and containers inside its own code with the process's operator new,
+// which a module's replacement would then be asked to free, so there use allocator_t instead
+//
+#ifdef _WIN32
+
+#define HOT_ROUTE_NEW() \
+	void* operator new(size_t _size)										{ void* p = hot_alloc::allocate(_size); if (!p) throw std::bad_alloc(); return p; }\
+	void* operator new[](size_t _size)										{ void* p = hot_alloc::allocate(_size); if (!p) throw std::bad_alloc(); return p; }\
+	void* operator new(size_t _size, std::align_val_t _align)				{ void* p = hot_alloc::allocate(_size, CASTTO(size_t, _align)); if (!p) throw std::bad_alloc(); return p; }\
+	void* operator new[](size_t _size, std::align_val_t _align)				{ void* p = hot_alloc::allocate(_size, CASTTO(size_t, _align)); if (!p) throw std::bad_alloc(); return p; }\
+	void* operator new(size_t _size, const std::nothrow_t&) noexcept		{ return hot_alloc::allocate(_size); }\
+	void* operator new[](size_t _size, const std::nothrow_t&) noexcept		{ return hot_alloc::allocate(_size); }\
+	void operator delete(void* _ptr) noexcept								{ hot_alloc::deallocate(_ptr); }\
+	void operator delete[](void* _ptr) noexcept								{ hot_alloc::deallocate(_ptr); }\
+	void operator delete(void* _ptr, size_t) noexcept						{ hot_alloc::deallocate(_ptr); }\
+	void operator delete[](void* _ptr, size_t) noexcept						{ hot_alloc::deallocate(_ptr); }\
+	void operator delete(void* _ptr, std::align_val_t) noexcept				{ hot_alloc::deallocate(_ptr); }\
+	void operator delete[](void* _ptr, std::align_val_t) noexcept			{ hot_alloc::deallocate(_ptr); }\
+	void operator delete(void* _ptr, size_t, std::align_val_t) noexcept		{ hot_alloc::deallocate(_ptr); }\
+	void operator delete[](void* _ptr, size_t, std::align_val_t) noexcept	{ hot_alloc::deallocate(_ptr); }
+
+#else
+
+#define HOT_ROUTE_NEW()
+
+#endif
@@ -8,6 +8,8 @@
 #include <source_location>
 #include <stdexcept>
 
+#include "macros.h"		// includes print.h
+
 //
 // std funcs and classes
 //
@@ -34,6 +36,7 @@ do { \
 			msg += std::format(" | {}", __VA_ARGS__); \
 		} \
 		msg += "\n";  \
+		hot_log::flush(); /* get everything printed before this out first */ \
 		std::cerr << msg; \
 		throw stl::assert_error(msg); \
 	} \
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
 
 #include "macros.h"
 
@@ -23,15 +25,269 @@ struct sub_test_ctx_t
 };
 
 //
-// wrapper for our contexts so that we can store them in a single array rather than
-// all individually, also makes it so that our engine context only contains valid
-// subsystems so that we don't get confused with or have to check what's valid or not
+// scheduler subsystem context
 //
-struct subsystem_info_t
+struct sub_scheduler_ctx_t
 {
-	const char* name;
-	void*		data;			// cast to input_context_t*, etc.
-	// uint32_t	version;		// dont really need atm
+	// the index of the current frame
+	uint64_t (*frame)();
+
+	// seconds since the scheduler started
+	double (*time)();
+
+	// the fixed timestep in seconds, what on_fixed_update's are passed
+	float (*fixed_dt)();
+
+	// how far we are between the last fixed step and the next one, 0 to 1, for interpolating
+	float (*alpha)();
+};
+
+//
+// thread pool subsystem context
+//
+
+// how soon a task should run, workers always take the highest priority task they can find
+enum task_priority_t : uint8_t
+{
+	TASK_HIGH = 0,
+	TASK_NORMAL,
+	TASK_LOW,
+
+	TASK_PRIORITY_COUNT,
+};
+
+// a task, and a chunk of a parallel for, passed the data they were submitted with
+using task_fn_t	 = void(*)(void*);
+using range_fn_t = void(*)(void*, size_t, size_t);
+
+// a set of tasks that can be waited on together, owned by the engine
+struct task_group_t;
+
+//
+// the engine's thread pool, so that modules dont have to start their own threads
+//
+// everything is tagged with the module that submitted it, anything of a module's that is still
+// queued when it's unloaded is cancelled, and anything running is waited on, so a module should
+// wait on its groups in on_unload if it needs its tasks to finish
+//
+struct sub_thread_pool_ctx_t
+{
+	// queues a task, returns false if it couldn't be queued, _group can be null
+	bool (*submit)(module_context_t*, task_fn_t, void*, task_priority_t, task_group_t*);
+
+	// creates an empty group, and destroys one that has finished
+	task_group_t* (*create_group)(module_context_t*);
+	void		  (*destroy_group)(task_group_t*);
+
+	// blocks until every task in the group has run or been cancelled, helping out in the meantime
+	void (*wait)(task_group_t*);
+
+	// splits [0, count) into chunks of about grain (0 picks one for us) and runs them across
+	// the pool, blocking until they're all done
+	void (*parallel_for)(module_context_t*, size_t, size_t, range_fn_t, void*, task_priority_t);
+
+	// how many worker threads the pool has
+	uint32_t (*worker_count)();
+};
+
+//
+// dispatcher subsystem context
+//
+
+// a named channel of fixed size events, owned by the engine and kept across reloads
+struct event_channel_t;
+
+// what a channel does when it's full and someone publishes to it
+enum event_policy_t : uint8_t
+{
+	EVENT_DROP_NEWEST = 0,	// the publish fails, for events that the publisher can retry or coalesce
+	EVENT_DROP_OLDEST,		// the oldest queued event is dropped to make room, for events where only the latest matter
+};
+
+// a subscriber, passed its user data and every event published to the channel since the last tick
+using event_fn_t = void(*)(void*, const void*, size_t);
+
+//
+// typed event channels that modules can publish and subscribe to, see shared/events.h for a typed wrapper
+//
+// publishing copies the event into the channel's ring buffer, there's no lock or allocation, and
+// it can be done from any thread, once a tick the engine hands every subscriber everything that's
+// been published since the last tick as one contiguous batch
+//
+// a module's subscriptions are removed when it's unloaded, so a reloaded module has to subscribe again
+//
+struct sub_dispatcher_ctx_t
+{
+	// gets the channel with the given name, creating it with the given event size, capacity, and policy if
+	// it doesn't exist yet, returns null if it exists with a different event size
+	event_channel_t* (*channel)(const char*, uint32_t, uint32_t, event_policy_t);
+
+	// copies an event into the channel, returns false if it was full and the event was dropped
+	bool (*publish)(event_channel_t*, const void*);
+
+	// subscribes to a channel, returns the subscription's id, 0 if it failed
+	uint64_t (*subscribe)(module_context_t*, event_channel_t*, event_fn_t, void*);
+
+	// removes a subscription
+	void (*unsubscribe)(uint64_t);
+
+	// how many events are waiting to be delivered, so that publishers can back off before the channel fills
+	size_t (*pending)(event_channel_t*);
+};
+
+//
+// state subsystem context
+//
+
+// what happened to a block when it was acquired
+enum state_status_t : uint8_t
+{
+	STATE_NEW = 0,		// it didn't exist, so it's been created zeroed
+	STATE_KEPT,			// it's the same block we had before the reload, as we left it
+	STATE_UPGRADED,		// its size or version changed and the upgrade func moved it over
+	STATE_RESET,		// its size or version changed and there was no upgrade func, or it failed, so it's zeroed
+};
+
+// moves a block from its old layout to its new one, passed the old block, its size and version, then
+// the new zeroed block, its size and version, returns false to start again from a zeroed block
+using state_upgrade_fn_t = bool(*)(const void*, uint32_t, uint32_t, void*, uint32_t, uint32_t);
+
+//
+// memory owned by the engine that outlives a module's reloads, so that it can keep its caches,
+// pools, and indices warm rather than rebuilding them on every reload
+//
+// blocks are named per module, and a reloaded build that asks for a block with the same name, size,
+// and version gets back the same pointer, anything in a block has to live in the block though,
+// since pointers into the module's own heap or statics go with it
+//
+// the old build keeps its block until it's unloaded, so if the new build fails to load then the
+// old one carries on with it as if nothing happened
+//
+struct sub_state_ctx_t
+{
+	// gets the named block, creating it if it doesn't exist, or upgrading it if its size or
+	// version have changed, the upgrade func and status can be null, blocks are 64 byte aligned
+	void* (*acquire)(module_context_t*, const char*, uint32_t, uint32_t, state_upgrade_fn_t, state_status_t*);
+
+	// frees the named block for good, once every build that has it is unloaded
+	void (*release)(module_context_t*, const char*);
+};
+
+//
+// frame arena subsystem context
+//
+
+//
+// scratch memory that only lasts until the end of the current tick, for the strings, vectors, and
+// messages that modules build in on_update and throw away, see shared/frame.h for a pmr resource
+//
+// every thread gets its own arena so allocating is just bumping an offset, nothing is freed, the
+// whole lot is reset at the end of each tick, anything that doesn't fit goes to the heap and is
+// counted as an overflow against the module that asked for it
+//
+struct sub_frame_ctx_t
+{
+	// allocates the given size and alignment from the calling thread's arena, never null
+	void* (*alloc)(module_context_t*, size_t, size_t);
+
+	// how many bytes are left in the calling thread's arena before allocations start overflowing
+	size_t (*remaining)();
+};
+
+//
+// allocator subsystem context
+//
+
+//
+// the header in front of every allocation made through the allocator, shared so that a module
+// can tell its own allocations from the engine's, see shared/alloc.h
+//
+struct alloc_header_t
+{
+	// the id of the module it's counted against, 0 for the engine
+	uint32_t module;
+
+	// which size class it came from, or one of the ALLOC_CLASS_ values below
+	uint16_t size_class;
+
+	// how far the header is from the start of the memory it was carved from, for aligned allocations
+	uint16_t offset;
+
+	// the size that was asked for
+	uint64_t size;
+};
+
+// allocations too big or too aligned for our size classes, they go straight to the heap
+#define ALLOC_CLASS_LARGE 0xfffe
+
+// allocations a module made itself before it was given the allocator, only it can free them
+#define ALLOC_CLASS_LOCAL 0xffff
+
+//
+// the engine's allocator, so that memory can be handed across the engine and module boundary
+// and freed on the other side, rather than copied, since each module has its own runtime
+//
+// everything is counted against the module that allocated it until it's transferred, and whatever
+// a build still has allocated once it's unloaded is reported as a leak
+//
+struct sub_alloc_ctx_t
+{
+	// allocates the given size and alignment for the given module, null if it failed
+	void* (*alloc)(module_context_t*, size_t, size_t);
+
+	// frees something from alloc(), no matter who allocated it
+	void (*free)(void*);
+
+	// counts an allocation against another module from now on, null for the engine
+	void (*transfer)(void*, module_context_t*);
+
+	// how many bytes the given module has allocated right now
+	size_t (*live)(module_context_t*);
+};
+
+//
+// log subsystem context
+//
+
+//
+// the engine's logger, every module's prints go through it once its subsystem manager is
+// initialised, see shared/log.h, and are written out in order by a single thread, so prints
+// from different threads never interleave and printing never blocks on the console
+//
+// each thread queues its prints in its own ring buffer, when it's full they're dropped, or
+// we wait for room if the engine has been told to block, errors always wait
+//
+struct sub_log_ctx_t
+{
+	// gets the id for the given module's prints, and the level it prints at, which can change at any time
+	uint16_t (*source)(const char*, const std::atomic<uint8_t>**);
+
+	// queues a finished record, see log_record_t in shared/print.h
+	void (*submit)(const void*, size_t);
+
+	// blocks until everything queued so far has been written out
+	void (*flush)();
+
+	// changes the level the given module prints at, or the engine's if it's null
+	void (*set_level)(const char*, log_level_t);
+};
+
+//
+// modules subsystem context
+//
+
+//
+// lets a module call into the modules it depends on, see module_context_t::depends
+//
+// a module is always initialised after everything it depends on, and reloaded along with them,
+// so whatever it gets from here stays valid until its own on_unload, as long as it gets it again
+// in every on_load, it's only safe to use from on_load
+//
+struct sub_modules_ctx_t
+{
+	// gets the named export from the named module's current build, null if it isn't a module
+	// we said we depend on, or it doesn't export it
+	void* (*find)(module_context_t*, const char*, const char*);
 };
 
 //
@@ -43,11 +299,13 @@ struct subsystem_info_t
 //
 struct engine_context_t
 {
-	// array of all of our subsystems
-	subsystem_info_t* subsystems;
+	// all of our subsystems' contexts, indexed by their subsystem_type_t, null for any we dont
+	// provide, built once by the engine and shared by every module, see shared/subsystem.h
+	void* const* subsystems;
 
-	// the size of our subsystem array, aka how many we have
-	uint8_t subsystem_count;
+	// the size of our subsystem table, a module built against a longer list of subsystems
+	// than we were mustn't read past it
+	uint32_t subsystem_count;
 };
 
 //
@@ -61,6 +319,9 @@ extern engine_context_t g_engine;
 
 #endif
 
+// what a module that hasn't said what its on_update touches is assumed to touch, everything
+#define SUB_ACCESS_ALL (~0ull)
+
 //
 // module context
 //
@@ -93,16 +354,39 @@ struct module_context_t
 	// whether this context was successfully loaded and setup
 	bool loaded = false;
 
+	// assigned by the engine every time the module is loaded, tags everything the module hands to
+	// the engine's subsystems so that it can all be cleaned up when this build is unloaded
+	uint32_t id = 0;
+
 	// pointers to our modules functions
-	// todo : add arguments
+	// on_update is passed the seconds since its last update and the current frame index
 	bool (*CTX_INIT_FN)(engine_context_t*)	= nullptr;
-	void (*CTX_UPDATE_FN)()					= nullptr;
+	void (*CTX_UPDATE_FN)(float, uint64_t)	= nullptr;
 	void (*CTX_INPUT_FN)()					= nullptr;
 	bool (*CTX_UNLOAD_FN)()					= nullptr;
 
 	// optional funcs
 	void (*CTX_RELOAD_FN)() = nullptr;
 
+	// called at a fixed rate, passed the fixed timestep in seconds and the index of the step
+	void (*CTX_FIXED_FN)(float, uint64_t) = nullptr;
+
+	// how many frames go by between each of our on_update's, for modules that dont need
+	// updating every frame, they're passed the time since their last update so it still adds up
+	uint32_t tick_divisor = 1;
+
+	// which of the engine's subsystems our on_update reads and which it writes, as masks of
+	// SUB_MASK()s, modules that dont conflict are updated at the same time on the engine's workers,
+	// and one that writes something another reads or writes is updated after it if it's sorted
+	// after it by name, so their order is always the same
+	// leaving writes as SUB_ACCESS_ALL means we're updated on the main thread with nobody else running
+	uint64_t reads	= 0;
+	uint64_t writes = SUB_ACCESS_ALL;
+
+	// the names of the modules we call into, their file names without the extension, ending with
+	// a nullptr, we're only loaded once they all are, and we're reloaded whenever any of them are
+	const char* const* depends = nullptr;
+
 	// todo : add more functions as we create more hooks for functions
 
 
@@ -122,14 +406,22 @@ struct module_context_t
 		return false;
 	}
 
-	void on_update()
+	void on_update(float _dt, uint64_t _frame)
 	{
 		if (CTX_UPDATE_FN)
-			CTX_UPDATE_FN();
+			CTX_UPDATE_FN(_dt, _frame);
 		else
 			DO_ONCE(printerror(std::format("no {} for '{}'", TO_STRING(CTX_UPDATE_FN), name)));
 	}
 
+	void on_fixed_update(float _dt, uint64_t _step)
+	{
+		if (CTX_FIXED_FN)
+			CTX_FIXED_FN(_dt, _step);
+		else
+			DO_ONCE(printerror(std::format("no {} for '{}'", TO_STRING(CTX_FIXED_FN), name)));
+	}
+
 	void on_input()
 	{
 		if (CTX_INPUT_FN)
@@ -0,0 +1,92 @@
+//
+//	events.h | Finn Le Var
+//
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+
+#include "shared/context.h"		// includes shared/macros.h
+
+//
+// a typed handle to one of the dispatcher's channels, so that modules publish and subscribe
+// with their own event types rather than void pointers and sizes
+//
+// events are copied byte for byte into the channel and handed to subscribers as an array,
+// so they have to be trivially copyable, and shouldn't point into the module that sent them
+// since the subscriber may not see them until after that module is reloaded
+//
+template<typename event_t>
+struct channel_t
+{
+	static_assert(std::is_trivially_copyable_v<event_t>, "events are copied byte for byte, they must be trivially copyable");
+	static_assert(alignof(event_t) <= alignof(std::max_align_t), "events cant be over aligned");
+
+	sub_dispatcher_ctx_t* dispatcher = nullptr;
+	event_channel_t*	  channel	 = nullptr;
+
+	//
+	// gets the channel with the given name, creating it if it doesn't exist, returns false if it
+	// already exists with a different event type
+	//
+	bool open(sub_dispatcher_ctx_t* _dispatcher, const char* _name, uint32_t _capacity = 4096, event_policy_t _policy = EVENT_DROP_NEWEST)
+	{
+		dispatcher = _dispatcher;
+		channel	   = dispatcher ? dispatcher->channel(_name, sizeof(event_t), _capacity, _policy) : nullptr;
+
+		return channel != nullptr;
+	}
+
+	//
+	// publishes an event, returns false if the channel was full and it was dropped
+	//
+	bool publish(const event_t& _event) const
+	{
+		return channel && dispatcher->publish(channel, &_event);
+	}
+
+	//
+	// subscribes the given func, which is passed every event published since the last tick,
+	// returns the subscription's id, 0 if it failed
+	//
+	template<void (*_fn)(const event_t*, size_t)>
+	uint64_t subscribe(module_context_t* _mod) const
+	{
+		if (!channel)
+			return 0;
+
+		return dispatcher->subscribe(_mod, channel, [](void*, const void* _events, size_t _count)
+		{
+			_fn(CASTTO(const event_t*, _events), _count);
+		}, nullptr);
+	}
+
+	//
+	// removes a subscription from subscribe(), clearing the id so that it isn't removed twice
+	//
+	void unsubscribe(uint64_t& _id) const
+	{
+		if (_id && dispatcher)
+			dispatcher->unsubscribe(_id);
+
+		_id = 0;
+	}
+
+	//
+	// lets go of the channel, which the engine keeps, so that nothing is published to it after
+	// we've been unloaded
+	//
+	void close()
+	{
+		dispatcher = nullptr;
+		channel	   = nullptr;
+	}
+
+	//
+	// how many events are waiting to be delivered
+	//
+	size_t pending() const
+	{
+		return channel ? dispatcher->pending(channel) : 0;
+	}
+};
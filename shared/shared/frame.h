@@ -0,0 +1,54 @@
+//
+//	frame.h | Finn Le Var
+//
+#pragma once
+
+#include <memory_resource>
+#include <new>
+
+#include "shared/context.h"		// includes shared/macros.h
+
+//
+// a pmr memory resource over the engine's frame arenas, for building scratch containers in
+// on_update without touching the heap, eg.
+//
+//	frame_resource_t frame(g_subsystem.find<SUB_FRAME>(), g_mod);
+//	std::pmr::vector<int> scratch(&frame);
+//
+// deallocating does nothing, everything goes at the end of the tick, so containers using it
+// must not outlive the tick they were made in
+//
+class frame_resource_t : public std::pmr::memory_resource
+{
+private:
+
+	sub_frame_ctx_t*  m_frame = nullptr;
+	module_context_t* m_mod	  = nullptr;
+
+public:
+
+	frame_resource_t(sub_frame_ctx_t* _frame, module_context_t* _mod)
+		: m_frame(_frame), m_mod(_mod)
+	{
+	}
+
+private:
+
+	void* do_allocate(size_t _bytes, size_t _align) override
+	{
+		if (!m_frame)
+			throw std::bad_alloc();
+
+		return m_frame->alloc(m_mod, _bytes, _align);
+	}
+
+	void do_deallocate(void*, size_t, size_t) override
+	{
+		// freed at the end of the tick
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& _other) const noexcept override
+	{
+		return this == &_other;
+	}
+};
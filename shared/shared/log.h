@@ -0,0 +1,49 @@
+//
+//	log.h | Finn Le Var
+//
+#pragma once
+
+#include "shared/context.h"		// includes shared/macros.h and shared/print.h
+
+//
+// module side of the engine's logger, see sub_log_ctx_t
+//
+// the subsystem manager attaches us when it's initialised, so a module's prints are queued
+// with the engine from then on, anything printed before that, by module_load say, is written
+// straight out like it always was
+//
+#ifdef HOT_MOD
+
+namespace hot_log
+{
+	//
+	// sends our prints through the engine's logger under the given name
+	//
+	inline void attach(sub_log_ctx_t* _ctx, const char* _name)
+	{
+		if (!_ctx)
+			return;
+
+		const std::atomic<uint8_t>* level = nullptr;
+
+		g_source = _ctx->source(_name, &level);
+		g_level	 = level;
+		g_flush	 = _ctx->flush;
+		g_submit = _ctx->submit;
+	}
+
+	//
+	// goes back to printing straight out, after writing out anything we've queued
+	//
+	inline void detach()
+	{
+		flush();
+
+		g_submit = nullptr;
+		g_flush	 = nullptr;
+		g_level	 = nullptr;
+		g_source = LOG_SOURCE_ENGINE;
+	}
+}
+
+#endif
@@ -3,8 +3,10 @@
 //
 #pragma once
 
-// debug macro
+// debug macro, only on in debug builds, a module can define it itself before including anything to always have it
+#if !defined(HOT_DEBUG) && !defined(NDEBUG)
 #define HOT_DEBUG
+#endif
 
 // wrapper macro so that we can use multi line code underneath statements
 #define _macro(_code) do { _code; } while(0)
@@ -81,6 +83,13 @@ _class& operator=(const _class&) = delete;
 // putting these here as macros so that its easy to change them if we want
 // todo : should probably not use macros for the release version
 
+// for functions that we're exporting from our modules to the engine
+#ifdef _WIN32
+#define HOT_EXPORT extern "C" __declspec(dllexport)
+#else
+#define HOT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
 // the name of the load module func in our modules, the func that sets our module context for that module
 // todo : maybe rename to 'get'
 #define MOD_LOAD_FN		module_load
@@ -92,6 +101,7 @@ _class& operator=(const _class&) = delete;
 #define MOD_UPDATE_FN	on_update
 #define MOD_UNLOAD_FN	on_unload
 #define MOD_RELOAD_FN	on_reload		// optional
+#define MOD_FIXED_FN	on_fixed_update	// optional
 
 // the suffix of our functions for our context definition
 #define FN_SUFFIX _fn
@@ -102,6 +112,7 @@ _class& operator=(const _class&) = delete;
 #define CTX_UPDATE_FN	CONCAT(MOD_UPDATE_FN,	FN_SUFFIX)
 #define CTX_UNLOAD_FN	CONCAT(MOD_UNLOAD_FN,	FN_SUFFIX)
 #define CTX_RELOAD_FN	CONCAT(MOD_RELOAD_FN,	FN_SUFFIX)
+#define CTX_FIXED_FN	CONCAT(MOD_FIXED_FN,	FN_SUFFIX)
 
 //
 // print macros, including last so that it has access to all the above macros
@@ -0,0 +1,21 @@
+//
+//	modules.h | Finn Le Var
+//
+#pragma once
+
+#include "shared/context.h"		// includes shared/macros.h
+
+//
+// gets a typed export from one of the modules we depend on, see sub_modules_ctx_t
+//
+// the module has to be in our module_context_t::depends, otherwise we wouldn't be reloaded when
+// it is, and would be left calling into a build that's been unloaded
+//
+template<typename fn_t>
+fn_t find_export(sub_modules_ctx_t* _modules, module_context_t* _mod, const char* _module, const char* _symbol)
+{
+	if (!_modules)
+		return nullptr;
+
+	return RECAST(fn_t, _modules->find(_mod, _module, _symbol));
+}
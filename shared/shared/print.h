@@ -4,38 +4,360 @@
 #pragma once
 
 #include <iostream>
+#include <sstream>
 #include <format>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
 
 #define PRINT_PREFIX "hot"
 
+//
+// how important a print is, anything below the level it's compiled at, or the level its module
+// is set to at runtime, is skipped
+//
+enum log_level_t : uint8_t
+{
+	LOG_DEBUG = 0,
+	LOG_INFO,
+	LOG_ERROR,
+	LOG_OFF,
+};
+
+// the lowest level that's compiled in, anything below it compiles to nothing, arguments and all,
+// a module can define its own before including anything to change it for just that module
+#ifndef HOT_LOG_LEVEL
+#ifdef HOT_DEBUG
+#define HOT_LOG_LEVEL LOG_DEBUG
+#else
+#define HOT_LOG_LEVEL LOG_INFO
+#endif
+#endif
+
+// the most a single print can take up, header included, anything longer is cut short
+#define LOG_RECORD_SIZE 1024
+
+// the source that the engine's own prints come from
+#define LOG_SOURCE_ENGINE 0
+
+// the print didn't fit in a record and was cut short
+#define LOG_FLAG_TRUNCATED 0x1
+
+//
+// the start of every print, followed by its prefix and then its arguments, each a log_arg_t
+// and its value, strings are a 32 bit length then their characters
+//
+struct log_header_t
+{
+	// the whole record, header included
+	uint32_t size;
+
+	// who printed it, LOG_SOURCE_ENGINE or a module's id from sub_log_ctx_t::source
+	uint16_t source;
+
+	// its log_level_t, and LOG_FLAG_ values
+	uint8_t level;
+	uint8_t flags;
+
+	// where it comes in the order that everything was printed in, set by the engine
+	uint64_t seq;
+};
+
+//
+// the types of argument a record holds
+//
+enum log_arg_t : uint8_t
+{
+	LOG_ARG_STR = 0,
+	LOG_ARG_INT,
+	LOG_ARG_UINT,
+	LOG_ARG_FLOAT,
+	LOG_ARG_CHAR,
+	LOG_ARG_BOOL,
+	LOG_ARG_PTR,
+};
+
+//
+// a single print, built on the stack by the print macros
+//
+// the arguments are only copied in, not formatted, that's left for whoever writes it out, which
+// is usually the engine's logger thread, so a print costs about as much as the copies do, things
+// we dont know how to copy are formatted here with a string stream like they always were
+//
+class log_record_t
+{
+private:
+
+	alignas(8) std::byte m_data[LOG_RECORD_SIZE];
+
+	// how much of m_data we've used
+	uint32_t m_size = sizeof(log_header_t);
+
+public:
+
+	log_record_t(log_level_t _level, std::string_view _prefix)
+	{
+		header() = { .size = 0, .source = LOG_SOURCE_ENGINE, .level = _level, .flags = 0, .seq = 0 };
+
+		put_str(_prefix);
+	}
+
+	log_header_t&		header()	   { return *RECAST(log_header_t*, m_data); }
+	const log_header_t& header() const { return *RECAST(const log_header_t*, m_data); }
+
+	const void* data() const { return m_data; }
+	uint32_t	size() const { return m_size; }
+
+	//
+	// stamps the header once everything has been added
+	//
+	void finish(uint16_t _source)
+	{
+		header().size	= m_size;
+		header().source = _source;
+	}
+
+	//
+	// adds an argument
+	//
+	template<typename type_t>
+	log_record_t& operator<<(const type_t& _arg)
+	{
+		using arg_t = std::remove_cvref_t<type_t>;
+
+		// the same overloads std::ostream would have picked, so that everything prints the same
+		if constexpr (std::is_same_v<arg_t, bool>)
+			put(LOG_ARG_BOOL, CASTTO(uint8_t, _arg));
+		else if constexpr (std::is_same_v<arg_t, char> || std::is_same_v<arg_t, signed char> || std::is_same_v<arg_t, unsigned char>)
+			put(LOG_ARG_CHAR, CASTTO(char, _arg));
+		else if constexpr (std::is_integral_v<arg_t> && std::is_signed_v<arg_t>)
+			put(LOG_ARG_INT, CASTTO(int64_t, _arg));
+		else if constexpr (std::is_integral_v<arg_t>)
+			put(LOG_ARG_UINT, CASTTO(uint64_t, _arg));
+		else if constexpr (std::is_same_v<arg_t, float> || std::is_same_v<arg_t, double>)
+			put(LOG_ARG_FLOAT, CASTTO(double, _arg));
+		else if constexpr (std::is_same_v<arg_t, const char*> || std::is_same_v<arg_t, char*>)
+			put_str(_arg ? std::string_view(_arg) : std::string_view("(null)"));
+		else if constexpr (std::is_convertible_v<const arg_t&, std::string_view>)
+			put_str(std::string_view(_arg));
+		else if constexpr (std::is_pointer_v<arg_t>)
+			put(LOG_ARG_PTR, RECAST(uintptr_t, _arg));
+		else
+		{
+			std::ostringstream out;
+			out << _arg;
+
+			put_str(out.view());
+		}
+
+		return *this;
+	}
+
+private:
+
+	//
+	// adds a fixed size argument
+	//
+	template<typename value_t>
+	void put(log_arg_t _type, value_t _value)
+	{
+		if (m_size + 1 + sizeof(value_t) > LOG_RECORD_SIZE)
+		{
+			header().flags |= LOG_FLAG_TRUNCATED;
+			return;
+		}
+
+		m_data[m_size] = CASTTO(std::byte, _type);
+		std::memcpy(m_data + m_size + 1, &_value, sizeof(value_t));
+
+		m_size += 1 + sizeof(value_t);
+	}
+
+	//
+	// adds a string, as much of it as fits
+	//
+	void put_str(std::string_view _str)
+	{
+		if (m_size + 1 + sizeof(uint32_t) > LOG_RECORD_SIZE)
+		{
+			header().flags |= LOG_FLAG_TRUNCATED;
+			return;
+		}
+
+		uint32_t len = CASTTO(uint32_t, std::min<size_t>(_str.size(), LOG_RECORD_SIZE - m_size - 1 - sizeof(uint32_t)));
+
+		if (len < _str.size())
+			header().flags |= LOG_FLAG_TRUNCATED;
+
+		m_data[m_size] = CASTTO(std::byte, LOG_ARG_STR);
+		std::memcpy(m_data + m_size + 1, &len, sizeof(len));
+		std::memcpy(m_data + m_size + 1 + sizeof(len), _str.data(), len);
+
+		m_size += 1 + sizeof(len) + len;
+	}
+};
+
+//
+// where prints go
+//
+namespace hot_log
+{
+	//
+	// reads a value out of a record
+	//
+	template<typename value_t>
+	value_t read(const std::byte*& _pos)
+	{
+		value_t value;
+		std::memcpy(&value, _pos, sizeof(value_t));
+
+		_pos += sizeof(value_t);
+
+		return value;
+	}
+
+	//
+	// formats a record as a line, something like "[mod][debug] our message", _source is empty for the engine
+	//
+	inline void format(std::ostream& _out, const log_header_t* _record, std::string_view _source)
+	{
+		auto pos = RECAST(const std::byte*, _record) + sizeof(log_header_t);
+		auto end = RECAST(const std::byte*, _record) + _record->size;
+
+		_out << "[";
+
+		if (!_source.empty())
+			_out << _source << "][";
+
+		// the first argument is always the prefix
+		for (bool prefix = true; pos < end; prefix = false)
+		{
+			switch (CASTTO(log_arg_t, *pos++))
+			{
+			case LOG_ARG_STR:
+			{
+				uint32_t len = read<uint32_t>(pos);
+
+				_out << std::string_view(RECAST(const char*, pos), len);
+				pos += len;
+
+				break;
+			}
+			case LOG_ARG_INT:	_out << read<int64_t>(pos);							 break;
+			case LOG_ARG_UINT:	_out << read<uint64_t>(pos);						 break;
+			case LOG_ARG_FLOAT: _out << read<double>(pos);							 break;
+			case LOG_ARG_CHAR:	_out << read<char>(pos);							 break;
+			case LOG_ARG_BOOL:	_out << CASTTO(bool, read<uint8_t>(pos));			 break;
+			case LOG_ARG_PTR:	_out << RECAST(const void*, read<uintptr_t>(pos));	 break;
+			default:			pos = end;											 break;
+			}
+
+			if (prefix)
+				_out << "] ";
+		}
+
+		if (_record->flags & LOG_FLAG_TRUNCATED)
+			_out << "...";
+
+		_out << "\n";
+	}
+
+	//
+	// writes a record out straight away on the calling thread, for when there's no logger to queue it with
+	//
+	inline void write(const log_header_t* _record, std::string_view _source)
+	{
+		std::ostringstream out;
+
+		format(out, _record, _source);
+
+		(_record->level >= LOG_ERROR ? std::cerr : std::cout) << out.view();
+	}
 
 #ifndef HOT_MOD // engine prints
 
-#define printprefix(_msg, _prefix)	_macro( std::cout << "[" << _prefix << "] " << _msg << "\n"; )
-#define printerror(_msg)			_macro( std::cerr << "[error] " << _msg << "\n"; )
-#define printmsg(_msg)				printprefix(_msg, PRINT_PREFIX)
-#define printdebug(_msg)			printprefix(_msg, "debug")
-#define printfunc(_msg)				printmsg(std::format("{} | ", __FUNCTION__) << _msg)
-#define printerrorfunc(_msg)		printerror(std::format("{} | ", __FUNCTION__) << _msg)
+	// the level the engine prints at, see logger_t
+	extern std::atomic<uint8_t> g_engine_level;
 
-// prints and returns out of the current function
-#define printerret(_ret, _msg)		_macro( printerrorfunc(_msg); return _ret; )
+	inline bool enabled(log_level_t _level)
+	{
+		return _level >= g_engine_level.load(std::memory_order_relaxed);
+	}
 
+	//
+	// queues a record with the engine's logger, see hotrod/logger.cpp
+	//
+	void submit(log_record_t& _record);
+
+	//
+	// blocks until everything printed so far has been written out
+	//
+	void flush();
 
 #else // module prints
 
+	//
+	// the engine's logger, handed to us by attach() in shared/log.h, until then we print straight out
+	//
+	inline void (*g_submit)(const void*, size_t)	= nullptr;
+	inline void (*g_flush)()						= nullptr;
+	inline const std::atomic<uint8_t>* g_level		= nullptr;
+	inline uint16_t g_source						= LOG_SOURCE_ENGINE;
+
+	inline bool enabled(log_level_t _level)
+	{
+		return !g_level || _level >= g_level->load(std::memory_order_relaxed);
+	}
+
+	inline void submit(log_record_t& _record)
+	{
+		_record.finish(g_source);
+
+		if (g_submit)
+			g_submit(_record.data(), _record.size());
+		else
+			write(&_record.header(), HOT_MOD);
+	}
+
+	inline void flush()
+	{
+		if (g_flush)
+			g_flush();
+	}
+
+#endif
+}
+
+//
+// prints for the engine and our modules, something like "[debug] our message" for the engine
+// and "[mod][debug] our message" for a module
 //
-// prints for our modules, will print something like "[mod][debug] our message"
+// levels below HOT_LOG_LEVEL compile to nothing, and the rest are checked against the level the
+// engine or module is set to at runtime before anything is evaluated
 //
+#define printlog(_level, _prefix, _msg)\
+_macro(\
+	if constexpr ((_level) >= HOT_LOG_LEVEL)\
+	{\
+		if (hot_log::enabled(_level))\
+		{\
+			log_record_t _record(_level, _prefix);\
+			_record << _msg;\
+			hot_log::submit(_record);\
+		}\
+	}\
+)
 
-#define printprefix(_msg, _prefix)	_macro( std::cout << "[" << HOT_MOD << "][" << _prefix << "] " << _msg << "\n"; )
-#define printerror(_msg)			_macro( std::cerr << "[" << HOT_MOD << "][error] " << _msg << "\n"; )
+#define printprefix(_msg, _prefix)	printlog(LOG_INFO, _prefix, _msg)
+#define printerror(_msg)			printlog(LOG_ERROR, "error", _msg)
 #define printmsg(_msg)				printprefix(_msg, PRINT_PREFIX)
-#define printdebug(_msg)			printprefix(_msg, "debug")
+#define printdebug(_msg)			printlog(LOG_DEBUG, "debug", _msg)
 #define printfunc(_msg)				printmsg(std::format("{} | ", __FUNCTION__) << _msg)
 #define printerrorfunc(_msg)		printerror(std::format("{} | ", __FUNCTION__) << _msg)
 
 // prints and returns out of the current function
 #define printerret(_ret, _msg)		_macro( printerrorfunc(_msg); return _ret; )
-
-#endif
@@ -0,0 +1,26 @@
+//
+//	state.h | Finn Le Var
+//
+#pragma once
+
+#include <type_traits>
+
+#include "shared/context.h"		// includes shared/macros.h
+
+//
+// gets a typed block of persistent state, see sub_state_ctx_t
+//
+// the block is copied byte for byte when it's kept across a reload, and zeroed when it's new, so
+// the type has to be trivially copyable, bump _version whenever its layout changes
+//
+template<typename state_t>
+state_t* acquire_state(sub_state_ctx_t* _state, module_context_t* _mod, const char* _name, uint32_t _version, state_upgrade_fn_t _upgrade = nullptr, state_status_t* _status = nullptr)
+{
+	static_assert(std::is_trivially_copyable_v<state_t>, "state is kept byte for byte across reloads, it must be trivially copyable");
+	static_assert(alignof(state_t) <= 64, "state blocks are only 64 byte aligned");
+
+	if (!_state)
+		return nullptr;
+
+	return CASTTO(state_t*, _state->acquire(_mod, _name, sizeof(state_t), _version, _upgrade, _status));
+}
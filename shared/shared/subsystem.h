@@ -4,23 +4,69 @@
 #pragma once
 
 #include "shared/context.h"		// includes shared/macros.h and shared/print.h
-
-#include <unordered_map>
-#include <utility>
+#include "shared/log.h"
 
 //
-// all of our different types of subsystems
+// all of our different types of subsystems, also their index in the engine's subsystem table
 //
 enum subsystem_type_t : int
 {
 	SUB_UNKNOWN = 0,
 	SUB_TEST,
-
-	// todo, just for testing
+	SUB_SCHEDULER,
 	SUB_THREAD_POOL,
 	SUB_DISPATCHER,
+	SUB_STATE,
+	SUB_FRAME,
+	SUB_ALLOC,
+	SUB_LOG,
+	SUB_MODULES,
+
+	SUB_COUNT,
 };
 
+// a subsystem's bit in module_context_t's reads and writes
+#define SUB_MASK(_type) (1ull << (_type))
+
+// where the bits for data that modules share between themselves rather than through the engine start, and how
+// many there are, fixed so that adding a subsystem never moves them out from under a module that's already built
+#define SUB_USER_FIRST 32
+#define SUB_USER_COUNT 32
+
+static_assert(SUB_COUNT <= SUB_USER_FIRST, "too many subsystems, they've run into the user bits");
+
+namespace hot_sub
+{
+	//
+	// the given user bit, out of range is a compile error
+	//
+	template<int _index>
+	constexpr uint64_t user_mask()
+	{
+		static_assert(_index >= 0 && _index < SUB_USER_COUNT, "SUB_MASK_USER index out of range");
+
+		return 1ull << (SUB_USER_FIRST + _index);
+	}
+
+	//
+	// the given user bit for an index only known at runtime, out of range gives every user bit,
+	// so that the module conflicts with everything that uses one rather than with nothing
+	//
+	constexpr uint64_t user_mask_at(int _index)
+	{
+		if (_index < 0 || _index >= SUB_USER_COUNT)
+			return ~0ull << SUB_USER_FIRST;
+
+		return 1ull << (SUB_USER_FIRST + _index);
+	}
+}
+
+// a user bit, for an index that's a constant
+#define SUB_MASK_USER(_index) (hot_sub::user_mask<(_index)>())
+
+// a user bit, for an index that's worked out at runtime
+#define SUB_MASK_USER_AT(_index) (hot_sub::user_mask_at(CASTTO(int, _index)))
+
 //
 // returns the string value for the given subsystem type
 //
@@ -29,12 +75,62 @@ inline const char* to_string(subsystem_type_t _type)
 	switch (_type)
 	{
 	case SUB_TEST:			return "SUB_TEST";
+	case SUB_SCHEDULER:		return "SUB_SCHEDULER";
 	case SUB_THREAD_POOL:	return "SUB_THREAD_POOL";
 	case SUB_DISPATCHER:	return "SUB_DISPATCHER";
+	case SUB_STATE:			return "SUB_STATE";
+	case SUB_FRAME:			return "SUB_FRAME";
+	case SUB_ALLOC:			return "SUB_ALLOC";
+	case SUB_LOG:			return "SUB_LOG";
+	case SUB_MODULES:		return "SUB_MODULES";
 	default:				return "unknown";
 	}
 }
 
+//
+// ties each subsystem type to its context, so that asking for a subsystem by its type
+// gives back the right pointer type without anyone having to name it
+//
+template<subsystem_type_t _type>
+struct subsystem_ctx;
+
+#define SUBSYSTEM_CTX(_type, _ctx) template<> struct subsystem_ctx<_type> { using type = _ctx; };
+
+SUBSYSTEM_CTX(SUB_TEST,			sub_test_ctx_t)
+SUBSYSTEM_CTX(SUB_SCHEDULER,	sub_scheduler_ctx_t)
+SUBSYSTEM_CTX(SUB_THREAD_POOL,	sub_thread_pool_ctx_t)
+SUBSYSTEM_CTX(SUB_DISPATCHER,	sub_dispatcher_ctx_t)
+SUBSYSTEM_CTX(SUB_STATE,		sub_state_ctx_t)
+SUBSYSTEM_CTX(SUB_FRAME,		sub_frame_ctx_t)
+SUBSYSTEM_CTX(SUB_ALLOC,		sub_alloc_ctx_t)
+SUBSYSTEM_CTX(SUB_LOG,			sub_log_ctx_t)
+SUBSYSTEM_CTX(SUB_MODULES,		sub_modules_ctx_t)
+
+template<subsystem_type_t _type>
+using subsystem_ctx_t = typename subsystem_ctx<_type>::type;
+
+//
+// the engine's subsystem table, built at compile time by the engine and shared with every module
+// through engine_context_t, so there's nothing to build or look up by name at load time
+//
+// set() only takes the context type that belongs to the given subsystem, so the table can't
+// hold the wrong thing at the wrong index
+//
+struct subsystem_table_t
+{
+	void* entries[SUB_COUNT] = {};
+
+	template<subsystem_type_t _type>
+	constexpr subsystem_table_t& set(subsystem_ctx_t<_type>* _ctx)
+	{
+		static_assert(_type > SUB_UNKNOWN && _type < SUB_COUNT, "invalid subsystem type");
+
+		entries[_type] = _ctx;
+
+		return *this;
+	}
+};
+
 //
 // subsystem manager for our modules
 //
@@ -45,9 +141,6 @@ private:
 	// our engine context
 	engine_context_t* m_engine = nullptr;
 
-	// list of all of our subsystems as raw void pointers
-	std::unordered_map<std::string, void*> m_subsystems;
-
 	// whether our manager has been initialised
 	bool m_init = false;
 
@@ -63,27 +156,20 @@ public:
 	//
 	void init(engine_context_t* _engine)
 	{
-		if (m_init)
-			printerret(; , "subsystem manager already initialised");
+		if (!_engine)
+			printerret(;, "no engine context given");
 
+		// a reloaded build gets a fresh manager, but the same module could be handed a new engine context
 		m_engine = _engine;
+		m_init	 = true;
 
-		printdebug("parsing subsystems");
-
-		// iterate over them all
-		for (int i = 0; std::cmp_less(i, m_engine->subsystem_count); ++i)
-		{
-			subsystem_info_t& subsystem = m_engine->subsystems[i];
-
-			printdebug("+    " << subsystem.name);
-
-			// store our subsystem
-			m_subsystems.emplace(subsystem.name, subsystem.data);
-		}
-
-		m_init = true;
+#ifdef HOT_MOD
+		// queue our prints with the engine's logger from here on, quietly, since an older engine might not have one
+		if (CASTTO(uint32_t, SUB_LOG) < m_engine->subsystem_count && m_engine->subsystems[SUB_LOG])
+			hot_log::attach(CASTTO(sub_log_ctx_t*, m_engine->subsystems[SUB_LOG]), HOT_MOD);
+#endif
 
-		printdebug("subsystem manager initialised");
+		printdebug("subsystem manager initialised with " << m_engine->subsystem_count << " subsystem slot(s)");
 	}
 
 	//
@@ -91,59 +177,68 @@ public:
 	//
 	void cleanup()
 	{
-		m_subsystems.clear();
+#ifdef HOT_MOD
+		hot_log::detach();
+#endif
 
 		m_engine = nullptr;
+		m_init	 = false;
 	}
 
 	//
-	// gets the given subsystem as a raw void pointer
+	// gets the given subsystem as a raw void pointer, a single index into the engine's table
 	//
 	void* get_raw(subsystem_type_t _type) const
 	{
-		if (m_subsystems.empty())
-			printerret(nullptr, "subsystem cache is empty");
+		if (!m_engine)
+			printerret(nullptr, "subsystem manager isn't initialised");
 
-		if (_type == SUB_UNKNOWN)
-			printerret(nullptr, "unknown subsystem name given");
+		if (_type <= SUB_UNKNOWN || CASTTO(uint32_t, _type) >= m_engine->subsystem_count)
+			printerret(nullptr, "unknown subsystem given");
 
-		const auto& it = m_subsystems.find(to_string(_type));
+		void* subsystem = m_engine->subsystems[_type];
 
-		if (it == m_subsystems.end())
+		if (!subsystem)
 			printerret(nullptr, "subsystem '" << to_string(_type) << "' does not exist");
 
-		return it->second;
+		return subsystem;
 	}
 
 	//
-	// finds and returns the subsystem with the given name from our list of cached subsystems
+	// gets the given subsystem's context
+	//
+	// the engine's contexts live as long as it does, so the pointer can be kept around for as
+	// long as the module is loaded rather than looked up every time
 	//
-	template<typename subsys_t>
-	subsys_t* find(subsystem_type_t _type)
+	template<subsystem_type_t _type>
+	subsystem_ctx_t<_type>* find() const
 	{
-		return CASTTO(subsys_t*, get_raw(_type));
+		return CASTTO(subsystem_ctx_t<_type>*, get_raw(_type));
 	}
 
-
 	//
 	// prints the names of all of our subsystems
 	//
-	void dump()
+	void dump() const
 	{
+		if (!m_engine)
+			printerret(;, "subsystem manager isn't initialised");
+
 		printdebug("dumping subsystems...");
 
-		for (const auto& [ name, sub ] : m_subsystems)
+		for (uint32_t i = SUB_UNKNOWN + 1; i < m_engine->subsystem_count; ++i)
 		{
-			printdebug("+    " << name);
+			if (m_engine->subsystems[i])
+				printdebug("+    " << to_string(CASTTO(subsystem_type_t, i)));
 		}
 	}
 
 
-	
+
 	// make this class a singleton
 	MAKE_SINGLETON(subsystem_manager_t);
 
 };
 
 // create our alias var
-MAKE_SINGLETON_ALIAS(subsystem_manager_t, subsystem)
\ No newline at end of file
+MAKE_SINGLETON_ALIAS(subsystem_manager_t, subsystem)